@@ -0,0 +1,205 @@
+#version 460 core
+//NOTE - 分簇前向渲染，见 clustered_lighting.h
+//灯光数组中前globalLightNum个是日光，对所有片元生效；其余的灯光只在所在格子的列表中出现
+//阴影从共享的深度图集中采样，见 shadow_atlas.h
+
+//input
+in VS_OUT{
+    vec3 globalPos;
+    vec3 globalNormal;
+    vec2 texCoord;
+    vec3 globalTangent;
+    vec3 globalBitangent;
+    mat3 TBN;
+}fs_in;
+flat in uint debugOccluded;//GPU剔除判定为被遮挡的实例，见 gpu_culling.h
+
+struct Light{
+    int lightType;
+    vec3 color;
+    float intensity;
+    vec3 position,rotation;
+    float innerCutOff,outerCutOff;// for spot light
+    float range;
+    int shadowIndex;//第一条阴影记录，-1表示没有阴影，见 shadow_atlas.h
+    float padding;
+};
+
+layout(std140,binding=1)uniform ClusterParams{
+    uvec4 gridSize;//xyz：格子数，w：日光数
+    vec4 depthParams;//near, far, sliceScale, sliceBias
+    vec4 viewportSize;
+};
+layout(std430,binding=2)readonly buffer ClusterLights{
+    Light lights[];
+};
+layout(std430,binding=3)readonly buffer ClusterRanges{
+    uvec2 clusterRanges[];//(起点, 数量)
+};
+layout(std430,binding=4)readonly buffer ClusterLightIndices{
+    uint lightIndices[];
+};
+
+//阴影图集：聚光一条记录，点光6条（+X,-X,+Y,-Y,+Z,-Z），日光每个级联一条
+struct ShadowRecord{
+    mat4 viewProjection;
+    vec4 atlasRect;//xy：起点，zw：大小（UV）
+    vec4 cascade;//日光：xy：级联覆盖的观察空间深度[near, far)，z：级联数
+};
+layout(std430,binding=5)readonly buffer ShadowRecords{
+    ShadowRecord shadowRecords[];
+};
+layout(binding=15)uniform sampler2DShadow shadowAtlas;
+
+//每一级末尾的这一部分和下一级混合，避免级联交界处出现接缝
+#define CASCADE_BLEND_RATIO 0.1
+
+//texture
+uniform sampler2D texture_diffuse0;
+uniform sampler2D texture_specular0;
+uniform sampler2D texture_normal0;
+uniform samplerCube skybox;
+uniform vec3 cameraPos;
+
+//output
+out vec4 fragColor;
+
+vec3 Lighting(uint i);
+float getViewDepth();
+uint getClusterIndex();
+float calculateShadow(uint i,vec3 dirToLight);
+float sampleShadow(int recordIndex,vec3 dirToLight);
+
+void main(){
+    vec3 outputColor=vec3(0.f);
+    for(uint i=0;i<gridSize.w;i++){
+        outputColor+=Lighting(i);
+    }
+    uvec2 range=clusterRanges[getClusterIndex()];
+    for(uint i=0;i<range.y;i++){
+        outputColor+=Lighting(lightIndices[range.x+i]);
+    }
+
+    //ambient加上一个随视角的改变，正视的时候强度小，斜视强度大
+    vec3 ambient=texture(skybox,reflect(fs_in.globalPos-cameraPos,fs_in.globalNormal)).xyz;
+    vec3 fragToCamera=normalize(cameraPos-fs_in.globalPos);
+    float fr=pow(1-max(dot(fragToCamera,fs_in.globalNormal),0.f),8);
+
+    fragColor=vec4(outputColor+ambient*fr,1.f);
+    if(debugOccluded!=0u){
+        fragColor.rgb=mix(fragColor.rgb,vec3(1.,0.,0.),.6);
+    }
+}
+
+float getViewDepth(){
+    //从深度缓冲的值还原观察空间深度
+    float near=depthParams.x,far=depthParams.y;
+    float zNdc=gl_FragCoord.z*2.-1.;
+    return 2.*near*far/(far+near-zNdc*(far-near));
+}
+
+uint getClusterIndex(){
+    float depth=getViewDepth();
+
+    uint slice=uint(clamp(floor(log(depth)*depthParams.z-depthParams.w),0.,float(gridSize.z-1)));
+    uvec2 tile=uvec2(clamp(gl_FragCoord.xy/viewportSize.xy*vec2(gridSize.xy),
+    vec2(0.),vec2(gridSize.xy-1)));
+    return tile.x+gridSize.x*(tile.y+gridSize.y*slice);
+}
+
+vec3 Lighting(uint i){
+    vec3 dispToLight=lights[i].position-fs_in.globalPos;
+    vec3 dirToLight=normalize(dispToLight);
+    if(lights[i].lightType==1){
+        //日光
+        dirToLight=-normalize(lights[i].rotation);
+    }
+    vec3 viewDir=normalize(cameraPos-fs_in.globalPos);
+
+    //光源衰减，和CPU上计算影响范围时用的衰减一致
+    float lightDistDropoff=1;
+    if(lights[i].lightType!=1){
+        //日光，不计算距离
+        float lightDistSq=max(dot(dispToLight,dispToLight),1e-4);
+        lightDistDropoff=1/lightDistSq;
+    }
+    // 聚光灯裁切
+    float spotLightCutOff=1;
+    if(lights[i].lightType==2){
+        spotLightCutOff=dot(-dirToLight,normalize(lights[i].rotation));
+        float cutOffRange=lights[i].innerCutOff-lights[i].outerCutOff;
+        spotLightCutOff=clamp((spotLightCutOff-lights[i].outerCutOff)/cutOffRange,0.f,1.f);
+    }
+
+    //diffusion
+    float diffuseFac=max(dot(dirToLight,fs_in.globalNormal),0.f);
+    vec3 diffuseColor=lights[i].color*texture(texture_diffuse0,fs_in.texCoord).rgb;
+    vec3 diffuse=diffuseColor*diffuseFac;
+
+    //specular
+    vec3 halfVec=normalize(dirToLight+viewDir);
+    float specularFac=pow(max(dot(halfVec,fs_in.globalNormal),0.f),64);
+    vec3 specularColor=texture(texture_diffuse0,fs_in.texCoord).rgb*lights[i].color;
+    vec3 specular=specularColor*specularFac;
+
+    //shadow
+    float shadow=calculateShadow(i,dirToLight);
+
+    //combine
+    return(diffuse+specular)*lights[i].intensity*lightDistDropoff*spotLightCutOff*shadow;
+}
+
+//返回可见度，1为完全照亮
+float calculateShadow(uint i,vec3 dirToLight){
+    int recordIndex=lights[i].shadowIndex;
+    if(recordIndex<0){
+        return 1.;
+    }
+    if(lights[i].lightType==1){
+        //日光：按观察空间深度选择级联
+        float depth=getViewDepth();
+        int cascadeNum=int(shadowRecords[recordIndex].cascade.z);
+        for(int c=0;c<cascadeNum;c++){
+            vec4 cascade=shadowRecords[recordIndex+c].cascade;
+            if(depth>=cascade.y){
+                continue;
+            }
+            float shadow=sampleShadow(recordIndex+c,dirToLight);
+            float blendStart=cascade.y-(cascade.y-cascade.x)*CASCADE_BLEND_RATIO;
+            if(c+1<cascadeNum&&depth>blendStart){
+                float t=(depth-blendStart)/(cascade.y-blendStart);
+                shadow=mix(shadow,sampleShadow(recordIndex+c+1,dirToLight),t);
+            }
+            return shadow;
+        }
+        return 1.;//超出最后一级
+    }
+    if(lights[i].lightType!=2){
+        //点光：按光源指向片元方向的主轴选择立方体的面
+        vec3 d=fs_in.globalPos-lights[i].position;
+        vec3 a=abs(d);
+        int face=(a.x>=a.y&&a.x>=a.z)?(d.x>0.?0:1):(a.y>=a.z?(d.y>0.?2:3):(d.z>0.?4:5));
+        recordIndex+=face;
+    }
+    return sampleShadow(recordIndex,dirToLight);
+}
+
+float sampleShadow(int recordIndex,vec3 dirToLight){
+    ShadowRecord record=shadowRecords[recordIndex];
+
+    //沿法线偏移，掠射角越大偏移越多
+    float cosTheta=clamp(dot(fs_in.globalNormal,dirToLight),0.,1.);
+    vec3 biasedPos=fs_in.globalPos+fs_in.globalNormal*0.02*(1.-cosTheta);
+    vec4 clipPos=record.viewProjection*vec4(biasedPos,1.);
+    vec3 ndc=clipPos.xyz/clipPos.w;
+    if(clipPos.w<=0.||ndc.z>1.){
+        return 1.;//在灯光的远平面之外
+    }
+    vec3 uvz=ndc*.5+.5;
+
+    //限制在自己的tile内，留半个texel，避免采到相邻tile
+    vec2 halfTexel=.5/vec2(textureSize(shadowAtlas,0));
+    vec2 uv=clamp(uvz.xy,vec2(0.),vec2(1.))*record.atlasRect.zw+record.atlasRect.xy;
+    uv=clamp(uv,record.atlasRect.xy+halfTexel,record.atlasRect.xy+record.atlasRect.zw-halfTexel);
+    return texture(shadowAtlas,vec3(uv,uvz.z));
+}
@@ -0,0 +1,129 @@
+#version 460 core
+//NOTE - GPU剔除，见 gpu_culling.h
+//每个线程处理一个候选实例：视锥剔除 -> Hi-Z遮挡剔除，通过的实例追加到所属命令的实例索引区间
+layout(local_size_x=64)in;
+
+struct DrawData{
+    vec4 dequantOffset;
+    vec4 dequantScale;
+    uvec4 instance;//x：在instanceIndices中的起始位置
+    vec4 boundsMin;//模型空间包围盒
+    vec4 boundsMax;
+};
+struct DrawCommand{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430,binding=0)readonly buffer InstanceTransforms{
+    mat4 transforms[];
+};
+layout(std430,binding=1)writeonly buffer InstanceIndices{
+    uint instanceIndices[];
+};
+layout(std430,binding=6)readonly buffer IndirectDrawData{
+    DrawData drawData[];
+};
+layout(std430,binding=7)readonly buffer CullingCandidates{
+    uvec2 candidates[];//x：槽位，y：命令
+};
+layout(std430,binding=8)buffer DrawCommands{
+    DrawCommand commands[];
+};
+layout(std430,binding=9)buffer CullingCounters{
+    uint frustumCulled;
+    uint occluded;
+    uint visible;
+};
+layout(binding=14)uniform sampler2D hiZ;
+
+uniform int candidateNum;
+uniform mat4 viewProjection;
+uniform mat4 hiZViewProjection;//生成Hi-Z时（上一帧）的矩阵
+uniform bool occlusionEnabled;
+uniform bool showOccluded;//被遮挡的实例也画出来，加上标记位由片元着色器染色
+uniform int hiZMaxLevel;
+
+const uint OCCLUDED_FLAG=0x80000000u;
+
+vec3 corner(vec3 bmin,vec3 bmax,int i){
+    return vec3((i&1)!=0?bmax.x:bmin.x,(i&2)!=0?bmax.y:bmin.y,(i&4)!=0?bmax.z:bmin.z);
+}
+
+//8个角点都在同一个裁剪平面之外时才剔除
+bool isInFrustum(mat4 mvp,vec3 bmin,vec3 bmax){
+    ivec3 belowNum=ivec3(0);
+    ivec3 aboveNum=ivec3(0);
+    for(int i=0;i<8;i++){
+        vec4 clip=mvp*vec4(corner(bmin,bmax,i),1.);
+        belowNum+=ivec3(lessThan(clip.xyz,vec3(-clip.w)));
+        aboveNum+=ivec3(greaterThan(clip.xyz,vec3(clip.w)));
+    }
+    return all(lessThan(belowNum,ivec3(8)))&&all(lessThan(aboveNum,ivec3(8)));
+}
+
+//包围盒投影到上一帧的屏幕上，和覆盖区域中最远的深度比较；拿不准时都当作可见
+bool isOccluded(mat4 mvp,vec3 bmin,vec3 bmax){
+    vec3 ndcMin=vec3(1.);
+    vec3 ndcMax=vec3(-1.);
+    for(int i=0;i<8;i++){
+        vec4 clip=mvp*vec4(corner(bmin,bmax,i),1.);
+        if(clip.w<=0.){
+            return false;//跨过相机平面
+        }
+        vec3 ndc=clip.xyz/clip.w;
+        ndcMin=min(ndcMin,ndc);
+        ndcMax=max(ndcMax,ndc);
+    }
+    vec2 uvMin=ndcMin.xy*.5+.5;
+    vec2 uvMax=ndcMax.xy*.5+.5;
+    if(any(lessThan(uvMin,vec2(0.)))||any(greaterThan(uvMax,vec2(1.)))){
+        return false;//有一部分在上一帧的屏幕之外，没有深度可以比较
+    }
+
+    //选一层让矩形最多跨2x2个texel
+    vec2 rectSize=(uvMax-uvMin)*vec2(textureSize(hiZ,0));
+    int level=int(ceil(log2(max(max(rectSize.x,rectSize.y),1.))));
+    level=clamp(level,0,hiZMaxLevel);
+    ivec2 levelSize=textureSize(hiZ,level);
+    ivec2 texelMin=clamp(ivec2(uvMin*vec2(levelSize)),ivec2(0),levelSize-1);
+    ivec2 texelMax=clamp(ivec2(uvMax*vec2(levelSize)),ivec2(0),levelSize-1);
+    float occluderDepth=max(max(texelFetch(hiZ,texelMin,level).r,
+                                texelFetch(hiZ,ivec2(texelMax.x,texelMin.y),level).r),
+                            max(texelFetch(hiZ,ivec2(texelMin.x,texelMax.y),level).r,
+                                texelFetch(hiZ,texelMax,level).r));
+    return ndcMin.z*.5+.5>occluderDepth;
+}
+
+void main(){
+    uint index=gl_GlobalInvocationID.x;
+    if(index>=uint(candidateNum)){
+        return;
+    }
+    uint slot=candidates[index].x;
+    uint command=candidates[index].y;
+    DrawData data=drawData[command];
+    mat4 modelMatrix=transforms[slot];
+    vec3 bmin=data.boundsMin.xyz;
+    vec3 bmax=data.boundsMax.xyz;
+
+    if(!isInFrustum(viewProjection*modelMatrix,bmin,bmax)){
+        atomicAdd(frustumCulled,1u);
+        return;
+    }
+    uint flag=0u;
+    if(occlusionEnabled&&isOccluded(hiZViewProjection*modelMatrix,bmin,bmax)){
+        atomicAdd(occluded,1u);
+        if(!showOccluded){
+            return;
+        }
+        flag=OCCLUDED_FLAG;
+    }else{
+        atomicAdd(visible,1u);
+    }
+    uint offset=atomicAdd(commands[command].instanceCount,1u);
+    instanceIndices[data.instance.x+offset]=slot|flag;
+}
@@ -0,0 +1,33 @@
+#version 460 core
+//NOTE - Hi-Z金字塔，见 gpu_culling.h
+//每个texel保存它覆盖的区域中最远的深度；第0层从深度纹理复制，之后每层由上一层做2x2的最大值归约
+//尺寸为奇数时，最后一行/列的texel多覆盖一个源texel，保证不会漏掉任何深度
+layout(local_size_x=8,local_size_y=8)in;
+
+uniform bool fromDepth;
+layout(binding=14)uniform sampler2D depthTexture;
+layout(r32f,binding=0)readonly uniform image2D srcLevel;
+layout(r32f,binding=1)writeonly uniform image2D dstLevel;
+
+void main(){
+    ivec2 dst=ivec2(gl_GlobalInvocationID.xy);
+    ivec2 dstSize=imageSize(dstLevel);
+    if(any(greaterThanEqual(dst,dstSize))){
+        return;
+    }
+    if(fromDepth){
+        imageStore(dstLevel,dst,vec4(texelFetch(depthTexture,dst,0).r));
+        return;
+    }
+
+    ivec2 srcSize=imageSize(srcLevel);
+    ivec2 begin=dst*2;
+    ivec2 end=min(begin+2+ivec2(equal(dst,dstSize-1))*(srcSize&1),srcSize);
+    float maxDepth=0.;
+    for(int y=begin.y;y<end.y;y++){
+        for(int x=begin.x;x<end.x;x++){
+            maxDepth=max(maxDepth,imageLoad(srcLevel,ivec2(x,y)).r);
+        }
+    }
+    imageStore(dstLevel,dst,vec4(maxDepth));
+}
@@ -1,9 +1,10 @@
 #version 460 core
 //input
-layout(location=0)in vec3 aPos;
+layout(location=0)in vec4 aPos;
 // layout(location=1)in vec3 aNormal;
 // layout(location=2)in vec2 aTexCoord;
 uniform mat4 model,view,projection;
+uniform vec3 dequantOffset,dequantScale;
 
 //output
 // out VS_OUT{
@@ -13,7 +14,7 @@ uniform mat4 model,view,projection;
 // }vs_out;
 
 void main(){
-    vec4 globalPos4=model*vec4(aPos,1);
+    vec4 globalPos4=model*vec4(aPos.xyz*dequantScale+dequantOffset,1);
     // vs_out.globalPos=globalPos4.xyz;
     // vs_out.globalNormal=normalize(mat3(transpose(inverse(model)))*aNormal);
     // vs_out.texCoord=aTexCoord;
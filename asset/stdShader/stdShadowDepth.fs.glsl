@@ -0,0 +1,5 @@
+#version 460 core
+//只写深度，没有颜色输出
+
+void main(){
+}
@@ -0,0 +1,11 @@
+#version 460 core
+//NOTE - 阴影图集的深度pass，见 shadow_atlas.h
+//顶点格式见 vertex_format.h，这里只需要位置
+layout(location=0)in vec4 aPos;//xyz：量化后的位置，w：副切线符号
+uniform mat4 model,lightViewProjection;
+uniform vec3 dequantOffset,dequantScale;
+
+void main(){
+    vec3 position=aPos.xyz*dequantScale+dequantOffset;
+    gl_Position=lightViewProjection*model*vec4(position,1);
+}
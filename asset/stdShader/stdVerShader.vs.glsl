@@ -1,11 +1,38 @@
 #version 460 core
 //input
-layout(location=0)in vec3 aPos;
-layout(location=1)in vec3 aNormal;
+//NOTE - 顶点格式见 vertex_format.h，位置经过包围盒量化，法线/切线为八面体编码
+layout(location=0)in vec4 aPos;//xyz：量化后的位置，w：副切线符号
+layout(location=1)in vec2 aNormal;
 layout(location=2)in vec2 aTexCoord;
-layout(location=3)in vec3 aTangent;
-layout(location=4)in vec3 aBitangent;
+layout(location=3)in vec2 aTangent;
 uniform mat4 model,view,projection;
+uniform vec3 dequantOffset,dequantScale;
+
+//NOTE - 实例化绘制，见 instance_buffer.h
+//transforms按RenderObject的槽位存放，只在变换改变时更新；instanceIndices每帧按批次重建
+uniform bool useInstancing;
+uniform int instanceBase;
+layout(std430,binding=0)readonly buffer InstanceTransforms{
+    mat4 transforms[];
+};
+layout(std430,binding=1)readonly buffer InstanceIndices{
+    uint instanceIndices[];
+};
+
+//NOTE - 间接绘制，见 indirect_draw_buffer.h
+//每条绘制命令对应一条绘制数据，用drawBase+gl_DrawID索引（gl_DrawID在每次多重绘制中从0开始）
+uniform bool useIndirect;
+uniform int drawBase;
+struct DrawData{
+    vec4 dequantOffset;
+    vec4 dequantScale;
+    uvec4 instance;//x：在instanceIndices中的起始位置
+    vec4 boundsMin;//模型空间包围盒，GPU剔除使用
+    vec4 boundsMax;
+};
+layout(std430,binding=6)readonly buffer IndirectDrawData{
+    DrawData drawData[];
+};
 
 //output
 out VS_OUT{
@@ -16,16 +43,43 @@ out VS_OUT{
     vec3 globalBitangent;
     mat3 TBN;
 }vs_out;
+//GPU剔除的调试模式：被遮挡的实例带着标记位画出来，见 gpu_culling.h
+flat out uint debugOccluded;
+
+vec3 octDecode(vec2 e){
+    vec3 v=vec3(e,1.-abs(e.x)-abs(e.y));
+    if(v.z<0){
+        v.xy=(1.-abs(v.yx))*vec2(v.x>=0.?1.:-1.,v.y>=0.?1.:-1.);
+    }
+    return normalize(v);
+}
 
 void main(){
-    vec4 globalPos4=model*vec4(aPos,1);
+    mat4 modelMatrix=model;
+    vec3 position=aPos.xyz*dequantScale+dequantOffset;
+    debugOccluded=0u;
+    if(useIndirect){
+        DrawData data=drawData[drawBase+gl_DrawID];
+        uint slot=instanceIndices[data.instance.x+gl_InstanceID];
+        debugOccluded=slot>>31;
+        modelMatrix=transforms[slot&0x7FFFFFFFu];
+        position=aPos.xyz*data.dequantScale.xyz+data.dequantOffset.xyz;
+    }else if(useInstancing){
+        modelMatrix=transforms[instanceIndices[instanceBase+gl_InstanceID]];
+    }
+    vec3 normal=octDecode(aNormal);
+    vec3 tangent=octDecode(aTangent);
+    vec3 bitangent=cross(normal,tangent)*aPos.w;
+    
+    mat3 normalMatrix=mat3(transpose(inverse(modelMatrix)));
+    vec4 globalPos4=modelMatrix*vec4(position,1);
     vs_out.globalPos=globalPos4.xyz;
-    vs_out.globalNormal=normalize(mat3(transpose(inverse(model)))*aNormal);
+    vs_out.globalNormal=normalize(normalMatrix*normal);
     vs_out.texCoord=aTexCoord;
-    vs_out.globalTangent=normalize(mat3(transpose(inverse(model)))*aTangent);
-    vs_out.globalBitangent=-normalize(mat3(transpose(inverse(model)))*aBitangent);
+    vs_out.globalTangent=normalize(normalMatrix*tangent);
+    vs_out.globalBitangent=-normalize(normalMatrix*bitangent);
     
     vs_out.TBN=mat3(vs_out.globalTangent,vs_out.globalBitangent,vs_out.globalNormal);
     
     gl_Position=projection*view*globalPos4;
-}
\ No newline at end of file
+}
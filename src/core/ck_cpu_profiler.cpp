@@ -0,0 +1,148 @@
+#include "ck_cpu_profiler.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace {
+
+// 缓冲写满时，导出跳过最旧的这么多个槽位：停止记录时还没结束的作用域可能正在覆盖它们
+const uint64_t TRACE_GUARD_EVENT_NUM = 64;
+
+// 还没有缓冲的线程先记下名字，等第一次记录时再分配缓冲，不记录的线程不占内存
+thread_local std::string pending_thread_name;
+
+std::string escape_json(const char* text)
+{
+    std::string result;
+    for (; *text != '\0'; text++)
+    {
+        if (*text == '"' || *text == '\\') { result += '\\'; }
+        if (static_cast<unsigned char>(*text) >= 0x20) { result += *text; }
+    }
+    return result;
+}
+
+}  // namespace
+
+std::atomic<bool>                          ck::CpuProfiler::recording{false};
+thread_local ck::CpuProfiler::ThreadBuffer* ck::CpuProfiler::thread_buffer = nullptr;
+
+ck::CpuProfiler& ck::CpuProfiler::get_instance()
+{
+    // 多个线程可能同时第一次调用，用局部静态变量保证只创建一次
+    static CpuProfiler* const singleton = new CpuProfiler();
+    return *singleton;
+}
+
+ck::CpuProfiler::CpuProfiler() : epoch(std::chrono::steady_clock::now()) {}
+
+ck::CpuProfiler::ThreadBuffer& ck::CpuProfiler::get_thread_buffer()
+{
+    if (thread_buffer == nullptr)
+    {
+        auto                        buffer = std::make_unique<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffer->thread_index = static_cast<uint32_t>(buffers.size());
+        buffer->thread_name  = pending_thread_name.empty()
+                                   ? "thread " + std::to_string(buffer->thread_index)
+                                   : pending_thread_name;
+        thread_buffer        = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+    return *thread_buffer;
+}
+
+void ck::CpuProfiler::set_recording(const bool value)
+{
+    recording.store(value, std::memory_order_relaxed);
+}
+
+void ck::CpuProfiler::set_thread_name(const std::string& name)
+{
+    if (thread_buffer == nullptr)
+    {
+        pending_thread_name = name;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    thread_buffer->thread_name = name;
+}
+
+[[nodiscard]] uint64_t ck::CpuProfiler::now_ns() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - epoch)
+                                     .count());
+}
+
+void ck::CpuProfiler::record(const char* name, const uint64_t begin_ns, const uint64_t end_ns)
+{
+    ThreadBuffer&  buffer = get_thread_buffer();
+    const uint64_t index  = buffer.write_index.load(std::memory_order_relaxed);
+    buffer.events[index & (CPU_PROFILER_RING_SIZE - 1)] = {name, begin_ns, end_ns};
+    buffer.write_index.store(index + 1, std::memory_order_release);
+}
+
+void ck::CpuProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto& buffer : buffers) { buffer->write_index.store(0, std::memory_order_release); }
+}
+
+bool ck::CpuProfiler::write_chrome_trace(const std::string& file_path)
+{
+    set_recording(false);
+    std::ofstream file(file_path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Failed to open " << file_path;
+        return false;
+    }
+
+    // Chrome trace的时间单位是微秒
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool                        first     = true;
+    size_t                      event_num = 0;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (const auto& buffer : buffers)
+    {
+        if (!first) { file << ",\n"; }
+        first = false;
+        file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+             << buffer->thread_index << ", \"args\": {\"name\": \""
+             << escape_json(buffer->thread_name.c_str()) << "\"}}";
+
+        const uint64_t end   = buffer->write_index.load(std::memory_order_acquire);
+        const uint64_t begin =
+            (end >= CPU_PROFILER_RING_SIZE) ? end - CPU_PROFILER_RING_SIZE + TRACE_GUARD_EVENT_NUM
+                                            : 0;
+        for (uint64_t i = begin; i < end; i++)
+        {
+            const CpuProfileEvent& event = buffer->events[i & (CPU_PROFILER_RING_SIZE - 1)];
+            file << ",\n{\"name\": \"" << escape_json(event.name)
+                 << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread_index
+                 << ", \"ts\": " << static_cast<double>(event.begin_ns) * 1e-3
+                 << ", \"dur\": " << static_cast<double>(event.end_ns - event.begin_ns) * 1e-3
+                 << "}";
+        }
+        event_num += end - begin;
+    }
+    file << "\n]}\n";
+    LOG(INFO) << "Wrote " << event_num << " CPU profile events from " << buffers.size()
+              << " threads to " << file_path;
+    return true;
+}
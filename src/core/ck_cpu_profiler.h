@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ck {
+
+static const uint32_t CPU_PROFILER_RING_SIZE = 1U << 16;  // 每个线程保留最近的事件数，2的幂
+
+/// @brief 一个已经结束的作用域
+struct CpuProfileEvent
+{
+    const char* name;      // 字符串字面量
+    uint64_t    begin_ns;  // 相对于计时器创建的时刻
+    uint64_t    end_ns;
+};
+
+/// @brief CPU作用域计时器，导出为Chrome trace（chrome://tracing、Perfetto都能打开）
+/// @note 设计成单例类，可以在任意线程上使用
+/**NOTE - 低开销的记录
+1. 关闭时CK_PROFILE_SCOPE只做一次relaxed的原子读，不取时间也不写内存。
+2. 每个线程第一次记录时分配自己的环形缓冲并登记（只有这一次加锁），之后只有这个线程写它：
+   写入事件，再用release更新写指针，不需要锁也不需要CAS。缓冲满了覆盖最旧的事件。
+3. 时间用steady_clock：在Windows上是QPC，在Linux上是vDSO的clock_gettime，
+   不需要像rdtsc那样校准频率，也不受CPU降频和跨核的影响。
+4. write_chrome_trace()先停止记录，再用acquire读写指针，导出每个线程最近的事件。
+   同一线程上的事件按结束顺序记录，嵌套关系由查看器根据时间区间还原。
+线程退出后缓冲仍然保留，它的事件也会被导出。
+*/
+class CpuProfiler {
+private:
+    struct ThreadBuffer
+    {
+        std::array<CpuProfileEvent, CPU_PROFILER_RING_SIZE> events;
+        std::atomic<uint64_t>                              write_index{0};
+        uint32_t                                           thread_index;
+        std::string                                        thread_name;
+    };
+
+    static std::atomic<bool>          recording;
+    static thread_local ThreadBuffer* thread_buffer;  // 当前线程的缓冲，第一次记录时创建
+
+    std::chrono::steady_clock::time_point      epoch;
+    std::mutex                                 buffers_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    // NOTE - 单例故意不释放：线程局部的指针可能在静态析构阶段还指向这些缓冲
+    CpuProfiler();
+
+    /// @brief 当前线程的缓冲，第一次调用时创建
+    ThreadBuffer& get_thread_buffer();
+
+public:
+    static CpuProfiler& get_instance();
+
+    CpuProfiler(const CpuProfiler&)            = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+    [[nodiscard]] static bool is_recording() { return recording.load(std::memory_order_relaxed); }
+    void                      set_recording(bool value);
+
+    /// @brief 给当前线程起名，显示在trace的线程轨道上
+    void set_thread_name(const std::string& name);
+
+    [[nodiscard]] uint64_t now_ns() const;
+    /// @brief 在当前线程的缓冲中追加一个事件
+    void record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+    /// @brief 丢弃所有线程已经记录的事件
+    /// @note 在开始记录之前调用，记录期间清空会和正在写入的线程竞争
+    void clear();
+
+    /// @brief 停止记录，导出所有线程的事件
+    /// @return 文件打不开时返回false
+    bool write_chrome_trace(const std::string& file_path);
+};
+
+/// @brief RAII的CPU计时作用域，关闭记录时几乎没有开销
+class CpuProfileScope {
+private:
+    const char* name;
+    uint64_t    begin_ns;
+
+public:
+    explicit CpuProfileScope(const char* scope_name) : name(nullptr), begin_ns(0)
+    {
+        if (!CpuProfiler::is_recording()) { return; }
+        name     = scope_name;
+        begin_ns = CpuProfiler::get_instance().now_ns();
+    }
+    ~CpuProfileScope()
+    {
+        if (name == nullptr) { return; }
+        CpuProfiler& profiler = CpuProfiler::get_instance();
+        profiler.record(name, begin_ns, profiler.now_ns());
+    }
+
+    CpuProfileScope(const CpuProfileScope&)            = delete;
+    CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+};
+
+};  // namespace ck
+
+#define CK_PROFILE_CONCAT_(a, b) a##b
+#define CK_PROFILE_CONCAT(a, b)  CK_PROFILE_CONCAT_(a, b)
+/// @brief 在当前作用域内记录CPU时间，name需要是字符串字面量
+#define CK_PROFILE_SCOPE(name) \
+    const ck::CpuProfileScope CK_PROFILE_CONCAT(ck_profile_scope_, __LINE__)(name)
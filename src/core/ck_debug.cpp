@@ -2,11 +2,33 @@
 
 #include <cstdint>
 
-#include <iostream>
 #include <string>
 
 #include <glog/logging.h>
 
+#include "ck_gl_debug_sink.h"
+
+namespace {
+
+uint32_t gl_check_interval = 1;
+uint32_t gl_check_counter  = 0;
+
+}  // namespace
+
+void ck::set_gl_check_interval(const uint32_t interval)
+{
+    gl_check_interval = interval;
+    gl_check_counter  = 0;
+}
+
+[[nodiscard]] bool ck::should_check_gl_error()
+{
+    if (gl_check_interval == 0) { return false; }
+    if (++gl_check_counter < gl_check_interval) { return false; }
+    gl_check_counter = 0;
+    return true;
+}
+
 GLenum ck::glCheckError_(const char* file, int32_t line)
 {
     GLenum errorCode = glGetError();
@@ -24,7 +46,8 @@ GLenum ck::glCheckError_(const char* file, int32_t line)
         case GL_INVALID_FRAMEBUFFER_OPERATION: error = "INVALID_FRAMEBUFFER_OPERATION"; break;
         default: error = "Unknown error code: " + std::to_string(errorCode); break;
     }
-    LOG(ERROR) << "OpenGL error: " << error << " | " << file << " (" << line << ")";
+    LOG(ERROR) << "OpenGL error: " << error << " | " << file << " (" << line << ")"
+               << ((gl_check_interval > 1) ? " (sampled, raised since an earlier GL_CHECK)" : "");
 
     return errorCode;
 }
@@ -40,41 +63,5 @@ void APIENTRY ck::glDebugOutput(GLenum        source,
     // 忽略一些不重要的错误/警告代码
     if (id == 131169 || id == 131185 || id == 131218 || id == 131204) { return; }
 
-    std::cout << "---------------" << std::endl;
-    std::cout << "Debug message (" << id << "): " << message << std::endl;
-
-    switch (source)
-    {
-        case GL_DEBUG_SOURCE_API: std::cout << "Source: API"; break;
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: std::cout << "Source: Window System"; break;
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: std::cout << "Source: Shader Compiler"; break;
-        case GL_DEBUG_SOURCE_THIRD_PARTY: std::cout << "Source: Third Party"; break;
-        case GL_DEBUG_SOURCE_APPLICATION: std::cout << "Source: Application"; break;
-        case GL_DEBUG_SOURCE_OTHER: std::cout << "Source: Other"; break;
-    }
-    std::cout << std::endl;
-
-    switch (type)
-    {
-        case GL_DEBUG_TYPE_ERROR: std::cout << "Type: Error"; break;
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: std::cout << "Type: Deprecated Behaviour"; break;
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: std::cout << "Type: Undefined Behaviour"; break;
-        case GL_DEBUG_TYPE_PORTABILITY: std::cout << "Type: Portability"; break;
-        case GL_DEBUG_TYPE_PERFORMANCE: std::cout << "Type: Performance"; break;
-        case GL_DEBUG_TYPE_MARKER: std::cout << "Type: Marker"; break;
-        case GL_DEBUG_TYPE_PUSH_GROUP: std::cout << "Type: Push Group"; break;
-        case GL_DEBUG_TYPE_POP_GROUP: std::cout << "Type: Pop Group"; break;
-        case GL_DEBUG_TYPE_OTHER: std::cout << "Type: Other"; break;
-    }
-    std::cout << std::endl;
-
-    switch (severity)
-    {
-        case GL_DEBUG_SEVERITY_HIGH: std::cout << "Severity: high"; break;
-        case GL_DEBUG_SEVERITY_MEDIUM: std::cout << "Severity: medium"; break;
-        case GL_DEBUG_SEVERITY_LOW: std::cout << "Severity: low"; break;
-        case GL_DEBUG_SEVERITY_NOTIFICATION: std::cout << "Severity: notification"; break;
-    }
-    std::cout << "---------------" << std::endl;
-    std::cout << std::endl;
+    GlDebugSink::get_instance().push(source, type, id, severity, length, message);
 }
@@ -7,13 +7,31 @@
 #ifdef NDEBUG
 #    define GL_CHECK()
 #else
-#    define GL_CHECK() ck::glCheckError_(__FILE__, __LINE__)
+#    define GL_CHECK()                                                                  \
+        do {                                                                            \
+            if (ck::should_check_gl_error()) { ck::glCheckError_(__FILE__, __LINE__); } \
+        } while (false)
 #endif
 
 namespace ck {
 
+static const uint32_t GL_CHECK_SAMPLED_INTERVAL = 64;  // 调试回调可用时的抽样间隔
+
+/**NOTE - 抽样的GL_CHECK()
+glGetError()会让驱动同步，几乎每个GL调用后都检查时调试版本慢得没法做性能分析。
+set_gl_check_interval(n)之后每n次GL_CHECK()才真正调用一次glGetError()：
+GL的错误标志在读取之前一直保留，所以错误不会漏掉，只是报告的位置可能晚于出错的调用。
+调试回调（GlDebugSink）会给出准确的错误信息，这时用抽样模式；n为1时每次都检查，为0时不检查。
+*/
+/// @brief 设置GL_CHECK()的抽样间隔
+/// @note GL_CHECK()只能在GL线程使用
+void set_gl_check_interval(uint32_t interval);
+/// @brief 这一次GL_CHECK()是否需要调用glGetError()
+[[nodiscard]] bool should_check_gl_error();
+
 GLenum glCheckError_(const char* file, int32_t line);
 
+/// @brief 调试回调，把消息交给GlDebugSink异步输出
 void APIENTRY glDebugOutput(GLenum        source,
                             GLenum        type,
                             GLuint        id,
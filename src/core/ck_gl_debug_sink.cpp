@@ -0,0 +1,269 @@
+#include "ck_gl_debug_sink.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace {
+
+const char* get_source_name(const GLenum source)
+{
+    switch (source)
+    {
+        case GL_DEBUG_SOURCE_API: return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "Window System";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "Third Party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "Application";
+        default: return "Other";
+    }
+}
+
+const char* get_type_name(const GLenum type)
+{
+    switch (type)
+    {
+        case GL_DEBUG_TYPE_ERROR: return "Error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behaviour";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "Undefined Behaviour";
+        case GL_DEBUG_TYPE_PORTABILITY: return "Portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "Performance";
+        case GL_DEBUG_TYPE_MARKER: return "Marker";
+        case GL_DEBUG_TYPE_PUSH_GROUP: return "Push Group";
+        case GL_DEBUG_TYPE_POP_GROUP: return "Pop Group";
+        default: return "Other";
+    }
+}
+
+const char* get_severity_name(const GLenum severity)
+{
+    switch (severity)
+    {
+        case GL_DEBUG_SEVERITY_HIGH: return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+        case GL_DEBUG_SEVERITY_LOW: return "low";
+        default: return "notification";
+    }
+}
+
+uint64_t get_message_key(const ck::GlDebugRecord& record)
+{
+    // 枚举值都小于0x10000，id占低32位
+    return (static_cast<uint64_t>(record.source & 0xFFFFU) << 48U) |
+           (static_cast<uint64_t>(record.type & 0xFFFFU) << 32U) | record.id;
+}
+
+void log_message(const ck::GlDebugRecord& record, const std::string& text)
+{
+    if (record.severity == GL_DEBUG_SEVERITY_HIGH || record.type == GL_DEBUG_TYPE_ERROR)
+    {
+        LOG(ERROR) << text;
+    }
+    else if (record.severity == GL_DEBUG_SEVERITY_MEDIUM) { LOG(WARNING) << text; }
+    else { LOG(INFO) << text; }
+}
+
+void log_record(const ck::GlDebugRecord& record)
+{
+    log_message(record, "GL debug message (" + std::to_string(record.id) +
+                            ") [Source: " + get_source_name(record.source) +
+                            " | Type: " + get_type_name(record.type) +
+                            " | Severity: " + get_severity_name(record.severity) +
+                            "]: " + std::string(record.message, record.length));
+}
+
+}  // namespace
+
+ck::GlDebugSink& ck::GlDebugSink::get_instance()
+{
+    // 驱动线程可能同时第一次调用，用局部静态变量保证只创建一次；故意不释放
+    static GlDebugSink* const singleton = new GlDebugSink();
+    return *singleton;
+}
+
+ck::GlDebugSink::GlDebugSink()
+    : enqueue_pos(0), dequeue_pos(0), dropped_num(0), running(false), stopping(false)
+{
+    for (uint32_t i = 0; i < GL_DEBUG_RING_SIZE; i++)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool ck::GlDebugSink::try_push(const GlDebugRecord& record)
+{
+    // 槽位的sequence等于写位置时可以写，等于写位置+1时可以读
+    uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot*    slot;
+    while (true)
+    {
+        slot                = &slots[pos & (GL_DEBUG_RING_SIZE - 1)];
+        const uint64_t seq  = slot->sequence.load(std::memory_order_acquire);
+        const auto     diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0) { return false; }  // 消费者还没有读走一圈之前的消息
+        else { pos = enqueue_pos.load(std::memory_order_relaxed); }
+    }
+    slot->record = record;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool ck::GlDebugSink::try_pop(GlDebugRecord& record)
+{
+    Slot& slot = slots[dequeue_pos & (GL_DEBUG_RING_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) { return false; }
+    record = slot.record;
+    slot.sequence.store(dequeue_pos + GL_DEBUG_RING_SIZE, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+void ck::GlDebugSink::start()
+{
+    if (running.load(std::memory_order_relaxed)) { return; }
+    stopping    = false;
+    last_report = Clock::now();
+    worker      = std::thread(&GlDebugSink::worker_loop, this);
+    running.store(true, std::memory_order_release);
+}
+
+void ck::GlDebugSink::push(const GLenum        source,
+                           const GLenum        type,
+                           const GLuint        id,
+                           const GLenum        severity,
+                           const GLsizei       length,
+                           const GLchar*       message)
+{
+    GlDebugRecord record;
+    record.source   = source;
+    record.type     = type;
+    record.id       = id;
+    record.severity = severity;
+    // length为负时消息以'\0'结尾
+    const size_t message_length =
+        (length >= 0) ? static_cast<size_t>(length) : std::strlen(message);
+    record.length = static_cast<uint32_t>(
+        std::min(message_length, static_cast<size_t>(GL_DEBUG_MESSAGE_MAX_LENGTH)));
+    std::memcpy(record.message, message, record.length);
+
+    if (!running.load(std::memory_order_acquire))
+    {
+        log_record(record);
+        return;
+    }
+    if (!try_push(record)) { dropped_num.fetch_add(1, std::memory_order_relaxed); }
+}
+
+void ck::GlDebugSink::worker_loop()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(worker_mutex);
+            worker_cv.wait_for(lock, std::chrono::milliseconds(GL_DEBUG_POLL_INTERVAL_MS),
+                               [this] { return stopping; });
+            if (stopping) { return; }
+        }
+        drain();
+        if (Clock::now() - last_report >= std::chrono::milliseconds(GL_DEBUG_REPORT_INTERVAL_MS))
+        {
+            report_repeats();
+        }
+    }
+}
+
+void ck::GlDebugSink::drain()
+{
+    GlDebugRecord record;
+    while (try_pop(record))
+    {
+        const uint64_t key  = get_message_key(record);
+        auto           iter = stats.find(key);
+        if (iter == stats.end())
+        {
+            stats.emplace(key, MessageStats{record, 1, 0});
+            log_record(record);
+        }
+        else
+        {
+            iter->second.total_num++;
+            iter->second.pending_num++;
+        }
+    }
+}
+
+void ck::GlDebugSink::report_repeats()
+{
+    last_report = Clock::now();
+    for (auto& [key, message_stats] : stats)
+    {
+        if (message_stats.pending_num == 0) { continue; }
+        log_message(message_stats.first,
+                    "GL debug message (" + std::to_string(message_stats.first.id) +
+                        ") repeated " + std::to_string(message_stats.pending_num) +
+                        " times, " + std::to_string(message_stats.total_num) + " in total");
+        message_stats.pending_num = 0;
+    }
+}
+
+void ck::GlDebugSink::report_summary() const
+{
+    std::vector<const MessageStats*> sorted;
+    sorted.reserve(stats.size());
+    for (const auto& [key, message_stats] : stats) { sorted.push_back(&message_stats); }
+    std::sort(sorted.begin(), sorted.end(), [](const MessageStats* a, const MessageStats* b) {
+        return a->total_num > b->total_num;
+    });
+
+    LOG(INFO) << "GL debug summary: " << sorted.size() << " distinct messages, "
+              << dropped_num.load(std::memory_order_relaxed) << " dropped";
+    const size_t num = std::min(sorted.size(), static_cast<size_t>(GL_DEBUG_SUMMARY_NUM));
+    for (size_t i = 0; i < num; i++)
+    {
+        const GlDebugRecord& first = sorted[i]->first;
+        LOG(INFO) << "  " << sorted[i]->total_num << " x (" << first.id << ") "
+                  << get_type_name(first.type) << ": "
+                  << std::string(first.message, first.length);
+    }
+}
+
+void ck::GlDebugSink::shutdown()
+{
+    if (!running.load(std::memory_order_relaxed)) { return; }
+    running.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        stopping = true;
+    }
+    worker_cv.notify_one();
+    if (worker.joinable()) { worker.join(); }
+
+    // 停止之前已经入队的消息；之后的push()直接写glog
+    drain();
+    report_repeats();
+    if (!stats.empty()) { report_summary(); }
+    stats.clear();
+}
+
+[[nodiscard]] uint64_t ck::GlDebugSink::get_dropped_num() const
+{
+    return dropped_num.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+namespace ck {
+
+static const uint32_t GL_DEBUG_RING_SIZE          = 1024;  // 必须是2的幂
+static const uint32_t GL_DEBUG_MESSAGE_MAX_LENGTH = 256;   // 更长的消息被截断
+static const uint32_t GL_DEBUG_POLL_INTERVAL_MS   = 10;
+static const uint32_t GL_DEBUG_REPORT_INTERVAL_MS = 1000;  // 重复消息的计数多久汇报一次
+static const uint32_t GL_DEBUG_SUMMARY_NUM        = 16;    // 退出时列出次数最多的消息数
+
+/// @brief 驱动回调中拷贝下来的一条调试消息，定长，不分配内存
+struct GlDebugRecord
+{
+    GLenum   source;
+    GLenum   type;
+    GLuint   id;
+    GLenum   severity;
+    uint32_t length;
+    char     message[GL_DEBUG_MESSAGE_MAX_LENGTH];
+};
+
+/// @brief 异步的GL调试消息输出：回调只写入无锁环形队列，后台线程格式化、去重后写到glog
+/// @note 设计成单例类；push()可以在任意线程（包括驱动线程）调用
+/**NOTE - 为什么要异步
+原来glDebugOutput在回调里用std::cout逐行输出并且每行都flush，调试上下文中回调往往在
+发出消息的GL调用里同步执行，一串性能警告就能让渲染线程卡住好几毫秒。现在：
+1. 回调只把id、枚举和截断后的消息拷进定长槽位：有界的多生产者队列（Vyukov），
+   生产者之间只用CAS争抢写位置，不加锁；队列满了丢弃并计数，绝不阻塞GL线程。
+2. 后台线程每GL_DEBUG_POLL_INTERVAL_MS取空队列，按(source, type, id)去重：
+   第一次出现的消息完整输出，之后只计数，每GL_DEBUG_REPORT_INTERVAL_MS汇报一次重复次数。
+3. 严重程度映射到glog：HIGH或类型为ERROR -> ERROR，MEDIUM -> WARNING，其他 -> INFO。
+start()之前和shutdown()之后，push()退回到在调用线程上直接写glog。
+*/
+class GlDebugSink {
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        GlDebugRecord         record;
+    };
+    /// @brief 同一条消息的统计
+    struct MessageStats
+    {
+        GlDebugRecord first;        // 第一次出现时的内容
+        uint64_t      total_num;    // 一共出现的次数
+        uint64_t      pending_num;  // 上次汇报之后又出现的次数
+    };
+    using Clock = std::chrono::steady_clock;
+
+    std::array<Slot, GL_DEBUG_RING_SIZE> slots;
+    alignas(64) std::atomic<uint64_t> enqueue_pos;
+    alignas(64) uint64_t dequeue_pos;  // 只有后台线程访问
+    std::atomic<uint64_t> dropped_num;
+    std::atomic<bool>     running;
+
+    std::thread             worker;
+    std::mutex              worker_mutex;
+    std::condition_variable worker_cv;
+    bool                    stopping;
+
+    // 只有后台线程访问（shutdown()在它退出之后访问）
+    std::unordered_map<uint64_t, MessageStats> stats;
+    Clock::time_point                          last_report;
+
+    GlDebugSink();
+
+    /// @brief 多生产者入队，队列满时返回false
+    bool try_push(const GlDebugRecord& record);
+    /// @brief 单消费者出队
+    bool try_pop(GlDebugRecord& record);
+
+    void worker_loop();
+    /// @brief 取空队列并去重
+    void drain();
+    /// @brief 输出上次汇报之后重复出现的消息的次数
+    void report_repeats();
+    /// @brief 输出次数最多的几条消息和丢弃的数量
+    void report_summary() const;
+
+public:
+    static GlDebugSink& get_instance();
+
+    GlDebugSink(const GlDebugSink&)            = delete;
+    GlDebugSink& operator=(const GlDebugSink&) = delete;
+
+    /// @brief 启动后台线程
+    void start();
+    /// @brief 在驱动回调中调用
+    void push(GLenum        source,
+              GLenum        type,
+              GLuint        id,
+              GLenum        severity,
+              GLsizei       length,
+              const GLchar* message);
+    /// @brief 输出剩余的消息和统计，停止后台线程
+    /// @note 需要在google::ShutdownGoogleLogging()之前调用
+    void shutdown();
+
+    [[nodiscard]] uint64_t get_dropped_num() const;
+};
+
+};  // namespace ck
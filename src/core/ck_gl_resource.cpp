@@ -0,0 +1,291 @@
+#include "ck_gl_resource.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glog/logging.h>
+
+#include "ck_debug.h"
+#include "ck_gl_state.h"
+
+namespace {
+
+GLenum get_label_identifier(const ck::GLObjectKind kind)
+{
+    switch (kind)
+    {
+        case ck::GLObjectKind::BUFFER: return GL_BUFFER;
+        case ck::GLObjectKind::TEXTURE: return GL_TEXTURE;
+        case ck::GLObjectKind::RENDERBUFFER: return GL_RENDERBUFFER;
+        case ck::GLObjectKind::FRAMEBUFFER: return GL_FRAMEBUFFER;
+        case ck::GLObjectKind::VERTEX_ARRAY: return GL_VERTEX_ARRAY;
+        default: return GL_PROGRAM;
+    }
+}
+
+void apply_label(ck::GLResourceInfo& info)
+{
+    if (info.labeled || info.label.empty()) { return; }
+    glObjectLabel(get_label_identifier(info.kind), info.name, -1, info.label.c_str());
+    info.labeled = true;
+}
+
+std::string quote_csv(const std::string& text)
+{
+    std::string result = "\"";
+    for (const char c : text)
+    {
+        if (c == '"') { result += '"'; }
+        result += c;
+    }
+    return result + "\"";
+}
+
+double to_mb(const size_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+}  // namespace
+
+[[nodiscard]] const char* ck::get_gl_object_kind_name(const GLObjectKind kind)
+{
+    switch (kind)
+    {
+        case GLObjectKind::BUFFER: return "buffer";
+        case GLObjectKind::TEXTURE: return "texture";
+        case GLObjectKind::RENDERBUFFER: return "renderbuffer";
+        case GLObjectKind::FRAMEBUFFER: return "framebuffer";
+        case GLObjectKind::VERTEX_ARRAY: return "vertex array";
+        case GLObjectKind::PROGRAM: return "program";
+        default: return "unknown";
+    }
+}
+
+ck::GLResourceRegistry* ck::GLResourceRegistry::singleton = nullptr;
+
+ck::GLResourceRegistry& ck::GLResourceRegistry::get_instance()
+{
+    if (singleton == nullptr) { singleton = new GLResourceRegistry(); }
+    return *singleton;
+}
+
+ck::GLResourceRegistry::GLResourceRegistry()
+    : kind_bytes{}, kind_object_num{}, total_bytes(0), context_alive(true)
+{
+}
+
+[[nodiscard]] uint64_t ck::GLResourceRegistry::make_key(const GLObjectKind kind,
+                                                        const uint32_t     name)
+{
+    return (static_cast<uint64_t>(kind) << 32U) | name;
+}
+
+uint32_t ck::GLResourceRegistry::create(const GLObjectKind kind,
+                                        const std::string& label,
+                                        const std::string& owner)
+{
+    GLuint name = 0;
+    switch (kind)
+    {
+        case GLObjectKind::BUFFER: glGenBuffers(1, &name); break;
+        case GLObjectKind::TEXTURE: glGenTextures(1, &name); break;
+        case GLObjectKind::RENDERBUFFER: glGenRenderbuffers(1, &name); break;
+        case GLObjectKind::FRAMEBUFFER: glGenFramebuffers(1, &name); break;
+        case GLObjectKind::VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+        default: name = glCreateProgram(); break;
+    }
+    adopt(kind, name, label, owner);
+    return name;
+}
+
+void ck::GLResourceRegistry::adopt(const GLObjectKind kind,
+                                   const uint32_t     name,
+                                   const std::string& label,
+                                   const std::string& owner)
+{
+    const auto [iter, inserted] =
+        resources.emplace(make_key(kind, name), GLResourceInfo{kind, name, 0, label, owner, false});
+    if (!inserted)
+    {
+        LOG(WARNING) << get_gl_object_kind_name(kind) << " " << name << " (" << label
+                     << ") is already tracked by " << iter->second.owner;
+        return;
+    }
+    kind_object_num[static_cast<uint32_t>(kind)]++;
+    // 程序对象创建时就已经存在，其他对象要等第一次绑定
+    if (kind == GLObjectKind::PROGRAM) { apply_label(iter->second); }
+}
+
+void ck::GLResourceRegistry::destroy(const GLObjectKind kind, const uint32_t name)
+{
+    const auto iter = resources.find(make_key(kind, name));
+    if (iter != resources.end())
+    {
+        const auto index   = static_cast<uint32_t>(kind);
+        kind_bytes[index] -= iter->second.bytes;
+        total_bytes       -= iter->second.bytes;
+        kind_object_num[index]--;
+        resources.erase(iter);
+    }
+    else
+    {
+        LOG(WARNING) << "destroy an untracked " << get_gl_object_kind_name(kind) << " " << name;
+    }
+
+    if (!context_alive) { return; }  // 上下文已经销毁，对象随之释放
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    GLuint        object   = name;
+    switch (kind)
+    {
+        case GLObjectKind::BUFFER:
+            gl_state.on_buffer_deleted(object);
+            glDeleteBuffers(1, &object);
+            break;
+        case GLObjectKind::TEXTURE:
+            gl_state.on_texture_deleted(object);
+            glDeleteTextures(1, &object);
+            break;
+        case GLObjectKind::RENDERBUFFER: glDeleteRenderbuffers(1, &object); break;
+        case GLObjectKind::FRAMEBUFFER: glDeleteFramebuffers(1, &object); break;
+        case GLObjectKind::VERTEX_ARRAY:
+            gl_state.on_vertex_array_deleted(object);
+            glDeleteVertexArrays(1, &object);
+            break;
+        default:
+            gl_state.on_program_deleted(object);
+            glDeleteProgram(object);
+            break;
+    }
+    GL_CHECK();
+}
+
+void ck::GLResourceRegistry::set_bytes(const GLObjectKind kind,
+                                       const uint32_t     name,
+                                       const size_t       bytes)
+{
+    const auto iter = resources.find(make_key(kind, name));
+    if (iter == resources.end()) { return; }
+    GLResourceInfo& info   = iter->second;
+    const auto      index  = static_cast<uint32_t>(kind);
+    kind_bytes[index]     += bytes - info.bytes;
+    total_bytes           += bytes - info.bytes;
+    info.bytes             = bytes;
+    if (context_alive) { apply_label(info); }
+}
+
+void ck::GLResourceRegistry::add_shared_bytes(const std::string& owner, const size_t bytes)
+{
+    shared_bytes[owner] += bytes;
+}
+
+void ck::GLResourceRegistry::remove_shared_bytes(const std::string& owner, const size_t bytes)
+{
+    const auto iter = shared_bytes.find(owner);
+    if (iter == shared_bytes.end()) { return; }
+    iter->second -= std::min(iter->second, bytes);
+    if (iter->second == 0) { shared_bytes.erase(iter); }
+}
+
+void ck::GLResourceRegistry::shutdown()
+{
+    if (!resources.empty())
+    {
+        LOG(INFO) << resources.size() << " GL objects (" << to_mb(total_bytes)
+                  << " MB) are still alive when the context is destroyed:";
+        for (const GLAssetMemory& asset : collect_asset_memory())
+        {
+            if (asset.object_num == 0) { continue; }
+            LOG(INFO) << "  " << asset.owner << ": " << asset.object_num << " objects, "
+                      << to_mb(asset.bytes) << " MB";
+        }
+    }
+    context_alive = false;
+}
+
+[[nodiscard]] size_t ck::GLResourceRegistry::get_total_bytes() const
+{
+    return total_bytes;
+}
+
+[[nodiscard]] size_t ck::GLResourceRegistry::get_object_num() const
+{
+    return resources.size();
+}
+
+[[nodiscard]] size_t ck::GLResourceRegistry::get_kind_bytes(const GLObjectKind kind) const
+{
+    return kind_bytes[static_cast<uint32_t>(kind)];
+}
+
+[[nodiscard]] uint32_t ck::GLResourceRegistry::get_kind_object_num(const GLObjectKind kind) const
+{
+    return kind_object_num[static_cast<uint32_t>(kind)];
+}
+
+[[nodiscard]] std::vector<ck::GLAssetMemory> ck::GLResourceRegistry::collect_asset_memory() const
+{
+    std::map<std::string, GLAssetMemory> assets;
+    for (const auto& [key, info] : resources)
+    {
+        GLAssetMemory& asset = assets[info.owner];
+        asset.object_num++;
+        asset.bytes += info.bytes;
+    }
+    for (const auto& [owner, bytes] : shared_bytes) { assets[owner].shared_bytes += bytes; }
+
+    std::vector<GLAssetMemory> result;
+    result.reserve(assets.size());
+    for (auto& [owner, asset] : assets)
+    {
+        asset.owner = owner;
+        result.push_back(std::move(asset));
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const GLAssetMemory& a, const GLAssetMemory& b) {
+                         return a.bytes + a.shared_bytes > b.bytes + b.shared_bytes;
+                     });
+    return result;
+}
+
+bool ck::GLResourceRegistry::write_csv(const std::string& file_path) const
+{
+    std::ofstream file(file_path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Failed to open " << file_path;
+        return false;
+    }
+
+    // 按owner排序，同一个资源的对象排在一起
+    std::vector<const GLResourceInfo*> sorted;
+    sorted.reserve(resources.size());
+    for (const auto& [key, info] : resources) { sorted.push_back(&info); }
+    std::sort(sorted.begin(), sorted.end(), [](const GLResourceInfo* a, const GLResourceInfo* b) {
+        if (a->owner != b->owner) { return a->owner < b->owner; }
+        return a->bytes > b->bytes;
+    });
+
+    file << "owner,kind,name,label,bytes\n";
+    for (const GLResourceInfo* info : sorted)
+    {
+        file << quote_csv(info->owner) << "," << get_gl_object_kind_name(info->kind) << ","
+             << info->name << "," << quote_csv(info->label) << "," << info->bytes << "\n";
+    }
+    for (const auto& [owner, bytes] : shared_bytes)
+    {
+        file << quote_csv(owner) << ",shared,0," << quote_csv("shared buffer ranges") << ","
+             << bytes << "\n";
+    }
+    LOG(INFO) << "Wrote " << sorted.size() << " GL objects to " << file_path;
+    return true;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ck {
+
+enum class GLObjectKind : uint32_t {
+    BUFFER,
+    TEXTURE,
+    RENDERBUFFER,
+    FRAMEBUFFER,
+    VERTEX_ARRAY,
+    PROGRAM,
+    KIND_NUM
+};
+static const uint32_t GL_OBJECT_KIND_NUM = static_cast<uint32_t>(GLObjectKind::KIND_NUM);
+
+[[nodiscard]] const char* get_gl_object_kind_name(GLObjectKind kind);
+
+/// @brief 一个被跟踪的GL对象
+struct GLResourceInfo
+{
+    GLObjectKind kind;
+    uint32_t     name;
+    size_t       bytes;    // 显存占用的估算，没有存储时为0
+    std::string  label;    // 同时通过glObjectLabel交给驱动，调试工具中可以看到
+    std::string  owner;    // 持有它的资源，通常是文件路径
+    bool         labeled;  // glObjectLabel已经调用过
+};
+
+/// @brief 一个资源（owner）的显存汇总
+struct GLAssetMemory
+{
+    std::string owner;
+    uint32_t    object_num;
+    size_t      bytes;         // 这个资源独占的GL对象
+    size_t      shared_bytes;  // 在共享缓冲（比如MeshArena）中占用的区间，不计入总量
+};
+
+/// @brief 所有GL对象的登记表：类型、大小、调试标签和所属的资源
+/// @note 设计成单例类，只能在GL线程使用
+/**NOTE - 显存统计
+1. GL对象通过GLHandle创建和删除，创建时登记，删除时注销，不会漏记也不会重复删除。
+   由别的模块生成的名字（比如TextureLoader创建的纹理）用adopt()接管。
+2. 大小由持有者在分配存储后用set_bytes()报告。glObjectLabel要求对象已经存在，
+   而glGen*得到的名字要第一次绑定之后才成为对象，所以标签在第一次set_bytes()时才交给驱动。
+3. 共享缓冲中的子分配按资源另外计数（add_shared_bytes），只用于按资源的报告，
+   缓冲本身已经以它的持有者登记过，不重复计入总量。
+4. shutdown()在销毁GL上下文之前调用：输出仍然存活的对象，之后删除句柄只注销、不再调用GL。
+   长时间运行时显存一直增长，可以在报告中看到是哪个资源持有的。
+*/
+class GLResourceRegistry {
+private:
+    std::unordered_map<uint64_t, GLResourceInfo> resources;      // (kind, name) -> info
+    std::unordered_map<std::string, size_t>      shared_bytes;   // owner -> 共享缓冲中的大小
+    std::array<size_t, GL_OBJECT_KIND_NUM>       kind_bytes;
+    std::array<uint32_t, GL_OBJECT_KIND_NUM>     kind_object_num;
+    size_t                                       total_bytes;
+    bool                                         context_alive;
+
+    static GLResourceRegistry* singleton;
+    // NOTE - 故意不释放：静态析构阶段的句柄还会注销自己
+    GLResourceRegistry();
+
+    [[nodiscard]] static uint64_t make_key(GLObjectKind kind, uint32_t name);
+
+public:
+    static GLResourceRegistry& get_instance();
+
+    GLResourceRegistry(const GLResourceRegistry&)            = delete;
+    GLResourceRegistry& operator=(const GLResourceRegistry&) = delete;
+
+    /// @brief 生成一个GL对象并登记
+    uint32_t create(GLObjectKind kind, const std::string& label, const std::string& owner);
+    /// @brief 登记一个已经生成的GL对象，之后由登记表负责删除
+    void adopt(GLObjectKind       kind,
+               uint32_t           name,
+               const std::string& label,
+               const std::string& owner);
+    /// @brief 注销并删除GL对象，shutdown()之后只注销
+    void destroy(GLObjectKind kind, uint32_t name);
+    /// @brief 报告对象的显存大小，第一次调用时给对象加上调试标签
+    void set_bytes(GLObjectKind kind, uint32_t name, size_t bytes);
+
+    void add_shared_bytes(const std::string& owner, size_t bytes);
+    void remove_shared_bytes(const std::string& owner, size_t bytes);
+
+    /// @brief 输出仍然存活的对象，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    [[nodiscard]] size_t   get_total_bytes() const;
+    [[nodiscard]] size_t   get_object_num() const;
+    [[nodiscard]] size_t   get_kind_bytes(GLObjectKind kind) const;
+    [[nodiscard]] uint32_t get_kind_object_num(GLObjectKind kind) const;
+    /// @brief 按资源汇总，按独占的大小从大到小排序
+    [[nodiscard]] std::vector<GLAssetMemory> collect_asset_memory() const;
+    /// @brief 每个对象一行：owner, kind, name, label, bytes
+    bool write_csv(const std::string& file_path) const;
+};
+
+/// @brief 独占一个GL对象的RAII句柄，只能移动，析构时删除对象
+/// @note 只能在GL线程使用
+template <GLObjectKind Kind> class GLHandle {
+private:
+    uint32_t name;
+
+public:
+    GLHandle() : name(0) {}
+    ~GLHandle() { reset(); }
+
+    GLHandle(const GLHandle&)            = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+    GLHandle(GLHandle&& other) noexcept : name(other.name) { other.name = 0; }
+    GLHandle& operator=(GLHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            name       = other.name;
+            other.name = 0;
+        }
+        return *this;
+    }
+
+    /// @brief 删除原来的对象（如果有），生成一个新的
+    void create(const std::string& label, const std::string& owner)
+    {
+        reset();
+        name = GLResourceRegistry::get_instance().create(Kind, label, owner);
+    }
+    /// @brief 接管一个已经生成的对象
+    void adopt(const uint32_t object, const std::string& label, const std::string& owner)
+    {
+        reset();
+        name = object;
+        if (name != 0) { GLResourceRegistry::get_instance().adopt(Kind, name, label, owner); }
+    }
+    void reset()
+    {
+        if (name == 0) { return; }
+        GLResourceRegistry::get_instance().destroy(Kind, name);
+        name = 0;
+    }
+    /// @brief 在分配存储之后调用；对象第一次绑定之后才能加上调试标签，VAO这样没有存储的传0
+    void set_bytes(const size_t bytes) const
+    {
+        if (name != 0) { GLResourceRegistry::get_instance().set_bytes(Kind, name, bytes); }
+    }
+
+    [[nodiscard]] uint32_t get() const { return name; }
+    [[nodiscard]] bool     is_valid() const { return name != 0; }
+};
+
+using GLBuffer       = GLHandle<GLObjectKind::BUFFER>;
+using GLTexture      = GLHandle<GLObjectKind::TEXTURE>;
+using GLRenderbuffer = GLHandle<GLObjectKind::RENDERBUFFER>;
+using GLFramebuffer  = GLHandle<GLObjectKind::FRAMEBUFFER>;
+using GLVertexArray  = GLHandle<GLObjectKind::VERTEX_ARRAY>;
+using GLProgram      = GLHandle<GLObjectKind::PROGRAM>;
+
+};  // namespace ck
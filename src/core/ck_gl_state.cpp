@@ -0,0 +1,311 @@
+#include "ck_gl_state.h"
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+ck::GLStateCache* ck::GLStateCache::singleton = nullptr;
+
+ck::GLStateCache& ck::GLStateCache::get_instance()
+{
+    if (singleton == nullptr) { singleton = new GLStateCache(); }
+    return *singleton;
+}
+
+ck::GLStateCache::GLStateCache() : frame_counters{0, 0}, last_frame_counters{0, 0}
+{
+    invalidate();
+}
+
+void ck::GLStateCache::invalidate()
+{
+    program             = UNKNOWN;
+    vertex_array        = UNKNOWN;
+    active_texture_unit = UNKNOWN;
+    for (auto& unit : textures)
+    {
+        unit.fill(UNKNOWN);
+    }
+    buffers.fill(UNKNOWN);
+    capabilities.fill(UNKNOWN);
+
+    blend_func.fill(UNKNOWN);
+    depth_func = UNKNOWN;
+    depth_mask = UNKNOWN;
+    cull_face  = UNKNOWN;
+    front_face = UNKNOWN;
+    stencil_func.fill(UNKNOWN);
+    stencil_op.fill(UNKNOWN);
+    stencil_mask       = 0;
+    stencil_mask_known = false;
+}
+
+void ck::GLStateCache::begin_frame()
+{
+    last_frame_counters = frame_counters;
+    frame_counters      = {0, 0};
+}
+
+[[nodiscard]] const ck::GLStateCounters& ck::GLStateCache::get_last_frame_counters() const
+{
+    return last_frame_counters;
+}
+
+bool ck::GLStateCache::update(uint32_t& shadow, const uint32_t value)
+{
+    if (shadow == value)
+    {
+        frame_counters.skipped++;
+        return false;
+    }
+    shadow = value;
+    frame_counters.issued++;
+    return true;
+}
+
+[[nodiscard]] uint32_t ck::GLStateCache::get_texture_target_index(const GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_2D: return TEXTURE_2D;
+        case GL_TEXTURE_CUBE_MAP: return TEXTURE_CUBE_MAP;
+        case GL_TEXTURE_2D_ARRAY: return TEXTURE_2D_ARRAY;
+        default: return TEXTURE_TARGET_NUM;
+    }
+}
+
+[[nodiscard]] uint32_t ck::GLStateCache::get_buffer_target_index(const GLenum target)
+{
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER: return ARRAY_BUFFER;
+        case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY_BUFFER;
+        case GL_UNIFORM_BUFFER: return UNIFORM_BUFFER;
+        case GL_SHADER_STORAGE_BUFFER: return SHADER_STORAGE_BUFFER;
+        case GL_DRAW_INDIRECT_BUFFER: return DRAW_INDIRECT_BUFFER;
+        case GL_PIXEL_UNPACK_BUFFER: return PIXEL_UNPACK_BUFFER;
+        default: return BUFFER_TARGET_NUM;
+    }
+}
+
+[[nodiscard]] uint32_t ck::GLStateCache::get_capability_index(const GLenum capability)
+{
+    switch (capability)
+    {
+        case GL_DEPTH_TEST: return DEPTH_TEST;
+        case GL_STENCIL_TEST: return STENCIL_TEST;
+        case GL_BLEND: return BLEND;
+        case GL_CULL_FACE: return CULL_FACE;
+        case GL_SCISSOR_TEST: return SCISSOR_TEST;
+        case GL_POLYGON_OFFSET_FILL: return POLYGON_OFFSET_FILL;
+        default: return CAPABILITY_NUM;
+    }
+}
+
+// ANCHOR - 绑定
+
+void ck::GLStateCache::use_program(const uint32_t program_id)
+{
+    if (update(program, program_id)) { glUseProgram(program_id); }
+}
+
+void ck::GLStateCache::bind_vertex_array(const uint32_t vao)
+{
+    if (update(vertex_array, vao))
+    {
+        glBindVertexArray(vao);
+        buffers[ELEMENT_ARRAY_BUFFER] = UNKNOWN;  // 索引缓冲的绑定跟着VAO走
+    }
+}
+
+void ck::GLStateCache::active_texture(const uint32_t unit)
+{
+    if (update(active_texture_unit, unit)) { glActiveTexture(GL_TEXTURE0 + unit); }
+}
+
+void ck::GLStateCache::bind_texture(const uint32_t unit,
+                                    const GLenum   target,
+                                    const uint32_t texture)
+{
+    const uint32_t target_index = get_texture_target_index(target);
+    if (unit >= MAX_TRACKED_TEXTURE_UNITS || target_index == TEXTURE_TARGET_NUM)
+    {
+        // 不缓存的纹理单元/目标，直接透传
+        active_texture(unit);
+        glBindTexture(target, texture);
+        frame_counters.issued++;
+        return;
+    }
+    if (textures[unit][target_index] == texture)
+    {
+        frame_counters.skipped++;
+        return;
+    }
+    active_texture(unit);
+    update(textures[unit][target_index], texture);
+    glBindTexture(target, texture);
+}
+
+void ck::GLStateCache::bind_buffer(const GLenum target, const uint32_t buffer)
+{
+    const uint32_t target_index = get_buffer_target_index(target);
+    if (target_index == BUFFER_TARGET_NUM)
+    {
+        glBindBuffer(target, buffer);
+        frame_counters.issued++;
+        return;
+    }
+    if (update(buffers[target_index], buffer)) { glBindBuffer(target, buffer); }
+}
+
+void ck::GLStateCache::bind_buffer_base(const GLenum   target,
+                                        const uint32_t index,
+                                        const uint32_t buffer)
+{
+    glBindBufferBase(target, index, buffer);
+    frame_counters.issued++;
+    // NOTE - glBindBufferBase同时会修改通用绑定点
+    const uint32_t target_index = get_buffer_target_index(target);
+    if (target_index != BUFFER_TARGET_NUM) { buffers[target_index] = buffer; }
+}
+
+void ck::GLStateCache::bind_buffer_range(const GLenum     target,
+                                         const uint32_t   index,
+                                         const uint32_t   buffer,
+                                         const GLintptr   offset,
+                                         const GLsizeiptr size)
+{
+    glBindBufferRange(target, index, buffer, offset, size);
+    frame_counters.issued++;
+    // NOTE - 和glBindBufferBase一样会修改通用绑定点
+    const uint32_t target_index = get_buffer_target_index(target);
+    if (target_index != BUFFER_TARGET_NUM) { buffers[target_index] = buffer; }
+}
+
+// ANCHOR - 固定管线状态
+
+void ck::GLStateCache::set_capability(const GLenum capability, const bool enabled)
+{
+    const uint32_t index = get_capability_index(capability);
+    if (index == CAPABILITY_NUM)
+    {
+        enabled ? glEnable(capability) : glDisable(capability);
+        frame_counters.issued++;
+        return;
+    }
+    if (update(capabilities[index], static_cast<uint32_t>(enabled)))
+    {
+        enabled ? glEnable(capability) : glDisable(capability);
+    }
+}
+
+void ck::GLStateCache::set_blend_func(const GLenum src_factor, const GLenum dst_factor)
+{
+    if (blend_func[0] == src_factor && blend_func[1] == dst_factor)
+    {
+        frame_counters.skipped++;
+        return;
+    }
+    blend_func = {src_factor, dst_factor};
+    frame_counters.issued++;
+    glBlendFunc(src_factor, dst_factor);
+}
+
+void ck::GLStateCache::set_depth_func(const GLenum func)
+{
+    if (update(depth_func, func)) { glDepthFunc(func); }
+}
+
+void ck::GLStateCache::set_depth_mask(const bool enabled)
+{
+    if (update(depth_mask, static_cast<uint32_t>(enabled)))
+    {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void ck::GLStateCache::set_cull_face(const GLenum mode)
+{
+    if (update(cull_face, mode)) { glCullFace(mode); }
+}
+
+void ck::GLStateCache::set_front_face(const GLenum mode)
+{
+    if (update(front_face, mode)) { glFrontFace(mode); }
+}
+
+void ck::GLStateCache::set_stencil_func(const GLenum func, const int32_t ref, const uint32_t mask)
+{
+    if (stencil_func[0] == func && stencil_func[1] == static_cast<uint32_t>(ref) &&
+        stencil_func[2] == mask)
+    {
+        frame_counters.skipped++;
+        return;
+    }
+    stencil_func = {func, static_cast<uint32_t>(ref), mask};
+    frame_counters.issued++;
+    glStencilFunc(func, ref, mask);
+}
+
+void ck::GLStateCache::set_stencil_op(const GLenum stencil_fail,
+                                      const GLenum depth_fail,
+                                      const GLenum depth_pass)
+{
+    if (stencil_op[0] == stencil_fail && stencil_op[1] == depth_fail &&
+        stencil_op[2] == depth_pass)
+    {
+        frame_counters.skipped++;
+        return;
+    }
+    stencil_op = {stencil_fail, depth_fail, depth_pass};
+    frame_counters.issued++;
+    glStencilOp(stencil_fail, depth_fail, depth_pass);
+}
+
+void ck::GLStateCache::set_stencil_mask(const uint32_t mask)
+{
+    if (stencil_mask_known && stencil_mask == mask)
+    {
+        frame_counters.skipped++;
+        return;
+    }
+    stencil_mask       = mask;
+    stencil_mask_known = true;
+    frame_counters.issued++;
+    glStencilMask(mask);
+}
+
+// ANCHOR - 对象删除通知
+
+void ck::GLStateCache::on_program_deleted(const uint32_t program_id)
+{
+    if (program == program_id) { program = UNKNOWN; }
+}
+
+void ck::GLStateCache::on_vertex_array_deleted(const uint32_t vao)
+{
+    if (vertex_array == vao)
+    {
+        vertex_array                  = UNKNOWN;
+        buffers[ELEMENT_ARRAY_BUFFER] = UNKNOWN;
+    }
+}
+
+void ck::GLStateCache::on_texture_deleted(const uint32_t texture)
+{
+    for (auto& unit : textures)
+    {
+        for (auto& bound_texture : unit)
+        {
+            if (bound_texture == texture) { bound_texture = UNKNOWN; }
+        }
+    }
+}
+
+void ck::GLStateCache::on_buffer_deleted(const uint32_t buffer)
+{
+    for (auto& bound_buffer : buffers)
+    {
+        if (bound_buffer == buffer) { bound_buffer = UNKNOWN; }
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+
+#include <glad/glad.h>
+
+namespace ck {
+
+static const uint32_t MAX_TRACKED_TEXTURE_UNITS = 32;
+
+/// @brief 一帧之内的状态切换计数
+struct GLStateCounters
+{
+    uint32_t issued;   // 真正提交给驱动的调用
+    uint32_t skipped;  // 和影子状态相同而被跳过的调用
+};
+
+/// @brief GL状态缓存：在CPU侧保存一份“影子状态”，跳过冗余的状态切换
+/// @note 设计成单例类，只能在GL线程使用
+/**NOTE - 使用约定
+1. 所有经过缓存的状态都必须通过GLStateCache修改，否则影子状态会和驱动状态不一致；
+   ImGui等第三方代码直接修改状态后，调用invalidate()让所有影子状态失效。
+2. 删除纹理/缓冲/VAO/程序之前调用对应的on_xxx_deleted()：
+   GL会把被删除的对象从绑定点上解绑，之后同名的新对象不能被误判为“已经绑定”。
+3. GL_ELEMENT_ARRAY_BUFFER的绑定属于VAO状态，切换VAO后它的影子状态自动失效。
+4. 只缓存常用的纹理目标（2D/CUBE_MAP/2D_ARRAY）和缓冲目标，其他目标直接透传。
+*/
+class GLStateCache {
+private:
+    // 影子状态失效；只用于不会取到这个值的状态（对象名、枚举），
+    // stencil_func/stencil_op/blend_func中总有一个枚举，整组比较时不会误判
+    static const uint32_t UNKNOWN = 0xFFFFFFFF;
+
+    enum TextureTargetIndex : uint32_t {
+        TEXTURE_2D,
+        TEXTURE_CUBE_MAP,
+        TEXTURE_2D_ARRAY,
+        TEXTURE_TARGET_NUM
+    };
+    enum BufferTargetIndex : uint32_t {
+        ARRAY_BUFFER,
+        ELEMENT_ARRAY_BUFFER,
+        UNIFORM_BUFFER,
+        SHADER_STORAGE_BUFFER,
+        DRAW_INDIRECT_BUFFER,
+        PIXEL_UNPACK_BUFFER,
+        BUFFER_TARGET_NUM
+    };
+    enum CapabilityIndex : uint32_t {
+        DEPTH_TEST,
+        STENCIL_TEST,
+        BLEND,
+        CULL_FACE,
+        SCISSOR_TEST,
+        POLYGON_OFFSET_FILL,
+        CAPABILITY_NUM
+    };
+
+    uint32_t program;
+    uint32_t vertex_array;
+    uint32_t active_texture_unit;
+    std::array<std::array<uint32_t, TEXTURE_TARGET_NUM>, MAX_TRACKED_TEXTURE_UNITS> textures;
+    std::array<uint32_t, BUFFER_TARGET_NUM>                                        buffers;
+    std::array<uint32_t, CAPABILITY_NUM>                                           capabilities;
+
+    std::array<uint32_t, 2> blend_func;  // src, dst
+    uint32_t                depth_func;
+    uint32_t                depth_mask;
+    uint32_t                cull_face;
+    uint32_t                front_face;
+    std::array<uint32_t, 3> stencil_func;  // func, ref, mask
+    std::array<uint32_t, 3> stencil_op;    // sfail, dpfail, dppass
+    uint32_t                stencil_mask;
+    bool                    stencil_mask_known;  // ~0u是合法的写掩码，不能用UNKNOWN表示失效
+
+    GLStateCounters frame_counters;
+    GLStateCounters last_frame_counters;
+
+    static GLStateCache* singleton;
+    // NOTE - 故意不释放：Mesh/Texture可能在静态析构阶段才析构，并通知缓存对象被删除
+    GLStateCache();
+
+    /// @brief 比较并更新影子状态，返回是否需要真正调用GL
+    bool update(uint32_t& shadow, uint32_t value);
+
+    [[nodiscard]] static uint32_t get_texture_target_index(GLenum target);
+    [[nodiscard]] static uint32_t get_buffer_target_index(GLenum target);
+    [[nodiscard]] static uint32_t get_capability_index(GLenum capability);
+
+public:
+    static GLStateCache& get_instance();
+
+    GLStateCache(const GLStateCache&)            = delete;
+    GLStateCache& operator=(const GLStateCache&) = delete;
+
+    /// @brief 让所有影子状态失效，下一次设置一定会提交给驱动
+    void invalidate();
+
+    /// @brief 每帧开始时调用，结算上一帧的计数
+    void begin_frame();
+    [[nodiscard]] const GLStateCounters& get_last_frame_counters() const;
+
+    // 绑定
+    void use_program(uint32_t program_id);
+    void bind_vertex_array(uint32_t vao);
+    void active_texture(uint32_t unit);
+    void bind_texture(uint32_t unit, GLenum target, uint32_t texture);
+    void bind_buffer(GLenum target, uint32_t buffer);
+    void bind_buffer_base(GLenum target, uint32_t index, uint32_t buffer);
+    void bind_buffer_range(GLenum     target,
+                           uint32_t   index,
+                           uint32_t   buffer,
+                           GLintptr   offset,
+                           GLsizeiptr size);
+
+    // 固定管线状态
+    void set_capability(GLenum capability, bool enabled);
+    void set_blend_func(GLenum src_factor, GLenum dst_factor);
+    void set_depth_func(GLenum func);
+    void set_depth_mask(bool enabled);
+    void set_cull_face(GLenum mode);
+    void set_front_face(GLenum mode);
+    void set_stencil_func(GLenum func, int32_t ref, uint32_t mask);
+    void set_stencil_op(GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass);
+    void set_stencil_mask(uint32_t mask);
+
+    // 对象删除通知
+    void on_program_deleted(uint32_t program_id);
+    void on_vertex_array_deleted(uint32_t vao);
+    void on_texture_deleted(uint32_t texture);
+    void on_buffer_deleted(uint32_t buffer);
+};
+
+};  // namespace ck
@@ -0,0 +1,231 @@
+#include "ck_gpu_profiler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glog/logging.h>
+
+ck::GpuProfiler* ck::GpuProfiler::singleton = nullptr;
+
+ck::GpuProfiler& ck::GpuProfiler::get_instance()
+{
+    if (singleton == nullptr) { singleton = new GpuProfiler(); }
+    return *singleton;
+}
+
+ck::GpuProfiler::GpuProfiler()
+    : enabled(true), next_enabled(true), frames{}, frame_index(0), frame_counter(0),
+      scope_stack{}, scope_depth(0), dropped_frame_num(0)
+{
+}
+
+void ck::GpuProfiler::begin_frame()
+{
+    if (scope_depth != 0)
+    {
+        LOG(WARNING) << "GpuProfiler: " << scope_depth << " scopes are still open at begin_frame()";
+        // 没有关闭的作用域按现在结束，GPU时间记为0
+        const uint32_t pushed = std::min(scope_depth, GPU_PROFILER_MAX_DEPTH);
+        for (uint32_t i = 0; i < pushed; i++)
+        {
+            frames[frame_index].records[scope_stack[i]].cpu_end = Clock::now();
+            glPopDebugGroup();
+        }
+        scope_depth = 0;
+    }
+    enabled = next_enabled;
+    frame_counter++;
+    frame_index = (frame_index + 1) % GPU_PROFILER_LATENCY;
+
+    // 这一组是GPU_PROFILER_LATENCY帧之前记录的，最后一个查询可用说明整帧都已经完成
+    FrameRecord& frame = frames[frame_index];
+    if (frame.pending)
+    {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(frame.queries[frame.query_num - 1], GL_QUERY_RESULT_AVAILABLE,
+                            &available);
+        if (available == GL_TRUE) { resolve(frame); }
+        else { dropped_frame_num++; }
+    }
+    frame.records.clear();
+    frame.query_num = 0;
+    frame.frame     = frame_counter;
+    frame.pending   = false;
+}
+
+uint32_t ck::GpuProfiler::acquire_query(FrameRecord& frame)
+{
+    if (frame.query_num == frame.queries.size())
+    {
+        uint32_t query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.query_num++;
+}
+
+void ck::GpuProfiler::begin_scope(const char* name)
+{
+    if (!enabled) { return; }
+    if (scope_depth >= GPU_PROFILER_MAX_DEPTH)
+    {
+        scope_depth++;  // 太深的作用域不记录，只保证end_scope()能配对
+        return;
+    }
+    FrameRecord&   frame  = frames[frame_index];
+    const uint32_t record = static_cast<uint32_t>(frame.records.size());
+    const uint32_t parent =
+        (scope_depth > 0) ? scope_stack[scope_depth - 1] : GPU_PROFILER_NULL_NODE;
+    const uint32_t query  = acquire_query(frame);
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    glQueryCounter(frame.queries[query], GL_TIMESTAMP);
+    frame.records.push_back({name, parent, query, query, Clock::now(), {}});
+    scope_stack[scope_depth++] = record;
+}
+
+void ck::GpuProfiler::end_scope()
+{
+    if (scope_depth == 0) { return; }  // 作用域打开时计时器是关闭的
+    scope_depth--;
+    if (scope_depth >= GPU_PROFILER_MAX_DEPTH) { return; }
+
+    FrameRecord& frame  = frames[frame_index];
+    ScopeRecord& record = frame.records[scope_stack[scope_depth]];
+    record.cpu_end      = Clock::now();
+    record.end_query    = acquire_query(frame);
+    glQueryCounter(frame.queries[record.end_query], GL_TIMESTAMP);
+    glPopDebugGroup();
+    frame.pending = true;
+}
+
+[[nodiscard]] uint32_t ck::GpuProfiler::find_or_add_node(const uint32_t parent, const char* name)
+{
+    const std::vector<uint32_t>& siblings =
+        (parent == GPU_PROFILER_NULL_NODE) ? root_nodes : nodes[parent].children;
+    for (const uint32_t sibling : siblings)
+    {
+        const char* sibling_name = nodes[sibling].name;
+        if (sibling_name == name || std::strcmp(sibling_name, name) == 0) { return sibling; }
+    }
+
+    const auto index = static_cast<uint32_t>(nodes.size());
+    GpuProfileNode node{};
+    node.name   = name;
+    node.parent = parent;
+    node.depth  = (parent == GPU_PROFILER_NULL_NODE) ? 0 : nodes[parent].depth + 1;
+    nodes.push_back(std::move(node));
+    if (parent == GPU_PROFILER_NULL_NODE) { root_nodes.push_back(index); }
+    else { nodes[parent].children.push_back(index); }
+    return index;
+}
+
+void ck::GpuProfiler::resolve(FrameRecord& frame)
+{
+    // 父作用域总是先于子作用域记录，按顺序归并时父节点已经存在
+    record_nodes.resize(frame.records.size());
+    for (size_t i = 0; i < frame.records.size(); i++)
+    {
+        const ScopeRecord& record = frame.records[i];
+        const uint32_t     parent =
+            (record.parent == GPU_PROFILER_NULL_NODE) ? record.parent : record_nodes[record.parent];
+        record_nodes[i] = find_or_add_node(parent, record.name);
+    }
+    frame_cpu_ms.assign(nodes.size(), 0.0F);
+    frame_gpu_ms.assign(nodes.size(), 0.0F);
+    for (size_t i = 0; i < frame.records.size(); i++)
+    {
+        const ScopeRecord& record = frame.records[i];
+        // 只检查过最后一个查询，其他的用NO_WAIT读取，万一还没有结果也不会阻塞
+        GLuint64 begin = 0;
+        GLuint64 end   = 0;
+        glGetQueryObjectui64v(frame.queries[record.begin_query], GL_QUERY_RESULT_NO_WAIT, &begin);
+        glGetQueryObjectui64v(frame.queries[record.end_query], GL_QUERY_RESULT_NO_WAIT, &end);
+        const uint32_t node     = record_nodes[i];
+        const auto     cpu_time = record.cpu_end - record.cpu_begin;
+        frame_cpu_ms[node] += std::chrono::duration<float, std::milli>(cpu_time).count();
+        frame_gpu_ms[node] += (end > begin) ? static_cast<float>(end - begin) * 1e-6F : 0.0F;
+        nodes[node].last_frame = frame.frame;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        GpuProfileNode& node = nodes[i];
+        if (node.last_frame != frame.frame) { continue; }
+        node.cpu_history[node.history_head] = frame_cpu_ms[i];
+        node.gpu_history[node.history_head] = frame_gpu_ms[i];
+        node.history_head                   = (node.history_head + 1) % GPU_PROFILER_HISTORY;
+        node.sample_num                     = std::min(node.sample_num + 1, GPU_PROFILER_HISTORY);
+
+        float cpu_sum = 0.0F;
+        float gpu_sum = 0.0F;
+        for (uint32_t s = 0; s < node.sample_num; s++)
+        {
+            cpu_sum += node.cpu_history[s];
+            gpu_sum += node.gpu_history[s];
+        }
+        node.cpu_ms = cpu_sum / static_cast<float>(node.sample_num);
+        node.gpu_ms = gpu_sum / static_cast<float>(node.sample_num);
+    }
+}
+
+void ck::GpuProfiler::set_enabled(const bool value)
+{
+    next_enabled = value;
+}
+
+[[nodiscard]] bool ck::GpuProfiler::is_enabled() const
+{
+    return next_enabled;
+}
+
+[[nodiscard]] const std::vector<ck::GpuProfileNode>& ck::GpuProfiler::get_nodes() const
+{
+    return nodes;
+}
+
+[[nodiscard]] const std::vector<uint32_t>& ck::GpuProfiler::get_root_nodes() const
+{
+    return root_nodes;
+}
+
+[[nodiscard]] uint32_t ck::GpuProfiler::get_dropped_frame_num() const
+{
+    return dropped_frame_num;
+}
+
+[[nodiscard]] bool ck::GpuProfiler::is_node_active(const GpuProfileNode& node) const
+{
+    if (node.sample_num == 0) { return false; }
+    return node.last_frame + GPU_PROFILER_LATENCY + GPU_PROFILER_HISTORY > frame_counter;
+}
+
+void ck::GpuProfiler::reset()
+{
+    nodes.clear();
+    root_nodes.clear();
+    dropped_frame_num = 0;
+}
+
+void ck::GpuProfiler::shutdown()
+{
+    for (FrameRecord& frame : frames)
+    {
+        if (!frame.queries.empty())
+        {
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        }
+        frame.queries.clear();
+        frame.records.clear();
+        frame.query_num = 0;
+        frame.pending   = false;
+    }
+    scope_depth = 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace ck {
+
+static const uint32_t GPU_PROFILER_LATENCY   = 4;   // 查询结果晚几帧读回
+static const uint32_t GPU_PROFILER_HISTORY   = 64;  // 滑动平均的帧数
+static const uint32_t GPU_PROFILER_MAX_DEPTH = 16;
+static const uint32_t GPU_PROFILER_NULL_NODE = 0xFFFFFFFF;
+
+/// @brief 计时树上的一个节点：同一个父节点下同名的作用域每帧都累计到同一个节点
+struct GpuProfileNode
+{
+    const char*           name;  // 作用域的名字必须是字符串字面量（或者生命周期足够长）
+    uint32_t              parent;
+    uint32_t              depth;
+    std::vector<uint32_t> children;
+
+    // 最近GPU_PROFILER_HISTORY帧的样本（毫秒），同一帧内多次进入的作用域时间相加
+    std::array<float, GPU_PROFILER_HISTORY> cpu_history;
+    std::array<float, GPU_PROFILER_HISTORY> gpu_history;
+    uint32_t                                history_head;
+    uint32_t                                sample_num;
+    float                                   cpu_ms;  // 滑动平均
+    float                                   gpu_ms;
+    uint64_t                                last_frame;  // 最后一次出现的帧
+};
+
+/// @brief GPU计时器：嵌套的作用域 + 时间戳查询，几帧之后再读回结果，永远不阻塞
+/// @note 设计成单例类，只能在GL线程使用
+/**NOTE - 非阻塞的GPU计时
+1. 每个作用域开始和结束时各调用一次glQueryCounter(GL_TIMESTAMP)，
+   同时用glPushDebugGroup/glPopDebugGroup标记，RenderDoc/Nsight里能看到同样的层级。
+   时间戳查询可以任意嵌套（GL_TIME_ELAPSED不行）。
+2. 查询对象按帧分成GPU_PROFILER_LATENCY组轮流使用。begin_frame()轮到一组时，
+   这组是GPU_PROFILER_LATENCY帧之前记录的：最后一个查询已经可用才读回整组，
+   否则丢弃这一帧的数据（记入dropped_frame_num），不会调用会阻塞的glGetQueryObject。
+3. 读回的作用域按(父节点, 名字)归并到计时树上，每个节点保留最近GPU_PROFILER_HISTORY帧的样本，
+   显示滑动平均。CPU时间是同一个作用域在CPU上的耗时（提交命令的时间）。
+*/
+class GpuProfiler {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ScopeRecord
+    {
+        const char*       name;
+        uint32_t          parent;       // 在本帧records中的下标
+        uint32_t          begin_query;  // 在本帧queries中的下标
+        uint32_t          end_query;
+        Clock::time_point cpu_begin;
+        Clock::time_point cpu_end;
+    };
+
+    struct FrameRecord
+    {
+        std::vector<ScopeRecord> records;
+        std::vector<uint32_t>    queries;    // 按需增长，不释放
+        uint32_t                 query_num;  // 本帧用到的查询数
+        uint64_t                 frame;
+        bool                     pending;  // 有还没读回的结果
+    };
+
+    bool                                          enabled;
+    bool                                          next_enabled;  // 在下一帧开始时生效
+    std::array<FrameRecord, GPU_PROFILER_LATENCY> frames;
+    uint32_t                                      frame_index;  // 本帧使用的一组
+    uint64_t                                      frame_counter;
+    std::array<uint32_t, GPU_PROFILER_MAX_DEPTH>  scope_stack;  // 打开的作用域在records中的下标
+    uint32_t                                      scope_depth;
+    uint32_t                                      dropped_frame_num;
+
+    std::vector<GpuProfileNode> nodes;
+    std::vector<uint32_t>       root_nodes;
+    std::vector<uint32_t>       record_nodes;  // 读回时每条记录对应的节点，复用内存
+    std::vector<float>          frame_cpu_ms;  // 读回时每个节点在这一帧的累计时间
+    std::vector<float>          frame_gpu_ms;
+
+    static GpuProfiler* singleton;
+    // NOTE - 故意不释放，查询对象由shutdown()在GL上下文销毁之前删除
+    GpuProfiler();
+
+    /// @brief 读回一组已经完成的查询，归并到计时树上
+    void resolve(FrameRecord& frame);
+    [[nodiscard]] uint32_t find_or_add_node(uint32_t parent, const char* name);
+    uint32_t               acquire_query(FrameRecord& frame);
+
+public:
+    static GpuProfiler& get_instance();
+
+    GpuProfiler(const GpuProfiler&)            = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    /// @brief 每帧开始时调用一次，读回GPU_PROFILER_LATENCY帧之前的结果
+    void begin_frame();
+
+    /// @brief 打开一个作用域，需要和end_scope()成对调用，一般用GpuProfileScope
+    void begin_scope(const char* name);
+    void end_scope();
+
+    void set_enabled(bool value);
+
+    [[nodiscard]] bool                               is_enabled() const;
+    [[nodiscard]] const std::vector<GpuProfileNode>& get_nodes() const;
+    [[nodiscard]] const std::vector<uint32_t>&       get_root_nodes() const;
+    [[nodiscard]] uint32_t                           get_dropped_frame_num() const;
+
+    /// @brief 在最近GPU_PROFILER_HISTORY帧里出现过的节点才算活跃
+    [[nodiscard]] bool is_node_active(const GpuProfileNode& node) const;
+
+    /// @brief 清空计时树
+    void reset();
+
+    /// @brief 释放查询对象，需要在销毁GL上下文之前调用
+    void shutdown();
+};
+
+/// @brief RAII的GPU计时作用域
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char* name) { GpuProfiler::get_instance().begin_scope(name); }
+    ~GpuProfileScope() { GpuProfiler::get_instance().end_scope(); }
+
+    GpuProfileScope(const GpuProfileScope&)            = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+};  // namespace ck
+
+#define CK_GPU_PROFILE_CONCAT_(a, b) a##b
+#define CK_GPU_PROFILE_CONCAT(a, b)  CK_GPU_PROFILE_CONCAT_(a, b)
+/// @brief 在当前作用域内计时，name需要是字符串字面量
+#define CK_GPU_PROFILE_SCOPE(name) \
+    const ck::GpuProfileScope CK_GPU_PROFILE_CONCAT(ck_gpu_profile_scope_, __LINE__)(name)
@@ -0,0 +1,151 @@
+#include "ck_job_benchmark.h"
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "ck_job_system.h"
+
+namespace {
+
+static const uint32_t BENCHMARK_ARRAY_SIZE = 1U << 24;  // parallel_for的元素数
+static const uint32_t BENCHMARK_GRAIN_SIZE = 1U << 14;
+static const uint32_t BENCHMARK_FAN_OUT    = 64;  // 依赖图每一层的任务数
+static const uint32_t BENCHMARK_LAYER_NUM  = 256;
+static const uint32_t BENCHMARK_REPEAT_NUM = 5;  // 取最好的一次，减少系统噪声
+
+/// @brief 执行BENCHMARK_REPEAT_NUM次fn，打印最短耗时
+template <typename Fn> double measure(const char* name, const uint32_t item_num, Fn&& fn)
+{
+    double best_ms = 0.0;
+    for (uint32_t i = 0; i < BENCHMARK_REPEAT_NUM; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto   end = std::chrono::steady_clock::now();
+        const double ms  = std::chrono::duration<double, std::milli>(end - start).count();
+        best_ms          = (i == 0 || ms < best_ms) ? ms : best_ms;
+    }
+    LOG(INFO) << "[job benchmark] " << name << ": " << best_ms << " ms ("
+              << best_ms * 1e6 / static_cast<double>(item_num) << " ns/item)";
+    return best_ms;
+}
+
+/// @brief 每个元素做一点计算，避免只测内存带宽
+inline uint64_t work_item(const uint32_t i)
+{
+    uint64_t x = i * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    return x ^ (x >> 29);
+}
+
+}  // namespace
+
+void ck::run_job_benchmark(const uint32_t job_num, const uint32_t worker_num)
+{
+    JobSystem& jobs = JobSystem::get_instance();
+    jobs.init(worker_num);
+    LOG(INFO) << "[job benchmark] " << jobs.get_thread_num() << " threads, " << job_num
+              << " jobs";
+
+    // 空任务：提交、窃取、计数器的开销
+    measure("run + wait (empty jobs)", job_num, [&]() {
+        std::atomic<uint32_t> executed(0);
+        JobCounter            counter;
+        for (uint32_t i = 0; i < job_num; i++)
+        {
+            jobs.run([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); },
+                     &counter);
+        }
+        jobs.wait(counter);
+        CHECK_EQ(executed.load(), job_num);
+    });
+
+    // 嵌套提交：每个任务再提交两个子任务，考验窃取
+    measure("nested run (binary tree)", job_num, [&]() {
+        std::atomic<uint32_t> executed(0);
+        JobCounter            counter;
+        std::function<void(uint32_t)> spawn = [&](const uint32_t node) {
+            executed.fetch_add(1, std::memory_order_relaxed);
+            for (const uint32_t child : {node * 2 + 1, node * 2 + 2})
+            {
+                if (child < job_num) { jobs.run([&spawn, child]() { spawn(child); }, &counter); }
+            }
+        };
+        jobs.run([&spawn]() { spawn(0); }, &counter);
+        jobs.wait(counter);
+        CHECK_EQ(executed.load(), job_num);
+    });
+
+    // parallel_for和串行循环对比
+    std::vector<uint64_t> values(BENCHMARK_ARRAY_SIZE, 0);
+    const double serial_ms = measure("serial for", BENCHMARK_ARRAY_SIZE, [&]() {
+        for (uint32_t i = 0; i < BENCHMARK_ARRAY_SIZE; i++)
+        {
+            values[i] = work_item(i);
+        }
+    });
+    const uint64_t expected = std::accumulate(values.begin(), values.end(), uint64_t{0});
+    const double   parallel_ms = measure("parallel_for", BENCHMARK_ARRAY_SIZE, [&]() {
+        jobs.parallel_for(0, BENCHMARK_ARRAY_SIZE, BENCHMARK_GRAIN_SIZE,
+                          [&values](const uint32_t first, const uint32_t last) {
+                              for (uint32_t i = first; i < last; i++)
+                              {
+                                  values[i] = work_item(i);
+                              }
+                          });
+    });
+    CHECK_EQ(std::accumulate(values.begin(), values.end(), uint64_t{0}), expected);
+    LOG(INFO) << "[job benchmark] parallel_for speedup: " << serial_ms / parallel_ms << "x";
+
+    // 依赖图：每层BENCHMARK_FAN_OUT个任务，全部依赖上一层完成
+    measure("run_after (layered graph)", BENCHMARK_FAN_OUT * BENCHMARK_LAYER_NUM, [&]() {
+        std::vector<JobCounter>            layers(BENCHMARK_LAYER_NUM);
+        std::vector<std::atomic<uint32_t>> finished(BENCHMARK_LAYER_NUM);
+        std::atomic<uint32_t>              violations(0);
+        for (uint32_t layer = 0; layer < BENCHMARK_LAYER_NUM; layer++)
+        {
+            for (uint32_t i = 0; i < BENCHMARK_FAN_OUT; i++)
+            {
+                auto job = [&finished, &violations, layer]() {
+                    // 上一层的计数器归零之后才会执行，它的所有任务一定都已经完成
+                    if (layer > 0 && finished[layer - 1].load() != BENCHMARK_FAN_OUT)
+                    {
+                        violations.fetch_add(1);
+                    }
+                    finished[layer].fetch_add(1);
+                };
+                if (layer == 0) { jobs.run(job, &layers[0]); }
+                else { jobs.run_after(layers[layer - 1], job, &layers[layer]); }
+            }
+        }
+        jobs.wait(layers.back());
+        CHECK_EQ(violations.load(), 0U);
+        CHECK_EQ(finished.back().load(), BENCHMARK_FAN_OUT);
+    });
+
+    // GL队列：工作线程提交，主线程执行
+    measure("run_on_main_thread", job_num, [&]() {
+        uint32_t   executed = 0;  // 只在主线程上修改，不需要原子
+        JobCounter counter;
+        jobs.parallel_for(0, job_num, BENCHMARK_GRAIN_SIZE / 16,
+                          [&](const uint32_t first, const uint32_t last) {
+                              for (uint32_t i = first; i < last; i++)
+                              {
+                                  jobs.run_on_main_thread([&executed]() { executed++; }, &counter);
+                              }
+                          });
+        jobs.wait(counter);
+        CHECK(jobs.is_main_thread() || jobs.get_thread_num() == 1);
+        CHECK_EQ(executed, job_num);
+    });
+
+    jobs.shutdown();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ck {
+
+static const uint32_t DEFAULT_JOB_BENCHMARK_JOB_NUM = 100000;
+
+/// @brief 任务系统的微基准测试：提交/执行开销、parallel_for、依赖链、GL队列
+/// @note 每一项都会检查结果，调度出错时CHECK失败；不需要GL上下文，在调用线程上init()任务系统
+/// @param worker_num 工作线程数，0表示按硬件线程数决定
+void run_job_benchmark(uint32_t job_num    = DEFAULT_JOB_BENCHMARK_JOB_NUM,
+                       uint32_t worker_num = 0);
+
+};  // namespace ck
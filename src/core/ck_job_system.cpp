@@ -0,0 +1,426 @@
+#include "ck_job_system.h"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "ck_cpu_profiler.h"
+
+struct ck::Job
+{
+    std::function<void()> function;
+    JobCounter*           counter;
+};
+
+namespace {
+
+thread_local uint32_t worker_index_of_thread = ck::NOT_A_JOB_WORKER;
+thread_local uint32_t steal_random_state     = 0x9E3779B9U;
+
+/// @brief xorshift32，选择窃取的对象
+uint32_t next_random()
+{
+    uint32_t x = steal_random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    steal_random_state = x;
+    return x;
+}
+
+}  // namespace
+
+// ANCHOR - 计数器
+
+ck::JobCounter::JobCounter() : pending(0) {}
+
+ck::JobCounter::~JobCounter()
+{
+    DCHECK(continuations.empty()) << "JobCounter destroyed with pending continuations";
+}
+
+[[nodiscard]] bool ck::JobCounter::is_done() const
+{
+    return pending.load(std::memory_order_acquire) == 0;
+}
+
+[[nodiscard]] uint32_t ck::JobCounter::get_pending() const
+{
+    return pending.load(std::memory_order_acquire);
+}
+
+// ANCHOR - 工作窃取队列
+
+ck::WorkStealingDeque::WorkStealingDeque() : top(0), bottom(0)
+{
+    static_assert((JOB_DEQUE_CAPACITY & (JOB_DEQUE_CAPACITY - 1)) == 0);
+    for (auto& slot : buffer)
+    {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+bool ck::WorkStealingDeque::push(Job* job)
+{
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= static_cast<int64_t>(JOB_DEQUE_CAPACITY)) { return false; }
+    buffer[static_cast<uint64_t>(b) & (JOB_DEQUE_CAPACITY - 1)].store(job,
+                                                                     std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);  // 发布任务的内容
+    return true;
+}
+
+[[nodiscard]] ck::Job* ck::WorkStealingDeque::pop()
+{
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_seq_cst);  // 先占住bottom，再看top
+    int64_t t = top.load(std::memory_order_seq_cst);
+    if (t > b)
+    {
+        // 队列是空的
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = buffer[static_cast<uint64_t>(b) & (JOB_DEQUE_CAPACITY - 1)].load(
+        std::memory_order_relaxed);
+    if (t == b)
+    {
+        // 最后一个任务，和窃取者争抢
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+[[nodiscard]] ck::Job* ck::WorkStealingDeque::steal()
+{
+    int64_t       t = top.load(std::memory_order_seq_cst);
+    const int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b) { return nullptr; }
+
+    Job* job = buffer[static_cast<uint64_t>(t) & (JOB_DEQUE_CAPACITY - 1)].load(
+        std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+    {
+        return nullptr;  // 被拥有者或者其他窃取者抢走了
+    }
+    return job;
+}
+
+[[nodiscard]] bool ck::WorkStealingDeque::empty() const
+{
+    return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+}
+
+// ANCHOR - 调度器
+
+std::unique_ptr<ck::JobSystem> ck::JobSystem::singleton = nullptr;
+
+ck::JobSystem& ck::JobSystem::get_instance()
+{
+    if (singleton == nullptr) { singleton.reset(new JobSystem()); }
+    return *singleton;
+}
+
+ck::JobSystem::JobSystem()
+    : injection_not_empty(false), queued_job_num(0), sleeping_worker_num(0), stopping(false),
+      initialized(false)
+{
+}
+
+ck::JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+void ck::JobSystem::init(uint32_t worker_num)
+{
+    if (initialized) { return; }
+    if (worker_num == 0)
+    {
+        const uint32_t hardware_threads = std::max(1U, std::thread::hardware_concurrency());
+        worker_num                      = hardware_threads - 1;  // 主线程也参与执行
+    }
+    worker_num = std::min(worker_num, MAX_JOB_WORKER_NUM - 1);
+
+    stopping.store(false);
+    initialized            = true;
+    worker_index_of_thread = 0;
+    deques.clear();
+    for (uint32_t i = 0; i <= worker_num; i++)
+    {
+        deques.push_back(std::make_unique<WorkStealingDeque>());
+    }
+    for (uint32_t i = 1; i <= worker_num; i++)
+    {
+        workers.emplace_back(&JobSystem::worker_loop, this, i);
+    }
+    LOG(INFO) << "Job system started with " << worker_num << " worker threads.";
+}
+
+void ck::JobSystem::shutdown()
+{
+    if (!initialized) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping.store(true);
+    }
+    sleep_cv.notify_all();
+    for (auto& worker : workers)
+    {
+        if (worker.joinable()) { worker.join(); }
+    }
+    workers.clear();
+
+    // 工作线程退出前会清空能拿到的任务，剩下的（比如主线程队列里的）在这里执行完
+    while (help_once()) {}
+    process_main_thread_jobs();
+
+    deques.clear();
+    initialized            = false;
+    worker_index_of_thread = NOT_A_JOB_WORKER;
+}
+
+[[nodiscard]] uint32_t ck::JobSystem::get_worker_index()
+{
+    return worker_index_of_thread;
+}
+
+void ck::JobSystem::worker_loop(const uint32_t worker_index)
+{
+    worker_index_of_thread = worker_index;
+    steal_random_state     = 0x9E3779B9U * (worker_index + 1);
+    CpuProfiler::get_instance().set_thread_name("job worker " + std::to_string(worker_index));
+
+    uint32_t spin = 0;
+    while (true)
+    {
+        if (Job* job = find_job(worker_index))
+        {
+            execute(job);
+            spin = 0;
+            continue;
+        }
+        if (stopping.load(std::memory_order_acquire)) { return; }
+        if (++spin < JOB_SPIN_BEFORE_SLEEP)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        /**NOTE - 不会丢失唤醒
+        睡眠前先增加sleeping_worker_num，再在锁内检查queued_job_num；
+        提交者先增加queued_job_num，再检查sleeping_worker_num，不为0时加锁通知。
+        两边都是seq_cst，至少有一边能看到另一边的修改。
+        */
+        spin = 0;
+        sleeping_worker_num.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_cv.wait(lock, [this] {
+                return stopping.load(std::memory_order_seq_cst) ||
+                       queued_job_num.load(std::memory_order_seq_cst) > 0;
+            });
+        }
+        sleeping_worker_num.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+void ck::JobSystem::wake_worker()
+{
+    if (sleeping_worker_num.load(std::memory_order_seq_cst) == 0) { return; }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_cv.notify_one();
+}
+
+void ck::JobSystem::schedule(Job* job)
+{
+    if (!initialized || workers.empty())
+    {
+        execute(job);  // 没有工作线程，直接执行
+        return;
+    }
+
+    queued_job_num.fetch_add(1, std::memory_order_seq_cst);
+    const uint32_t worker_index = get_worker_index();
+    if (worker_index < deques.size())
+    {
+        if (!deques[worker_index]->push(job))
+        {
+            queued_job_num.fetch_sub(1, std::memory_order_seq_cst);
+            execute(job);  // 队列满了，直接在当前线程执行
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(injection_mutex);
+        injection_queue.push_back(job);
+        injection_not_empty.store(true, std::memory_order_release);
+    }
+    wake_worker();
+}
+
+[[nodiscard]] ck::Job* ck::JobSystem::find_job(const uint32_t worker_index)
+{
+    Job* job = nullptr;
+    if (worker_index < deques.size()) { job = deques[worker_index]->pop(); }
+
+    if (job == nullptr && injection_not_empty.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(injection_mutex);
+        if (!injection_queue.empty())
+        {
+            job = injection_queue.front();
+            injection_queue.pop_front();
+        }
+        injection_not_empty.store(!injection_queue.empty(), std::memory_order_release);
+    }
+
+    if (job == nullptr && !deques.empty())
+    {
+        // 从随机的位置开始，依次尝试偷其他线程的任务
+        const auto     deque_num = static_cast<uint32_t>(deques.size());
+        const uint32_t start     = next_random() % deque_num;
+        for (uint32_t i = 0; i < deque_num && job == nullptr; i++)
+        {
+            const uint32_t victim = (start + i) % deque_num;
+            if (victim != worker_index) { job = deques[victim]->steal(); }
+        }
+    }
+
+    if (job != nullptr) { queued_job_num.fetch_sub(1, std::memory_order_seq_cst); }
+    return job;
+}
+
+void ck::JobSystem::execute(Job* job)
+{
+    CK_PROFILE_SCOPE("job");
+    job->function();
+    JobCounter* counter = job->counter;
+    delete job;
+    if (counter != nullptr) { finish(counter); }
+}
+
+void ck::JobSystem::finish(JobCounter* counter)
+{
+    /**NOTE - 计数器的生命周期
+    在锁内减计数：wait()看到归零后会再加一次锁，保证这里已经不再访问计数器，
+    等待者可以立刻销毁它（比如parallel_for中栈上的计数器）。
+    */
+    std::vector<Job*> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuation_mutex);
+        if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            ready.swap(counter->continuations);
+        }
+    }
+    for (Job* job : ready)
+    {
+        schedule(job);
+    }
+}
+
+bool ck::JobSystem::help_once()
+{
+    Job* job = find_job(get_worker_index());
+    if (job == nullptr) { return false; }
+    execute(job);
+    return true;
+}
+
+void ck::JobSystem::run(std::function<void()> function, JobCounter* counter)
+{
+    if (counter != nullptr) { counter->pending.fetch_add(1, std::memory_order_acq_rel); }
+    schedule(new Job{std::move(function), counter});
+}
+
+void ck::JobSystem::run_after(JobCounter&           dependency,
+                              std::function<void()> function,
+                              JobCounter*           counter)
+{
+    if (counter != nullptr) { counter->pending.fetch_add(1, std::memory_order_acq_rel); }
+    Job* job = new Job{std::move(function), counter};
+    {
+        std::lock_guard<std::mutex> lock(dependency.continuation_mutex);
+        if (dependency.pending.load(std::memory_order_acquire) != 0)
+        {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    schedule(job);  // 依赖已经完成
+}
+
+void ck::JobSystem::run_on_main_thread(std::function<void()> function, JobCounter* counter)
+{
+    if (counter != nullptr) { counter->pending.fetch_add(1, std::memory_order_acq_rel); }
+    Job* job = new Job{std::move(function), counter};
+    if (!initialized)
+    {
+        execute(job);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(main_thread_mutex);
+    main_thread_jobs.push_back(job);
+}
+
+void ck::JobSystem::wait(JobCounter& counter)
+{
+    while (counter.pending.load(std::memory_order_acquire) != 0)
+    {
+        if (help_once()) { continue; }
+        // GL任务只能由主线程执行，主线程等待时必须处理它们，否则可能互相等待
+        if (is_main_thread() && process_main_thread_jobs() > 0) { continue; }
+        std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> lock(counter.continuation_mutex);  // 等finish()放开计数器
+}
+
+uint32_t ck::JobSystem::process_main_thread_jobs()
+{
+    DCHECK(!initialized || is_main_thread()) << "main thread jobs must run on the main thread";
+    // 任务中可能再次wait()，重入这个函数，所以先把队列整个换出来
+    std::vector<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(main_thread_mutex);
+        if (main_thread_jobs.empty()) { return 0; }
+        jobs.swap(main_thread_jobs);
+    }
+    for (Job* job : jobs)
+    {
+        execute(job);
+    }
+    return static_cast<uint32_t>(jobs.size());
+}
+
+[[nodiscard]] uint32_t ck::JobSystem::get_thread_num() const
+{
+    return std::max<uint32_t>(1, static_cast<uint32_t>(deques.size()));
+}
+
+[[nodiscard]] bool ck::JobSystem::is_main_thread() const
+{
+    return initialized && get_worker_index() == 0;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ck {
+
+static const uint32_t JOB_DEQUE_CAPACITY    = 4096;  // 必须是2的幂
+static const uint32_t MAX_JOB_WORKER_NUM    = 64;
+static const uint32_t JOB_SPIN_BEFORE_SLEEP = 64;  // 找不到任务时先自旋几轮再睡眠
+static const uint32_t NOT_A_JOB_WORKER      = 0xFFFFFFFF;
+
+struct Job;
+class JobSystem;
+
+/// @brief 任务计数器：记录还没有完成的任务数，可以等待它归零，也可以让其他任务在它归零后执行
+/// @note 计数器必须活到它关联的所有任务都完成；归零之后可以重新使用
+class JobCounter {
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> pending;
+    std::mutex            continuation_mutex;
+    std::vector<Job*>     continuations;  // 归零后才调度的任务
+
+public:
+    JobCounter();
+    ~JobCounter();
+
+    JobCounter(const JobCounter&)            = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] bool     is_done() const;
+    [[nodiscard]] uint32_t get_pending() const;
+};
+
+/// @brief 固定容量的Chase-Lev工作窃取双端队列
+/**NOTE - 无锁双端队列
+拥有者在bottom端push/pop（后进先出，缓存友好），其他线程在top端steal（先进先出，偷走最早、
+通常也是最大的任务）。只有队列里剩最后一个任务时，pop和steal才需要用CAS争抢top。
+论文中的内存屏障（fence）在这里换成了seq_cst的原子操作，ThreadSanitizer可以正确理解。
+容量固定，满了push返回false，由调用者直接在当前线程执行这个任务。
+*/
+class WorkStealingDeque {
+private:
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::array<std::atomic<Job*>, JOB_DEQUE_CAPACITY> buffer;
+
+public:
+    WorkStealingDeque();
+
+    /// @note 只能由拥有者调用
+    bool push(Job* job);
+    /// @note 只能由拥有者调用
+    [[nodiscard]] Job* pop();
+    /// @note 任何线程都可以调用
+    [[nodiscard]] Job* steal();
+    [[nodiscard]] bool empty() const;
+};
+
+/// @brief 工作窃取的任务调度器
+/// @note 设计成单例类；调用init()的线程是主线程（GL线程），它也参与执行任务
+/**NOTE - 任务系统
+1. 每个工作线程（包括主线程）有一个自己的无锁双端队列，提交的任务放进当前线程的队列；
+   非工作线程（比如纹理解码线程）提交的任务放进一个加锁的注入队列。
+2. 空闲的线程依次尝试：自己的队列 -> 注入队列 -> 随机选一个线程偷任务；
+   都没有时自旋几轮，然后在条件变量上睡眠，有新任务时才被唤醒。
+3. 依赖用JobCounter表示：run()时计数加一，任务完成时减一；
+   run_after()提交的任务在依赖的计数器归零后才进入队列；
+   wait()在等待时也会执行其他任务，不会让调用线程空等。
+4. GL上下文只属于主线程。run_on_main_thread()提交的任务放进单独的GL队列，
+   只在主线程的process_main_thread_jobs()或者wait()中执行。
+5. 没有调用init()（比如基准测试）或者只有一个线程时，所有任务直接在调用线程上执行。
+*/
+class JobSystem {
+private:
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;  // 0号属于主线程
+    std::vector<std::thread>                        workers;
+
+    std::mutex        injection_mutex;
+    std::deque<Job*>  injection_queue;
+    std::atomic<bool> injection_not_empty;
+
+    std::mutex        main_thread_mutex;
+    std::vector<Job*> main_thread_jobs;
+
+    std::mutex              sleep_mutex;
+    std::condition_variable sleep_cv;
+    std::atomic<uint32_t>   queued_job_num;  // 在队列中、还没有被取走的任务数
+    std::atomic<uint32_t>   sleeping_worker_num;
+    std::atomic<bool>       stopping;
+    bool                    initialized;
+
+    static std::unique_ptr<JobSystem> singleton;
+    JobSystem();
+
+    void worker_loop(uint32_t worker_index);
+    /// @brief 把任务放进当前线程的队列（或者注入队列），必要时唤醒一个睡眠的线程
+    void schedule(Job* job);
+    void wake_worker();
+    [[nodiscard]] Job* find_job(uint32_t worker_index);
+    void               execute(Job* job);
+    void               finish(JobCounter* counter);
+    /// @brief 执行一个可用的任务
+    /// @return 没有可执行的任务时返回false
+    bool help_once();
+
+    [[nodiscard]] static uint32_t get_worker_index();
+
+public:
+    static JobSystem& get_instance();
+    ~JobSystem();
+
+    JobSystem(const JobSystem&)            = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /// @brief 启动工作线程，调用线程成为主线程
+    /// @param worker_num 不包括主线程，0表示按硬件线程数决定
+    void init(uint32_t worker_num = 0);
+    /// @brief 执行完所有剩下的任务，然后结束工作线程
+    void shutdown();
+
+    /// @brief 提交一个任务，counter不为空时计数加一，任务完成后减一
+    void run(std::function<void()> function, JobCounter* counter = nullptr);
+    /// @brief dependency归零之后再提交任务
+    void run_after(JobCounter&           dependency,
+                   std::function<void()> function,
+                   JobCounter*           counter = nullptr);
+    /// @brief 提交一个必须在主线程（GL上下文）上执行的任务
+    void run_on_main_thread(std::function<void()> function, JobCounter* counter = nullptr);
+
+    /// @brief 等待计数器归零，等待期间执行其他任务
+    void wait(JobCounter& counter);
+
+    /// @brief 执行GL队列中的所有任务，只能在主线程上调用，每帧一次
+    /// @return 执行的任务数
+    uint32_t process_main_thread_jobs();
+
+    /// @brief 把[begin, end)切成每段grain_size个，并行调用fn(first, last)，返回时全部完成
+    /// @note 调用线程执行第一段，然后在wait()中帮忙执行剩下的
+    template <typename Fn>
+    void parallel_for(const uint32_t begin, const uint32_t end, uint32_t grain_size, Fn&& fn)
+    {
+        if (end <= begin) { return; }
+        grain_size = (grain_size == 0) ? 1 : grain_size;
+        if (workers.empty() || end - begin <= grain_size)
+        {
+            fn(begin, end);
+            return;
+        }
+
+        JobCounter counter;
+        for (uint32_t first = begin + grain_size; first < end; first += grain_size)
+        {
+            const uint32_t last = (end - first > grain_size) ? first + grain_size : end;
+            run([&fn, first, last]() { fn(first, last); }, &counter);
+        }
+        fn(begin, begin + grain_size);
+        wait(counter);
+    }
+
+    [[nodiscard]] uint32_t get_thread_num() const;  // 包括主线程
+    [[nodiscard]] bool     is_main_thread() const;
+};
+
+};  // namespace ck
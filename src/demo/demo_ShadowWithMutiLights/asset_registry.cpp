@@ -0,0 +1,140 @@
+#include "asset_registry.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "model.h"
+#include "shader.h"
+
+bool ck::AssetRegistry::ShaderKey::operator==(const ShaderKey& other) const
+{
+    return path_ids == other.path_ids;
+}
+
+size_t ck::AssetRegistry::ShaderKeyHash::operator()(const ShaderKey& key) const
+{
+    // PathId是很小的递增整数，直接拼成64位再哈希
+    const uint64_t packed = (static_cast<uint64_t>(key.path_ids[0]) << 42U) ^
+                            (static_cast<uint64_t>(key.path_ids[1]) << 21U) ^
+                            static_cast<uint64_t>(key.path_ids[2]);
+    return std::hash<uint64_t>()(packed);
+}
+
+ck::AssetRegistry::AssetRegistry()
+{
+    paths.emplace_back();
+    path_ids.emplace(std::string(), EMPTY_PATH_ID);
+}
+
+std::string ck::AssetRegistry::canonicalize_path(const std::string& file_path)
+{
+    std::error_code error;
+    const auto      canonical_path = std::filesystem::weakly_canonical(file_path, error);
+    if (error) { return std::filesystem::path(file_path).lexically_normal().generic_string(); }
+    return canonical_path.generic_string();
+}
+
+uint32_t ck::AssetRegistry::intern(const std::string& file_path)
+{
+    const auto it = path_ids.find(file_path);
+    if (it != path_ids.end()) { return it->second; }
+
+    // 原始字符串没见过，规范化之后可能和已有的路径相同
+    std::string canonical_path = canonicalize_path(file_path);
+    uint32_t    path_id        = EMPTY_PATH_ID;
+    const auto  canonical_it   = path_ids.find(canonical_path);
+    if (canonical_it != path_ids.end()) { path_id = canonical_it->second; }
+    else
+    {
+        path_id = static_cast<uint32_t>(paths.size());
+        paths.push_back(canonical_path);
+        path_ids.emplace(std::move(canonical_path), path_id);
+    }
+    path_ids.emplace(file_path, path_id);  // 别名
+    return path_id;
+}
+
+[[nodiscard]] const std::string& ck::AssetRegistry::get_path(const uint32_t path_id) const
+{
+    return paths[path_id];
+}
+
+std::shared_ptr<ck::Model> ck::AssetRegistry::acquire_model(const std::string& model_file_path)
+{
+    const uint32_t path_id = intern(model_file_path);
+
+    auto it = models.find(path_id);
+    if (it == models.end())
+    {
+        it = models.emplace(path_id, std::make_shared<Model>(model_file_path)).first;
+    }
+    return it->second;
+}
+
+std::shared_ptr<ck::Shader>
+ck::AssetRegistry::acquire_shader(const std::array<std::string, 3>& shader_file_path)
+{
+    const ShaderKey key = {
+        {intern(shader_file_path[0]), intern(shader_file_path[1]), intern(shader_file_path[2])}
+    };
+
+    auto it = shaders.find(key);
+    if (it == shaders.end())
+    {
+        it = shaders
+                 .emplace(key, std::make_shared<Shader>(shader_file_path[0], shader_file_path[1],
+                                                        shader_file_path[2]))
+                 .first;
+    }
+    return it->second;
+}
+
+size_t ck::AssetRegistry::release_unused()
+{
+    size_t released_num = 0;
+    for (auto it = models.begin(); it != models.end();)
+    {
+        if (it->second.use_count() == 1)
+        {
+            it = models.erase(it);
+            released_num++;
+        }
+        else { it++; }
+    }
+    for (auto it = shaders.begin(); it != shaders.end();)
+    {
+        if (it->second.use_count() == 1)
+        {
+            it = shaders.erase(it);
+            released_num++;
+        }
+        else { it++; }
+    }
+    if (released_num > 0) { LOG(INFO) << "released " << released_num << " unused prototypes"; }
+    return released_num;
+}
+
+[[nodiscard]] size_t ck::AssetRegistry::get_path_num() const
+{
+    return paths.size() - 1;  // 不算空路径
+}
+
+[[nodiscard]] size_t ck::AssetRegistry::get_model_num() const
+{
+    return models.size();
+}
+
+[[nodiscard]] size_t ck::AssetRegistry::get_shader_num() const
+{
+    return shaders.size();
+}
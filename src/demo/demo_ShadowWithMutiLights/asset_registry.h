@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "model.h"
+#include "shader.h"
+
+namespace ck {
+
+static const uint32_t EMPTY_PATH_ID = 0;  // 空路径（比如没有几何着色器）
+
+/// @brief 场景中model/shader原型的注册表，按驻留后的路径做哈希查找
+/**NOTE - 路径驻留（interning）
+每个不同的路径只保存一份字符串，对应一个递增的PathId：
+1. 先用原始字符串查找，命中时不需要访问文件系统；
+2. 未命中时规范化路径再查找，"a/../b/cube.obj" 和 "b/cube.obj" 得到同一个PathId，
+   并把原始字符串记为别名，下次直接命中。
+model以PathId为键，shader以三个PathId组成的ShaderKey为键，
+批量添加成千上万个物体时每次查找都是O(1)，不再逐个比较完整的路径字符串。
+*/
+class AssetRegistry {
+private:
+    struct ShaderKey
+    {
+        std::array<uint32_t, 3> path_ids;
+
+        bool operator==(const ShaderKey& other) const;
+    };
+
+    struct ShaderKeyHash
+    {
+        size_t operator()(const ShaderKey& key) const;
+    };
+
+    std::vector<std::string>                  paths;     // PathId -> 规范化路径
+    std::unordered_map<std::string, uint32_t> path_ids;  // 原始路径/规范化路径 -> PathId
+
+    std::unordered_map<uint32_t, std::shared_ptr<Model>>                  models;
+    std::unordered_map<ShaderKey, std::shared_ptr<Shader>, ShaderKeyHash> shaders;
+
+    [[nodiscard]] static std::string canonicalize_path(const std::string& file_path);
+
+public:
+    AssetRegistry();
+
+    /// @return 路径对应的PathId，第一次出现时分配新的PathId
+    uint32_t intern(const std::string& file_path);
+    [[nodiscard]] const std::string& get_path(uint32_t path_id) const;
+
+    /// @brief 获取model原型，第一次获取时从文件加载
+    std::shared_ptr<Model>  acquire_model(const std::string& model_file_path);
+    /// @brief 获取shader原型，第一次获取时编译
+    std::shared_ptr<Shader> acquire_shader(const std::array<std::string, 3>& shader_file_path);
+
+    /// @brief 释放不再被任何物体引用的原型（引用计数为1，只有注册表自己持有）
+    /// @return 释放的原型数量
+    size_t release_unused();
+
+    [[nodiscard]] size_t get_path_num() const;
+    [[nodiscard]] size_t get_model_num() const;
+    [[nodiscard]] size_t get_shader_num() const;
+};
+
+};  // namespace ck
@@ -0,0 +1,286 @@
+/**NOTE - ck_bench
+无窗口的逐帧基准测试：在离屏帧缓冲里沿着脚本化的相机路径渲染场景描述，输出每帧的CPU/GPU时间。
+不需要GPU，CI上用Mesa llvmpipe也能跑出可比较的数字：
+
+    ck_bench <scene> [--frames N] [--warmup N] [--size WxH] [--samples N]
+             [--csv path] [--json path] [--trace path] [--no-gpu-culling] [--mesh-cache]
+
+scene的路径可以是绝对路径，也可以相对于资源目录；资源目录由环境变量CK_ASSET_ROOT指定。
+--trace从加载场景开始录制CPU作用域，结束后保存为Chrome trace。
+--mesh-cache在渲染之前对场景中的每个模型各加载两次：先删除.ckmesh（冷启动，Assimp导入并写缓存），
+再从刚写出的缓存加载（热启动），输出两者的耗时。
+llvmpipe报告的GL版本低于4.6时，用MESA_GL_VERSION_OVERRIDE=4.6 MESA_GLSL_VERSION_OVERRIDE=460。
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <glad/glad.h>  //GLAD first
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <glm/glm.hpp>
+#include <glog/logging.h>
+#include <stb_image.h>
+
+#include "core/ck_cpu_profiler.h"
+#include "core/ck_debug.h"
+#include "core/ck_gl_resource.h"
+#include "core/ck_gl_state.h"
+#include "core/ck_gpu_profiler.h"
+#include "core/ck_job_system.h"
+#include "frame_benchmark.h"
+#include "headless_context.h"
+#include "indirect_draw_buffer.h"
+#include "instance_buffer.h"
+#include "mesh_arena.h"
+#include "mesh_cache.h"
+#include "model.h"
+#include "offscreen_target.h"
+#include "scene.h"
+#include "scene_description.h"
+#include "texture_loader.h"
+
+namespace {
+
+std::string get_asset_root()
+{
+    const char* root = std::getenv("CK_ASSET_ROOT");
+    if (root == nullptr) { return "E:/Study/CodeProj/CookieKiss-Render/asset/"; }
+    std::string result(root);
+    if (!result.empty() && result.back() != '/') { result += '/'; }
+    return result;
+}
+
+}  // namespace
+
+// global variable
+extern const std::string stdAsset_root = get_asset_root();
+extern const std::string asset_root    = stdAsset_root + "asset_demo_ShadowWithMutiLights/";
+
+namespace {
+
+struct BenchOptions
+{
+    std::string scene_path;
+    uint32_t    frame_num{ck::DEFAULT_BENCHMARK_FRAME_NUM};
+    uint32_t    warmup_num{ck::DEFAULT_BENCHMARK_WARMUP_NUM};
+    uint32_t    width{1280};
+    uint32_t    height{720};
+    uint32_t    samples{ck::DEFAULT_OFFSCREEN_SAMPLES};
+    std::string csv_path{"ck_bench.csv"};
+    std::string json_path{"ck_bench.json"};
+    std::string trace_path;  // 为空时不录制CPU trace
+    bool        gpu_culling{true};
+    bool        mesh_cache{false};  // 比较冷/热启动加载模型的时间
+};
+
+void print_usage()
+{
+    std::printf("usage: ck_bench <scene> [--frames N] [--warmup N] [--size WxH] [--samples N]\n"
+                "                [--csv path] [--json path] [--trace path] [--no-gpu-culling]\n"
+                "                [--mesh-cache]\n");
+}
+
+/// @brief 把整段text解析为uint32_t，含非数字字符、负数或超出范围时返回false
+bool parse_uint(const char* text, uint32_t& value)
+{
+    const char* const end         = text + std::strlen(text);
+    const auto [parse_end, error] = std::from_chars(text, end, value);
+    return error == std::errc() && parse_end == end;
+}
+
+bool parse_options(const int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg       = argv[i];
+        const bool        has_value = i + 1 < argc;
+        if (arg == "--frames" && has_value)
+        {
+            if (!parse_uint(argv[++i], options.frame_num)) { return false; }
+        }
+        else if (arg == "--warmup" && has_value)
+        {
+            if (!parse_uint(argv[++i], options.warmup_num)) { return false; }
+        }
+        else if (arg == "--samples" && has_value)
+        {
+            if (!parse_uint(argv[++i], options.samples)) { return false; }
+        }
+        else if (arg == "--csv" && has_value) { options.csv_path = argv[++i]; }
+        else if (arg == "--json" && has_value) { options.json_path = argv[++i]; }
+        else if (arg == "--trace" && has_value) { options.trace_path = argv[++i]; }
+        else if (arg == "--no-gpu-culling") { options.gpu_culling = false; }
+        else if (arg == "--mesh-cache") { options.mesh_cache = true; }
+        else if (arg == "--size" && has_value)
+        {
+            if (std::sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 ||
+                options.width == 0 || options.height == 0)
+            {
+                return false;
+            }
+        }
+        else if (options.scene_path.empty() && arg.rfind("--", 0) != 0)
+        {
+            options.scene_path = arg;
+        }
+        else { return false; }
+    }
+    return !options.scene_path.empty();
+}
+
+/// @brief 构造一个模型并返回构造的耗时，返回时模型随之释放
+double load_model_ms(const std::string& model_path)
+{
+    const auto      start = std::chrono::steady_clock::now();
+    const ck::Model model(model_path);
+    const auto      end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/// @brief 每个模型先删除缓存加载一次（冷），再从缓存加载一次（热），输出耗时
+void run_mesh_cache_benchmark(const ck::SceneDescription& description)
+{
+    std::set<std::string> model_paths;
+    for (const auto& object : description.objects) { model_paths.insert(object.model_file_path); }
+
+    double cold_total = 0.0;
+    double warm_total = 0.0;
+    for (const std::string& model_path : model_paths)
+    {
+        std::error_code error;
+        std::filesystem::remove(ck::get_mesh_cache_path(model_path), error);
+        const double cold_ms  = load_model_ms(model_path);
+        const double warm_ms  = load_model_ms(model_path);
+        cold_total           += cold_ms;
+        warm_total           += warm_ms;
+        LOG(INFO) << "[mesh cache] " << model_path << ": cold " << cold_ms << " ms, warm "
+                  << warm_ms << " ms";
+    }
+    LOG(INFO) << "[mesh cache] " << model_paths.size() << " models: cold " << cold_total
+              << " ms, warm " << warm_total << " ms, speedup "
+              << ((warm_total > 0.0) ? cold_total / warm_total : 0.0) << "x";
+}
+
+/// @brief 按场景描述搭建场景，灯光和main.cpp中一样缩小显示
+void build_scene(ck::Scene& scene, const ck::SceneDescription& description)
+{
+    scene.get_skyBox().load_skyBox_texture_from_file(stdAsset_root + "stdTexture/skybox/");
+    scene.add_models(description.objects);
+    for (const auto& light_desc : description.lights)
+    {
+        const ck::EntityHandle light = scene.add_light(light_desc.object_name, light_desc.light);
+
+        ck::SceneObjectEdittingCtx ctx;
+        ctx.object_type = ck::RenderObjectType::LIGHT;
+        ctx.object_name = light_desc.object_name;
+        glm::vec3 position = light_desc.postion;
+        glm::vec3 rotation = light_desc.rotation;
+        glm::vec3 scale(0.1F);
+        ctx.postion  = &position;
+        ctx.rotation = &rotation;
+        ctx.scale    = &scale;
+        scene.modify_object(light, &ctx);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    // init glog
+    google::InitGoogleLogging(*argv);
+    FLAGS_minloglevel = google::LogSeverity::GLOG_INFO;
+    FLAGS_logtostderr = true;
+    ck::CpuProfiler::get_instance().set_thread_name("main");
+
+    BenchOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (!std::filesystem::exists(options.scene_path))
+    {
+        options.scene_path = stdAsset_root + options.scene_path;
+    }
+    ck::SceneDescription description;
+    if (!ck::load_scene_description(options.scene_path, description)) { return EXIT_FAILURE; }
+
+    // 无窗口的上下文，没有ImGui和垂直同步
+    ck::HeadlessContext context;
+    if (gladLoadGLLoader(ck::HeadlessContext::get_loader()) == 0)
+    {
+        LOG(ERROR) << "Failed to initialize GLAD";
+        return EXIT_FAILURE;
+    }
+    LOG(INFO) << "GL_RENDERER: " << glGetString(GL_RENDERER);
+    LOG(INFO) << "GL_VERSION: " << glGetString(GL_VERSION);
+
+    // 任务系统，持有GL上下文的线程是主线程
+    ck::JobSystem::get_instance().init();
+
+    // ANCHOR - opengl setting，和main.cpp一致
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_STENCIL_TEST);
+    glStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_MULTISAMPLE);
+    glEnable(GL_FRAMEBUFFER_SRGB);
+    GL_CHECK();
+
+    ck::OffscreenTarget target;
+    if (!target.create(options.width, options.height, options.samples)) { return EXIT_FAILURE; }
+
+    if (options.mesh_cache) { run_mesh_cache_benchmark(description); }
+    if (!options.trace_path.empty()) { ck::CpuProfiler::get_instance().set_recording(true); }
+
+    auto& scene = ck::Scene::get_instance();
+    scene.get_gpu_culling().set_enabled(options.gpu_culling);
+    build_scene(scene, description);
+    ck::SceneLightUBOManager scene_light_maneger;
+    scene_light_maneger.create_light_UBO();
+    scene_light_maneger.binding_uniformBuffer(0);
+
+    ck::FrameBenchmark benchmark(options.frame_num, options.warmup_num);
+    benchmark.run(scene, scene_light_maneger, description, target);
+    benchmark.print_summary();
+    bool written =
+        benchmark.write_csv(options.csv_path) && benchmark.write_json(options.json_path);
+    if (!options.trace_path.empty())
+    {
+        written = ck::CpuProfiler::get_instance().write_chrome_trace(options.trace_path) && written;
+    }
+
+    // clean up，顺序和main.cpp一致
+    ck::JobSystem::get_instance().shutdown();
+    ck::TextureLoader::get_instance().shutdown();
+    ck::InstanceBuffer::get_instance().shutdown();
+    ck::IndirectDrawBuffer::get_instance().shutdown();
+    scene.get_clustered_lighting().shutdown();
+    scene.get_shadow_atlas().shutdown();
+    scene.get_gpu_culling().shutdown();
+    scene_light_maneger.shutdown();
+    benchmark.shutdown();
+    ck::GpuProfiler::get_instance().shutdown();
+    target.shutdown();
+    ck::MeshArena::get_instance().shutdown();
+    ck::GLResourceRegistry::get_instance().shutdown();
+    context.shutdown();
+
+    google::ShutdownGoogleLogging();
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,182 @@
+#include "bounds.h"
+
+#include <cfloat>
+#include <cstdint>
+
+#include <cmath>
+
+#if CK_FRUSTUM_SIMD
+#    include <emmintrin.h>
+#endif
+
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+
+// ANCHOR - AABB
+
+[[nodiscard]] bool ck::AABB::is_empty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+[[nodiscard]] glm::vec3 ck::AABB::get_center() const
+{
+    return (min + max) * 0.5F;
+}
+
+[[nodiscard]] glm::vec3 ck::AABB::get_extent() const
+{
+    return (max - min) * 0.5F;
+}
+
+[[nodiscard]] float ck::AABB::get_surface_area() const
+{
+    const glm::vec3 size = max - min;
+    return 2.0F * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+[[nodiscard]] bool ck::AABB::contains(const AABB& other) const
+{
+    return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+           max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+}
+
+void ck::AABB::expand(const glm::vec3& point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void ck::AABB::expand(const AABB& other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+[[nodiscard]] ck::AABB ck::AABB::transformed(const glm::mat4& matrix) const
+{
+    if (is_empty()) { return *this; }
+    /**NOTE - Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990
+    新的中心 = M * 中心；新的半边长 = |M的3x3部分| * 半边长
+    */
+    const glm::vec3 center = glm::vec3(matrix * glm::vec4(get_center(), 1.0F));
+    const glm::vec3 extent = get_extent();
+    glm::vec3       new_extent(0.0F);
+    for (int column = 0; column < 3; column++)
+    {
+        new_extent += glm::abs(glm::vec3(matrix[column])) * extent[column];
+    }
+    return {center - new_extent, center + new_extent};
+}
+
+[[nodiscard]] ck::AABB ck::AABB::fattened(const glm::vec3& margin) const
+{
+    return {min - margin, max + margin};
+}
+
+[[nodiscard]] ck::AABB ck::AABB::merge(const AABB& a, const AABB& b)
+{
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+[[nodiscard]] ck::AABB ck::AABB::from_ai_mesh(const aiMesh* mesh)
+{
+    AABB bounds;
+    for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+    {
+        bounds.expand(glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z));
+    }
+    return bounds;
+}
+
+// ANCHOR - Frustum
+
+ck::Frustum::Frustum(const glm::mat4& view_projection)
+{
+    // glm是列主序，第i行为 (m[0][i], m[1][i], m[2][i], m[3][i])
+    const auto row = [&view_projection](const int i) {
+        return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i],
+                         view_projection[3][i]);
+    };
+    const std::array<glm::vec4, PLANE_NUM> planes = {
+        row(3) + row(0),  // left
+        row(3) - row(0),  // right
+        row(3) + row(1),  // bottom
+        row(3) - row(1),  // top
+        row(3) + row(2),  // near
+        row(3) - row(2),  // far
+    };
+    for (uint32_t i = 0; i < PADDED_PLANE_NUM; i++)
+    {
+        if (i < PLANE_NUM)
+        {
+            const float length = glm::length(glm::vec3(planes[i]));
+            const float scale  = (length > 0.0F) ? 1.0F / length : 0.0F;
+            normal_x[i]        = planes[i].x * scale;
+            normal_y[i]        = planes[i].y * scale;
+            normal_z[i]        = planes[i].z * scale;
+            distance[i]        = planes[i].w * scale;
+        }
+        else
+        {
+            // 补齐的平面：任何包围盒都在它的内侧
+            normal_x[i] = 0.0F;
+            normal_y[i] = 0.0F;
+            normal_z[i] = 0.0F;
+            distance[i] = FLT_MAX;
+        }
+    }
+}
+
+[[nodiscard]] ck::FrustumTestResult ck::Frustum::test(const AABB& bounds) const
+{
+    const glm::vec3 center = bounds.get_center();
+    const glm::vec3 extent = bounds.get_extent();
+
+#if CK_FRUSTUM_SIMD
+    const __m128 center_x  = _mm_set1_ps(center.x);
+    const __m128 center_y  = _mm_set1_ps(center.y);
+    const __m128 center_z  = _mm_set1_ps(center.z);
+    const __m128 extent_x  = _mm_set1_ps(extent.x);
+    const __m128 extent_y  = _mm_set1_ps(extent.y);
+    const __m128 extent_z  = _mm_set1_ps(extent.z);
+    const __m128 sign_mask = _mm_set1_ps(-0.0F);
+    const __m128 zero      = _mm_setzero_ps();
+
+    int outside   = 0;
+    int intersect = 0;
+    for (uint32_t i = 0; i < PADDED_PLANE_NUM; i += 4)
+    {
+        const __m128 nx = _mm_load_ps(normal_x.data() + i);
+        const __m128 ny = _mm_load_ps(normal_y.data() + i);
+        const __m128 nz = _mm_load_ps(normal_z.data() + i);
+        const __m128 nw = _mm_load_ps(distance.data() + i);
+
+        // d = dot(n, center) + w
+        __m128 d = _mm_add_ps(_mm_mul_ps(nx, center_x), nw);
+        d        = _mm_add_ps(_mm_mul_ps(ny, center_y), d);
+        d        = _mm_add_ps(_mm_mul_ps(nz, center_z), d);
+        // r = dot(|n|, extent)
+        __m128 r = _mm_mul_ps(_mm_andnot_ps(sign_mask, nx), extent_x);
+        r        = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, ny), extent_y), r);
+        r        = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, nz), extent_z), r);
+
+        outside   |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        intersect |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(d, r), zero));
+    }
+    if (outside != 0) { return FrustumTestResult::OUTSIDE; }
+    return (intersect != 0) ? FrustumTestResult::INTERSECT : FrustumTestResult::INSIDE;
+#else
+    bool intersect = false;
+    for (uint32_t i = 0; i < PLANE_NUM; i++)
+    {
+        const float d = normal_x[i] * center.x + normal_y[i] * center.y +
+                        normal_z[i] * center.z + distance[i];
+        const float r = std::abs(normal_x[i]) * extent.x + std::abs(normal_y[i]) * extent.y +
+                        std::abs(normal_z[i]) * extent.z;
+        if (d + r < 0.0F) { return FrustumTestResult::OUTSIDE; }
+        if (d - r < 0.0F) { intersect = true; }
+    }
+    return intersect ? FrustumTestResult::INTERSECT : FrustumTestResult::INSIDE;
+#endif
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+
+#include <array>
+
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+
+// MSVC的x64目标总是支持SSE2，GCC/Clang通过__SSE2__判断
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CK_FRUSTUM_SIMD 1
+#else
+#    define CK_FRUSTUM_SIMD 0
+#endif
+
+namespace ck {
+
+/// @brief 轴对齐包围盒
+/// @note 默认构造为空盒（min > max），expand()任意一个点之后才有效
+struct AABB
+{
+    glm::vec3 min{FLT_MAX};
+    glm::vec3 max{-FLT_MAX};
+
+    [[nodiscard]] bool      is_empty() const;
+    [[nodiscard]] glm::vec3 get_center() const;
+    [[nodiscard]] glm::vec3 get_extent() const;  // 半边长
+    [[nodiscard]] float     get_surface_area() const;
+    [[nodiscard]] bool      contains(const AABB& other) const;
+
+    void expand(const glm::vec3& point);
+    void expand(const AABB& other);
+
+    /// @brief 变换后重新包围（Arvo的方法，不需要变换8个角点）
+    [[nodiscard]] AABB transformed(const glm::mat4& matrix) const;
+    /// @brief 向外扩张margin
+    [[nodiscard]] AABB fattened(const glm::vec3& margin) const;
+
+    [[nodiscard]] static AABB merge(const AABB& a, const AABB& b);
+    [[nodiscard]] static AABB from_ai_mesh(const aiMesh* mesh);
+};
+
+enum class FrustumTestResult : uint32_t { OUTSIDE, INTERSECT, INSIDE };
+
+/// @brief 视锥体的6个平面，法线指向视锥体内部
+/**NOTE - SoA存储，一次测试4个平面
+平面按分量分开存放，补齐到8个（补齐的平面恒为“在内侧”），
+用SSE一次计算4个平面到包围盒中心的距离d和包围盒在法线上的投影半径r：
+    d + r < 0  包围盒完全在平面外侧 -> OUTSIDE
+    d - r < 0  包围盒跨过平面       -> INTERSECT
+两次迭代测完6个平面，没有分支地得到结果。不支持SSE2的平台退化为逐平面的标量测试。
+*/
+class Frustum {
+private:
+    static const uint32_t PLANE_NUM        = 6;
+    static const uint32_t PADDED_PLANE_NUM = 8;
+
+    alignas(16) std::array<float, PADDED_PLANE_NUM> normal_x;
+    alignas(16) std::array<float, PADDED_PLANE_NUM> normal_y;
+    alignas(16) std::array<float, PADDED_PLANE_NUM> normal_z;
+    alignas(16) std::array<float, PADDED_PLANE_NUM> distance;
+
+public:
+    /// @brief 从投影矩阵 * 观察矩阵中提取平面（Gribb-Hartmann），裁剪空间z ∈ [-w, w]
+    explicit Frustum(const glm::mat4& view_projection);
+
+    [[nodiscard]] FrustumTestResult test(const AABB& bounds) const;
+};
+
+};  // namespace ck
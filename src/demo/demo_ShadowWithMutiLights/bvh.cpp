@@ -0,0 +1,319 @@
+#include "bvh.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace {
+
+const float BVH_FAT_MARGIN_RATIO = 0.1F;   // 胖包围盒按半边长的10%扩张
+const float BVH_FAT_MARGIN_MIN   = 0.05F;  // 薄片（比如平面）也至少扩张这么多
+const float BVH_REINSERT_AREA_RATIO = 4.0F;
+
+// 遍历栈中的标记位：整棵子树都在视锥体内部，不需要再做平面测试
+const uint32_t INSIDE_FLAG = 0x80000000;
+
+ck::AABB make_fat(const ck::AABB& bounds)
+{
+    return bounds.fattened(glm::max(bounds.get_extent() * BVH_FAT_MARGIN_RATIO,
+                                    glm::vec3(BVH_FAT_MARGIN_MIN)));
+}
+
+}  // namespace
+
+ck::DynamicBVH::DynamicBVH() : root(NULL_BVH_NODE), free_list(NULL_BVH_NODE), proxy_num(0) {}
+
+uint32_t ck::DynamicBVH::allocate_node()
+{
+    uint32_t node = 0;
+    if (free_list != NULL_BVH_NODE)
+    {
+        node      = free_list;
+        free_list = nodes[node].parent;
+    }
+    else
+    {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[node].parent      = NULL_BVH_NODE;
+    nodes[node].children[0] = NULL_BVH_NODE;
+    nodes[node].children[1] = NULL_BVH_NODE;
+    nodes[node].user_data   = 0;
+    nodes[node].height      = 0;
+    return node;
+}
+
+void ck::DynamicBVH::free_node(const uint32_t node)
+{
+    nodes[node].parent = free_list;
+    nodes[node].height = -1;
+    free_list          = node;
+}
+
+uint32_t ck::DynamicBVH::create_proxy(const AABB& bounds, const uint32_t user_data)
+{
+    const uint32_t proxy   = allocate_node();
+    nodes[proxy].bounds    = make_fat(bounds);
+    nodes[proxy].user_data = user_data;
+    insert_leaf(proxy);
+    proxy_num++;
+    return proxy;
+}
+
+void ck::DynamicBVH::destroy_proxy(const uint32_t proxy)
+{
+    remove_leaf(proxy);
+    free_node(proxy);
+    proxy_num--;
+}
+
+bool ck::DynamicBVH::move_proxy(const uint32_t proxy, const AABB& bounds)
+{
+    // 胖包围盒比需要的大太多时（物体缩小了）也重新插入，否则剔除会越来越保守
+    const AABB fat_bounds = make_fat(bounds);
+    if (nodes[proxy].bounds.contains(bounds) &&
+        nodes[proxy].bounds.get_surface_area() <=
+            BVH_REINSERT_AREA_RATIO * fat_bounds.get_surface_area())
+    {
+        return false;
+    }
+    remove_leaf(proxy);
+    nodes[proxy].bounds = fat_bounds;
+    insert_leaf(proxy);
+    return true;
+}
+
+void ck::DynamicBVH::insert_leaf(const uint32_t leaf)
+{
+    if (root == NULL_BVH_NODE)
+    {
+        root               = leaf;
+        nodes[leaf].parent = NULL_BVH_NODE;
+        return;
+    }
+
+    // 从根往下，按表面积启发选择兄弟节点
+    const AABB leaf_bounds = nodes[leaf].bounds;
+    uint32_t   index       = root;
+    while (!nodes[index].is_leaf())
+    {
+        const Node& node          = nodes[index];
+        const float area          = node.bounds.get_surface_area();
+        const float combined_area = AABB::merge(node.bounds, leaf_bounds).get_surface_area();
+
+        // 在这里新建父节点的代价，以及把叶子继续往下推时祖先包围盒变大的代价
+        const float cost             = 2.0F * combined_area;
+        const float inheritance_cost = 2.0F * (combined_area - area);
+
+        float child_costs[2];
+        for (int i = 0; i < 2; i++)
+        {
+            const Node& child       = nodes[node.children[i]];
+            const float merged_area = AABB::merge(child.bounds, leaf_bounds).get_surface_area();
+            child_costs[i] =
+                (child.is_leaf() ? merged_area : merged_area - child.bounds.get_surface_area()) +
+                inheritance_cost;
+        }
+
+        if (cost < child_costs[0] && cost < child_costs[1]) { break; }
+        index = (child_costs[0] < child_costs[1]) ? node.children[0] : node.children[1];
+    }
+    const uint32_t sibling = index;
+
+    // 新建父节点替换兄弟节点的位置
+    const uint32_t old_parent = nodes[sibling].parent;
+    const uint32_t new_parent = allocate_node();  // NOTE - 可能扩容，之后才能取引用
+    nodes[new_parent].parent      = old_parent;
+    nodes[new_parent].bounds      = AABB::merge(leaf_bounds, nodes[sibling].bounds);
+    nodes[new_parent].height      = nodes[sibling].height + 1;
+    nodes[new_parent].children[0] = sibling;
+    nodes[new_parent].children[1] = leaf;
+    nodes[sibling].parent         = new_parent;
+    nodes[leaf].parent            = new_parent;
+    if (old_parent == NULL_BVH_NODE) { root = new_parent; }
+    else if (nodes[old_parent].children[0] == sibling)
+    {
+        nodes[old_parent].children[0] = new_parent;
+    }
+    else { nodes[old_parent].children[1] = new_parent; }
+
+    refit_ancestors(nodes[leaf].parent);
+}
+
+void ck::DynamicBVH::remove_leaf(const uint32_t leaf)
+{
+    if (leaf == root)
+    {
+        root = NULL_BVH_NODE;
+        return;
+    }
+
+    // 父节点被删除，兄弟节点顶替父节点的位置
+    const uint32_t parent       = nodes[leaf].parent;
+    const uint32_t grand_parent = nodes[parent].parent;
+    const uint32_t sibling      = (nodes[parent].children[0] == leaf) ? nodes[parent].children[1]
+                                                                      : nodes[parent].children[0];
+    nodes[sibling].parent       = grand_parent;
+    free_node(parent);
+    if (grand_parent == NULL_BVH_NODE)
+    {
+        root = sibling;
+        return;
+    }
+    if (nodes[grand_parent].children[0] == parent) { nodes[grand_parent].children[0] = sibling; }
+    else { nodes[grand_parent].children[1] = sibling; }
+    refit_ancestors(grand_parent);
+}
+
+void ck::DynamicBVH::refit_ancestors(uint32_t node)
+{
+    while (node != NULL_BVH_NODE)
+    {
+        node          = balance(node);
+        Node&       n = nodes[node];
+        const Node& a = nodes[n.children[0]];
+        const Node& b = nodes[n.children[1]];
+        n.height      = 1 + std::max(a.height, b.height);
+        n.bounds      = AABB::merge(a.bounds, b.bounds);
+        node          = n.parent;
+    }
+}
+
+uint32_t ck::DynamicBVH::balance(const uint32_t index_a)
+{
+    /**NOTE - AVL式的旋转
+          A             左右子树高度差超过1时，把较高的子节点（C）提上来：
+         / \            C取代A的位置，A成为C的一个子节点，
+        B   C           C原来的两个子节点中较高的留给C，较矮的交给A。
+           / \
+          F   G
+    */
+    Node& a = nodes[index_a];
+    if (a.is_leaf() || a.height < 2) { return index_a; }
+
+    const uint32_t index_b = a.children[0];
+    const uint32_t index_c = a.children[1];
+    Node&          b       = nodes[index_b];
+    Node&          c       = nodes[index_c];
+
+    const int32_t height_diff = c.height - b.height;
+    if (height_diff > 1)
+    {
+        // 把C提上来
+        const uint32_t index_f = c.children[0];
+        const uint32_t index_g = c.children[1];
+        Node&          f       = nodes[index_f];
+        Node&          g       = nodes[index_g];
+
+        c.children[0] = index_a;
+        c.parent      = a.parent;
+        a.parent      = index_c;
+        if (c.parent == NULL_BVH_NODE) { root = index_c; }
+        else if (nodes[c.parent].children[0] == index_a) { nodes[c.parent].children[0] = index_c; }
+        else { nodes[c.parent].children[1] = index_c; }
+
+        const bool     keep_f   = f.height > g.height;
+        const uint32_t index_up = keep_f ? index_f : index_g;  // 留给C
+        const uint32_t index_dn = keep_f ? index_g : index_f;  // 交给A
+        c.children[1]           = index_up;
+        a.children[1]           = index_dn;
+        nodes[index_dn].parent  = index_a;
+        a.bounds                = AABB::merge(b.bounds, nodes[index_dn].bounds);
+        c.bounds                = AABB::merge(a.bounds, nodes[index_up].bounds);
+        a.height                = 1 + std::max(b.height, nodes[index_dn].height);
+        c.height                = 1 + std::max(a.height, nodes[index_up].height);
+        return index_c;
+    }
+    if (height_diff < -1)
+    {
+        // 把B提上来，和上面对称
+        const uint32_t index_d = b.children[0];
+        const uint32_t index_e = b.children[1];
+        Node&          d       = nodes[index_d];
+        Node&          e       = nodes[index_e];
+
+        b.children[0] = index_a;
+        b.parent      = a.parent;
+        a.parent      = index_b;
+        if (b.parent == NULL_BVH_NODE) { root = index_b; }
+        else if (nodes[b.parent].children[0] == index_a) { nodes[b.parent].children[0] = index_b; }
+        else { nodes[b.parent].children[1] = index_b; }
+
+        const bool     keep_d   = d.height > e.height;
+        const uint32_t index_up = keep_d ? index_d : index_e;  // 留给B
+        const uint32_t index_dn = keep_d ? index_e : index_d;  // 交给A
+        b.children[1]           = index_up;
+        a.children[0]           = index_dn;
+        nodes[index_dn].parent  = index_a;
+        a.bounds                = AABB::merge(c.bounds, nodes[index_dn].bounds);
+        b.bounds                = AABB::merge(a.bounds, nodes[index_up].bounds);
+        a.height                = 1 + std::max(c.height, nodes[index_dn].height);
+        b.height                = 1 + std::max(a.height, nodes[index_up].height);
+        return index_b;
+    }
+    return index_a;
+}
+
+void ck::DynamicBVH::query(const Frustum&         frustum,
+                           std::vector<uint32_t>& out_user_data,
+                           CullingStats&          stats)
+{
+    out_user_data.clear();
+    stats = {0, 0, 0};
+    traversal_stack.clear();
+    if (root != NULL_BVH_NODE) { traversal_stack.push_back(root); }
+
+    while (!traversal_stack.empty())
+    {
+        const uint32_t entry = traversal_stack.back();
+        traversal_stack.pop_back();
+        const uint32_t index  = entry & ~INSIDE_FLAG;
+        uint32_t       inside = entry & INSIDE_FLAG;
+        const Node&    node   = nodes[index];
+
+        if (inside == 0)
+        {
+            stats.tested++;
+            const FrustumTestResult result = frustum.test(node.bounds);
+            if (result == FrustumTestResult::OUTSIDE) { continue; }
+            if (result == FrustumTestResult::INSIDE) { inside = INSIDE_FLAG; }
+        }
+        if (node.is_leaf())
+        {
+            out_user_data.push_back(node.user_data);
+            continue;
+        }
+        traversal_stack.push_back(node.children[0] | inside);
+        traversal_stack.push_back(node.children[1] | inside);
+    }
+
+    stats.visible = static_cast<uint32_t>(out_user_data.size());
+    stats.culled  = static_cast<uint32_t>(proxy_num) - stats.visible;
+}
+
+[[nodiscard]] size_t ck::DynamicBVH::get_proxy_num() const
+{
+    return proxy_num;
+}
+
+[[nodiscard]] int32_t ck::DynamicBVH::get_height() const
+{
+    return (root == NULL_BVH_NODE) ? 0 : nodes[root].height;
+}
+
+[[nodiscard]] const ck::AABB& ck::DynamicBVH::get_fat_bounds(const uint32_t proxy) const
+{
+    return nodes[proxy].bounds;
+}
+
+[[nodiscard]] ck::AABB ck::DynamicBVH::get_root_bounds() const
+{
+    return (root == NULL_BVH_NODE) ? AABB() : nodes[root].bounds;
+}
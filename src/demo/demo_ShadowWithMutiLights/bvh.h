@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "bounds.h"
+
+namespace ck {
+
+static const uint32_t NULL_BVH_NODE = 0xFFFFFFFF;
+
+/// @brief 一次视锥剔除的统计
+struct CullingStats
+{
+    uint32_t tested;   // 和视锥体做过平面测试的BVH节点数
+    uint32_t culled;   // 被剔除的物体数
+    uint32_t visible;  // 可见的物体数
+};
+
+/// @brief 动态包围盒层次结构（dynamic AABB tree）
+/**NOTE - 增量更新
+1. 叶子节点保存“胖”包围盒：在真实包围盒外扩张一圈margin。
+   物体移动后，只要新的包围盒还在胖包围盒之内，树就不需要任何改动；
+   超出时才把叶子拿出来、重新插入，并沿路径向上重新拟合祖先的包围盒。
+2. 插入时按表面积启发（SAH）从根往下挑选代价最小的兄弟节点，
+   向上回溯时做AVL式的旋转保持平衡，树高始终是O(log n)。
+3. 节点存放在连续数组中，空闲节点串成free list复用，proxy就是叶子节点的下标。
+查询时整棵子树都在视锥体内部的节点不再继续做平面测试，直接收集其中所有的叶子。
+*/
+class DynamicBVH {
+private:
+    struct Node
+    {
+        AABB     bounds;
+        uint32_t parent;  // 空闲节点复用为free list的next
+        uint32_t children[2];
+        uint32_t user_data;
+        int32_t  height;  // 叶子为0，空闲节点为-1
+
+        [[nodiscard]] bool is_leaf() const { return children[0] == NULL_BVH_NODE; }
+    };
+
+    std::vector<Node>     nodes;
+    uint32_t              root;
+    uint32_t              free_list;
+    size_t                proxy_num;
+    std::vector<uint32_t> traversal_stack;
+
+    uint32_t allocate_node();
+    void     free_node(uint32_t node);
+    void     insert_leaf(uint32_t leaf);
+    void     remove_leaf(uint32_t leaf);
+    /// @brief 从node开始向上重新拟合包围盒和树高，并做旋转
+    void     refit_ancestors(uint32_t node);
+    /// @return 旋转后占据原位置的节点
+    uint32_t balance(uint32_t node);
+
+public:
+    DynamicBVH();
+
+    /// @param bounds 世界空间中的真实包围盒，内部会扩张成胖包围盒
+    /// @return proxy，用于之后的移动和删除
+    uint32_t create_proxy(const AABB& bounds, uint32_t user_data);
+    void     destroy_proxy(uint32_t proxy);
+    /// @return 是否超出了胖包围盒、需要重新插入
+    bool     move_proxy(uint32_t proxy, const AABB& bounds);
+
+    /// @brief 收集所有和视锥体相交的叶子的user_data（会先清空out_user_data）
+    void query(const Frustum& frustum, std::vector<uint32_t>& out_user_data, CullingStats& stats);
+
+    [[nodiscard]] size_t  get_proxy_num() const;
+    [[nodiscard]] int32_t get_height() const;
+    /// @brief proxy当前的胖包围盒
+    [[nodiscard]] const AABB& get_fat_bounds(uint32_t proxy) const;
+    /// @brief 整棵树的包围盒，没有proxy时为空盒
+    [[nodiscard]] AABB get_root_bounds() const;
+};
+
+};  // namespace ck
@@ -36,11 +36,29 @@ ck::Camera::Camera(const glm::vec3& position, const glm::vec3& world_up_vec)
     return glm::perspective(glm::radians(camera_zoom), aspect_ratio, near_plane, far_plane);
 }
 
+[[nodiscard]] float ck::Camera::get_near_plane() const
+{
+    return near_plane;
+}
+
+[[nodiscard]] float ck::Camera::get_far_plane() const
+{
+    return far_plane;
+}
+
 void ck::Camera::set_skip_one_frame(const bool flag)
 {
     skip_one_frame_flag = flag;
 }
 
+void ck::Camera::set_pose(const glm::vec3& new_position, const float new_yaw, const float new_pitch)
+{
+    position = new_position;
+    yaw      = new_yaw;
+    pitch    = std::clamp(new_pitch, -89.9F, 89.9F);
+    update_camera_vector();
+}
+
 void ck::Camera::process_keyboard(const std::array<int32_t, 6>& directions, const float delta_time)
 {
     float velocity = move_speed * delta_time;
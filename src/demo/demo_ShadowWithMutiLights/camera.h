@@ -44,8 +44,12 @@ public:
     [[nodiscard]] float     get_camera_zoom() const;
     [[nodiscard]] glm::mat4 get_view_matrix() const;
     [[nodiscard]] glm::mat4 get_projection_matrix(float aspect_ratio) const;
+    [[nodiscard]] float     get_near_plane() const;
+    [[nodiscard]] float     get_far_plane() const;
 
     void set_skip_one_frame(bool flag);
+    /// @brief 直接设置位置和朝向（角度制），用于脚本化的相机路径
+    void set_pose(const glm::vec3& new_position, float new_yaw, float new_pitch);
 
     void process_keyboard(const std::array<int32_t, 6>& directions, float delta_time);
     void process_mouse_movement(float x_offset, float y_offset, bool constarinPitch = true);
@@ -0,0 +1,477 @@
+#include "clustered_lighting.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <glm/glm.hpp>
+#include <glog/logging.h>
+
+#include "bounds.h"  // CK_FRUSTUM_SIMD
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "core/ck_job_system.h"
+#include "entity_registry.h"
+#include "light.h"
+#include "transform.h"
+
+#if CK_FRUSTUM_SIMD
+#    include <emmintrin.h>
+#endif
+
+namespace {
+
+/// @brief 和着色器中的ClusterParams一致（std140）
+struct ClusterParamsData
+{
+    glm::uvec4 grid_size;     // xyz：格子数，w：日光数
+    glm::vec4  depth_params;  // near, far, slice_scale, slice_bias
+    glm::vec4  viewport;      // width, height
+};
+
+}  // namespace
+
+ck::ClusteredLighting::ClusteredLighting()
+    : cached_projection(0.0F), slice_scale(0.0F), slice_bias(0.0F), overflow_num(0), stats{},
+      lights_capacity(0), indices_capacity(0), viewport_width(1), viewport_height(1)
+{
+    for (auto* soa : {&cluster_min_x, &cluster_min_y, &cluster_min_z, &cluster_max_x,
+                      &cluster_max_y, &cluster_max_z, &cluster_center_x, &cluster_center_y,
+                      &cluster_center_z, &cluster_radius})
+    {
+        soa->resize(CLUSTER_NUM, 0.0F);
+    }
+    slice_lights.resize(CLUSTER_GRID_Z);
+    cluster_counts.resize(CLUSTER_NUM, 0);
+    cluster_scratch.resize(static_cast<size_t>(CLUSTER_NUM) * MAX_LIGHTS_PER_CLUSTER);
+    cluster_ranges.resize(CLUSTER_NUM, glm::uvec2(0));
+}
+
+ck::ClusteredLighting::~ClusteredLighting()
+{
+    shutdown();
+}
+
+void ck::ClusteredLighting::shutdown()
+{
+    params_buffer.reset();
+    lights_buffer.reset();
+    ranges_buffer.reset();
+    indices_buffer.reset();
+    lights_capacity  = 0;
+    indices_capacity = 0;
+}
+
+void ck::ClusteredLighting::build_clusters(const glm::mat4& projection,
+                                           const float      near_plane,
+                                           const float      far_plane)
+{
+    cached_projection     = glm::vec4(projection[0][0], projection[1][1], near_plane, far_plane);
+    const float log_ratio = std::log(far_plane / near_plane);
+    slice_scale           = static_cast<float>(CLUSTER_GRID_Z) / log_ratio;
+    slice_bias            = static_cast<float>(CLUSTER_GRID_Z) * std::log(near_plane) / log_ratio;
+
+    for (uint32_t z = 0; z < CLUSTER_GRID_Z; z++)
+    {
+        // 观察空间看向-z，深度d = -z_view
+        const float depth_near = near_plane * std::pow(far_plane / near_plane,
+                                                       static_cast<float>(z) / CLUSTER_GRID_Z);
+        const float depth_far  = near_plane * std::pow(far_plane / near_plane,
+                                                      static_cast<float>(z + 1) / CLUSTER_GRID_Z);
+        for (uint32_t y = 0; y < CLUSTER_GRID_Y; y++)
+        {
+            const float ndc_y0 = -1.0F + 2.0F * static_cast<float>(y) / CLUSTER_GRID_Y;
+            const float ndc_y1 = -1.0F + 2.0F * static_cast<float>(y + 1) / CLUSTER_GRID_Y;
+            for (uint32_t x = 0; x < CLUSTER_GRID_X; x++)
+            {
+                const float ndc_x0 = -1.0F + 2.0F * static_cast<float>(x) / CLUSTER_GRID_X;
+                const float ndc_x1 = -1.0F + 2.0F * static_cast<float>(x + 1) / CLUSTER_GRID_X;
+
+                // 格子是一个平截头体，取它8个角点的包围盒
+                const glm::vec3 box_min(
+                    std::min(ndc_x0 * depth_near, ndc_x0 * depth_far) / projection[0][0],
+                    std::min(ndc_y0 * depth_near, ndc_y0 * depth_far) / projection[1][1],
+                    -depth_far);
+                const glm::vec3 box_max(
+                    std::max(ndc_x1 * depth_near, ndc_x1 * depth_far) / projection[0][0],
+                    std::max(ndc_y1 * depth_near, ndc_y1 * depth_far) / projection[1][1],
+                    -depth_near);
+                const glm::vec3 center = (box_min + box_max) * 0.5F;
+
+                const uint32_t i    = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+                cluster_min_x[i]    = box_min.x;
+                cluster_min_y[i]    = box_min.y;
+                cluster_min_z[i]    = box_min.z;
+                cluster_max_x[i]    = box_max.x;
+                cluster_max_y[i]    = box_max.y;
+                cluster_max_z[i]    = box_max.z;
+                cluster_center_x[i] = center.x;
+                cluster_center_y[i] = center.y;
+                cluster_center_z[i] = center.z;
+                cluster_radius[i]   = glm::length(box_max - center);
+            }
+        }
+    }
+}
+
+bool ck::ClusteredLighting::compute_cluster_range(const glm::mat4& projection,
+                                                  CullingLight&    light,
+                                                  uint32_t&        z_begin,
+                                                  uint32_t&        z_end) const
+{
+    const float near_plane = cached_projection.z;
+    const float far_plane  = cached_projection.w;
+
+    // 深度方向
+    float depth_min = -light.position.z - light.range;
+    float depth_max = -light.position.z + light.range;
+    if (depth_max <= near_plane || depth_min >= far_plane) { return false; }
+    depth_min = std::max(depth_min, near_plane);
+    depth_max = std::min(depth_max, far_plane);
+
+    const auto to_slice = [this](const float depth) {
+        const float slice = std::floor(std::log(depth) * slice_scale - slice_bias);
+        return static_cast<uint32_t>(
+            std::clamp(slice, 0.0F, static_cast<float>(CLUSTER_GRID_Z - 1)));
+    };
+    z_begin = to_slice(depth_min);
+    z_end   = to_slice(depth_max);
+
+    // 屏幕方向：把球的包围盒在[depth_min, depth_max]内的四个角投影到NDC，取范围
+    const auto to_tiles = [&](const float center, const float scale, const uint32_t tile_num,
+                              uint32_t& begin, uint32_t& end) {
+        float ndc_min = FLT_MAX;
+        float ndc_max = -FLT_MAX;
+        for (const float offset : {center - light.range, center + light.range})
+        {
+            for (const float depth : {depth_min, depth_max})
+            {
+                const float ndc = offset * scale / depth;
+                ndc_min         = std::min(ndc_min, ndc);
+                ndc_max         = std::max(ndc_max, ndc);
+            }
+        }
+        if (ndc_max < -1.0F || ndc_min > 1.0F) { return false; }
+        const auto to_tile = [tile_num](const float ndc) {
+            const float tile = std::floor((ndc + 1.0F) * 0.5F * static_cast<float>(tile_num));
+            return static_cast<uint32_t>(
+                std::clamp(tile, 0.0F, static_cast<float>(tile_num - 1)));
+        };
+        begin = to_tile(ndc_min);
+        end   = to_tile(ndc_max);
+        return true;
+    };
+    return to_tiles(light.position.x, projection[0][0], CLUSTER_GRID_X, light.x_begin,
+                    light.x_end) &&
+           to_tiles(light.position.y, projection[1][1], CLUSTER_GRID_Y, light.y_begin,
+                    light.y_end);
+}
+
+void ck::ClusteredLighting::assign_slice(const uint32_t z)
+{
+    const auto push_light = [this](const uint32_t cluster, const uint32_t gpu_index) {
+        uint32_t& count = cluster_counts[cluster];
+        if (count < MAX_LIGHTS_PER_CLUSTER)
+        {
+            cluster_scratch[static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER + count] =
+                gpu_index;
+            count++;
+        }
+        else { overflow_num.fetch_add(1, std::memory_order_relaxed); }
+    };
+
+    for (const uint32_t light_index : slice_lights[z])
+    {
+        const CullingLight& light = culling_lights[light_index];
+        const float         range_sq = light.range * light.range;
+
+#if CK_FRUSTUM_SIMD
+        const __m128 pos_x     = _mm_set1_ps(light.position.x);
+        const __m128 pos_y     = _mm_set1_ps(light.position.y);
+        const __m128 pos_z     = _mm_set1_ps(light.position.z);
+        const __m128 dir_x     = _mm_set1_ps(light.direction.x);
+        const __m128 dir_y     = _mm_set1_ps(light.direction.y);
+        const __m128 dir_z     = _mm_set1_ps(light.direction.z);
+        const __m128 cos_outer = _mm_set1_ps(light.cos_outer);
+        const __m128 sin_outer = _mm_set1_ps(light.sin_outer);
+        const __m128 range     = _mm_set1_ps(light.range);
+        const __m128 radius_sq = _mm_set1_ps(range_sq);
+        const __m128 zero      = _mm_setzero_ps();
+        // 一个轴上球心到包围盒的距离的平方
+        const auto axis_dist = [zero](const __m128 p, const float* box_min, const float* box_max) {
+            const __m128 d = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(box_min), p),
+                                        _mm_sub_ps(p, _mm_loadu_ps(box_max)));
+            const __m128 clamped = _mm_max_ps(d, zero);
+            return _mm_mul_ps(clamped, clamped);
+        };
+#endif
+
+        for (uint32_t y = light.y_begin; y <= light.y_end; y++)
+        {
+            const uint32_t row = CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+            // 一次测试一行中对齐的4个格子，范围外的格子用掩码去掉
+            for (uint32_t x = light.x_begin & ~3U; x <= light.x_end; x += 4)
+            {
+                const uint32_t base = row + x;
+                int            hit  = 0;
+#if CK_FRUSTUM_SIMD
+                // 球-包围盒：球心到包围盒的最近距离
+                __m128 dist_sq = axis_dist(pos_x, &cluster_min_x[base], &cluster_max_x[base]);
+                dist_sq = _mm_add_ps(dist_sq,
+                                     axis_dist(pos_y, &cluster_min_y[base], &cluster_max_y[base]));
+                dist_sq = _mm_add_ps(dist_sq,
+                                     axis_dist(pos_z, &cluster_min_z[base], &cluster_max_z[base]));
+                hit = _mm_movemask_ps(_mm_cmple_ps(dist_sq, radius_sq));
+
+                if (light.spot && hit != 0)
+                {
+                    // 锥-包围球：格子包围球到圆锥侧面的距离
+                    const __m128 v_x = _mm_sub_ps(_mm_loadu_ps(&cluster_center_x[base]), pos_x);
+                    const __m128 v_y = _mm_sub_ps(_mm_loadu_ps(&cluster_center_y[base]), pos_y);
+                    const __m128 v_z = _mm_sub_ps(_mm_loadu_ps(&cluster_center_z[base]), pos_z);
+                    const __m128 radius = _mm_loadu_ps(&cluster_radius[base]);
+
+                    const __m128 len_sq = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(v_x, v_x), _mm_mul_ps(v_y, v_y)),
+                        _mm_mul_ps(v_z, v_z));
+                    const __m128 v1_len = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(v_x, dir_x), _mm_mul_ps(v_y, dir_y)),
+                        _mm_mul_ps(v_z, dir_z));
+                    const __m128 perp_sq  = _mm_sub_ps(len_sq, _mm_mul_ps(v1_len, v1_len));
+                    const __m128 perp_len = _mm_sqrt_ps(_mm_max_ps(perp_sq, zero));
+                    const __m128 dist_closest = _mm_sub_ps(_mm_mul_ps(cos_outer, perp_len),
+                                                           _mm_mul_ps(v1_len, sin_outer));
+
+                    __m128 culled = _mm_cmpgt_ps(dist_closest, radius);
+                    culled = _mm_or_ps(culled, _mm_cmpgt_ps(v1_len, _mm_add_ps(radius, range)));
+                    culled = _mm_or_ps(culled,
+                                       _mm_cmplt_ps(v1_len, _mm_sub_ps(zero, radius)));
+                    hit &= ~_mm_movemask_ps(culled);
+                }
+#else
+                for (uint32_t lane = 0; lane < 4; lane++)
+                {
+                    const uint32_t  i = base + lane;
+                    const glm::vec3 box_min(cluster_min_x[i], cluster_min_y[i], cluster_min_z[i]);
+                    const glm::vec3 box_max(cluster_max_x[i], cluster_max_y[i], cluster_max_z[i]);
+                    const glm::vec3 d = glm::max(glm::max(box_min - light.position,
+                                                          light.position - box_max),
+                                                 glm::vec3(0.0F));
+                    if (glm::dot(d, d) > range_sq) { continue; }
+
+                    if (light.spot)
+                    {
+                        const glm::vec3 v =
+                            glm::vec3(cluster_center_x[i], cluster_center_y[i],
+                                      cluster_center_z[i]) -
+                            light.position;
+                        const float radius   = cluster_radius[i];
+                        const float v1_len   = glm::dot(v, light.direction);
+                        const float perp_len = std::sqrt(std::max(glm::dot(v, v) - v1_len * v1_len,
+                                                                  0.0F));
+                        const float dist_closest =
+                            light.cos_outer * perp_len - v1_len * light.sin_outer;
+                        if (dist_closest > radius || v1_len > radius + light.range ||
+                            v1_len < -radius)
+                        {
+                            continue;
+                        }
+                    }
+                    hit |= 1 << lane;
+                }
+#endif
+                for (uint32_t lane = 0; lane < 4; lane++)
+                {
+                    if ((hit & (1 << lane)) == 0) { continue; }
+                    if (x + lane < light.x_begin || x + lane > light.x_end) { continue; }
+                    push_light(base + lane, light.gpu_index);
+                }
+            }
+        }
+    }
+}
+
+void ck::ClusteredLighting::update(const EntityRegistry&             registry,
+                                   const glm::mat4&                  view,
+                                   const glm::mat4&                  projection,
+                                   const float                       near_plane,
+                                   const float                       far_plane,
+                                   const uint32_t                    viewport_width,
+                                   const uint32_t                    viewport_height,
+                                   const std::vector<int32_t>* const shadow_indices)
+{
+    this->viewport_width  = std::max(1U, viewport_width);
+    this->viewport_height = std::max(1U, viewport_height);
+    if (cached_projection != glm::vec4(projection[0][0], projection[1][1], near_plane, far_plane))
+    {
+        build_clusters(projection, near_plane, far_plane);
+    }
+
+    const std::vector<Light>& lights = registry.get_lights();
+    const auto                get_shadow_index = [shadow_indices](const uint32_t i) {
+        return (shadow_indices != nullptr && i < shadow_indices->size()) ? (*shadow_indices)[i]
+                                                                         : -1;
+    };
+    light_data.clear();
+    culling_lights.clear();
+    for (auto& slice : slice_lights)
+    {
+        slice.clear();
+    }
+
+    // 日光排在最前面，对所有格子生效
+    uint32_t light_num = 0;
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        if (lights[i].get_light_type() != 1) { continue; }
+        const Transform& transform = registry.get_light_transform(i);
+        light_data.push_back(
+            lights[i].get_uniform_data(transform.get_world_position(), transform.get_rotation()));
+        light_data.back().shadow_index = get_shadow_index(i);
+        light_num++;
+    }
+    const uint32_t global_light_num = light_num;
+
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        const int32_t light_type = lights[i].get_light_type();
+        if (light_type == -1 || light_type == 1) { continue; }
+        const Transform& transform      = registry.get_light_transform(i);
+        const glm::vec3  world_position = transform.get_world_position();
+        light_data.push_back(lights[i].get_uniform_data(world_position, transform.get_rotation()));
+        light_data.back().shadow_index = get_shadow_index(i);
+
+        CullingLight light = {};
+        light.position     = glm::vec3(view * glm::vec4(world_position, 1.0F));
+        light.range        = lights[i].get_range();
+        light.gpu_index    = light_num++;
+        // 面光暂时按点光处理
+        const glm::vec3 direction = transform.get_rotation();
+        light.spot = (light_type == 2) && glm::dot(direction, direction) > 0.0F;
+        if (light.spot)
+        {
+            light.direction = glm::normalize(glm::mat3(view) * direction);
+            light.cos_outer = lights[i].get_outer_cutOff();
+            light.sin_outer = std::sqrt(std::max(1.0F - light.cos_outer * light.cos_outer, 0.0F));
+        }
+
+        uint32_t z_begin = 0;
+        uint32_t z_end   = 0;
+        if (!compute_cluster_range(projection, light, z_begin, z_end)) { continue; }
+        const auto culling_index = static_cast<uint32_t>(culling_lights.size());
+        culling_lights.push_back(light);
+        for (uint32_t z = z_begin; z <= z_end; z++)
+        {
+            slice_lights[z].push_back(culling_index);
+        }
+    }
+
+    // 按深度切片分配，每个切片只写自己的格子
+    std::fill(cluster_counts.begin(), cluster_counts.end(), 0);
+    overflow_num = 0;
+    const auto assign_slices = [this](const uint32_t first, const uint32_t last) {
+        for (uint32_t z = first; z < last; z++)
+        {
+            assign_slice(z);
+        }
+    };
+    if (culling_lights.size() >= MIN_LIGHTS_FOR_WORKERS)
+    {
+        JobSystem::get_instance().parallel_for(0, CLUSTER_GRID_Z, 1, assign_slices);
+    }
+    else { assign_slices(0, CLUSTER_GRID_Z); }
+
+    // 前缀和，把各格子的灯光列表压成一个数组
+    light_indices.clear();
+    uint32_t max_cluster_light_num = 0;
+    for (uint32_t i = 0; i < CLUSTER_NUM; i++)
+    {
+        const uint32_t count = cluster_counts[i];
+        cluster_ranges[i]    = glm::uvec2(static_cast<uint32_t>(light_indices.size()), count);
+        const auto first =
+            cluster_scratch.begin() + static_cast<ptrdiff_t>(i) * MAX_LIGHTS_PER_CLUSTER;
+        light_indices.insert(light_indices.end(), first, first + count);
+        max_cluster_light_num = std::max(max_cluster_light_num, count);
+    }
+
+    stats = {light_num, global_light_num, static_cast<uint32_t>(light_indices.size()),
+             max_cluster_light_num, overflow_num.load()};
+    if (stats.overflow_num > 0)
+    {
+        LOG_EVERY_N(WARNING, 600) << "Warning: " << stats.overflow_num
+                                  << " light assignments dropped, a cluster can hold at most "
+                                  << MAX_LIGHTS_PER_CLUSTER << " lights.";
+    }
+}
+
+void ck::ClusteredLighting::upload_and_bind()
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+
+    // 参数
+    const ClusterParamsData params = {
+        glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, stats.global_light_num),
+        glm::vec4(cached_projection.z, cached_projection.w, slice_scale, slice_bias),
+        glm::vec4(static_cast<float>(viewport_width), static_cast<float>(viewport_height), 0.0F,
+                  0.0F)};
+    if (!params_buffer.is_valid())
+    {
+        params_buffer.create("cluster params", "ClusteredLighting");
+        gl_state.bind_buffer(GL_UNIFORM_BUFFER, params_buffer.get());
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ClusterParamsData), nullptr, GL_DYNAMIC_DRAW);
+        params_buffer.set_bytes(sizeof(ClusterParamsData));
+    }
+    gl_state.bind_buffer(GL_UNIFORM_BUFFER, params_buffer.get());
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ClusterParamsData), &params);
+
+    // 灯光数组和灯光索引的长度每帧都在变，容量不够时按2倍扩容，每帧先orphan再写入
+    const auto upload_stream = [&gl_state](GLBuffer& buffer, const char* label, size_t& capacity,
+                                           const size_t num, const size_t element_size,
+                                           const void* data) {
+        if (!buffer.is_valid()) { buffer.create(label, "ClusteredLighting"); }
+        gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, buffer.get());
+        capacity = std::max<size_t>(64, capacity);
+        while (capacity < num) { capacity *= 2; }
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity * element_size),
+                     nullptr, GL_STREAM_DRAW);
+        buffer.set_bytes(capacity * element_size);
+        if (num > 0)
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                            static_cast<GLsizeiptr>(num * element_size), data);
+        }
+    };
+    upload_stream(lights_buffer, "cluster lights", lights_capacity, light_data.size(),
+                  sizeof(LightUniformData), light_data.data());
+    upload_stream(indices_buffer, "cluster light indices", indices_capacity, light_indices.size(),
+                  sizeof(uint32_t), light_indices.data());
+
+    // 格子范围大小固定
+    const size_t ranges_bytes = cluster_ranges.size() * sizeof(glm::uvec2);
+    if (!ranges_buffer.is_valid()) { ranges_buffer.create("cluster ranges", "ClusteredLighting"); }
+    gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, ranges_buffer.get());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(ranges_bytes),
+                 cluster_ranges.data(), GL_STREAM_DRAW);
+    ranges_buffer.set_bytes(ranges_bytes);
+
+    gl_state.bind_buffer_base(GL_UNIFORM_BUFFER, CLUSTER_PARAMS_BINDING, params_buffer.get());
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHTS_BINDING,
+                              lights_buffer.get());
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, CLUSTER_RANGES_BINDING,
+                              ranges_buffer.get());
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_INDICES_BINDING,
+                              indices_buffer.get());
+    GL_CHECK();
+}
+
+[[nodiscard]] const ck::ClusteredLightingStats& ck::ClusteredLighting::get_stats() const
+{
+    return stats;
+}
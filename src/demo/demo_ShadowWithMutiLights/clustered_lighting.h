@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/ck_gl_resource.h"
+#include "entity_registry.h"
+#include "light.h"
+
+namespace ck {
+
+static const uint32_t CLUSTER_GRID_X = 16;  // 必须是4的倍数，SIMD一次测试一行中的4个格子
+static const uint32_t CLUSTER_GRID_Y = 9;
+static const uint32_t CLUSTER_GRID_Z = 24;
+static const uint32_t CLUSTER_NUM    = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+static const uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+static const uint32_t MIN_LIGHTS_FOR_WORKERS = 32;  // 灯光太少时不提交任务，直接在调用线程上分配
+
+static const uint32_t CLUSTER_PARAMS_BINDING        = 1;  // UBO binding，0是灯光组UBO
+static const uint32_t CLUSTER_LIGHTS_BINDING        = 2;  // SSBO binding，0/1是实例化绘制
+static const uint32_t CLUSTER_RANGES_BINDING        = 3;
+static const uint32_t CLUSTER_LIGHT_INDICES_BINDING = 4;
+
+/// @brief 一帧分簇光照的统计
+struct ClusteredLightingStats
+{
+    uint32_t light_num;              // 上传的灯光数
+    uint32_t global_light_num;       // 日光，对所有格子生效
+    uint32_t light_index_num;        // 所有格子的灯光列表总长度
+    uint32_t max_cluster_light_num;  // 单个格子中最多的灯光数
+    uint32_t overflow_num;           // 超出MAX_LIGHTS_PER_CLUSTER被丢弃的次数
+};
+
+/// @brief 分簇前向渲染（clustered forward）的灯光分配
+/**NOTE - 分簇
+把视锥体切成 X * Y * Z 个格子（froxel）：屏幕上均匀划分，深度方向按指数划分，
+远处的格子更厚，每个格子在观察空间中的形状都接近立方体。
+1. 投影矩阵改变时重新计算每个格子在观察空间中的包围盒和包围球（SoA存放）。
+2. 每帧把点光/聚光变换到观察空间，用包围球在屏幕和深度上的投影算出它可能覆盖的格子范围，
+   再按深度切片交给任务系统并行分配（JobSystem::parallel_for），每个任务只写自己切片中的格子，
+   不需要加锁。
+3. 精确测试用SSE一次测4个格子：点光是球-包围盒测试，聚光再加一次锥-包围球测试。
+4. 前缀和把各格子的灯光列表压成一个数组，和每个格子的(起点, 数量)一起上传到SSBO。
+日光没有范围，排在灯光数组的最前面，着色器对每个片元都会计算。
+片元着色器根据gl_FragCoord和观察空间深度找到自己的格子，只遍历格子里的灯光。
+*/
+class ClusteredLighting {
+private:
+    /// @brief 观察空间中的灯光，用于剔除
+    struct CullingLight
+    {
+        glm::vec3 position;
+        float     range;
+        glm::vec3 direction;  // 聚光方向，点光忽略
+        float     cos_outer;
+        float     sin_outer;
+        bool      spot;
+        uint32_t  gpu_index;  // 在上传的灯光数组中的下标
+        uint32_t  x_begin, x_end, y_begin, y_end;  // 覆盖的格子范围[begin, end]
+    };
+
+    // 格子在观察空间中的包围盒和包围球，下标 = x + X * (y + Y * z)
+    std::vector<float> cluster_min_x, cluster_min_y, cluster_min_z;
+    std::vector<float> cluster_max_x, cluster_max_y, cluster_max_z;
+    std::vector<float> cluster_center_x, cluster_center_y, cluster_center_z, cluster_radius;
+    glm::vec4          cached_projection;  // (proj[0][0], proj[1][1], near, far)
+    float              slice_scale;        // slice = log(depth) * slice_scale - slice_bias
+    float              slice_bias;
+
+    // 每帧重建，复用内存
+    std::vector<LightUniformData>      light_data;  // 上传的灯光数组
+    std::vector<CullingLight>          culling_lights;
+    std::vector<std::vector<uint32_t>> slice_lights;  // 每个深度切片可能受影响的灯光
+    std::vector<uint32_t>              cluster_counts;
+    std::vector<uint32_t>              cluster_scratch;  // 每个格子MAX_LIGHTS_PER_CLUSTER个位置
+    std::vector<glm::uvec2>            cluster_ranges;   // (起点, 数量)
+    std::vector<uint32_t>              light_indices;
+    std::atomic<uint32_t>              overflow_num;
+    ClusteredLightingStats             stats;
+
+    GLBuffer params_buffer;
+    GLBuffer lights_buffer;
+    GLBuffer ranges_buffer;
+    GLBuffer indices_buffer;
+    size_t   lights_capacity;   // 以灯光为单位
+    size_t   indices_capacity;  // 以uint32_t为单位
+    uint32_t viewport_width;
+    uint32_t viewport_height;
+
+    void build_clusters(const glm::mat4& projection, float near_plane, float far_plane);
+    /// @return 灯光和视锥体不相交时返回false
+    bool compute_cluster_range(const glm::mat4& projection,
+                               CullingLight&    light,
+                               uint32_t&        z_begin,
+                               uint32_t&        z_end) const;
+    void assign_slice(uint32_t z);
+
+public:
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    ClusteredLighting(const ClusteredLighting&)            = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    /// @brief 在CPU上把场景中的灯光分配到格子里
+    /// @param shadow_indices 每个灯光（按灯光组件下标）的第一条阴影记录，为空表示都没有阴影
+    void update(const EntityRegistry&       registry,
+                const glm::mat4&            view,
+                const glm::mat4&            projection,
+                float                       near_plane,
+                float                       far_plane,
+                uint32_t                    viewport_width,
+                uint32_t                    viewport_height,
+                const std::vector<int32_t>* shadow_indices = nullptr);
+
+    /// @brief 上传灯光数组、格子范围和灯光索引，并绑定到对应的binding point
+    void upload_and_bind();
+
+    /// @brief 释放GL缓冲，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    [[nodiscard]] const ClusteredLightingStats& get_stats() const;
+};
+
+};  // namespace ck
@@ -0,0 +1,485 @@
+#include "entity_registry.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "bvh.h"
+#include "instance_buffer.h"
+#include "light.h"
+#include "render_object.h"
+#include "transform.h"
+
+ck::EntityRegistry::EntityRegistry() : entity_num(0) {}
+
+ck::EntityHandle ck::EntityRegistry::create(const RenderObjectType type,
+                                            std::string            name,
+                                            const EntityHandle     parent)
+{
+    uint32_t index = 0;
+    if (!free_indices.empty())
+    {
+        index = free_indices.back();
+        free_indices.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(generations.size());
+        generations.push_back(0);
+        alive.push_back(0);
+        types.push_back(RenderObjectType::NULL_OBJECT);
+        names.emplace_back();
+        hierarchy.push_back({});
+        transforms.emplace_back();
+        descendant_dirty.push_back(0);
+        renderable_lookup.push_back(NULL_ENTITY_INDEX);
+        light_lookup.push_back(NULL_ENTITY_INDEX);
+    }
+
+    alive[index]            = 1;
+    types[index]            = type;
+    names[index]            = std::move(name);
+    hierarchy[index]        = {NULL_ENTITY_INDEX, NULL_ENTITY_INDEX, NULL_ENTITY_INDEX,
+                               NULL_ENTITY_INDEX};
+    transforms[index]       = Transform();
+    descendant_dirty[index] = 0;
+    entity_num++;
+
+    if (is_alive(parent)) { link_child(parent.index, index); }
+    else
+    {
+        if (!parent.is_null()) { LOG(WARNING) << "parent entity is not alive: " << names[index]; }
+        roots.push_back(index);
+    }
+    mark_ancestors_dirty(index);  // 新实体的世界矩阵在下一次update_transforms()时计算
+    return {index, generations[index]};
+}
+
+void ck::EntityRegistry::destroy(const EntityHandle entity)
+{
+    if (!is_alive(entity))
+    {
+        LOG(WARNING) << "entity is not alive!";
+        return;
+    }
+
+    // 先把整棵子树收集起来，再逐个销毁
+    destroy_queue.clear();
+    destroy_queue.push_back(entity.index);
+    for (size_t head = 0; head < destroy_queue.size(); head++)
+    {
+        for (uint32_t child = hierarchy[destroy_queue[head]].first_child;
+             child != NULL_ENTITY_INDEX; child = hierarchy[child].next_sibling)
+        {
+            destroy_queue.push_back(child);
+        }
+    }
+    if (hierarchy[entity.index].parent == NULL_ENTITY_INDEX) { remove_root(entity.index); }
+    unlink_child(entity.index);
+
+    for (const uint32_t index : destroy_queue)
+    {
+        remove_renderable(index);
+        remove_light(index);
+        names[index].clear();
+        names[index].shrink_to_fit();
+        alive[index] = 0;
+        generations[index]++;  // 之前发出去的句柄全部失效
+        free_indices.push_back(index);
+        entity_num--;
+    }
+}
+
+void ck::EntityRegistry::reserve(const size_t entity_capacity, const size_t renderable_capacity,
+                                 const size_t light_capacity)
+{
+    generations.reserve(entity_capacity);
+    alive.reserve(entity_capacity);
+    types.reserve(entity_capacity);
+    names.reserve(entity_capacity);
+    hierarchy.reserve(entity_capacity);
+    transforms.reserve(entity_capacity);
+    descendant_dirty.reserve(entity_capacity);
+    renderable_lookup.reserve(entity_capacity);
+    light_lookup.reserve(entity_capacity);
+    moved_entities.reserve(entity_capacity);
+    renderables.reserve(renderable_capacity);
+    renderable_owners.reserve(renderable_capacity);
+    lights.reserve(light_capacity);
+    light_owners.reserve(light_capacity);
+    light_dirty.reserve(light_capacity);
+}
+
+[[nodiscard]] bool ck::EntityRegistry::is_alive(const EntityHandle entity) const
+{
+    return entity.index < generations.size() && alive[entity.index] != 0 &&
+           generations[entity.index] == entity.generation;
+}
+
+[[nodiscard]] size_t ck::EntityRegistry::get_entity_num() const
+{
+    return entity_num;
+}
+
+// ANCHOR - 层级
+
+void ck::EntityRegistry::link_child(const uint32_t parent, const uint32_t child)
+{
+    // 插到链表头部，O(1)
+    HierarchyNode& node = hierarchy[child];
+    node.parent         = parent;
+    node.prev_sibling   = NULL_ENTITY_INDEX;
+    node.next_sibling   = hierarchy[parent].first_child;
+    if (node.next_sibling != NULL_ENTITY_INDEX)
+    {
+        hierarchy[node.next_sibling].prev_sibling = child;
+    }
+    hierarchy[parent].first_child = child;
+}
+
+void ck::EntityRegistry::unlink_child(const uint32_t child)
+{
+    HierarchyNode& node = hierarchy[child];
+    if (node.parent == NULL_ENTITY_INDEX) { return; }
+    if (node.prev_sibling != NULL_ENTITY_INDEX)
+    {
+        hierarchy[node.prev_sibling].next_sibling = node.next_sibling;
+    }
+    else { hierarchy[node.parent].first_child = node.next_sibling; }
+    if (node.next_sibling != NULL_ENTITY_INDEX)
+    {
+        hierarchy[node.next_sibling].prev_sibling = node.prev_sibling;
+    }
+    node.parent       = NULL_ENTITY_INDEX;
+    node.prev_sibling = NULL_ENTITY_INDEX;
+    node.next_sibling = NULL_ENTITY_INDEX;
+}
+
+void ck::EntityRegistry::mark_ancestors_dirty(const uint32_t index)
+{
+    // 沿着父节点向上标记，已经标记过的祖先说明更上层也标记过了
+    for (uint32_t ancestor = hierarchy[index].parent;
+         ancestor != NULL_ENTITY_INDEX && descendant_dirty[ancestor] == 0;
+         ancestor = hierarchy[ancestor].parent)
+    {
+        descendant_dirty[ancestor] = 1;
+    }
+}
+
+void ck::EntityRegistry::remove_root(const uint32_t index)
+{
+    for (auto it = roots.begin(); it != roots.end(); it++)
+    {
+        if (*it == index)
+        {
+            *it = roots.back();
+            roots.pop_back();
+            return;
+        }
+    }
+}
+
+bool ck::EntityRegistry::set_parent(const EntityHandle entity, const EntityHandle parent)
+{
+    if (!is_alive(entity) || !is_alive(parent))
+    {
+        LOG(WARNING) << "entity or parent entity is not alive!";
+        return false;
+    }
+    if (hierarchy[entity.index].parent == parent.index) { return true; }
+
+    // 不能把自己挂到自己的子树下面，否则层级中会出现环
+    for (uint32_t ancestor = parent.index; ancestor != NULL_ENTITY_INDEX;
+         ancestor          = hierarchy[ancestor].parent)
+    {
+        if (ancestor == entity.index)
+        {
+            LOG(WARNING) << "cannot parent an entity to its own descendant: "
+                         << names[entity.index];
+            return false;
+        }
+    }
+
+    if (hierarchy[entity.index].parent == NULL_ENTITY_INDEX) { remove_root(entity.index); }
+    unlink_child(entity.index);
+    link_child(parent.index, entity.index);
+    transforms[entity.index].mark_world_dirty();  // 父节点变了，世界矩阵需要重新计算
+    mark_ancestors_dirty(entity.index);
+    return true;
+}
+
+[[nodiscard]] ck::EntityHandle ck::EntityRegistry::get_parent(const EntityHandle entity) const
+{
+    DCHECK(is_alive(entity));
+    const uint32_t parent = hierarchy[entity.index].parent;
+    if (parent == NULL_ENTITY_INDEX) { return {}; }
+    return {parent, generations[parent]};
+}
+
+[[nodiscard]] std::vector<ck::EntityHandle>
+ck::EntityRegistry::get_children(const EntityHandle entity) const
+{
+    DCHECK(is_alive(entity));
+    std::vector<EntityHandle> children;
+    for (uint32_t child = hierarchy[entity.index].first_child; child != NULL_ENTITY_INDEX;
+         child          = hierarchy[child].next_sibling)
+    {
+        children.push_back({child, generations[child]});
+    }
+    return children;
+}
+
+// ANCHOR - 通用属性
+
+[[nodiscard]] ck::RenderObjectType ck::EntityRegistry::get_type(const EntityHandle entity) const
+{
+    DCHECK(is_alive(entity));
+    return types[entity.index];
+}
+
+[[nodiscard]] const std::string& ck::EntityRegistry::get_name(const EntityHandle entity) const
+{
+    DCHECK(is_alive(entity));
+    return names[entity.index];
+}
+
+void ck::EntityRegistry::set_name(const EntityHandle entity, std::string name)
+{
+    DCHECK(is_alive(entity));
+    names[entity.index] = std::move(name);
+}
+
+// ANCHOR - 变换
+
+[[nodiscard]] const ck::Transform&
+ck::EntityRegistry::get_transform(const EntityHandle entity) const
+{
+    DCHECK(is_alive(entity));
+    return transforms[entity.index];
+}
+
+[[nodiscard]] ck::Transform& ck::EntityRegistry::edit_transform(const EntityHandle entity)
+{
+    DCHECK(is_alive(entity));
+    mark_ancestors_dirty(entity.index);
+    return transforms[entity.index];
+}
+
+void ck::EntityRegistry::update_transforms()
+{
+    /**NOTE - 广度优先
+    队列中保存(实体下标, 父节点的世界矩阵是否改变)。父节点一定先于子节点出队，
+    子节点更新时父节点的世界矩阵已经是最新的。
+    世界矩阵没变、子树中也没有脏实体时，整棵子树都不会被访问。
+    */
+    transform_queue.clear();
+    for (const uint32_t root : roots)
+    {
+        transform_queue.emplace_back(root, false);
+    }
+
+    InstanceBuffer& instance_buffer = InstanceBuffer::get_instance();
+    for (size_t head = 0; head < transform_queue.size(); head++)
+    {
+        const auto [index, parent_changed] = transform_queue[head];
+
+        Transform& transform = transforms[index];
+        const bool changed   = parent_changed || transform.is_world_dirty();
+        if (changed)
+        {
+            const uint32_t parent = hierarchy[index].parent;
+            transform.update_world_matrix(
+                (parent == NULL_ENTITY_INDEX) ? nullptr : &(transforms[parent].get_world_matrix()));
+            const uint32_t renderable = renderable_lookup[index];
+            if (renderable != NULL_ENTITY_INDEX)
+            {
+                instance_buffer.set_transform(renderables[renderable].get_instance_slot(),
+                                              transform.get_world_matrix());
+                moved_entities.push_back(index);
+            }
+            const uint32_t light = light_lookup[index];
+            if (light != NULL_ENTITY_INDEX) { light_dirty[light] = 1; }
+        }
+
+        const bool subtree_dirty = descendant_dirty[index] != 0;
+        descendant_dirty[index]  = 0;
+        if (!changed && !subtree_dirty) { continue; }
+        for (uint32_t child = hierarchy[index].first_child; child != NULL_ENTITY_INDEX;
+             child          = hierarchy[child].next_sibling)
+        {
+            transform_queue.emplace_back(child, changed);
+        }
+    }
+}
+
+[[nodiscard]] const std::vector<uint32_t>& ck::EntityRegistry::get_moved_entities() const
+{
+    return moved_entities;
+}
+
+void ck::EntityRegistry::clear_moved_entities()
+{
+    moved_entities.clear();
+}
+
+[[nodiscard]] const std::vector<uint32_t>& ck::EntityRegistry::get_released_bounds_proxies() const
+{
+    return released_bounds_proxies;
+}
+
+void ck::EntityRegistry::clear_released_bounds_proxies()
+{
+    released_bounds_proxies.clear();
+}
+
+// ANCHOR - 组件
+
+ck::Renderable& ck::EntityRegistry::add_renderable(const EntityHandle             entity,
+                                                   const std::shared_ptr<Model>&  model,
+                                                   const std::shared_ptr<Shader>& shader,
+                                                   const RenderDrawType           draw_type)
+{
+    DCHECK(is_alive(entity));
+    remove_renderable(entity.index);  // 每个实体最多一个
+    renderable_lookup[entity.index] = static_cast<uint32_t>(renderables.size());
+    renderables.emplace_back(types[entity.index], model, shader, draw_type);
+    renderable_owners.push_back(entity.index);
+    transforms[entity.index].mark_world_dirty();  // 新槽位需要写入世界矩阵
+    mark_ancestors_dirty(entity.index);
+    return renderables.back();
+}
+
+ck::Light& ck::EntityRegistry::add_light(const EntityHandle entity, const Light& light)
+{
+    DCHECK(is_alive(entity));
+    remove_light(entity.index);
+    light_lookup[entity.index] = static_cast<uint32_t>(lights.size());
+    lights.push_back(light);
+    light_owners.push_back(entity.index);
+    light_dirty.push_back(1);
+    return lights.back();
+}
+
+void ck::EntityRegistry::remove_renderable(const uint32_t index)
+{
+    const uint32_t removed = renderable_lookup[index];
+    if (removed == NULL_ENTITY_INDEX) { return; }
+    if (renderables[removed].get_bounds_proxy() != NULL_BVH_NODE)
+    {
+        released_bounds_proxies.push_back(renderables[removed].get_bounds_proxy());
+    }
+    // 把末尾的组件移动到空位上
+    const auto last = static_cast<uint32_t>(renderables.size() - 1);
+    if (removed != last)
+    {
+        renderables[removed]                         = std::move(renderables[last]);
+        renderable_owners[removed]                   = renderable_owners[last];
+        renderable_lookup[renderable_owners[removed]] = removed;
+    }
+    renderables.pop_back();
+    renderable_owners.pop_back();
+    renderable_lookup[index] = NULL_ENTITY_INDEX;
+}
+
+void ck::EntityRegistry::remove_light(const uint32_t index)
+{
+    const uint32_t removed = light_lookup[index];
+    if (removed == NULL_ENTITY_INDEX) { return; }
+    const auto last = static_cast<uint32_t>(lights.size() - 1);
+    if (removed != last)
+    {
+        lights[removed]                    = lights[last];
+        light_owners[removed]              = light_owners[last];
+        light_lookup[light_owners[removed]] = removed;
+        light_dirty[removed]                = 1;  // 同一个下标现在是另一个灯光
+    }
+    lights.pop_back();
+    light_owners.pop_back();
+    light_dirty.pop_back();
+    light_lookup[index] = NULL_ENTITY_INDEX;
+}
+
+[[nodiscard]] ck::Renderable* ck::EntityRegistry::find_renderable(const EntityHandle entity)
+{
+    if (!is_alive(entity) || renderable_lookup[entity.index] == NULL_ENTITY_INDEX)
+    {
+        return nullptr;
+    }
+    return &renderables[renderable_lookup[entity.index]];
+}
+
+[[nodiscard]] const ck::Light* ck::EntityRegistry::find_light(const EntityHandle entity) const
+{
+    if (!is_alive(entity) || light_lookup[entity.index] == NULL_ENTITY_INDEX) { return nullptr; }
+    return &lights[light_lookup[entity.index]];
+}
+
+[[nodiscard]] ck::Light* ck::EntityRegistry::edit_light(const EntityHandle entity)
+{
+    if (!is_alive(entity) || light_lookup[entity.index] == NULL_ENTITY_INDEX) { return nullptr; }
+    light_dirty[light_lookup[entity.index]] = 1;
+    return &lights[light_lookup[entity.index]];
+}
+
+[[nodiscard]] uint32_t ck::EntityRegistry::get_renderable_index(const uint32_t entity_index) const
+{
+    return renderable_lookup[entity_index];
+}
+
+[[nodiscard]] ck::Renderable& ck::EntityRegistry::get_renderable(const uint32_t renderable_index)
+{
+    return renderables[renderable_index];
+}
+
+[[nodiscard]] const std::vector<ck::Renderable>& ck::EntityRegistry::get_renderables() const
+{
+    return renderables;
+}
+
+[[nodiscard]] const std::vector<ck::Light>& ck::EntityRegistry::get_lights() const
+{
+    return lights;
+}
+
+[[nodiscard]] const glm::mat4&
+ck::EntityRegistry::get_renderable_world_matrix(const uint32_t renderable_index) const
+{
+    return transforms[renderable_owners[renderable_index]].get_world_matrix();
+}
+
+[[nodiscard]] const ck::Light*
+ck::EntityRegistry::get_renderable_light(const uint32_t renderable_index) const
+{
+    const uint32_t light = light_lookup[renderable_owners[renderable_index]];
+    return (light == NULL_ENTITY_INDEX) ? nullptr : &lights[light];
+}
+
+[[nodiscard]] const ck::Transform&
+ck::EntityRegistry::get_light_transform(const uint32_t light_index) const
+{
+    return transforms[light_owners[light_index]];
+}
+
+[[nodiscard]] ck::EntityHandle
+ck::EntityRegistry::get_light_entity(const uint32_t light_index) const
+{
+    const uint32_t owner = light_owners[light_index];
+    return {owner, generations[owner]};
+}
+
+[[nodiscard]] bool ck::EntityRegistry::is_light_dirty(const uint32_t light_index) const
+{
+    return light_dirty[light_index] != 0;
+}
+
+void ck::EntityRegistry::clear_light_dirty()
+{
+    std::fill(light_dirty.begin(), light_dirty.end(), 0);
+}
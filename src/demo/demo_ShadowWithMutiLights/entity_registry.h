@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "light.h"
+#include "model.h"
+#include "render_object.h"
+#include "shader.h"
+#include "transform.h"
+
+namespace ck {
+
+static const uint32_t NULL_ENTITY_INDEX = 0xFFFFFFFF;
+
+/// @brief 实体句柄 = 槽位下标 + 代数
+/// @note 实体被销毁后槽位会被复用，代数加一，之前发出去的句柄随之失效
+struct EntityHandle
+{
+    uint32_t index{NULL_ENTITY_INDEX};
+    uint32_t generation{0};
+
+    [[nodiscard]] bool is_null() const { return index == NULL_ENTITY_INDEX; }
+    bool               operator==(const EntityHandle& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+/// @brief 场景中所有实体的数据，按组件分成若干个连续数组（SoA）
+/**NOTE - 存储布局
+1. 按实体下标索引的数组：代数、类型、名字、层级、变换。
+   销毁的槽位放进free list优先复用，数组保持紧密。
+2. 紧密排列的组件数组：renderables、lights。
+   xxx_owners保存组件所属的实体下标，xxx_lookup把实体下标映射回组件下标；
+   删除组件时把末尾的组件移动到空位上，遍历时不会遇到空洞。
+3. 层级用first_child/next_sibling组成的侵入式链表表示，不需要为每个实体分配子节点数组。
+   父子关系只保存下标，对外只发放EntityHandle，不再有悬空的裸指针。
+遍历灯光、可渲染物体时只访问对应的紧密数组，不需要在堆上跳来跳去。
+*/
+class EntityRegistry {
+private:
+    struct HierarchyNode
+    {
+        uint32_t parent;
+        uint32_t first_child;
+        uint32_t next_sibling;
+        uint32_t prev_sibling;
+    };
+
+    // 按实体下标索引
+    std::vector<uint32_t>         generations;
+    std::vector<uint8_t>          alive;
+    std::vector<RenderObjectType> types;
+    std::vector<std::string>      names;
+    std::vector<HierarchyNode>    hierarchy;
+    std::vector<Transform>        transforms;
+    std::vector<uint8_t>          descendant_dirty;  // 子树中有实体的变换改变了
+    std::vector<uint32_t>         renderable_lookup;
+    std::vector<uint32_t>         light_lookup;
+    std::vector<uint32_t>         free_indices;
+    std::vector<uint32_t>         roots;  // 没有父节点的实体
+    size_t                        entity_num;
+
+    // 紧密排列的组件
+    std::vector<Renderable> renderables;
+    std::vector<uint32_t>   renderable_owners;
+    std::vector<Light>      lights;
+    std::vector<uint32_t>   light_owners;
+    std::vector<uint8_t>    light_dirty;  // 灯光参数或世界矩阵改变了，GPU上的记录需要重写
+
+    std::vector<std::pair<uint32_t, bool>> transform_queue;  // 广度优先遍历用，复用内存
+    std::vector<uint32_t>                  destroy_queue;
+
+    // 留给Scene维护BVH：世界矩阵改变的可渲染实体，以及被删除的组件留下的proxy
+    std::vector<uint32_t> moved_entities;
+    std::vector<uint32_t> released_bounds_proxies;
+
+    void link_child(uint32_t parent, uint32_t child);
+    void unlink_child(uint32_t child);
+    void mark_ancestors_dirty(uint32_t index);
+    void remove_root(uint32_t index);
+    void remove_renderable(uint32_t index);
+    void remove_light(uint32_t index);
+
+public:
+    EntityRegistry();
+
+    /// @param parent 为空时创建一个没有父节点的实体（场景根节点）
+    EntityHandle create(RenderObjectType type, std::string name, EntityHandle parent);
+    /// @brief 销毁实体以及它的整棵子树
+    void destroy(EntityHandle entity);
+
+    /// @brief 预先分配实体和组件的存储，批量创建时避免反复扩容
+    /// @note 组件数组紧密排列，容量单独给出，灯光通常远少于实体
+    void reserve(size_t entity_capacity, size_t renderable_capacity, size_t light_capacity);
+
+    [[nodiscard]] bool   is_alive(EntityHandle entity) const;
+    [[nodiscard]] size_t get_entity_num() const;
+
+    // 层级
+    /// @return 父节点无效或者会形成环时返回false
+    bool                      set_parent(EntityHandle entity, EntityHandle parent);
+    [[nodiscard]] EntityHandle get_parent(EntityHandle entity) const;
+    [[nodiscard]] std::vector<EntityHandle> get_children(EntityHandle entity) const;
+
+    // 通用属性
+    [[nodiscard]] RenderObjectType   get_type(EntityHandle entity) const;
+    [[nodiscard]] const std::string& get_name(EntityHandle entity) const;
+    void                             set_name(EntityHandle entity, std::string name);
+
+    // 变换
+    [[nodiscard]] const Transform& get_transform(EntityHandle entity) const;
+    /// @brief 获取可修改的变换，同时通知祖先“子树中有变换改变”
+    [[nodiscard]] Transform& edit_transform(EntityHandle entity);
+    /// @brief 广度优先更新世界矩阵，只进入有变化的子树
+    /// @note 世界矩阵改变的可渲染实体会记录到get_moved_entities()中
+    void update_transforms();
+    /// @brief 自上次clear_moved_entities()以来世界矩阵改变过的可渲染实体（实体下标，可能重复）
+    [[nodiscard]] const std::vector<uint32_t>& get_moved_entities() const;
+    void                                       clear_moved_entities();
+    /// @brief 被删除的Renderable留下的BVH proxy，需要由持有BVH的一方释放
+    [[nodiscard]] const std::vector<uint32_t>& get_released_bounds_proxies() const;
+    void                                       clear_released_bounds_proxies();
+
+    // 组件
+    Renderable& add_renderable(EntityHandle                   entity,
+                               const std::shared_ptr<Model>&  model,
+                               const std::shared_ptr<Shader>& shader,
+                               RenderDrawType                 draw_type);
+    Light&      add_light(EntityHandle entity, const Light& light);
+    [[nodiscard]] Renderable* find_renderable(EntityHandle entity);
+    [[nodiscard]] const Light* find_light(EntityHandle entity) const;
+    /// @brief 获取可修改的灯光，同时把它标记为脏
+    [[nodiscard]] Light*       edit_light(EntityHandle entity);
+
+    /// @return 实体下标对应的renderable下标，没有该组件时返回NULL_ENTITY_INDEX
+    [[nodiscard]] uint32_t    get_renderable_index(uint32_t entity_index) const;
+    [[nodiscard]] Renderable& get_renderable(uint32_t renderable_index);
+
+    // 按组件紧密遍历
+    [[nodiscard]] const std::vector<Renderable>& get_renderables() const;
+    [[nodiscard]] const std::vector<Light>&      get_lights() const;
+    [[nodiscard]] const glm::mat4& get_renderable_world_matrix(uint32_t renderable_index) const;
+    /// @return 灯光物体的灯光组件，几何体返回nullptr
+    [[nodiscard]] const Light* get_renderable_light(uint32_t renderable_index) const;
+    [[nodiscard]] const Transform& get_light_transform(uint32_t light_index) const;
+    [[nodiscard]] EntityHandle     get_light_entity(uint32_t light_index) const;
+    /// @note 新增、修改、移动了位置（包括被交换删除挪过来）的灯光都是脏的
+    [[nodiscard]] bool is_light_dirty(uint32_t light_index) const;
+    void               clear_light_dirty();
+};
+
+};  // namespace ck
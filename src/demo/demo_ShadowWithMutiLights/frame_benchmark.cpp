@@ -0,0 +1,297 @@
+#include "frame_benchmark.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <glog/logging.h>
+
+#include "core/ck_debug.h"
+#include "core/ck_gl_resource.h"
+#include "core/ck_gpu_profiler.h"
+#include "core/ck_job_system.h"
+#include "offscreen_target.h"
+#include "scene.h"
+#include "scene_description.h"
+#include "texture_loader.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Summary
+{
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+Summary summarize(const std::vector<ck::FrameTiming>&                timings,
+                  const std::function<double(const ck::FrameTiming&)>& field)
+{
+    if (timings.empty()) { return {}; }
+    std::vector<double> values;
+    values.reserve(timings.size());
+    for (const auto& timing : timings) { values.push_back(field(timing)); }
+    std::sort(values.begin(), values.end());
+    // 最近秩法：第ceil(p * n)小的值
+    const auto percentile = [&values](const double p) {
+        const auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    };
+    const double sum = std::accumulate(values.begin(), values.end(), 0.0);
+    return {sum / static_cast<double>(values.size()), percentile(0.50), percentile(0.95),
+            percentile(0.99), values.back()};
+}
+
+double to_ms(const Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+std::string get_gl_string(const GLenum name)
+{
+    const auto* value = reinterpret_cast<const char*>(glGetString(name));
+    return (value != nullptr) ? value : "unknown";
+}
+
+/// @brief JSON字符串转义，驱动名里可能有引号和反斜杠
+std::string escape_json(const std::string& text)
+{
+    std::string result;
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\') { result += '\\'; }
+        if (static_cast<unsigned char>(c) >= 0x20) { result += c; }
+    }
+    return result;
+}
+
+}  // namespace
+
+ck::FrameBenchmark::FrameBenchmark(const uint32_t frame_num, const uint32_t warmup_num)
+    : frame_num(std::max(frame_num, 1U)), warmup_num(warmup_num), timestamp_queries{},
+      frame_fences{}, pending_frames{}
+{
+}
+
+ck::FrameBenchmark::~FrameBenchmark()
+{
+    shutdown();
+}
+
+void ck::FrameBenchmark::shutdown()
+{
+    for (GLsync& fence : frame_fences)
+    {
+        if (fence != nullptr) { glDeleteSync(fence); }
+        fence = nullptr;
+    }
+    for (auto& queries : timestamp_queries)
+    {
+        if (queries[0] == 0) { continue; }
+        glDeleteQueries(2, queries.data());
+        queries = {};
+    }
+}
+
+void ck::FrameBenchmark::resolve_slot(const uint32_t slot)
+{
+    GLsync& fence = frame_fences[slot];
+    if (fence == nullptr) { return; }
+    // 第一次等待时要flush，否则fence可能永远不会被提交
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    GLuint64 begin = 0;
+    GLuint64 end   = 0;
+    glGetQueryObjectui64v(timestamp_queries[slot][0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(timestamp_queries[slot][1], GL_QUERY_RESULT, &end);
+    timings[pending_frames[slot]].gpu_ms = static_cast<double>(end - begin) * 1e-6;
+}
+
+void ck::FrameBenchmark::run(Scene&                  scene,
+                             SceneLightUBOManager&   light_manager,
+                             const SceneDescription& description,
+                             const OffscreenTarget&  target)
+{
+    if (timestamp_queries[0][0] == 0)
+    {
+        for (auto& queries : timestamp_queries) { glGenQueries(2, queries.data()); }
+    }
+    JobSystem&     job_system     = JobSystem::get_instance();
+    TextureLoader& texture_loader = TextureLoader::get_instance();
+    Camera&        camera         = scene.get_camera();
+    const uint32_t width          = target.get_width();
+    const uint32_t height         = target.get_height();
+    const float    start_time     = description.camera_path.empty()
+                                        ? 0.0F
+                                        : description.camera_path.front().time;
+    const float    duration       = description.get_duration();
+
+    const auto render = [&](const float camera_time) {
+        GpuProfiler::get_instance().begin_frame();
+        job_system.process_main_thread_jobs();  // 工作线程提交的GL任务
+        const CameraKeyframe pose = description.sample_camera_path(camera_time);
+        camera.set_pose(pose.position, pose.yaw, pose.pitch);
+        scene.update_transforms();
+        light_manager.update_light_UBO();
+        target.bind();
+        scene.draw(width, height);
+    };
+
+    // ANCHOR - 预热：跑满warmup_num帧，并且所有纹理都已经上传
+    const Clock::time_point warmup_start = Clock::now();
+    uint32_t                warmup_frame = 0;
+    while (warmup_frame < warmup_num || texture_loader.get_pending_num() > 0)
+    {
+        render(start_time);
+        glFinish();
+        warmup_frame++;
+        if (to_ms(Clock::now() - warmup_start) > BENCHMARK_UPLOAD_TIMEOUT_SECS * 1000.0)
+        {
+            LOG(WARNING) << "[frame benchmark] " << texture_loader.get_pending_num()
+                         << " textures are still loading, timings may be noisy";
+            break;
+        }
+    }
+    LOG(INFO) << "[frame benchmark] " << warmup_frame << " warmup frames, measuring " << frame_num
+              << " frames at " << width << "x" << height;
+
+    // ANCHOR - 计时
+    timings.assign(frame_num, FrameTiming{});
+    Clock::time_point frame_start = Clock::now();
+    for (uint32_t i = 0; i < frame_num; i++)
+    {
+        const uint32_t slot = i % FRAME_BENCHMARK_LATENCY;
+        resolve_slot(slot);  // 限制在GPU上排队的帧数
+
+        const Clock::time_point cpu_start = Clock::now();
+        if (i > 0) { timings[i - 1].frame_ms = to_ms(cpu_start - frame_start); }
+        frame_start = cpu_start;
+
+        const float camera_time =
+            (frame_num > 1) ? start_time + duration * static_cast<float>(i) /
+                                               static_cast<float>(frame_num - 1)
+                            : start_time;
+        glQueryCounter(timestamp_queries[slot][0], GL_TIMESTAMP);
+        render(camera_time);
+        glQueryCounter(timestamp_queries[slot][1], GL_TIMESTAMP);
+        frame_fences[slot]   = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pending_frames[slot] = i;
+        glFlush();
+
+        FrameTiming& timing         = timings[i];
+        timing.frame                = i;
+        timing.camera_time          = camera_time;
+        timing.cpu_ms               = to_ms(Clock::now() - cpu_start);
+        timing.draw_call_num        = scene.get_render_queue().get_draw_call_num();
+        timing.indirect_command_num = scene.get_render_queue().get_indirect_command_num();
+        timing.gpu_culling          = scene.get_gpu_culling().get_stats();
+    }
+    for (uint32_t slot = 0; slot < FRAME_BENCHMARK_LATENCY; slot++) { resolve_slot(slot); }
+    timings.back().frame_ms = to_ms(Clock::now() - frame_start);
+    GL_CHECK();
+}
+
+bool ck::FrameBenchmark::write_csv(const std::string& file_path) const
+{
+    std::ofstream file(file_path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Failed to open " << file_path;
+        return false;
+    }
+    file << "frame,camera_time,cpu_ms,gpu_ms,frame_ms,draw_calls,indirect_commands,"
+            "gpu_frustum_culled,gpu_occluded,gpu_visible\n";
+    for (const auto& t : timings)
+    {
+        file << t.frame << ',' << t.camera_time << ',' << t.cpu_ms << ',' << t.gpu_ms << ','
+             << t.frame_ms << ',' << t.draw_call_num << ',' << t.indirect_command_num << ','
+             << t.gpu_culling.frustum_culled << ',' << t.gpu_culling.occluded << ','
+             << t.gpu_culling.visible << '\n';
+    }
+    return true;
+}
+
+bool ck::FrameBenchmark::write_json(const std::string& file_path) const
+{
+    std::ofstream file(file_path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Failed to open " << file_path;
+        return false;
+    }
+    const auto write_summary = [&file, this](const char* name, const auto& field) {
+        const Summary s = summarize(timings, field);
+        file << "    \"" << name << "\": {\"mean\": " << s.mean << ", \"p50\": " << s.p50
+             << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max
+             << "}";
+    };
+
+    file << "{\n";
+    file << "  \"renderer\": \"" << escape_json(get_gl_string(GL_RENDERER)) << "\",\n";
+    file << "  \"version\": \"" << escape_json(get_gl_string(GL_VERSION)) << "\",\n";
+    file << "  \"frame_num\": " << timings.size() << ",\n";
+    file << "  \"summary\": {\n";
+    write_summary("cpu_ms", [](const FrameTiming& t) { return t.cpu_ms; });
+    file << ",\n";
+    write_summary("gpu_ms", [](const FrameTiming& t) { return t.gpu_ms; });
+    file << ",\n";
+    write_summary("frame_ms", [](const FrameTiming& t) { return t.frame_ms; });
+    file << "\n  },\n";
+    file << "  \"frames\": [\n";
+    for (size_t i = 0; i < timings.size(); i++)
+    {
+        const FrameTiming& t = timings[i];
+        file << "    {\"frame\": " << t.frame << ", \"camera_time\": " << t.camera_time
+             << ", \"cpu_ms\": " << t.cpu_ms << ", \"gpu_ms\": " << t.gpu_ms
+             << ", \"frame_ms\": " << t.frame_ms << ", \"draw_calls\": " << t.draw_call_num
+             << ", \"indirect_commands\": " << t.indirect_command_num << "}"
+             << ((i + 1 < timings.size()) ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return true;
+}
+
+void ck::FrameBenchmark::print_summary() const
+{
+    const Summary cpu   = summarize(timings, [](const FrameTiming& t) { return t.cpu_ms; });
+    const Summary gpu   = summarize(timings, [](const FrameTiming& t) { return t.gpu_ms; });
+    const Summary frame = summarize(timings, [](const FrameTiming& t) { return t.frame_ms; });
+    LOG(INFO) << "[frame benchmark] " << get_gl_string(GL_RENDERER);
+    LOG(INFO) << "[frame benchmark] cpu   mean " << cpu.mean << " ms, p95 " << cpu.p95 << " ms";
+    LOG(INFO) << "[frame benchmark] gpu   mean " << gpu.mean << " ms, p95 " << gpu.p95 << " ms";
+    LOG(INFO) << "[frame benchmark] frame mean " << frame.mean << " ms, p95 " << frame.p95
+              << " ms, p99 " << frame.p99 << " ms";
+    const GLResourceRegistry& registry = GLResourceRegistry::get_instance();
+    LOG(INFO) << "[frame benchmark] tracked VRAM "
+              << static_cast<double>(registry.get_total_bytes()) / (1024.0 * 1024.0) << " MB in "
+              << registry.get_object_num() << " GL objects";
+    // 各个通道最近几十帧的平均时间
+    const GpuProfiler& profiler = GpuProfiler::get_instance();
+    for (const auto& node : profiler.get_nodes())
+    {
+        if (!profiler.is_node_active(node)) { continue; }
+        LOG(INFO) << "[frame benchmark]   " << std::string(node.depth * 2, ' ') << node.name
+                  << ": cpu " << node.cpu_ms << " ms, gpu " << node.gpu_ms << " ms";
+    }
+}
+
+[[nodiscard]] const std::vector<ck::FrameTiming>& ck::FrameBenchmark::get_timings() const
+{
+    return timings;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gpu_culling.h"
+
+namespace ck {
+
+class Scene;
+class SceneLightUBOManager;
+class OffscreenTarget;
+struct SceneDescription;
+
+static const uint32_t FRAME_BENCHMARK_LATENCY       = 3;  // 最多同时在GPU上的帧数
+static const uint32_t DEFAULT_BENCHMARK_FRAME_NUM   = 600;
+static const uint32_t DEFAULT_BENCHMARK_WARMUP_NUM  = 60;
+static const double   BENCHMARK_UPLOAD_TIMEOUT_SECS = 60.0;  // 等纹理上传完成的上限
+
+/// @brief 一帧的计时和统计
+struct FrameTiming
+{
+    uint32_t        frame;
+    float           camera_time;        // 相机路径上的时刻（秒）
+    double          cpu_ms;             // CPU准备和提交这一帧的时间
+    double          gpu_ms;             // GPU执行这一帧的时间（时间戳查询）
+    double          frame_ms;           // 和下一帧开始之间的间隔，包括等待GPU的时间
+    uint32_t        draw_call_num;
+    uint32_t        indirect_command_num;
+    GpuCullingStats gpu_culling;  // 读回的是几帧之前的统计
+};
+
+/// @brief 离屏的逐帧基准测试：沿着场景描述中的相机路径渲染固定的帧数
+/**NOTE - 可重复的计时
+1. 预热：先渲染若干帧，并等TextureLoader把所有纹理上传完，之后每一帧要画的东西都是确定的。
+2. 第i帧的相机时刻 = 路径时长 * i / (N - 1)，和运行速度无关，不同机器上画的是同样的帧。
+3. GPU时间用一对GL_TIMESTAMP查询包住scene.draw()；查询和fence各有FRAME_BENCHMARK_LATENCY份，
+   轮到一份时先等它的fence，再读上一次的结果，所以最多只有这么多帧同时在GPU上，
+   CPU不会无限地跑在GPU前面，读查询结果时也不会阻塞。
+*/
+class FrameBenchmark {
+private:
+    uint32_t frame_num;
+    uint32_t warmup_num;
+
+    std::array<std::array<uint32_t, 2>, FRAME_BENCHMARK_LATENCY> timestamp_queries;
+    std::array<GLsync, FRAME_BENCHMARK_LATENCY>                  frame_fences;
+    std::array<uint32_t, FRAME_BENCHMARK_LATENCY>                pending_frames;  // 每份对应的帧
+
+    std::vector<FrameTiming> timings;
+
+    /// @brief 等待第slot份的fence，读回它对应的帧的GPU时间
+    void resolve_slot(uint32_t slot);
+
+public:
+    explicit FrameBenchmark(uint32_t frame_num  = DEFAULT_BENCHMARK_FRAME_NUM,
+                            uint32_t warmup_num = DEFAULT_BENCHMARK_WARMUP_NUM);
+    ~FrameBenchmark();
+
+    FrameBenchmark(const FrameBenchmark&)            = delete;
+    FrameBenchmark& operator=(const FrameBenchmark&) = delete;
+
+    /// @brief 把场景渲染到target，记录每一帧的计时
+    /// @note 场景需要已经按description搭好，GL上下文在当前线程上
+    void run(Scene&                  scene,
+             SceneLightUBOManager&   light_manager,
+             const SceneDescription& description,
+             const OffscreenTarget&  target);
+
+    /// @brief 每帧一行
+    bool write_csv(const std::string& file_path) const;
+    /// @brief 运行环境、汇总统计（平均值和分位数）和每帧的数据
+    bool write_json(const std::string& file_path) const;
+
+    /// @brief 打印汇总到日志
+    void print_summary() const;
+
+    [[nodiscard]] const std::vector<FrameTiming>& get_timings() const;
+
+    /// @brief 释放查询和fence，需要在销毁GL上下文之前调用
+    void shutdown();
+};
+
+};  // namespace ck
@@ -0,0 +1,315 @@
+#include "gpu_culling.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <string>
+
+#include <glad/glad.h>  //glad first
+
+#include <glm/glm.hpp>
+#include <glog/logging.h>
+
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "core/ck_gpu_profiler.h"
+#include "indirect_draw_buffer.h"
+#include "shader.h"
+
+extern const std::string stdAsset_root;
+
+ck::GpuCulling::GpuCulling()
+    : cull_shader(stdAsset_root + "stdShader/stdGpuCulling.cs.glsl"),
+      hiz_shader(stdAsset_root + "stdShader/stdHiZBuild.cs.glsl"), enabled(true),
+      occlusion_enabled(true), show_occluded(false), source_framebuffer(0), hiz_width(0),
+      hiz_height(0), hiz_level_num(0), hiz_view_projection(1.0F), hiz_valid(false),
+      counter_fences{}, counter_index(0), counters_used(false), stats{}
+{
+    candidate_num_uniform       = cull_shader.get_uniform<int>("candidateNum");
+    view_projection_uniform     = cull_shader.get_uniform<glm::mat4>("viewProjection");
+    hiz_view_projection_uniform = cull_shader.get_uniform<glm::mat4>("hiZViewProjection");
+    occlusion_uniform           = cull_shader.get_uniform<bool>("occlusionEnabled");
+    show_occluded_uniform       = cull_shader.get_uniform<bool>("showOccluded");
+    hiz_max_level_uniform       = cull_shader.get_uniform<int>("hiZMaxLevel");
+    from_depth_uniform          = hiz_shader.get_uniform<bool>("fromDepth");
+}
+
+ck::GpuCulling::~GpuCulling()
+{
+    shutdown();
+}
+
+void ck::GpuCulling::shutdown()
+{
+    release_targets();
+    for (GLsync& fence : counter_fences)
+    {
+        if (fence != nullptr) { glDeleteSync(fence); }
+        fence = nullptr;
+    }
+    for (GLBuffer& buffer : counter_buffers) { buffer.reset(); }
+    counters_used = false;
+}
+
+void ck::GpuCulling::create_targets(const uint32_t width,
+                                    const uint32_t height,
+                                    const uint32_t framebuffer)
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+
+    // blit要求深度格式完全一致，按源帧缓冲的深度/模板位数选择
+    // 默认帧缓冲的附件叫GL_DEPTH/GL_STENCIL，离屏帧缓冲的叫GL_*_ATTACHMENT
+    const GLenum depth_attachment   = (framebuffer == 0) ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    const GLenum stencil_attachment = (framebuffer == 0) ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+    GLint        depth_bits         = 0;
+    GLint        stencil_bits       = 0;
+    GLint        object_type        = GL_NONE;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, depth_attachment,
+                                          GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &object_type);
+    if (object_type != GL_NONE)
+    {
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, depth_attachment,
+                                              GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
+    }
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, stencil_attachment,
+                                          GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &object_type);
+    if (object_type != GL_NONE)
+    {
+        glGetFramebufferAttachmentParameteriv(
+            GL_FRAMEBUFFER, stencil_attachment, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE,
+            &stencil_bits);
+    }
+    GLenum depth_format = (depth_bits == 32) ? GL_DEPTH_COMPONENT32F
+                          : (depth_bits == 16) ? GL_DEPTH_COMPONENT16
+                                               : GL_DEPTH_COMPONENT24;
+    size_t texel_bytes  = (depth_bits == 16) ? 2 : 4;  // 24位深度按4字节对齐
+    if (stencil_bits > 0)
+    {
+        depth_format = (depth_bits == 32) ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+        texel_bytes  = (depth_bits == 32) ? 8 : 4;
+    }
+    const size_t pixel_num = static_cast<size_t>(width) * height;
+
+    depth_texture.create("Hi-Z depth copy", "GpuCulling");
+    gl_state.bind_texture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, depth_texture.get());
+    glTexStorage2D(GL_TEXTURE_2D, 1, depth_format, static_cast<GLsizei>(width),
+                   static_cast<GLsizei>(height));
+    depth_texture.set_bytes(pixel_num * texel_bytes);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    depth_framebuffer.create("Hi-Z depth copy", "GpuCulling");
+    glBindFramebuffer(GL_FRAMEBUFFER, depth_framebuffer.get());
+    depth_framebuffer.set_bytes(0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,
+                           (stencil_bits > 0) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                           GL_TEXTURE_2D, depth_texture.get(), 0);
+    glDrawBuffer(GL_NONE);  // 只有深度
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG(ERROR) << "Hi-Z depth framebuffer is not complete!";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    source_framebuffer = framebuffer;
+    hiz_width          = width;
+    hiz_height         = height;
+    hiz_level_num = 1;
+    while ((std::max(width, height) >> hiz_level_num) > 0) { hiz_level_num++; }
+    hiz_texture.create("Hi-Z pyramid", "GpuCulling");
+    gl_state.bind_texture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, hiz_texture.get());
+    glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(hiz_level_num), GL_R32F,
+                   static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    size_t hiz_bytes = 0;
+    for (uint32_t level = 0; level < hiz_level_num; level++)
+    {
+        hiz_bytes += static_cast<size_t>(std::max(width >> level, 1U)) *
+                     std::max(height >> level, 1U) * sizeof(float);
+    }
+    hiz_texture.set_bytes(hiz_bytes);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GL_CHECK();
+}
+
+void ck::GpuCulling::release_targets()
+{
+    depth_texture.reset();
+    hiz_texture.reset();
+    depth_framebuffer.reset();
+    hiz_width     = 0;
+    hiz_height    = 0;
+    hiz_level_num = 0;
+    hiz_valid     = false;
+}
+
+void ck::GpuCulling::begin_frame()
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    if (!counter_buffers[0].is_valid())
+    {
+        for (GLBuffer& buffer : counter_buffers)
+        {
+            buffer.create("gpu culling counters", "GpuCulling");
+            gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, buffer.get());
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuCullingStats), nullptr,
+                         GL_DYNAMIC_READ);
+            buffer.set_bytes(sizeof(GpuCullingStats));
+        }
+    }
+
+    // 轮到的缓冲是GPU_CULLING_READBACK_LATENCY帧之前用过的，完成了才读，没完成就放弃这一份
+    counter_index         = (counter_index + 1) % GPU_CULLING_READBACK_LATENCY;
+    GLsync&        fence  = counter_fences[counter_index];
+    const uint32_t buffer = counter_buffers[counter_index].get();
+    if (fence != nullptr)
+    {
+        const GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+        {
+            gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GpuCullingStats), &stats);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    else if (!enabled) { stats = {}; }
+
+    const GpuCullingStats zero = {};
+    gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GpuCullingStats), &zero);
+    counters_used = false;
+    GL_CHECK();
+}
+
+void ck::GpuCulling::cull(const IndirectDrawBuffer& indirect_buffer,
+                          const glm::mat4&          view_projection)
+{
+    const auto candidate_num = static_cast<uint32_t>(indirect_buffer.get_candidate_num());
+    if (candidate_num == 0) { return; }
+    CK_GPU_PROFILE_SCOPE("gpu culling");
+
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    cull_shader.use();
+    cull_shader.setParameter(candidate_num_uniform, static_cast<int>(candidate_num));
+    cull_shader.setParameter(view_projection_uniform, view_projection);
+    cull_shader.setParameter(hiz_view_projection_uniform, hiz_view_projection);
+    cull_shader.setParameter(occlusion_uniform, occlusion_enabled && hiz_valid);
+    cull_shader.setParameter(show_occluded_uniform, show_occluded);
+    cull_shader.setParameter(hiz_max_level_uniform, static_cast<int>(hiz_level_num) - 1);
+    if (hiz_valid) { gl_state.bind_texture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, hiz_texture.get()); }
+
+    // 实例变换/索引、绘制数据和候选实例已经由各自的upload_and_bind()绑定
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GPU_CULLING_COMMANDS_BINDING,
+                              indirect_buffer.get_command_buffer());
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GPU_CULLING_COUNTERS_BINDING,
+                              counter_buffers[counter_index].get());
+    glDispatchCompute((candidate_num + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+    // 之后的绘制从命令缓冲读实例数，顶点着色器从SSBO读实例索引
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    counters_used = true;
+    GL_CHECK();
+}
+
+void ck::GpuCulling::build_hiz(const uint32_t   width,
+                               const uint32_t   height,
+                               const glm::mat4& view_projection)
+{
+    if (counters_used)
+    {
+        counter_fences[counter_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    if (!enabled || !occlusion_enabled || width == 0 || height == 0)
+    {
+        hiz_valid = false;
+        return;
+    }
+    CK_GPU_PROFILE_SCOPE("hi-z build");
+    // 从当前绑定的帧缓冲（默认帧缓冲或者离屏的渲染目标）读取深度
+    GLint bound_framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound_framebuffer);
+    const auto framebuffer = static_cast<uint32_t>(bound_framebuffer);
+    if (width != hiz_width || height != hiz_height || framebuffer != source_framebuffer)
+    {
+        release_targets();
+        create_targets(width, height, framebuffer);
+    }
+
+    // 多重采样的帧缓冲不能直接采样，先把深度复制到单采样的纹理（剪裁测试会影响blit）
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    gl_state.set_capability(GL_SCISSOR_TEST, false);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depth_framebuffer.get());
+    const auto w = static_cast<GLint>(width);
+    const auto h = static_cast<GLint>(height);
+    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // 第0层从深度纹理复制，之后每层读上一层、写这一层，层与层之间需要image屏障
+    hiz_shader.use();
+    gl_state.bind_texture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, depth_texture.get());
+    for (uint32_t level = 0; level < hiz_level_num; level++)
+    {
+        const uint32_t level_width  = std::max(width >> level, 1U);
+        const uint32_t level_height = std::max(height >> level, 1U);
+        hiz_shader.setParameter(from_depth_uniform, level == 0);
+        if (level > 0)
+        {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glBindImageTexture(0, hiz_texture.get(), static_cast<GLint>(level - 1), GL_FALSE, 0,
+                               GL_READ_ONLY, GL_R32F);
+        }
+        glBindImageTexture(1, hiz_texture.get(), static_cast<GLint>(level), GL_FALSE, 0,
+                           GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((level_width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+                          (level_height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+    }
+    // 下一帧的剔除用texelFetch读取
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    hiz_view_projection = view_projection;
+    hiz_valid           = true;
+    GL_CHECK();
+}
+
+void ck::GpuCulling::set_enabled(const bool value)
+{
+    enabled = value;
+    if (!enabled) { hiz_valid = false; }
+}
+
+void ck::GpuCulling::set_occlusion_enabled(const bool value)
+{
+    occlusion_enabled = value;
+    if (!occlusion_enabled) { hiz_valid = false; }
+}
+
+void ck::GpuCulling::set_show_occluded(const bool value)
+{
+    show_occluded = value;
+}
+
+[[nodiscard]] bool ck::GpuCulling::is_enabled() const
+{
+    return enabled;
+}
+
+[[nodiscard]] bool ck::GpuCulling::is_occlusion_enabled() const
+{
+    return occlusion_enabled;
+}
+
+[[nodiscard]] bool ck::GpuCulling::is_showing_occluded() const
+{
+    return show_occluded;
+}
+
+[[nodiscard]] const ck::GpuCullingStats& ck::GpuCulling::get_stats() const
+{
+    return stats;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "core/ck_gl_resource.h"
+#include "shader.h"
+
+namespace ck {
+
+class IndirectDrawBuffer;
+
+static const uint32_t GPU_CULLING_COMMANDS_BINDING = 8;   // SSBO binding，7是候选实例
+static const uint32_t GPU_CULLING_COUNTERS_BINDING = 9;
+static const uint32_t HIZ_TEXTURE_UNIT             = 14;  // 和着色器中的layout(binding)一致
+static const uint32_t GPU_CULLING_GROUP_SIZE       = 64;  // 和着色器中的local_size_x一致
+static const uint32_t HIZ_GROUP_SIZE               = 8;
+static const uint32_t GPU_CULLING_READBACK_LATENCY = 3;  // 统计晚几帧读回，不等待GPU
+
+/// @brief 一帧GPU剔除的统计，也是计数器缓冲的布局（std430）
+struct GpuCullingStats
+{
+    uint32_t frustum_culled;
+    uint32_t occluded;
+    uint32_t visible;
+};
+static_assert(sizeof(GpuCullingStats) == 12);
+
+/// @brief 用计算着色器对间接绘制的实例做视锥剔除和Hi-Z遮挡剔除
+/**NOTE - GPU剔除
+1. 渲染队列生成间接绘制命令时，每个实例写一条候选记录(槽位, 命令)，上传的命令中实例数为0。
+2. 剔除的计算着色器每个线程处理一个候选实例：用InstanceBuffer中的model矩阵把网格的包围盒
+   投影到裁剪空间，8个角点都在同一个平面之外时剔除；再把包围盒投影到上一帧的屏幕上，
+   和Hi-Z金字塔中对应区域最远的深度比较，包围盒最近的深度更远时判定为被遮挡。
+   通过的实例用atomicAdd在命令的实例数上占一个位置，把槽位写回实例索引数组，
+   之后的glMultiDrawElementsIndirect直接读取GPU写好的命令，CPU不需要知道结果。
+3. 不透明通道提交之后，把当前帧缓冲的深度blit到单采样的深度纹理（格式和源帧缓冲一致，
+   多重采样的帧缓冲只能这样复制），再逐层做最大值归约生成Hi-Z，供下一帧使用。
+   用上一帧的深度和矩阵测试，物体或相机快速移动时，刚刚露出来的物体可能晚一帧出现。
+4. 统计用GPU_CULLING_READBACK_LATENCY个计数器缓冲轮流使用，每个缓冲用完后插入fence，
+   轮回来时fence已经完成才读回，永远不阻塞CPU。
+为了能在llvmpipe上运行，只用到GL 4.3的计算着色器和原子操作，
+没有使用glMultiDrawElementsIndirectCount和subgroup扩展：命令数仍由CPU决定，实例数为0的命令是空操作。
+*/
+class GpuCulling {
+private:
+    Shader cull_shader;
+    Shader hiz_shader;
+
+    UniformHandle<int>       candidate_num_uniform;
+    UniformHandle<glm::mat4> view_projection_uniform;
+    UniformHandle<glm::mat4> hiz_view_projection_uniform;
+    UniformHandle<bool>      occlusion_uniform;
+    UniformHandle<bool>      show_occluded_uniform;
+    UniformHandle<int>       hiz_max_level_uniform;
+    UniformHandle<bool>      from_depth_uniform;
+
+    bool enabled;
+    bool occlusion_enabled;
+    bool show_occluded;  // 被遮挡的实例也画出来，用红色标出
+
+    // 深度纹理和Hi-Z，窗口大小改变时重新创建
+    GLTexture     depth_texture;
+    GLFramebuffer depth_framebuffer;
+    GLTexture     hiz_texture;
+    uint32_t      source_framebuffer;  // 深度从这个帧缓冲复制，它变了也要重新创建
+    uint32_t      hiz_width;
+    uint32_t      hiz_height;
+    uint32_t      hiz_level_num;
+    glm::mat4     hiz_view_projection;  // 生成Hi-Z时的矩阵
+    bool          hiz_valid;
+
+    std::array<GLBuffer, GPU_CULLING_READBACK_LATENCY> counter_buffers;
+    std::array<GLsync, GPU_CULLING_READBACK_LATENCY>   counter_fences;
+    uint32_t                                           counter_index;  // 本帧使用的计数器缓冲
+    bool                                               counters_used;
+    GpuCullingStats                                    stats;
+
+    /// @brief 创建和源帧缓冲同样大小、同样深度格式的深度纹理，以及完整mip链的Hi-Z
+    void create_targets(uint32_t width, uint32_t height, uint32_t framebuffer);
+    void release_targets();
+
+public:
+    GpuCulling();
+    ~GpuCulling();
+
+    GpuCulling(const GpuCulling&)            = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    /// @brief 读回已经完成的统计，清零本帧的计数器，每帧在提交之前调用一次
+    void begin_frame();
+
+    /// @brief 剔除已经上传的间接绘制命令，需要在upload_and_bind(true)之后、绘制之前调用
+    void cull(const IndirectDrawBuffer& indirect_buffer, const glm::mat4& view_projection);
+
+    /// @brief 用当前绑定的帧缓冲的深度生成Hi-Z，在不透明通道之后调用
+    void build_hiz(uint32_t width, uint32_t height, const glm::mat4& view_projection);
+
+    /// @brief 释放GL资源，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    void set_enabled(bool value);
+    void set_occlusion_enabled(bool value);
+    void set_show_occluded(bool value);
+
+    [[nodiscard]] bool                   is_enabled() const;
+    [[nodiscard]] bool                   is_occlusion_enabled() const;
+    [[nodiscard]] bool                   is_showing_occluded() const;
+    [[nodiscard]] const GpuCullingStats& get_stats() const;
+};
+
+};  // namespace ck
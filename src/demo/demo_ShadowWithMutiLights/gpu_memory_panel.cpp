@@ -0,0 +1,74 @@
+#include "gpu_memory_panel.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include <imgui.h>
+
+#include "core/ck_gl_resource.h"
+
+namespace {
+
+const char* const GPU_MEMORY_CSV_PATH = "ck_gpu_memory.csv";
+
+float to_mb(const size_t bytes)
+{
+    return static_cast<float>(static_cast<double>(bytes) / (1024.0 * 1024.0));
+}
+
+}  // namespace
+
+void ck::draw_gpu_memory_panel()
+{
+    const GLResourceRegistry& registry = GLResourceRegistry::get_instance();
+
+    // 第一次出现时放在右下角，之后可以拖动
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.0F,
+                                   viewport->WorkPos.y + viewport->WorkSize.y - 10.0F),
+                            ImGuiCond_FirstUseEver, ImVec2(1.0F, 1.0F));
+    ImGui::SetNextWindowBgAlpha(0.8F);
+    ImGui::Begin("GPU Memory");
+
+    ImGui::Text("%.2f MB in %zu objects", to_mb(registry.get_total_bytes()),
+                registry.get_object_num());
+    ImGui::SameLine();
+    if (ImGui::Button("export CSV")) { registry.write_csv(GPU_MEMORY_CSV_PATH); }
+    for (uint32_t i = 0; i < GL_OBJECT_KIND_NUM; i++)
+    {
+        const auto kind = static_cast<GLObjectKind>(i);
+        if (registry.get_kind_object_num(kind) == 0) { continue; }
+        ImGui::BulletText("%s: %u, %.2f MB", get_gl_object_kind_name(kind),
+                          registry.get_kind_object_num(kind), to_mb(registry.get_kind_bytes(kind)));
+    }
+
+    // 共享缓冲中的区间已经算在缓冲的持有者名下，单独一列，不计入上面的总量
+    const ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH |
+                                        ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("gpu_memory_assets", 4, table_flags, ImVec2(0.0F, 300.0F)))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("asset", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("objects", ImGuiTableColumnFlags_WidthFixed, 60.0F);
+        ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_WidthFixed, 70.0F);
+        ImGui::TableSetupColumn("shared MB", ImGuiTableColumnFlags_WidthFixed, 70.0F);
+        ImGui::TableHeadersRow();
+        for (const GLAssetMemory& asset : registry.collect_asset_memory())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(asset.owner.c_str());
+            if (ImGui::IsItemHovered()) { ImGui::SetTooltip("%s", asset.owner.c_str()); }
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", asset.object_num);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", to_mb(asset.bytes));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", to_mb(asset.shared_bytes));
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
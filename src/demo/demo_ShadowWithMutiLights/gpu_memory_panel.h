@@ -0,0 +1,10 @@
+#pragma once
+
+namespace ck {
+
+/// @brief 显存统计的ImGui浮窗：按类型和按资源显示GLResourceRegistry中的对象，
+///        并可以把所有对象导出到ck_gpu_memory.csv
+/// @note 在ImGui::NewFrame()和ImGui::Render()之间调用
+void draw_gpu_memory_panel();
+
+};  // namespace ck
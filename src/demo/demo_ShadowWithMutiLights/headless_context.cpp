@@ -0,0 +1,131 @@
+#include "headless_context.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+#include <array>
+
+#include <glog/logging.h>
+
+#ifdef CK_HEADLESS_EGL
+#    include <EGL/eglext.h>
+#endif
+
+#ifdef CK_HEADLESS_EGL
+
+namespace {
+
+void* egl_get_proc_address(const char* name)
+{
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+}  // namespace
+
+ck::HeadlessContext::HeadlessContext(const std::array<int32_t, 2> version)
+    : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT)
+{
+    // 优先使用surfaceless平台，不依赖任何显示服务器
+    const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display != nullptr)
+    {
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY)
+    {
+        LOG(WARNING) << "EGL surfaceless platform is unavailable, using the default display";
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (display == EGL_NO_DISPLAY || eglInitialize(display, &major, &minor) == EGL_FALSE)
+    {
+        throw std::runtime_error("eglInitialize failed!");
+    }
+    LOG(INFO) << "EGL " << major << "." << minor << ", " << eglQueryString(display, EGL_VENDOR);
+
+    if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE)
+    {
+        throw std::runtime_error("eglBindAPI(EGL_OPENGL_API) failed!");
+    }
+    // 不需要surface，config只用来创建上下文
+    const std::array<EGLint, 5> config_attributes = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                                     EGL_SURFACE_TYPE, 0, EGL_NONE};
+    EGLConfig                   config            = nullptr;
+    EGLint                      config_num        = 0;
+    if (eglChooseConfig(display, config_attributes.data(), &config, 1, &config_num) == EGL_FALSE ||
+        config_num == 0)
+    {
+        throw std::runtime_error("eglChooseConfig failed!");
+    }
+
+    const std::array<EGLint, 7> context_attributes = {
+        EGL_CONTEXT_MAJOR_VERSION,       version[0],
+        EGL_CONTEXT_MINOR_VERSION,       version[1],
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes.data());
+    if (context == EGL_NO_CONTEXT)
+    {
+        throw std::runtime_error("eglCreateContext failed! (llvmpipe may need "
+                                 "MESA_GL_VERSION_OVERRIDE)");
+    }
+    if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE)
+    {
+        throw std::runtime_error("eglMakeCurrent failed!");
+    }
+}
+
+void ck::HeadlessContext::shutdown()
+{
+    if (display == EGL_NO_DISPLAY) { return; }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) { eglDestroyContext(display, context); }
+    eglTerminate(display);
+    context = EGL_NO_CONTEXT;
+    display = EGL_NO_DISPLAY;
+}
+
+[[nodiscard]] GLADloadproc ck::HeadlessContext::get_loader()
+{
+    return static_cast<GLADloadproc>(egl_get_proc_address);
+}
+
+#else
+
+ck::HeadlessContext::HeadlessContext(const std::array<int32_t, 2> version) : window(nullptr)
+{
+    LOG(WARNING) << "built without EGL, falling back to a hidden GLFW window";
+    if (glfwInit() == 0) { throw std::runtime_error("glfwInit failed!"); }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);  // 只需要上下文
+
+    window = glfwCreateWindow(1, 1, "ck_bench", nullptr, nullptr);
+    if (window == nullptr) { throw std::runtime_error("glfwCreateWindow failed!"); }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);  // 不等垂直同步
+}
+
+void ck::HeadlessContext::shutdown()
+{
+    if (window == nullptr) { return; }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    window = nullptr;
+}
+
+[[nodiscard]] GLADloadproc ck::HeadlessContext::get_loader()
+{
+    return reinterpret_cast<GLADloadproc>(glfwGetProcAddress);
+}
+
+#endif
+
+ck::HeadlessContext::~HeadlessContext()
+{
+    shutdown();
+}
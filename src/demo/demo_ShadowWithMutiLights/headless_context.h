@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include <array>
+
+#include <glad/glad.h>  //GLAD first
+
+#ifdef CK_HEADLESS_EGL
+#    include <EGL/egl.h>
+#else
+#    include <GLFW/glfw3.h>
+#endif
+
+namespace ck {
+
+/// @brief 没有窗口的GL上下文，用于离屏渲染和基准测试
+/**NOTE - 无头模式
+编译时找到了EGL（定义了CK_HEADLESS_EGL）：用EGL_MESA_platform_surfaceless创建不带任何surface的
+核心上下文，不需要X11/Wayland，也不需要GPU，CI上可以直接跑在Mesa llvmpipe上。
+平台扩展不可用时退回eglGetDisplay(EGL_DEFAULT_DISPLAY)。
+没有EGL时退回一个隐藏的GLFW窗口（仍然需要显示服务器，比如Xvfb）。
+
+两种情况下都不创建默认帧缓冲之外的东西，也没有ImGui和垂直同步，
+场景画在OffscreenTarget里，见 offscreen_target.h。
+*/
+class HeadlessContext {
+private:
+#ifdef CK_HEADLESS_EGL
+    EGLDisplay display;
+    EGLContext context;
+#else
+    GLFWwindow* window;
+#endif
+
+public:
+    explicit HeadlessContext(std::array<int32_t, 2> version = {4, 6});
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&)            = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    /// @brief 交给gladLoadGLLoader()的函数加载器
+    [[nodiscard]] static GLADloadproc get_loader();
+
+    /// @brief 销毁上下文，之后不能再调用任何GL函数
+    void shutdown();
+};
+
+};  // namespace ck
@@ -0,0 +1,155 @@
+#include "indirect_draw_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "mesh_arena.h"
+
+ck::IndirectDrawBuffer* ck::IndirectDrawBuffer::singleton = nullptr;
+
+ck::IndirectDrawBuffer& ck::IndirectDrawBuffer::get_instance()
+{
+    if (singleton == nullptr) { singleton = new IndirectDrawBuffer(); }
+    return *singleton;
+}
+
+ck::IndirectDrawBuffer::IndirectDrawBuffer() = default;
+
+void ck::IndirectDrawBuffer::clear()
+{
+    commands.clear();
+    draw_data.clear();
+    candidates.clear();
+}
+
+uint32_t ck::IndirectDrawBuffer::push(const MeshAllocation& allocation,
+                                      const DequantBox&     dequant_box,
+                                      const AABB&           bounds,
+                                      const uint32_t        instance_base,
+                                      const uint32_t*       slots,
+                                      const uint32_t        instance_num)
+{
+    const auto command_index = static_cast<uint32_t>(commands.size());
+    commands.push_back({allocation.index_num, instance_num, allocation.first_index,
+                        static_cast<int32_t>(allocation.base_vertex), 0});
+    draw_data.push_back({glm::vec4(dequant_box.offset, 0.0F), glm::vec4(dequant_box.scale, 0.0F),
+                         glm::uvec4(instance_base, 0, 0, 0), glm::vec4(bounds.min, 0.0F),
+                         glm::vec4(bounds.max, 0.0F)});
+    for (uint32_t i = 0; i < instance_num; i++)
+    {
+        candidates.push_back({slots[i], command_index});
+    }
+    return command_index;
+}
+
+void ck::IndirectDrawBuffer::upload_and_bind(const bool gpu_culling)
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    if (!command_buffer.is_valid())
+    {
+        command_buffer.create("indirect commands", "IndirectDrawBuffer");
+        data_buffer.create("indirect draw data", "IndirectDrawBuffer");
+    }
+
+    // GPU剔除时实例数从0开始累加
+    const DrawElementsIndirectCommand* command_data = commands.data();
+    if (gpu_culling)
+    {
+        upload_scratch.assign(commands.begin(), commands.end());
+        for (auto& command : upload_scratch)
+        {
+            command.instance_count = 0;
+        }
+        command_data = upload_scratch.data();
+    }
+    const size_t command_bytes =
+        std::max<size_t>(1, commands.size()) * sizeof(DrawElementsIndirectCommand);
+    gl_state.bind_buffer(GL_DRAW_INDIRECT_BUFFER, command_buffer.get());
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(command_bytes), nullptr,
+                 GL_STREAM_DRAW);
+    command_buffer.set_bytes(command_bytes);
+    if (!commands.empty())
+    {
+        glBufferSubData(
+            GL_DRAW_INDIRECT_BUFFER, 0,
+            static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand)),
+            command_data);
+    }
+
+    const size_t data_bytes = std::max<size_t>(1, draw_data.size()) * sizeof(IndirectDrawData);
+    gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, data_buffer.get());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(data_bytes), nullptr,
+                 GL_STREAM_DRAW);
+    data_buffer.set_bytes(data_bytes);
+    if (!draw_data.empty())
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                        static_cast<GLsizeiptr>(draw_data.size() * sizeof(IndirectDrawData)),
+                        draw_data.data());
+    }
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, INDIRECT_DRAW_DATA_BINDING,
+                              data_buffer.get());
+
+    if (gpu_culling)
+    {
+        if (!candidate_buffer.is_valid())
+        {
+            candidate_buffer.create("culling candidates", "IndirectDrawBuffer");
+        }
+        const size_t candidate_bytes =
+            std::max<size_t>(1, candidates.size()) * sizeof(CullingCandidate);
+        gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, candidate_buffer.get());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(candidate_bytes), nullptr,
+                     GL_STREAM_DRAW);
+        candidate_buffer.set_bytes(candidate_bytes);
+        if (!candidates.empty())
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                            static_cast<GLsizeiptr>(candidates.size() * sizeof(CullingCandidate)),
+                            candidates.data());
+        }
+        gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, CULLING_CANDIDATES_BINDING,
+                                  candidate_buffer.get());
+    }
+    GL_CHECK();
+}
+
+void ck::IndirectDrawBuffer::multi_draw(const uint32_t first, const uint32_t count) const
+{
+    // 绑定点可能被其他代码改过，经过状态缓存，相同时不会重复提交
+    GLStateCache::get_instance().bind_buffer(GL_DRAW_INDIRECT_BUFFER, command_buffer.get());
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(first * sizeof(DrawElementsIndirectCommand)),
+        static_cast<GLsizei>(count), 0);
+    GL_CHECK();
+}
+
+void ck::IndirectDrawBuffer::shutdown()
+{
+    command_buffer.reset();
+    data_buffer.reset();
+    candidate_buffer.reset();
+}
+
+[[nodiscard]] size_t ck::IndirectDrawBuffer::get_command_num() const
+{
+    return commands.size();
+}
+
+[[nodiscard]] size_t ck::IndirectDrawBuffer::get_candidate_num() const
+{
+    return candidates.size();
+}
+
+[[nodiscard]] uint32_t ck::IndirectDrawBuffer::get_command_buffer() const
+{
+    return command_buffer.get();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "core/ck_gl_resource.h"
+#include "mesh_arena.h"
+#include "vertex_format.h"
+
+namespace ck {
+
+static const uint32_t INDIRECT_DRAW_DATA_BINDING = 6;  // SSBO binding，5是阴影记录
+static const uint32_t CULLING_CANDIDATES_BINDING = 7;  // GPU剔除的输入，见 gpu_culling.h
+
+/// @brief glMultiDrawElementsIndirect读取的一条绘制命令，布局由GL规定
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t  base_vertex;
+    uint32_t base_instance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20);
+
+/// @brief 着色器中的一条绘制数据（std430），用drawBase + gl_DrawID索引
+struct IndirectDrawData
+{
+    glm::vec4  dequant_offset;  // w未使用
+    glm::vec4  dequant_scale;
+    glm::uvec4 instance;    // x：在实例索引数组中的起始位置
+    glm::vec4  bounds_min;  // 网格在模型空间中的包围盒，GPU剔除使用
+    glm::vec4  bounds_max;
+};
+static_assert(sizeof(IndirectDrawData) == 80);
+
+/// @brief GPU剔除的一个候选实例
+struct CullingCandidate
+{
+    uint32_t slot;           // 在InstanceBuffer中的槽位
+    uint32_t command_index;  // 所属的绘制命令
+};
+
+/// @brief 间接绘制的命令缓冲和每个绘制的数据SSBO
+/// @note 设计成单例类，只能在GL线程使用
+/**NOTE - 间接绘制
+渲染队列分批之后，每个实例化批次变成一条绘制命令，同时写一条绘制数据：
+网格的反量化参数和批次在实例索引数组（见 instance_buffer.h）中的起始位置。
+相邻的、shader和材质都相同的批次用一次glMultiDrawElementsIndirect提交，
+着色器用drawBase + gl_DrawID找到自己的绘制数据（gl_DrawID在每次调用中都从0开始）。
+缓冲和实例索引一样，每次提交都整块重建：先orphan再写入。
+打开GPU剔除时，每个实例再写一条候选记录，上传的命令中实例数为0，
+由剔除的计算着色器把通过测试的实例写回实例索引数组并累加实例数。
+*/
+class IndirectDrawBuffer {
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawData>            draw_data;
+    std::vector<CullingCandidate>            candidates;
+    std::vector<DrawElementsIndirectCommand> upload_scratch;  // 实例数清零后的命令
+    GLBuffer                                 command_buffer;
+    GLBuffer                                 data_buffer;
+    GLBuffer                                 candidate_buffer;
+
+    static IndirectDrawBuffer* singleton;
+    IndirectDrawBuffer();
+
+public:
+    static IndirectDrawBuffer& get_instance();
+
+    IndirectDrawBuffer(const IndirectDrawBuffer&)            = delete;
+    IndirectDrawBuffer& operator=(const IndirectDrawBuffer&) = delete;
+
+    /// @brief 开始记录新的一组绘制命令
+    void clear();
+    /// @return 这条命令在命令数组中的位置
+    /// @param slots 批次中每个实例的槽位，共instance_num个，用于生成剔除的候选记录
+    uint32_t push(const MeshAllocation& allocation,
+                  const DequantBox&     dequant_box,
+                  const AABB&           bounds,
+                  uint32_t              instance_base,
+                  const uint32_t*       slots,
+                  uint32_t              instance_num);
+
+    /// @brief 上传命令和绘制数据，绑定到GL_DRAW_INDIRECT_BUFFER和SSBO binding point
+    /// @param gpu_culling 为true时上传候选记录，命令中的实例数清零，等待剔除的计算着色器填写
+    void upload_and_bind(bool gpu_culling);
+
+    /// @brief 用一次调用提交[first, first + count)的命令，需要先绑定共享VAO
+    void multi_draw(uint32_t first, uint32_t count) const;
+
+    /// @brief 释放GL缓冲，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    [[nodiscard]] size_t   get_command_num() const;
+    [[nodiscard]] size_t   get_candidate_num() const;
+    [[nodiscard]] uint32_t get_command_buffer() const;
+};
+
+};  // namespace ck
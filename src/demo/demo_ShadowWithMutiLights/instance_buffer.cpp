@@ -0,0 +1,144 @@
+#include "instance_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+
+ck::InstanceBuffer* ck::InstanceBuffer::singleton = nullptr;
+
+ck::InstanceBuffer& ck::InstanceBuffer::get_instance()
+{
+    if (singleton == nullptr) { singleton = new InstanceBuffer(); }
+    return *singleton;
+}
+
+ck::InstanceBuffer::InstanceBuffer()
+    : dirty_begin(0), dirty_end(0), transform_capacity(0)
+{
+}
+
+uint32_t ck::InstanceBuffer::allocate_slot()
+{
+    if (!free_slots.empty())
+    {
+        const uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+    transforms.emplace_back(1.0F);
+    return static_cast<uint32_t>(transforms.size() - 1);
+}
+
+void ck::InstanceBuffer::free_slot(const uint32_t slot)
+{
+    free_slots.push_back(slot);
+}
+
+void ck::InstanceBuffer::set_transform(const uint32_t slot, const glm::mat4& transform)
+{
+    transforms[slot] = transform;
+    if (dirty_begin == dirty_end)
+    {
+        dirty_begin = slot;
+        dirty_end   = slot + 1;
+    }
+    else
+    {
+        dirty_begin = std::min(dirty_begin, static_cast<size_t>(slot));
+        dirty_end   = std::max(dirty_end, static_cast<size_t>(slot) + 1);
+    }
+}
+
+void ck::InstanceBuffer::clear_indices()
+{
+    instance_indices.clear();
+}
+
+uint32_t ck::InstanceBuffer::push_index(const uint32_t slot)
+{
+    instance_indices.push_back(slot);
+    return static_cast<uint32_t>(instance_indices.size() - 1);
+}
+
+void ck::InstanceBuffer::upload_transforms()
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    if (!transform_buffer.is_valid())
+    {
+        transform_buffer.create("instance transforms", "InstanceBuffer");
+    }
+    gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, transform_buffer.get());
+
+    if (transforms.size() > transform_capacity)
+    {
+        // 容量不够时按2倍扩容，整块重新上传
+        transform_capacity = std::max<size_t>(64, transform_capacity);
+        while (transform_capacity < transforms.size()) { transform_capacity *= 2; }
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     static_cast<GLsizeiptr>(transform_capacity * sizeof(glm::mat4)), nullptr,
+                     GL_DYNAMIC_DRAW);
+        transform_buffer.set_bytes(transform_capacity * sizeof(glm::mat4));
+        dirty_begin = 0;
+        dirty_end   = transforms.size();
+    }
+    if (dirty_begin < dirty_end)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                        static_cast<GLintptr>(dirty_begin * sizeof(glm::mat4)),
+                        static_cast<GLsizeiptr>((dirty_end - dirty_begin) * sizeof(glm::mat4)),
+                        glm::value_ptr(transforms[dirty_begin]));
+        dirty_begin = dirty_end = 0;
+    }
+}
+
+void ck::InstanceBuffer::upload_and_bind()
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    upload_transforms();
+
+    // 索引数组每次都整块重建，先orphan再写入，不需要等待上一批绘制完成
+    if (!index_buffer.is_valid()) { index_buffer.create("instance indices", "InstanceBuffer"); }
+    gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, index_buffer.get());
+    const size_t index_size = std::max<size_t>(1, instance_indices.size()) * sizeof(uint32_t);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(index_size), nullptr,
+                 GL_STREAM_DRAW);
+    index_buffer.set_bytes(index_size);
+    if (!instance_indices.empty())
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                        static_cast<GLsizeiptr>(instance_indices.size() * sizeof(uint32_t)),
+                        instance_indices.data());
+    }
+
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, INSTANCE_TRANSFORM_BINDING,
+                              transform_buffer.get());
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, INSTANCE_INDEX_BINDING,
+                              index_buffer.get());
+    GL_CHECK();
+}
+
+void ck::InstanceBuffer::shutdown()
+{
+    transform_buffer.reset();
+    index_buffer.reset();
+    transform_capacity = 0;
+}
+
+[[nodiscard]] size_t ck::InstanceBuffer::get_slot_num() const
+{
+    return transforms.size();
+}
+
+[[nodiscard]] const std::vector<uint32_t>& ck::InstanceBuffer::get_indices() const
+{
+    return instance_indices;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/ck_gl_resource.h"
+
+namespace ck {
+
+static const uint32_t INSTANCE_TRANSFORM_BINDING = 0;  // SSBO binding，和stdVerShader一致
+static const uint32_t INSTANCE_INDEX_BINDING     = 1;
+static const uint32_t NULL_INSTANCE_SLOT         = 0xFFFFFFFF;
+
+/// @brief 实例化绘制用到的两块SSBO
+/// @note 设计成单例类，只能在GL线程使用
+/**NOTE - 两级索引
+transforms：每个Renderable在构造时分到一个固定的槽位，只有变换改变时才标记为脏，
+            每帧只上传脏区间，静止的物体不产生任何上传。
+indices：   渲染队列每帧分批后，把每个批次中物体的槽位依次写进来（4B/实例），
+            着色器中用 transforms[indices[instanceBase + gl_InstanceID]] 取得model矩阵。
+排序结果每帧都在变化，但需要重建的只有很小的索引数组。
+*/
+class InstanceBuffer {
+private:
+    std::vector<glm::mat4> transforms;
+    std::vector<uint32_t>  free_slots;
+    size_t                 dirty_begin;  // 脏区间[dirty_begin, dirty_end)，以槽位为单位
+    size_t                 dirty_end;
+    GLBuffer               transform_buffer;
+    size_t                 transform_capacity;  // GPU上已分配的槽位数
+
+    std::vector<uint32_t> instance_indices;
+    GLBuffer              index_buffer;
+
+    static InstanceBuffer* singleton;
+    // NOTE - 故意不释放：Renderable可能在静态析构阶段才归还槽位
+    InstanceBuffer();
+
+    void upload_transforms();
+
+public:
+    static InstanceBuffer& get_instance();
+
+    InstanceBuffer(const InstanceBuffer&)            = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    uint32_t allocate_slot();
+    void     free_slot(uint32_t slot);
+    void     set_transform(uint32_t slot, const glm::mat4& transform);
+
+    /// @brief 开始记录新的一组实例索引
+    void clear_indices();
+    /// @return 这个实例在索引数组中的位置
+    uint32_t push_index(uint32_t slot);
+
+    /// @brief 上传脏的变换和本次的实例索引，并绑定到SSBO binding point
+    void upload_and_bind();
+
+    /// @brief 释放GL缓冲，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    [[nodiscard]] size_t                       get_slot_num() const;
+    [[nodiscard]] const std::vector<uint32_t>& get_indices() const;
+};
+
+};  // namespace ck
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <glad/glad.h>  //glad first
@@ -30,35 +32,39 @@ ck::Light::Light(const int32_t   light_type,
     return color;
 }
 
+[[nodiscard]] float ck::Light::get_intensity() const
+{
+    return intensity;
+}
+
+[[nodiscard]] float ck::Light::get_outer_cutOff() const
+{
+    return outer_cutOff;
+}
+
+[[nodiscard]] float ck::Light::get_range() const
+{
+    const float brightness = intensity * std::max(color.x, std::max(color.y, color.z));
+    return std::sqrt(std::max(brightness, 0.0F) / LIGHT_ATTENUATION_CUTOFF);
+}
+
 int32_t ck::Light::calculate_memory_occupancy()
 {
-    /**NOTE - memory occupation
-     * GLint     lightType;（4B）
-     * glm::vec3 color;（16B）
-     * GLfloat   intensity;（4B）
-     * GLfloat innerCutOff, outerCutOf,;（4B，4B）
-     */
-    /**FIXME - 错题本
-     * std140的布局理解错了！
-     * 详细的计算分析请看 opengl/src/advancedLighting/memoryLayout.md
-     */
-    return 80;
-    // NOTE - 还是按照原来的填充方案，只不过position和rotation的数据从外面送进来
+    return sizeof(LightUniformData);
 }
 
-void ck::Light::update_light_uniformBuffer(unsigned char* const ptr,
-                                           const glm::vec3&     position,
-                                           const glm::vec3&     rotation) const
+[[nodiscard]] ck::LightUniformData ck::Light::get_uniform_data(const glm::vec3& position,
+                                                               const glm::vec3& rotation) const
 {
-    memcpy(ptr + 0, &(light_type), sizeof(int32_t));
-    memcpy(ptr + 16, &(color), sizeof(glm::vec3));
-    memcpy(ptr + 28, &(intensity), sizeof(float));
-    memcpy(ptr + 32, &(position), sizeof(glm::vec3));
-    memcpy(ptr + 48, &(rotation), sizeof(glm::vec3));
-    memcpy(ptr + 60, &(inner_cutOff), sizeof(float));
-    memcpy(ptr + 64, &(outer_cutOff), sizeof(float));
-    /**FIXME - 错题本
-     * std140的布局理解错了！
-     * 详细的计算分析请看 opengl/src/advancedLighting/memoryLayout.md
-     */
+    LightUniformData data = {};
+    data.light_type       = light_type;
+    data.color            = color;
+    data.intensity        = intensity;
+    data.position         = position;
+    data.rotation         = rotation;
+    data.inner_cutOff     = inner_cutOff;
+    data.outer_cutOff     = outer_cutOff;
+    data.range            = get_range();
+    data.shadow_index     = -1;
+    return data;
 }
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include <vector>
 
 #include <glm/glm.hpp>
 
-static const uint32_t MAX_LIGHTS_SUPPORTED = 16;
+static const uint32_t MAX_LIGHTS_SUPPORTED = 16;  // 灯光组UBO的上限，分簇光照没有这个限制
 static const float    DEFUALT_INNER_CUTOFF = cos(glm::radians(12.5F));
 static const float    DEFUALT_OUTER_CUTOFF = cos(glm::radians(17.5F));
+// 光照衰减到这个亮度以下就认为没有影响了，用来计算灯光的影响范围
+static const float LIGHT_ATTENUATION_CUTOFF = 0.01F;
 
 namespace ck {
 
@@ -21,6 +24,39 @@ struct LightAttributes
     float inner_cutOff, outer_cutOff;  // for spot light
 };
 
+/// @brief 灯光组UBO（std140）和分簇光照SSBO（std430）中的一条灯光记录
+/**NOTE - 内存布局
+vec3按16B对齐，后面紧跟的float可以填进它剩下的4B里，整个结构体按16B对齐。
+两种布局下这个结构体的排布相同，和着色器中的struct Light一一对应；
+偏移量由下面的static_assert在编译期检查，详细的计算分析请看
+opengl/src/advancedLighting/memoryLayout.md
+*/
+struct alignas(16) LightUniformData
+{
+    int32_t   light_type;
+    int32_t   padding0[3];
+    glm::vec3 color;
+    float     intensity;
+    glm::vec3 position;
+    float     padding1;
+    glm::vec3 rotation;
+    float     inner_cutOff;
+    float     outer_cutOff;
+    float     range;         // 灯光组UBO中没有声明，占用原来的填充
+    int32_t   shadow_index;  // 第一条阴影记录的下标，-1表示没有阴影，同上
+    float     padding2;
+};
+static_assert(offsetof(LightUniformData, light_type) == 0);
+static_assert(offsetof(LightUniformData, color) == 16);
+static_assert(offsetof(LightUniformData, intensity) == 28);
+static_assert(offsetof(LightUniformData, position) == 32);
+static_assert(offsetof(LightUniformData, rotation) == 48);
+static_assert(offsetof(LightUniformData, inner_cutOff) == 60);
+static_assert(offsetof(LightUniformData, outer_cutOff) == 64);
+static_assert(offsetof(LightUniformData, range) == 68);
+static_assert(offsetof(LightUniformData, shadow_index) == 72);
+static_assert(sizeof(LightUniformData) == 80);
+
 /// @param lightType -1代表无效灯，0点光，1日光，2聚光，3面光。
 class Light {
 private:
@@ -39,11 +75,15 @@ public:
 
     [[nodiscard]] int32_t   get_light_type() const;
     [[nodiscard]] glm::vec3 get_color() const;
+    [[nodiscard]] float     get_intensity() const;
+    [[nodiscard]] float     get_outer_cutOff() const;
+    /// @brief 影响范围：intensity / d^2 衰减到LIGHT_ATTENUATION_CUTOFF时的距离d
+    [[nodiscard]] float     get_range() const;
 
     static int32_t calculate_memory_occupancy();
-    void           update_light_uniformBuffer(unsigned char*   ptr,
-                                              const glm::vec3& position,
-                                              const glm::vec3& rotation) const;
+    /// @brief 灯光不持有变换，位置和朝向由所属的实体提供
+    [[nodiscard]] LightUniformData get_uniform_data(const glm::vec3& position,
+                                                    const glm::vec3& rotation) const;
 };
 
 };  // namespace ck
\ No newline at end of file
@@ -7,6 +7,7 @@
  */
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -40,14 +41,30 @@
 */
 
 #include "camera.h"
+#include "core/ck_cpu_profiler.h"
 #include "core/ck_debug.h"
+#include "core/ck_gl_debug_sink.h"
+#include "core/ck_gl_resource.h"
+#include "core/ck_gl_state.h"
+#include "core/ck_gpu_profiler.h"
+#include "core/ck_job_benchmark.h"
+#include "core/ck_job_system.h"
+#include "gpu_culling.h"
+#include "gpu_memory_panel.h"
 #include "imgui_glfw_window_base.h"
 #include "imgui_stdlib.h"
+#include "indirect_draw_buffer.h"
+#include "instance_buffer.h"
 #include "light.h"
+#include "mesh_arena.h"
 #include "model.h"
+#include "profiler_panel.h"
 #include "render_object.h"
 #include "scene.h"
+#include "scene_benchmark.h"
 #include "shader.h"
+#include "texture_loader.h"
+#include "texture_registry.h"
 
 #define USE_NEW_SYSTEM
 
@@ -188,11 +205,12 @@ uint32_t create_image_bufferObject(const std::string& file_path,
     return texture;
 }
 
-uint32_t create_skyBox_texture(const std::string& image_folder)
+ck::GLTexture create_skyBox_texture(const std::string& image_folder)
 {
-    GLuint cubeTexture;
-    glGenTextures(1, &cubeTexture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubeTexture);
+    ck::GLTexture cubeTexture;
+    size_t        cubeTexture_bytes = 0;
+    cubeTexture.create("reflection cubemap", image_folder);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubeTexture.get());
     std::vector<std::string> cubeTexture_names = {"right.jpg",  "left.jpg",  "top.jpg",
                                                   "bottom.jpg", "front.jpg", "back.jpg"};
     for (int i = 0; i < 6; i++)
@@ -207,6 +225,7 @@ uint32_t create_skyBox_texture(const std::string& image_folder)
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_SRGB, width, height, 0, GL_RGB,
                          GL_UNSIGNED_BYTE, data);
+            cubeTexture_bytes += static_cast<size_t>(width) * height * 4;  // RGB按RGBA存储
             // 设置纹理属性
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -217,6 +236,7 @@ uint32_t create_skyBox_texture(const std::string& image_folder)
         else { std::cout << "Failed to load texture: " << cubeTexture_path << std::endl; }
         stbi_image_free(data);
     }
+    cubeTexture.set_bytes(cubeTexture_bytes);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);  // 解绑
     return cubeTexture;
 }
@@ -226,9 +246,31 @@ int main(int argc, char** argv)
     // init glog
     google::InitGoogleLogging(*argv);
     FLAGS_minloglevel = google::LogSeverity::GLOG_INFO;  // 设置最小日志级别
+    ck::CpuProfiler::get_instance().set_thread_name("main");
     // FLAGS_log_dir                   = "./log";                         // 设置日志目录
     // FLAGS_stop_logging_if_full_disk = true;  // 设置磁盘满时停止写日志
 
+    // 场景存储的基准测试，不创建窗口
+    // 用法：demo_ShadowWithMutiLights --bench-scene [entity_num]
+    if (argc > 1 && std::string(argv[1]) == "--bench-scene")
+    {
+        ck::run_scene_benchmark((argc > 2) ? static_cast<uint32_t>(std::stoul(argv[2]))
+                                           : ck::DEFAULT_BENCHMARK_ENTITY_NUM);
+        google::ShutdownGoogleLogging();
+        return EXIT_SUCCESS;
+    }
+
+    // 任务系统的基准测试，不创建窗口
+    // 用法：demo_ShadowWithMutiLights --bench-jobs [job_num] [worker_num]
+    if (argc > 1 && std::string(argv[1]) == "--bench-jobs")
+    {
+        ck::run_job_benchmark((argc > 2) ? static_cast<uint32_t>(std::stoul(argv[2]))
+                                         : ck::DEFAULT_JOB_BENCHMARK_JOB_NUM,
+                              (argc > 3) ? static_cast<uint32_t>(std::stoul(argv[3])) : 0);
+        google::ShutdownGoogleLogging();
+        return EXIT_SUCCESS;
+    }
+
     // create glfw window
     ck::ImguiGlfwWindowBase window({1280, 720}, "ShadowWithMutiLights");
 
@@ -238,6 +280,9 @@ int main(int argc, char** argv)
         throw std::runtime_error("Failed to initialize GLAD");
     }
 
+    // 任务系统，持有GL上下文的线程是主线程
+    ck::JobSystem::get_instance().init();
+
     // glfw opengl debug
 #ifdef NDEBUG
 #else
@@ -245,9 +290,11 @@ int main(int argc, char** argv)
     glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
     if ((flags & GL_CONTEXT_FLAG_DEBUG_BIT) != 0)
     {
+        ck::GlDebugSink::get_instance().start();             // 回调只入队，后台线程输出
         glDebugMessageCallback(ck::glDebugOutput, nullptr);  // 向opengl注册调试回调函数
         glDebugMessageControl(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR,
                               GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_TRUE);
+        ck::set_gl_check_interval(ck::GL_CHECK_SAMPLED_INTERVAL);  // 错误由调试回调准确报告
     }
     else { LOG(WARNING) << "GL_CONTEXT_FLAG_DEBUG_BIT is not enabled."; }
 #endif
@@ -277,7 +324,8 @@ int main(int argc, char** argv)
                               stdAsset_root + "stdShader/stdPureColor.fs.glsl");
     ck::Shader skyboxShader(stdAsset_root + "stdShader/stdSkyboxShader.vs.glsl",
                             stdAsset_root + "stdShader/stdSkyboxShader.fs.glsl");
-    uint32_t   skyBox_texture = create_skyBox_texture(stdAsset_root + "stdTexture/skybox/");
+
+    ck::GLTexture skyBox_texture = create_skyBox_texture(stdAsset_root + "stdTexture/skybox/");
     GL_CHECK();
 
     // 灯光组
@@ -295,14 +343,14 @@ int main(int argc, char** argv)
     // Use New Render System
     auto& scene = ck::Scene::get_instance();
     scene.get_skyBox().load_skyBox_texture_from_file(stdAsset_root + "stdTexture/skybox/");
-    auto cube_01  = scene.add_model_from_file(asset_root + "cube.obj",
-                                              {stdAsset_root + "stdShader/stdVerShader.vs.glsl",
-                                               asset_root + "stdShadowedPhongLighting.fs.glsl", ""},
-                                              "cube_01");
-    auto plane_01 = scene.add_model_from_file(asset_root + "plane.obj",
-                                              {stdAsset_root + "stdShader/stdVerShader.vs.glsl",
-                                               asset_root + "stdShadowedPhongLighting.fs.glsl", ""},
-                                              "plane_01");
+    // 几何体使用分簇光照，不受灯光组UBO的灯光数量限制
+    const std::array<std::string, 3> clustered_phong_shader = {
+        stdAsset_root + "stdShader/stdVerShader.vs.glsl",
+        asset_root + "stdClusteredPhongLighting.fs.glsl", ""};
+    auto cube_01 =
+        scene.add_model_from_file(asset_root + "cube.obj", clustered_phong_shader, "cube_01");
+    auto plane_01 =
+        scene.add_model_from_file(asset_root + "plane.obj", clustered_phong_shader, "plane_01");
 
     // modify the 2nd object
     {
@@ -322,7 +370,7 @@ int main(int argc, char** argv)
         ck::SceneObjectEdittingCtx ctx;
         ctx.object_type   = ck::RenderObjectType::LIGHT;
         ctx.object_name   = "this is a light";
-        ctx.parent_object = cube_01.get();
+        ctx.parent_object = cube_01;
         glm::vec3 position(1, 3, 0);
         glm::vec3 scale(0.1F);
         ctx.postion = &position;
@@ -334,7 +382,7 @@ int main(int argc, char** argv)
         ck::SceneObjectEdittingCtx ctx;
         ctx.object_type   = ck::RenderObjectType::LIGHT;
         ctx.object_name   = "this is a light";
-        ctx.parent_object = cube_01.get();
+        ctx.parent_object = cube_01;
         glm::vec3 position(2, 0, 2);
         glm::vec3 scale(0.1F);
         ctx.postion = &position;
@@ -346,13 +394,27 @@ int main(int argc, char** argv)
         ck::SceneObjectEdittingCtx ctx;
         ctx.object_type   = ck::RenderObjectType::LIGHT;
         ctx.object_name   = "this is a light";
-        ctx.parent_object = cube_01.get();
+        ctx.parent_object = cube_01;
         glm::vec3 position(-2, 0, -2);
         glm::vec3 scale(0.1F);
         ctx.postion = &position;
         ctx.scale   = &scale;
         scene.modify_object(light_03, &ctx);
     }
+    // 日光：rotation表示光照方向，阴影由级联阴影覆盖
+    {
+        auto sun = scene.add_light("sun", ck::Light(1, glm::vec3(1), 0.6F));
+        ck::SceneObjectEdittingCtx ctx;
+        ctx.object_type = ck::RenderObjectType::LIGHT;
+        ctx.object_name = "sun";
+        glm::vec3 position(0, 8, 0);
+        glm::vec3 rotation(1, -2, 1);
+        glm::vec3 scale(0.1F);
+        ctx.postion  = &position;
+        ctx.rotation = &rotation;
+        ctx.scale    = &scale;
+        scene.modify_object(sun, &ctx);
+    }
     // light manager
     ck::SceneLightUBOManager scene_light_maneger;
     scene_light_maneger.create_light_UBO();
@@ -362,7 +424,11 @@ int main(int argc, char** argv)
     while (glfwWindowShouldClose(window.get_window()) == 0)
     {
         glfwPollEvents();
+        ck::GpuProfiler& profiler = ck::GpuProfiler::get_instance();
+        profiler.begin_frame();  // 读回几帧之前的计时
+        profiler.begin_scope("frame");
         processInput(window);
+        ck::JobSystem::get_instance().process_main_thread_jobs();  // 工作线程提交的GL任务
 
         // ANCHOR -  Start the Dear ImGui frame
         {
@@ -374,6 +440,76 @@ int main(int argc, char** argv)
 
             ImGui::Begin("CookieKiss Render Assistant");
             ImGui::ColorEdit3("clear color", clear_color.data());
+            {
+                const auto& texture_registry = ck::TextureRegistry::get_instance();
+                ImGui::Text("textures: %zu | resident: %.1f MB | pending: %u",
+                            texture_registry.get_texture_num(),
+                            static_cast<double>(texture_registry.get_resident_bytes()) / 1048576.0,
+                            ck::TextureLoader::get_instance().get_pending_num());
+                const auto& gl_state_counters =
+                    ck::GLStateCache::get_instance().get_last_frame_counters();
+                ImGui::Text("GL state changes: %u issued | %u skipped", gl_state_counters.issued,
+                            gl_state_counters.skipped);
+                const auto& render_queue = ck::Scene::get_instance().get_render_queue();
+                ImGui::Text("draw calls: %u | draw packets: %zu | indirect commands: %u",
+                            render_queue.get_draw_call_num(), render_queue.get_packet_num(),
+                            render_queue.get_indirect_command_num());
+                const auto&  arena_stats = ck::MeshArena::get_instance().get_stats();
+                const size_t arena_used  = arena_stats.vertex_bytes + arena_stats.index_bytes;
+                ImGui::Text("mesh arena: %u meshes | %.1f MB used | %.1f MB reserved",
+                            arena_stats.allocation_num, static_cast<double>(arena_used) / 1048576.0,
+                            static_cast<double>(arena_stats.capacity_bytes) / 1048576.0);
+                auto&       scene           = ck::Scene::get_instance();
+                bool        culling_enabled = scene.is_frustum_culling_enabled();
+                const auto& culling_stats   = scene.get_culling_stats();
+                if (ImGui::Checkbox("frustum culling", &culling_enabled))
+                {
+                    scene.set_frustum_culling(culling_enabled);
+                }
+                bool indirect_enabled = scene.is_indirect_drawing_enabled();
+                if (ImGui::Checkbox("multi-draw-indirect", &indirect_enabled))
+                {
+                    scene.set_indirect_drawing(indirect_enabled);
+                }
+                ImGui::Text("culling: %u tested | %u culled | %u visible", culling_stats.tested,
+                            culling_stats.culled, culling_stats.visible);
+                ck::GpuCulling& gpu_culling    = scene.get_gpu_culling();
+                bool            gpu_enabled    = gpu_culling.is_enabled();
+                bool            hiz_enabled    = gpu_culling.is_occlusion_enabled();
+                bool            show_occluded  = gpu_culling.is_showing_occluded();
+                const auto&     gpu_cull_stats = gpu_culling.get_stats();
+                if (ImGui::Checkbox("GPU culling", &gpu_enabled))
+                {
+                    gpu_culling.set_enabled(gpu_enabled);
+                }
+                ImGui::SameLine();
+                if (ImGui::Checkbox("Hi-Z occlusion", &hiz_enabled))
+                {
+                    gpu_culling.set_occlusion_enabled(hiz_enabled);
+                }
+                ImGui::SameLine();
+                if (ImGui::Checkbox("show occluded", &show_occluded))
+                {
+                    gpu_culling.set_show_occluded(show_occluded);
+                }
+                ImGui::Text("GPU culling: %u frustum culled | %u occluded | %u visible",
+                            gpu_cull_stats.frustum_culled, gpu_cull_stats.occluded,
+                            gpu_cull_stats.visible);
+                const auto& light_stats = scene.get_clustered_lighting().get_stats();
+                ImGui::Text("clustered lights: %u (%u global) | indices: %u | max/cluster: %u",
+                            light_stats.light_num, light_stats.global_light_num,
+                            light_stats.light_index_num, light_stats.max_cluster_light_num);
+                const auto& shadow_stats = scene.get_shadow_atlas().get_stats();
+                ImGui::Text("shadows: %u lights | %u tiles | %u rendered | %u failed",
+                            shadow_stats.caster_num, shadow_stats.view_num,
+                            shadow_stats.rendered_view_num, shadow_stats.failed_num);
+                auto cascade_num = static_cast<int>(scene.get_shadow_atlas().get_cascade_num());
+                if (ImGui::SliderInt("sun cascades", &cascade_num, 1,
+                                     static_cast<int>(ck::CSM_MAX_CASCADE_NUM)))
+                {
+                    scene.get_shadow_atlas().set_cascade_num(static_cast<uint32_t>(cascade_num));
+                }
+            }
             if (ImGui::Button("open Demo window")) { open_demo_window = true; }
 
             if (open_demo_window) { ImGui::ShowDemoWindow(&open_demo_window); }
@@ -462,6 +598,9 @@ int main(int argc, char** argv)
             }
 
             ImGui::End();
+
+            ck::draw_profiler_panel();
+            ck::draw_gpu_memory_panel();
         }
         ImGui::Render();
 
@@ -493,7 +632,7 @@ int main(int argc, char** argv)
             shadowed_phong.setParameter("cameraPos", camera.get_position());
             int32_t skyBox_texture_slot = cube.get_avaliable_texture_slot();
             glActiveTexture(GL_TEXTURE0 + skyBox_texture_slot);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture.get());
             shadowed_phong.setParameter("skybox", skyBox_texture_slot);
             cube.draw(shadowed_phong);
             GL_CHECK();
@@ -511,7 +650,7 @@ int main(int argc, char** argv)
             shadowed_phong.setParameter("model", glm::scale(glm::mat4(1), glm::vec3(5)));
             skyBox_texture_slot = plane.get_avaliable_texture_slot();
             glActiveTexture(GL_TEXTURE0 + skyBox_texture_slot);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture.get());
             shadowed_phong.setParameter("skybox", skyBox_texture_slot);
             plane.draw(shadowed_phong);
             GL_CHECK();
@@ -542,7 +681,7 @@ int main(int argc, char** argv)
             skyboxShader.setParameter("projection", projection);
             skyBox_texture_slot = cube.get_avaliable_texture_slot();
             glActiveTexture(GL_TEXTURE0 + skyBox_texture_slot);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture.get());
             skyboxShader.setParameter("skybox", skyBox_texture_slot);
             cube.draw(skyboxShader);
             glFrontFace(GL_CCW);
@@ -560,21 +699,41 @@ int main(int argc, char** argv)
                                glm::radians(sin(ImGui::GetTime() + 50.0F) * 90.0F));
             ctx.rotation = &rotation;
             scene.modify_object(cube_01, &ctx);
+            scene.update_transforms();
+            scene_light_maneger.update_light_UBO();  // 灯光挂在旋转的cube_01下面，每帧都在移动
             scene.draw(window);
         }
 
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            CK_GPU_PROFILE_SCOPE("imgui");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            ck::GLStateCache::get_instance().invalidate();  // ImGui绕过了状态缓存
+        }
+        profiler.end_scope();  // frame
         glfwSwapBuffers(window.get_window());
         GL_CHECK();
     }
     // clean up
+    ck::JobSystem::get_instance().shutdown();  // 可能还有GL任务，先于GL资源释放
+    ck::TextureLoader::get_instance().shutdown();
+    ck::InstanceBuffer::get_instance().shutdown();
+    ck::IndirectDrawBuffer::get_instance().shutdown();
+    scene.get_clustered_lighting().shutdown();
+    scene.get_shadow_atlas().shutdown();
+    scene.get_gpu_culling().shutdown();
+    scene_light_maneger.shutdown();
+    ck::GpuProfiler::get_instance().shutdown();
+    ck::MeshArena::get_instance().shutdown();  // 之后析构的网格不再访问GL
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
+    // 场景、模型、着色器和纹理在main()返回时才析构，这里输出的就是它们持有的对象
+    ck::GLResourceRegistry::get_instance().shutdown();
 
     glfwDestroyWindow(window.get_window());
     glfwTerminate();
     // NOTE - 这里GL_CHECK()没问题，大概是oprngl上下文被删除了。
+    ck::GlDebugSink::get_instance().shutdown();  // 上下文已经销毁，不会再有新消息
 
     google::ShutdownGoogleLogging();
     return EXIT_SUCCESS;
@@ -0,0 +1,258 @@
+#include "mesh_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <glog/logging.h>
+
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "mesh_cache.h"
+#include "vertex_format.h"
+
+// ANCHOR - ArenaRangeAllocator
+
+ck::ArenaRangeAllocator::ArenaRangeAllocator() : top(0) {}
+
+uint32_t ck::ArenaRangeAllocator::allocate(const uint32_t size)
+{
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); it++)
+    {
+        if (it->size < size) { continue; }
+        const uint32_t offset  = it->offset;
+        it->offset            += size;
+        it->size              -= size;
+        if (it->size == 0) { free_ranges.erase(it); }
+        return offset;
+    }
+    const uint32_t offset  = top;
+    top                   += size;
+    return offset;
+}
+
+void ck::ArenaRangeAllocator::free(const uint32_t offset, const uint32_t size)
+{
+    if (size == 0) { return; }
+    auto next = std::lower_bound(
+        free_ranges.begin(), free_ranges.end(), offset,
+        [](const Range& range, const uint32_t value) { return range.offset < value; });
+    next = free_ranges.insert(next, {offset, size});
+
+    // 和后一个、前一个空闲区间合并
+    if (next + 1 != free_ranges.end() && next->offset + next->size == (next + 1)->offset)
+    {
+        next->size += (next + 1)->size;
+        free_ranges.erase(next + 1);
+    }
+    if (next != free_ranges.begin() && (next - 1)->offset + (next - 1)->size == next->offset)
+    {
+        (next - 1)->size += next->size;
+        next              = free_ranges.erase(next) - 1;
+    }
+    // 末尾的空闲区间退回给top
+    if (next + 1 == free_ranges.end() && next->offset + next->size == top)
+    {
+        top = next->offset;
+        free_ranges.pop_back();
+    }
+}
+
+void ck::ArenaRangeAllocator::reset()
+{
+    free_ranges.clear();
+    top = 0;
+}
+
+[[nodiscard]] uint32_t ck::ArenaRangeAllocator::get_top() const
+{
+    return top;
+}
+
+// ANCHOR - MeshArena
+
+ck::MeshArena* ck::MeshArena::singleton = nullptr;
+
+ck::MeshArena& ck::MeshArena::get_instance()
+{
+    if (singleton == nullptr) { singleton = new MeshArena(); }
+    return *singleton;
+}
+
+ck::MeshArena::MeshArena() : pools{}, next_id(0), stats{} {}
+
+[[nodiscard]] ck::MeshArena::Pool& ck::MeshArena::get_pool(const VertexFormat format)
+{
+    return pools[static_cast<uint32_t>(format)];
+}
+
+[[nodiscard]] const ck::MeshArena::Pool& ck::MeshArena::get_pool(const VertexFormat format) const
+{
+    return pools[static_cast<uint32_t>(format)];
+}
+
+void ck::MeshArena::grow_buffer(GLBuffer&      buffer,
+                                const GLenum   target,
+                                uint32_t&      capacity,
+                                const uint32_t required,
+                                const size_t   element_size)
+{
+    if (buffer.is_valid() && required <= capacity) { return; }
+    uint32_t new_capacity = std::max(capacity, (target == GL_ARRAY_BUFFER)
+                                                   ? MESH_ARENA_INITIAL_VERTEX_NUM
+                                                   : MESH_ARENA_INITIAL_INDEX_NUM);
+    while (new_capacity < required) { new_capacity *= 2; }
+
+    // NOTE - 用COPY_WRITE/COPY_READ绑定点搬运数据，不影响当前VAO的索引缓冲绑定
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    GLBuffer      new_buffer;
+    new_buffer.create((target == GL_ARRAY_BUFFER) ? "mesh arena vertices" : "mesh arena indices",
+                      "MeshArena");
+    gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, new_buffer.get());
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(new_capacity * element_size),
+                 nullptr, GL_STATIC_DRAW);
+    new_buffer.set_bytes(new_capacity * element_size);
+    if (buffer.is_valid())
+    {
+        gl_state.bind_buffer(GL_COPY_READ_BUFFER, buffer.get());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            static_cast<GLsizeiptr>(capacity * element_size));
+    }
+    if (capacity > 0)
+    {
+        LOG(INFO) << "mesh arena " << ((target == GL_ARRAY_BUFFER) ? "vertex" : "index")
+                  << " buffer grows to " << new_capacity << " elements";
+    }
+    buffer   = std::move(new_buffer);  // 删除旧的缓冲
+    capacity = new_capacity;
+    GL_CHECK();
+}
+
+void ck::MeshArena::attach_buffers(const VertexFormat format)
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    Pool&         pool     = get_pool(format);
+    gl_state.bind_vertex_array(pool.vao.get());
+    gl_state.bind_buffer(GL_ARRAY_BUFFER, pool.vertex_buffer.get());
+    gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, pool.index_buffer.get());
+    setup_vertex_attributes(format);
+    gl_state.bind_vertex_array(0);
+    gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ck::MeshArena::create_pool(const VertexFormat format)
+{
+    Pool& pool = get_pool(format);
+    pool.vao.create("mesh arena VAO", "MeshArena");
+    grow_buffer(pool.vertex_buffer, GL_ARRAY_BUFFER, pool.vertex_capacity, 0,
+                get_vertex_stride(format));
+    grow_buffer(pool.index_buffer, GL_ELEMENT_ARRAY_BUFFER, pool.index_capacity, 0,
+                sizeof(uint32_t));
+    stats.capacity_bytes += static_cast<size_t>(pool.vertex_capacity) * get_vertex_stride(format) +
+                            static_cast<size_t>(pool.index_capacity) * sizeof(uint32_t);
+    attach_buffers(format);
+    pool.vao.set_bytes(0);  // VAO绑定过之后才能加上调试标签
+}
+
+ck::MeshAllocation ck::MeshArena::allocate(const MeshData& mesh_data)
+{
+    const uint32_t stride = get_vertex_stride(mesh_data.vertex_format);
+    Pool&          pool   = get_pool(mesh_data.vertex_format);
+    if (!pool.vao.is_valid()) { create_pool(mesh_data.vertex_format); }
+
+    MeshAllocation allocation = {};
+    allocation.vertex_format  = mesh_data.vertex_format;
+    allocation.vertex_num     = static_cast<uint32_t>(mesh_data.vertex_data_size / stride);
+    allocation.index_num      = mesh_data.index_num;
+    allocation.base_vertex    = pool.vertex_ranges.allocate(allocation.vertex_num);
+    allocation.first_index    = pool.index_ranges.allocate(allocation.index_num);
+    if (free_ids.empty()) { allocation.id = next_id++; }
+    else
+    {
+        allocation.id = free_ids.back();
+        free_ids.pop_back();
+    }
+
+    // 容量不够时扩容，缓冲换了之后重新挂到VAO上
+    const size_t old_capacity_bytes =
+        static_cast<size_t>(pool.vertex_capacity) * stride +
+        static_cast<size_t>(pool.index_capacity) * sizeof(uint32_t);
+    const uint32_t old_vertex_buffer = pool.vertex_buffer.get();
+    const uint32_t old_index_buffer  = pool.index_buffer.get();
+    grow_buffer(pool.vertex_buffer, GL_ARRAY_BUFFER, pool.vertex_capacity,
+                pool.vertex_ranges.get_top(), stride);
+    grow_buffer(pool.index_buffer, GL_ELEMENT_ARRAY_BUFFER, pool.index_capacity,
+                pool.index_ranges.get_top(), sizeof(uint32_t));
+    if (pool.vertex_buffer.get() != old_vertex_buffer ||
+        pool.index_buffer.get() != old_index_buffer)
+    {
+        stats.capacity_bytes += static_cast<size_t>(pool.vertex_capacity) * stride +
+                                static_cast<size_t>(pool.index_capacity) * sizeof(uint32_t) -
+                                old_capacity_bytes;
+        attach_buffers(mesh_data.vertex_format);
+    }
+
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, pool.vertex_buffer.get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    static_cast<GLintptr>(static_cast<size_t>(allocation.base_vertex) * stride),
+                    static_cast<GLsizeiptr>(static_cast<size_t>(allocation.vertex_num) * stride),
+                    mesh_data.vertex_data);
+    gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, pool.index_buffer.get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    static_cast<GLintptr>(allocation.first_index * sizeof(uint32_t)),
+                    static_cast<GLsizeiptr>(allocation.index_num * sizeof(uint32_t)),
+                    mesh_data.indices);
+
+    stats.allocation_num++;
+    stats.vertex_bytes += static_cast<size_t>(allocation.vertex_num) * stride;
+    stats.index_bytes  += static_cast<size_t>(allocation.index_num) * sizeof(uint32_t);
+    GL_CHECK();
+    return allocation;
+}
+
+void ck::MeshArena::free(MeshAllocation& allocation)
+{
+    if (allocation.id == NULL_MESH_ALLOCATION) { return; }
+    Pool& pool = get_pool(allocation.vertex_format);
+    // shutdown()之后缓冲已经释放，区间也已经清空
+    if (pool.vao.is_valid())
+    {
+        const uint32_t stride = get_vertex_stride(allocation.vertex_format);
+        pool.vertex_ranges.free(allocation.base_vertex, allocation.vertex_num);
+        pool.index_ranges.free(allocation.first_index, allocation.index_num);
+        stats.allocation_num--;
+        stats.vertex_bytes -= static_cast<size_t>(allocation.vertex_num) * stride;
+        stats.index_bytes  -= static_cast<size_t>(allocation.index_num) * sizeof(uint32_t);
+        free_ids.push_back(allocation.id);
+    }
+    allocation.id = NULL_MESH_ALLOCATION;
+}
+
+void ck::MeshArena::bind(const VertexFormat format) const
+{
+    GLStateCache::get_instance().bind_vertex_array(get_pool(format).vao.get());
+}
+
+void ck::MeshArena::shutdown()
+{
+    for (Pool& pool : pools) { pool = {}; }  // 句柄析构时删除VAO和缓冲
+    free_ids.clear();
+    next_id = 0;
+    stats   = {};
+}
+
+[[nodiscard]] uint32_t ck::MeshArena::get_vao(const VertexFormat format) const
+{
+    return get_pool(format).vao.get();
+}
+
+[[nodiscard]] const ck::MeshArenaStats& ck::MeshArena::get_stats() const
+{
+    return stats;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "core/ck_gl_resource.h"
+
+#include "mesh_cache.h"
+#include "vertex_format.h"
+
+namespace ck {
+
+static const uint32_t MESH_ARENA_INITIAL_VERTEX_NUM = 1 << 16;
+static const uint32_t MESH_ARENA_INITIAL_INDEX_NUM  = 1 << 18;
+static const uint32_t VERTEX_FORMAT_NUM             = 3;
+static const uint32_t NULL_MESH_ALLOCATION          = 0xFFFFFFFF;
+
+/// @brief 一个网格在共享缓冲中的位置，都以元素（顶点/索引）为单位
+struct MeshAllocation
+{
+    uint32_t     id;  // 分配的编号，NULL_MESH_ALLOCATION表示没有分配
+    VertexFormat vertex_format;
+    uint32_t     base_vertex;
+    uint32_t     vertex_num;
+    uint32_t     first_index;
+    uint32_t     index_num;
+};
+
+/// @brief 共享缓冲的使用情况
+struct MeshArenaStats
+{
+    uint32_t allocation_num;
+    size_t   vertex_bytes;    // 已分配的顶点数据
+    size_t   index_bytes;     // 已分配的索引数据
+    size_t   capacity_bytes;  // GPU上所有顶点/索引缓冲的总大小
+};
+
+/// @brief 区间分配器：首次适配，释放时和相邻的空闲区间合并
+class ArenaRangeAllocator {
+private:
+    struct Range
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    std::vector<Range> free_ranges;  // 按offset排序
+    uint32_t           top;          // [top, ∞)都没有用过
+
+public:
+    ArenaRangeAllocator();
+
+    /// @return 分配到的起点，可能超出当前容量，由调用者扩容
+    uint32_t allocate(uint32_t size);
+    void     free(uint32_t offset, uint32_t size);
+    void     reset();
+
+    [[nodiscard]] uint32_t get_top() const;
+};
+
+/// @brief 所有网格的顶点/索引都放在几块共享缓冲里
+/// @note 设计成单例类，只能在GL线程使用
+/**NOTE - 共享顶点/索引缓冲
+每种顶点格式一个池：一个VAO、一块顶点缓冲、一块索引缓冲。
+网格构造时从池中分出一段顶点和一段索引，绘制时用base vertex / first index定位，
+索引本身仍然从0开始，不需要改写。
+1. 所有同格式的网格共用一个VAO，相邻的绘制不再切换VAO，
+   也让整个不透明通道可以用glMultiDrawElementsIndirect一次提交（见 indirect_draw_buffer.h）。
+2. 容量不够时按2倍扩容：新建缓冲，用glCopyBufferSubData在GPU上搬运旧数据，再重新挂到VAO上。
+3. 网格析构时归还区间，相邻的空闲区间合并，末尾的空闲区间直接退回。
+*/
+class MeshArena {
+private:
+    struct Pool
+    {
+        GLVertexArray       vao;
+        GLBuffer            vertex_buffer;
+        GLBuffer            index_buffer;
+        uint32_t            vertex_capacity;  // 以顶点为单位
+        uint32_t            index_capacity;   // 以索引为单位
+        ArenaRangeAllocator vertex_ranges;
+        ArenaRangeAllocator index_ranges;
+    };
+
+    std::array<Pool, VERTEX_FORMAT_NUM> pools;
+    std::vector<uint32_t>               free_ids;
+    uint32_t                            next_id;
+    MeshArenaStats                      stats;
+
+    static MeshArena* singleton;
+    // NOTE - 故意不释放：Mesh可能在静态析构阶段才归还区间
+    MeshArena();
+
+    void create_pool(VertexFormat format);
+    /// @brief 把缓冲扩大到至少required个元素，保留原有的数据
+    static void grow_buffer(GLBuffer& buffer,
+                            GLenum    target,
+                            uint32_t& capacity,
+                            uint32_t  required,
+                            size_t    element_size);
+    void        attach_buffers(VertexFormat format);
+
+    [[nodiscard]] Pool&       get_pool(VertexFormat format);
+    [[nodiscard]] const Pool& get_pool(VertexFormat format) const;
+
+public:
+    static MeshArena& get_instance();
+
+    MeshArena(const MeshArena&)            = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    /// @brief 为网格分配顶点/索引区间并上传数据
+    MeshAllocation allocate(const MeshData& mesh_data);
+    void           free(MeshAllocation& allocation);
+
+    /// @brief 绑定这种顶点格式的共享VAO（索引缓冲是VAO状态，一起生效）
+    void bind(VertexFormat format) const;
+
+    /// @brief 释放GL缓冲，需要在销毁GL上下文之前调用；之后归还的区间直接忽略
+    void shutdown();
+
+    [[nodiscard]] uint32_t              get_vao(VertexFormat format) const;
+    [[nodiscard]] const MeshArenaStats& get_stats() const;
+};
+
+};  // namespace ck
@@ -0,0 +1,494 @@
+#include "mesh_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include <assimp/scene.h>
+#include <glog/logging.h>
+
+#include "vertex_format.h"
+
+namespace {
+
+const char MESH_CACHE_MAGIC[8] = {'C', 'K', 'M', 'E', 'S', 'H', '\0', '\0'};
+
+struct MeshCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertex_format;
+    uint32_t import_flags;
+    uint32_t source_path_offset;  // in string table
+    int64_t  source_mtime;
+    uint32_t source_path_length;
+    uint32_t mesh_num;
+    uint32_t material_num;
+    uint32_t texture_num;
+    uint64_t mesh_table_offset;
+    uint64_t material_table_offset;
+    uint64_t texture_table_offset;
+    uint64_t string_table_offset;
+    uint64_t string_table_size;
+};
+
+struct MeshCacheMeshEntry
+{
+    uint32_t material_index;
+    uint32_t index_num;
+    float    dequant_offset[3];
+    float    dequant_scale[3];
+    float    bounds_min[3];
+    float    bounds_max[3];
+    uint64_t vertex_data_offset;
+    uint64_t vertex_data_size;
+    uint64_t index_data_offset;
+};
+
+struct MeshCacheMaterialEntry
+{
+    uint32_t first_texture;
+    uint32_t texture_num;
+};
+
+struct MeshCacheTextureEntry
+{
+    uint32_t type_offset;
+    uint32_t type_length;
+    uint32_t path_offset;
+    uint32_t path_length;
+    uint32_t gamma_correction;
+};
+
+constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+inline uint64_t align_up(const uint64_t value, const uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/// @brief [offset, offset + size)在文件范围内，且起点按alignment对齐；写法不会溢出
+inline bool is_range_valid(const uint64_t offset,
+                           const uint64_t size,
+                           const uint64_t file_size,
+                           const uint64_t alignment = 1)
+{
+    return offset <= file_size && size <= file_size - offset && offset % alignment == 0;
+}
+
+}  // namespace
+
+// ANCHOR - MeshCacheKey
+
+ck::MeshCacheKey ck::MeshCacheKey::from_source(const std::string& source_path,
+                                               const uint32_t     import_flags,
+                                               const VertexFormat vertex_format)
+{
+    std::error_code error;
+    const auto      mtime = std::filesystem::last_write_time(source_path, error);
+    return {source_path, error ? int64_t(-1) : static_cast<int64_t>(mtime.time_since_epoch().count()),
+            import_flags, vertex_format};
+}
+
+// ANCHOR - CookedMesh
+
+ck::MeshData ck::CookedMesh::view() const
+{
+    return {vertex_format,      dequant_box,    bounds, vertex_data.data(),
+            vertex_data.size(), indices.data(), static_cast<uint32_t>(indices.size())};
+}
+
+ck::CookedMesh ck::cook_mesh(const aiMesh* mesh, const VertexFormat vertex_format)
+{
+    CookedMesh cooked;
+    cooked.material_index = mesh->mMaterialIndex;
+    cooked.vertex_format  = vertex_format;
+    cooked.dequant_box    = pack_vertices(mesh, vertex_format, cooked.vertex_data);
+    cooked.bounds         = AABB::from_ai_mesh(mesh);
+
+    for (int i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace& face = mesh->mFaces[i];
+        cooked.indices.insert(cooked.indices.end(), face.mIndices,
+                              face.mIndices + face.mNumIndices);
+    }
+    return cooked;
+}
+
+// ANCHOR - MappedFile
+
+#ifdef _WIN32
+ck::MappedFile::MappedFile(const std::string& path)
+    : data(nullptr), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr)
+{
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) { return; }
+
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file_handle, &file_size) == 0 || file_size.QuadPart == 0) { return; }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) { return; }
+
+    data = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (data != nullptr) { size = static_cast<size_t>(file_size.QuadPart); }
+}
+
+ck::MappedFile::~MappedFile()
+{
+    if (data != nullptr) { UnmapViewOfFile(data); }
+    if (mapping_handle != nullptr) { CloseHandle(mapping_handle); }
+    if (file_handle != INVALID_HANDLE_VALUE) { CloseHandle(file_handle); }
+}
+#else
+ck::MappedFile::MappedFile(const std::string& path)
+    : data(nullptr), size(0), file_descriptor(-1)
+{
+    file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) { return; }
+
+    struct stat file_stat = {};
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0) { return; }
+
+    void* ptr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (ptr == MAP_FAILED) { return; }
+    data = static_cast<const uint8_t*>(ptr);
+    size = static_cast<size_t>(file_stat.st_size);
+}
+
+ck::MappedFile::~MappedFile()
+{
+    if (data != nullptr) { munmap(const_cast<uint8_t*>(data), size); }
+    if (file_descriptor >= 0) { close(file_descriptor); }
+}
+#endif
+
+[[nodiscard]] bool ck::MappedFile::is_open() const
+{
+    return data != nullptr;
+}
+
+[[nodiscard]] const uint8_t* ck::MappedFile::get_data() const
+{
+    return data;
+}
+
+[[nodiscard]] size_t ck::MappedFile::get_size() const
+{
+    return size;
+}
+
+// ANCHOR - MeshCacheWriter
+
+void ck::MeshCacheWriter::add_material(std::vector<TextureRef> texture_refs)
+{
+    materials.emplace_back(std::move(texture_refs));
+}
+
+void ck::MeshCacheWriter::add_mesh(CookedMesh mesh)
+{
+    meshes.emplace_back(std::move(mesh));
+}
+
+bool ck::MeshCacheWriter::write(const std::string& cache_path, const MeshCacheKey& key) const
+{
+    std::string string_table;
+    auto        add_string = [&string_table](const std::string& str) {
+        const auto offset = static_cast<uint32_t>(string_table.size());
+        string_table += str;
+        return offset;
+    };
+
+    // 材质表与纹理表
+    std::vector<MeshCacheMaterialEntry> material_entries;
+    std::vector<MeshCacheTextureEntry>  texture_entries;
+    for (const auto& texture_refs : materials)
+    {
+        material_entries.push_back({static_cast<uint32_t>(texture_entries.size()),
+                                    static_cast<uint32_t>(texture_refs.size())});
+        for (const auto& texture_ref : texture_refs)
+        {
+            MeshCacheTextureEntry entry = {};
+            entry.type_offset           = add_string(texture_ref.type);
+            entry.type_length           = static_cast<uint32_t>(texture_ref.type.size());
+            entry.path_offset           = add_string(texture_ref.path);
+            entry.path_length           = static_cast<uint32_t>(texture_ref.path.size());
+            entry.gamma_correction      = texture_ref.gamma_correction ? 1 : 0;
+            texture_entries.push_back(entry);
+        }
+    }
+
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version            = MESH_CACHE_VERSION;
+    header.vertex_format      = static_cast<uint32_t>(key.vertex_format);
+    header.import_flags       = key.import_flags;
+    header.source_mtime       = key.source_mtime;
+    header.source_path_offset = add_string(key.source_path);
+    header.source_path_length = static_cast<uint32_t>(key.source_path.size());
+    header.mesh_num           = static_cast<uint32_t>(meshes.size());
+    header.material_num       = static_cast<uint32_t>(material_entries.size());
+    header.texture_num        = static_cast<uint32_t>(texture_entries.size());
+
+    // 计算各个段的偏移
+    uint64_t offset              = sizeof(MeshCacheHeader);
+    header.mesh_table_offset     = offset;
+    offset                      += meshes.size() * sizeof(MeshCacheMeshEntry);
+    header.material_table_offset = offset;
+    offset                      += material_entries.size() * sizeof(MeshCacheMaterialEntry);
+    header.texture_table_offset  = offset;
+    offset                      += texture_entries.size() * sizeof(MeshCacheTextureEntry);
+    header.string_table_offset   = offset;
+    header.string_table_size     = string_table.size();
+    offset                      += string_table.size();
+
+    std::vector<MeshCacheMeshEntry> mesh_entries;
+    for (const auto& mesh : meshes)
+    {
+        MeshCacheMeshEntry entry = {};
+        entry.material_index     = mesh.material_index;
+        entry.index_num          = static_cast<uint32_t>(mesh.indices.size());
+        for (int i = 0; i < 3; i++)
+        {
+            entry.dequant_offset[i] = mesh.dequant_box.offset[i];
+            entry.dequant_scale[i]  = mesh.dequant_box.scale[i];
+            entry.bounds_min[i]     = mesh.bounds.min[i];
+            entry.bounds_max[i]     = mesh.bounds.max[i];
+        }
+        offset                   = align_up(offset, BLOB_ALIGNMENT);
+        entry.vertex_data_offset = offset;
+        entry.vertex_data_size   = mesh.vertex_data.size();
+        offset                  += mesh.vertex_data.size();
+        offset                   = align_up(offset, BLOB_ALIGNMENT);
+        entry.index_data_offset  = offset;
+        offset                  += mesh.indices.size() * sizeof(uint32_t);
+        mesh_entries.push_back(entry);
+    }
+
+    // 先写到临时文件，成功后再替换，避免留下写了一半的缓存
+    const std::string temp_path = cache_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            LOG(WARNING) << "failed to create mesh cache: " << temp_path;
+            return false;
+        }
+        auto pad_to = [&file](const uint64_t target) {
+            static const char zeros[BLOB_ALIGNMENT] = {};
+            const auto        current = static_cast<uint64_t>(file.tellp());
+            if (target > current) { file.write(zeros, static_cast<std::streamsize>(target - current)); }
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(mesh_entries.data()),
+                   static_cast<std::streamsize>(mesh_entries.size() * sizeof(MeshCacheMeshEntry)));
+        file.write(reinterpret_cast<const char*>(material_entries.data()),
+                   static_cast<std::streamsize>(material_entries.size() *
+                                                sizeof(MeshCacheMaterialEntry)));
+        file.write(reinterpret_cast<const char*>(texture_entries.data()),
+                   static_cast<std::streamsize>(texture_entries.size() *
+                                                sizeof(MeshCacheTextureEntry)));
+        file.write(string_table.data(), static_cast<std::streamsize>(string_table.size()));
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            pad_to(mesh_entries[i].vertex_data_offset);
+            file.write(reinterpret_cast<const char*>(meshes[i].vertex_data.data()),
+                       static_cast<std::streamsize>(meshes[i].vertex_data.size()));
+            pad_to(mesh_entries[i].index_data_offset);
+            file.write(reinterpret_cast<const char*>(meshes[i].indices.data()),
+                       static_cast<std::streamsize>(meshes[i].indices.size() * sizeof(uint32_t)));
+        }
+        if (!file.good())
+        {
+            LOG(WARNING) << "failed to write mesh cache: " << temp_path;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error)
+    {
+        LOG(WARNING) << "failed to replace mesh cache " << cache_path << ": " << error.message();
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+// ANCHOR - MeshCacheReader
+
+ck::MeshCacheReader::MeshCacheReader(const std::string& cache_path, const MeshCacheKey& key)
+    : mapped_file(cache_path), valid(false)
+{
+    if (!mapped_file.is_open() || mapped_file.get_size() < sizeof(MeshCacheHeader)) { return; }
+
+    const auto* header = reinterpret_cast<const MeshCacheHeader*>(mapped_file.get_data());
+    if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MESH_CACHE_VERSION)
+    {
+        return;
+    }
+
+    // 检查每个段都在文件范围内，表按各自的类型对齐（之后直接reinterpret_cast）
+    // 偏移和大小都来自磁盘，数量是uint32_t，乘以表项大小不会溢出uint64_t
+    const uint64_t file_size = mapped_file.get_size();
+    if (!is_range_valid(header->mesh_table_offset,
+                        uint64_t(header->mesh_num) * sizeof(MeshCacheMeshEntry), file_size,
+                        alignof(MeshCacheMeshEntry)) ||
+        !is_range_valid(header->material_table_offset,
+                        uint64_t(header->material_num) * sizeof(MeshCacheMaterialEntry),
+                        file_size, alignof(MeshCacheMaterialEntry)) ||
+        !is_range_valid(header->texture_table_offset,
+                        uint64_t(header->texture_num) * sizeof(MeshCacheTextureEntry), file_size,
+                        alignof(MeshCacheTextureEntry)) ||
+        !is_range_valid(header->string_table_offset, header->string_table_size, file_size))
+    {
+        LOG(WARNING) << "mesh cache is truncated: " << cache_path;
+        return;
+    }
+
+    // 检查缓存键：源文件、修改时间、导入参数、顶点格式必须全部一致
+    if (header->source_mtime != key.source_mtime || header->import_flags != key.import_flags ||
+        header->vertex_format != static_cast<uint32_t>(key.vertex_format) ||
+        read_string(header->source_path_offset, header->source_path_length) != key.source_path)
+    {
+        return;
+    }
+
+    // 每个网格的数据块在文件内，索引按4B对齐且不超出顶点数，
+    // 损坏或过期的缓存不能把越界的索引交给glDrawElements
+    const uint32_t stride       = get_vertex_stride(key.vertex_format);
+    const auto*    mesh_entries = reinterpret_cast<const MeshCacheMeshEntry*>(
+        mapped_file.get_data() + header->mesh_table_offset);
+    for (uint32_t i = 0; i < header->mesh_num; i++)
+    {
+        const MeshCacheMeshEntry& entry = mesh_entries[i];
+        if (!is_range_valid(entry.vertex_data_offset, entry.vertex_data_size, file_size) ||
+            !is_range_valid(entry.index_data_offset, uint64_t(entry.index_num) * sizeof(uint32_t),
+                            file_size, alignof(uint32_t)) ||
+            entry.material_index >= header->material_num || stride == 0 ||
+            entry.vertex_data_size % stride != 0)
+        {
+            LOG(WARNING) << "mesh cache is corrupted: " << cache_path;
+            return;
+        }
+        const uint64_t vertex_num = entry.vertex_data_size / stride;
+        const auto*    indices =
+            reinterpret_cast<const uint32_t*>(mapped_file.get_data() + entry.index_data_offset);
+        if (entry.index_num > 0 &&
+            *std::max_element(indices, indices + entry.index_num) >= vertex_num)
+        {
+            LOG(WARNING) << "mesh cache has out-of-range indices: " << cache_path;
+            return;
+        }
+    }
+    valid = true;
+}
+
+std::string ck::MeshCacheReader::read_string(const uint32_t offset, const uint32_t length) const
+{
+    const auto* header = reinterpret_cast<const MeshCacheHeader*>(mapped_file.get_data());
+    if (static_cast<uint64_t>(offset) + length > header->string_table_size) { return {}; }
+    const auto* str = reinterpret_cast<const char*>(mapped_file.get_data() +
+                                                    header->string_table_offset + offset);
+    return {str, length};
+}
+
+[[nodiscard]] bool ck::MeshCacheReader::is_valid() const
+{
+    return valid;
+}
+
+[[nodiscard]] uint32_t ck::MeshCacheReader::get_mesh_num() const
+{
+    return reinterpret_cast<const MeshCacheHeader*>(mapped_file.get_data())->mesh_num;
+}
+
+[[nodiscard]] uint32_t ck::MeshCacheReader::get_material_num() const
+{
+    return reinterpret_cast<const MeshCacheHeader*>(mapped_file.get_data())->material_num;
+}
+
+[[nodiscard]] ck::MeshData ck::MeshCacheReader::get_mesh(const uint32_t mesh_index) const
+{
+    const uint8_t* base   = mapped_file.get_data();
+    const auto*    header = reinterpret_cast<const MeshCacheHeader*>(base);
+    const auto&    entry  = reinterpret_cast<const MeshCacheMeshEntry*>(
+        base + header->mesh_table_offset)[mesh_index];
+
+    MeshData data         = {};
+    data.vertex_format    = static_cast<VertexFormat>(header->vertex_format);
+    data.dequant_box      = {glm::vec3(entry.dequant_offset[0], entry.dequant_offset[1],
+                                       entry.dequant_offset[2]),
+                             glm::vec3(entry.dequant_scale[0], entry.dequant_scale[1],
+                                       entry.dequant_scale[2])};
+    data.bounds           = {glm::vec3(entry.bounds_min[0], entry.bounds_min[1],
+                                       entry.bounds_min[2]),
+                             glm::vec3(entry.bounds_max[0], entry.bounds_max[1],
+                                       entry.bounds_max[2])};
+    data.vertex_data      = base + entry.vertex_data_offset;
+    data.vertex_data_size = entry.vertex_data_size;
+    data.indices          = reinterpret_cast<const uint32_t*>(base + entry.index_data_offset);
+    data.index_num        = entry.index_num;
+    return data;
+}
+
+[[nodiscard]] uint32_t ck::MeshCacheReader::get_mesh_material(const uint32_t mesh_index) const
+{
+    const uint8_t* base   = mapped_file.get_data();
+    const auto*    header = reinterpret_cast<const MeshCacheHeader*>(base);
+    return reinterpret_cast<const MeshCacheMeshEntry*>(base + header->mesh_table_offset)[mesh_index]
+        .material_index;
+}
+
+[[nodiscard]] std::vector<ck::TextureRef>
+ck::MeshCacheReader::get_material_textures(const uint32_t material_index) const
+{
+    const uint8_t* base     = mapped_file.get_data();
+    const auto*    header   = reinterpret_cast<const MeshCacheHeader*>(base);
+    const auto&    material = reinterpret_cast<const MeshCacheMaterialEntry*>(
+        base + header->material_table_offset)[material_index];
+    const auto* texture_entries =
+        reinterpret_cast<const MeshCacheTextureEntry*>(base + header->texture_table_offset);
+
+    std::vector<TextureRef> texture_refs;
+    for (uint32_t i = 0; i < material.texture_num; i++)
+    {
+        if (material.first_texture + i >= header->texture_num) { break; }
+        const auto& entry = texture_entries[material.first_texture + i];
+        texture_refs.push_back({read_string(entry.type_offset, entry.type_length),
+                                read_string(entry.path_offset, entry.path_length),
+                                entry.gamma_correction != 0});
+    }
+    return texture_refs;
+}
+
+std::string ck::get_mesh_cache_path(const std::string& model_path)
+{
+    return model_path + ".ckmesh";
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include <assimp/scene.h>
+
+#include "bounds.h"
+#include "vertex_format.h"
+
+namespace ck {
+
+/**NOTE - .ckmesh 烘焙格式
+Assimp的后处理（计算切线、合并顶点……）非常慢，每次启动都重新导入一遍很浪费。
+第一次导入后把GPU可以直接使用的顶点/索引数据、网格/材质表和纹理引用写进 <model>.ckmesh，
+之后的启动只需要mmap一次文件，直接把其中的数据块交给glBufferData，不需要逐顶点解析。
+
+文件布局（所有偏移都相对于文件起始位置，数据块按16B对齐）：
+    MeshCacheHeader
+    MeshCacheMeshEntry[mesh_num]
+    MeshCacheMaterialEntry[material_num]
+    MeshCacheTextureEntry[texture_num]
+    string table
+    vertex / index blobs
+*/
+static const uint32_t MESH_CACHE_VERSION = 2;  // 2: 网格表中加入包围盒
+
+/// @brief 纹理引用：材质中的一张贴图
+struct TextureRef
+{
+    std::string type;  // texture_diffuse / texture_specular / texture_normal
+    std::string path;  // 相对于模型所在目录
+    bool        gamma_correction;
+};
+
+/// @brief 判断缓存是否有效的全部依据
+struct MeshCacheKey
+{
+    std::string  source_path;
+    int64_t      source_mtime;
+    uint32_t     import_flags;
+    VertexFormat vertex_format;
+
+    static MeshCacheKey from_source(const std::string& source_path,
+                                    uint32_t           import_flags,
+                                    VertexFormat       vertex_format);
+};
+
+/// @brief 一个网格在GPU上需要的全部数据（只是视图，不持有内存）
+struct MeshData
+{
+    VertexFormat    vertex_format;
+    DequantBox      dequant_box;
+    AABB            bounds;  // 模型空间
+    const uint8_t*  vertex_data;
+    size_t          vertex_data_size;
+    const uint32_t* indices;
+    uint32_t        index_num;
+};
+
+/// @brief 从aiMesh打包得到的网格数据（持有内存）
+struct CookedMesh
+{
+    uint32_t              material_index;
+    VertexFormat          vertex_format;
+    DequantBox            dequant_box;
+    AABB                  bounds;
+    std::vector<uint8_t>  vertex_data;
+    std::vector<uint32_t> indices;
+
+    [[nodiscard]] MeshData view() const;
+};
+
+CookedMesh cook_mesh(const aiMesh* mesh, VertexFormat vertex_format);
+
+/// @brief 只读的内存映射文件
+class MappedFile {
+private:
+    const uint8_t* data;
+    size_t         size;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int file_descriptor;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool           is_open() const;
+    [[nodiscard]] const uint8_t* get_data() const;
+    [[nodiscard]] size_t         get_size() const;
+};
+
+/// @brief 收集网格和材质，写出.ckmesh文件
+class MeshCacheWriter {
+private:
+    std::vector<std::vector<TextureRef>> materials;
+    std::vector<CookedMesh>              meshes;
+
+public:
+    void add_material(std::vector<TextureRef> texture_refs);
+    void add_mesh(CookedMesh mesh);
+
+    bool write(const std::string& cache_path, const MeshCacheKey& key) const;
+};
+
+/// @brief mmap一个.ckmesh文件并按需读取网格/材质
+class MeshCacheReader {
+private:
+    MappedFile mapped_file;
+    bool       valid;
+
+    [[nodiscard]] std::string read_string(uint32_t offset, uint32_t length) const;
+
+public:
+    MeshCacheReader(const std::string& cache_path, const MeshCacheKey& key);
+
+    [[nodiscard]] bool     is_valid() const;
+    [[nodiscard]] uint32_t get_mesh_num() const;
+    [[nodiscard]] uint32_t get_material_num() const;
+    [[nodiscard]] MeshData get_mesh(uint32_t mesh_index) const;
+    [[nodiscard]] uint32_t get_mesh_material(uint32_t mesh_index) const;
+
+    [[nodiscard]] std::vector<TextureRef> get_material_textures(uint32_t material_index) const;
+};
+
+[[nodiscard]] std::string get_mesh_cache_path(const std::string& model_path);
+
+};  // namespace ck
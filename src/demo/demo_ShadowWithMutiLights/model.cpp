@@ -1,151 +1,142 @@
 #include "model.h"
 
+#include <cstddef>
+#include <cstdint>
+
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
-#include <stb_image.h>
 
+#include "core/ck_cpu_profiler.h"
 #include "core/ck_debug.h"
+#include "core/ck_gl_resource.h"
+#include "core/ck_gl_state.h"
+#include "mesh_arena.h"
+#include "mesh_cache.h"
 #include "shader.h"
+#include "texture_registry.h"
 
-ck::Mesh::Mesh(const aiMesh* mesh, std::vector<Texture>& textures) : textures(std::move(textures))
+ck::Mesh::Mesh(const MeshData& mesh_data, std::vector<Texture>& textures)
+    : textures(std::move(textures)), material_key(0),
+      allocation(MeshArena::get_instance().allocate(mesh_data)),
+      dequant_box(mesh_data.dequant_box), bounds(mesh_data.bounds)
 {
-    // 申请缓冲
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-
-    // 预计算texCoords和indices，并计算缓冲区的总大小
-    // texCoords
-    std::vector<glm::vec2> mesh_texCoords;
-    if (mesh->HasTextureCoords(0))
+    CK_PROFILE_SCOPE("Mesh::Mesh");
+    /**NOTE - 交错顶点 vs 分离顶点
+    原来的做法是把position/normal/texCoord/tangent/bitangent分成五段依次存放（56B/顶点），
+    取一个顶点要跨五段内存。现在一个顶点的数据是连续的，并且经过量化（20B/顶点）。
+    */
+    /**NOTE - 共享缓冲
+    原来每个网格有自己的VAO/VBO/EBO，现在顶点和索引都放进MeshArena中同一顶点格式的共享缓冲，
+    绘制时用base vertex / first index定位，见 mesh_arena.h。
+    */
+
+    // 采样器名字只和纹理列表有关，提前生成，绘制时不再拼接字符串
+    uint32_t diffuseNr  = 0;
+    uint32_t specularNr = 0;
+    uint32_t normalNr   = 0;
+    texture_uniform_names.reserve(this->textures.size());
+    for (const auto& texture : this->textures)
     {
-        for (int i = 0; i < mesh->mNumVertices; i++)
-        {
-            mesh_texCoords.emplace_back(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-            /**FIXME - emplace_back 和 push_back 的区别：
-            push_back先用普通构造创建一个临时对象，再触发移动构造，最后将临时对象移动到容器中。
-            emplace_back直接用参数在容器末尾构造对象构造对象。
-            */
-        }
+        std::string name = texture.type;
+        if (name == "texture_diffuse") { name += std::to_string(diffuseNr++); }
+        else if (name == "texture_specular") { name += std::to_string(specularNr++); }
+        else if (name == "texture_normal") { name += std::to_string(normalNr++); }
+        texture_uniform_names.emplace_back(std::move(name));
     }
-    else { mesh_texCoords.resize(mesh->mNumVertices, glm::vec2(0.0F, 0.0F)); }
-    // indices
-    std::vector<uint32_t> indices;
-    for (int i = 0; i < mesh->mNumFaces; i++)
+
+    // 使用同一组纹理的网格得到相同的material_key（FNV-1a）
+    material_key = 2166136261U;
+    for (const auto& texture : this->textures)
     {
-        aiFace face = mesh->mFaces[i];
-        for (int j = 0; j < face.mNumIndices; j++)
-        {
-            indices.push_back(face.mIndices[j]);
-        }
+        material_key ^= texture.id;
+        material_key *= 16777619U;
     }
-    indices_num = indices.size();
-
-    // 计算缓冲区的总大小
-    GLsizeiptr total_vertex_buffer_size = mesh->mNumVertices * sizeof(aiVector3D)    // 顶点位置
-                                          + mesh->mNumVertices * sizeof(aiVector3D)  // 顶点法向
-                                          + mesh_texCoords.size() * sizeof(glm::vec2)  // 纹理坐标
-                                          + mesh->mNumVertices * sizeof(aiVector3D)  // 顶点切线
-                                          + mesh->mNumVertices * sizeof(aiVector3D);  // 顶点副切线
-    GLsizeiptr total_element_buffer_size = indices_num * sizeof(uint32_t);
-    // 申请
-    glBufferData(GL_ARRAY_BUFFER, total_vertex_buffer_size, nullptr, GL_STATIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, total_element_buffer_size, nullptr, GL_STATIC_DRAW);
-    // 向缓冲区填充顶点数据
-    glBufferSubData(GL_ARRAY_BUFFER, 0, mesh->mNumVertices * sizeof(aiVector3D), mesh->mVertices);
-    glBufferSubData(GL_ARRAY_BUFFER, mesh->mNumVertices * sizeof(aiVector3D),
-                    mesh->mNumVertices * sizeof(aiVector3D), mesh->mNormals);
-    glBufferSubData(GL_ARRAY_BUFFER, 2 * mesh->mNumVertices * sizeof(aiVector3D),
-                    mesh_texCoords.size() * sizeof(glm::vec2), mesh_texCoords.data());
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    2 * mesh->mNumVertices * sizeof(aiVector3D) +
-                        mesh_texCoords.size() * sizeof(glm::vec2),
-                    mesh->mNumVertices * sizeof(aiVector3D), mesh->mTangents);
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    3 * mesh->mNumVertices * sizeof(aiVector3D) +
-                        mesh_texCoords.size() * sizeof(glm::vec2),
-                    mesh->mNumVertices * sizeof(aiVector3D), mesh->mBitangents);
-    // 向缓冲区填充索引数据
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_num * sizeof(uint32_t), indices.data(),
-                 GL_STATIC_DRAW);
-    /**FIXME - 错误定位：//生成顶点数据（26~46）
-    在使用glBufferSubData填充数据之前，要先申请一片缓冲区（glBufferData）。
-    */
-
-    // 设置VAO中数据的解读方式
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0,
-                          (void*)(mesh->mNumVertices * sizeof(aiVector3D)));
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0,
-                          (void*)(2 * mesh->mNumVertices * sizeof(aiVector3D)));
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0,
-                          (void*)(2 * mesh->mNumVertices * sizeof(aiVector3D) +
-                                  mesh_texCoords.size() * sizeof(glm::vec2)));
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0,
-                          (void*)(3 * mesh->mNumVertices * sizeof(aiVector3D) +
-                                  mesh_texCoords.size() * sizeof(glm::vec2)));
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
-
-    // 解绑
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     GL_CHECK();
 }
 
 ck::Mesh::~Mesh()
 {
-    // opengl释放缓存区
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
+    MeshArena::get_instance().free(allocation);
 }
 
-void ck::Mesh::draw(const Shader& shader) const
+ck::Mesh::Mesh(Mesh&& other) noexcept
+    : textures(std::move(other.textures)),
+      texture_uniform_names(std::move(other.texture_uniform_names)),
+      material_key(other.material_key), allocation(other.allocation),
+      dequant_box(other.dequant_box), bounds(other.bounds)
 {
-    // shader.use();
+    other.allocation.id = NULL_MESH_ALLOCATION;  // 区间的所有权转移了
+}
 
-    // 设置贴图纹理
-    uint32_t diffuseNr  = 0;
-    uint32_t specularNr = 0;
-    uint32_t normalNr   = 0;
+ck::Mesh& ck::Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this == &other) { return *this; }
+    MeshArena::get_instance().free(allocation);
+    textures              = std::move(other.textures);
+    texture_uniform_names = std::move(other.texture_uniform_names);
+    material_key          = other.material_key;
+    allocation            = other.allocation;
+    dequant_box           = other.dequant_box;
+    bounds                = other.bounds;
+    other.allocation.id   = NULL_MESH_ALLOCATION;
+    return *this;
+}
+
+void ck::Mesh::bind_textures(const Shader& shader) const
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
     for (int i = 0; i < textures.size(); i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);  // 在绑定纹理之前激活相应的纹理单元
-        glBindTexture(GL_TEXTURE_2D,
-                      textures[i].id);  // FIXME - 启动槽之后记得要绑定纹理啊
-
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse") { name += std::to_string(diffuseNr++); }
-        else if (name == "texture_specular") { name += std::to_string(specularNr++); }
-        else if (name == "texture_normal") { name += std::to_string(normalNr++); }
-
-        shader.setParameter(name, i);
+        gl_state.bind_texture(i, GL_TEXTURE_2D, textures[i].id);  // 激活纹理单元并绑定纹理
+        shader.setParameter(texture_uniform_names[i], i);
     }
+}
 
-    // 绘制
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, indices_num, GL_UNSIGNED_INT, 0);
-    // glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceNum);
-    glBindVertexArray(0);
+void ck::Mesh::draw(const Shader& shader, const uint32_t instance_num) const
+{
+    // shader.use();
 
-    // always good practice to set everything back to defaults
-    glBindTexture(GL_TEXTURE_2D, 0);
+    static const UniformName dequant_offset_name("dequantOffset");
+    static const UniformName dequant_scale_name("dequantScale");
+
+    // 设置贴图纹理
+    bind_textures(shader);
+
+    // 顶点位置的反量化参数
+    shader.setParameter(dequant_offset_name, dequant_box.offset);
+    shader.setParameter(dequant_scale_name, dequant_box.scale);
+
+    // 绘制：共享缓冲中的索引从0开始，用base vertex偏移到这个网格的顶点
+    MeshArena::get_instance().bind(allocation.vertex_format);
+    const auto* first_index = reinterpret_cast<const void*>(
+        static_cast<size_t>(allocation.first_index) * sizeof(uint32_t));
+    const auto index_num   = static_cast<GLsizei>(allocation.index_num);
+    const auto base_vertex = static_cast<GLint>(allocation.base_vertex);
+    if (instance_num > 1)
+    {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, index_num, GL_UNSIGNED_INT, first_index,
+                                          static_cast<GLsizei>(instance_num), base_vertex);
+    }
+    else
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, index_num, GL_UNSIGNED_INT, first_index,
+                                 base_vertex);
+    }
+    /**NOTE - 不再解绑
+    原来每次绘制后都把VAO和纹理解绑回0，下一个网格又要重新绑定，都是冗余调用。
+    所有绑定都经过GLStateCache，不会有代码误用残留的绑定。
+    */
 
     GL_CHECK();
 }
@@ -155,23 +146,80 @@ void ck::Mesh::draw(const Shader& shader) const
     return textures.size();
 }
 
+[[nodiscard]] uint32_t ck::Mesh::get_material_key() const
+{
+    return material_key;
+}
+
 [[nodiscard]] uint32_t ck::Mesh::get_vao() const
 {
-    return vao;  // NOTE - 返回的是int的副本，确实没必要出const
+    return MeshArena::get_instance().get_vao(allocation.vertex_format);
+}
+
+[[nodiscard]] uint32_t ck::Mesh::get_mesh_id() const
+{
+    return allocation.id;
+}
+
+[[nodiscard]] const ck::MeshAllocation& ck::Mesh::get_allocation() const
+{
+    return allocation;
+}
+
+[[nodiscard]] ck::VertexFormat ck::Mesh::get_vertex_format() const
+{
+    return allocation.vertex_format;
+}
+
+[[nodiscard]] const ck::DequantBox& ck::Mesh::get_dequant_box() const
+{
+    return dequant_box;
+}
+
+[[nodiscard]] const ck::AABB& ck::Mesh::get_bounds() const
+{
+    return bounds;
 }
 
-ck::Model::Model(const std::string& model_path) : load_path(model_path)
+[[nodiscard]] size_t ck::Mesh::get_arena_bytes() const
 {
+    if (allocation.id == NULL_MESH_ALLOCATION) { return 0; }
+    const size_t stride = get_vertex_stride(allocation.vertex_format);
+    return static_cast<size_t>(allocation.vertex_num) * stride +
+           static_cast<size_t>(allocation.index_num) * sizeof(uint32_t);
+}
+
+ck::Model::Model(const std::string& model_path, const VertexFormat vertex_format)
+    : load_path(model_path), vertex_format(vertex_format), arena_bytes(0)
+{
+    CK_PROFILE_SCOPE("Model::Model");
     if (model_path.empty())
     {
         LOG(WARNING) << "model path is empty, please check your model path";
         return;
     }
 
+    const auto start_time = std::chrono::steady_clock::now();
+    model_directory       = model_path.substr(0, model_path.find_last_of('/'));
+
+    // 优先从.ckmesh缓存加载，跳过Assimp的导入和后处理
+    const uint32_t     import_flags = aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_FlipUVs;
+    const MeshCacheKey cache_key = MeshCacheKey::from_source(model_path, import_flags, vertex_format);
+    const std::string  cache_path = get_mesh_cache_path(model_path);
+    if (loadFromMeshCache(cache_path, cache_key))
+    {
+        LOG(INFO) << "load model from mesh cache (warm): " << model_path << " | "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                               start_time)
+                         .count()
+                  << " ms";
+        GL_CHECK();
+        return;
+    }
+
     // load model from path
     Assimp::Importer importer;
-    const aiScene*   scene = importer.ReadFile(
-        model_path.c_str(), aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_FlipUVs);
+    const aiScene*   scene = importer.ReadFile(model_path.c_str(), import_flags);
     if (scene == nullptr || ((scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0U) ||
         scene->mRootNode == nullptr)
     {
@@ -179,7 +227,14 @@ ck::Model::Model(const std::string& model_path) : load_path(model_path)
         return;
     }
 
-    model_directory = model_path.substr(0, model_path.find_last_of('/'));
+    // 收集所有材质的纹理引用，同时记录到缓存中
+    MeshCacheWriter                      cache_writer;
+    std::vector<std::vector<TextureRef>> material_textures;
+    for (int i = 0; i < scene->mNumMaterials; ++i)
+    {
+        material_textures.push_back(collectMaterialTextures(scene->mMaterials[i]));
+        cache_writer.add_material(material_textures.back());
+    }
 
     // 层序遍历
     std::queue<const aiNode*> node_queue;
@@ -188,7 +243,7 @@ ck::Model::Model(const std::string& model_path) : load_path(model_path)
     {
         // process node in the front
         const aiNode* node = node_queue.front();
-        processNode(node, scene);
+        processNode(node, scene, material_textures, cache_writer);
 
         // add child nodes to queue
         for (int i = 0; i < node->mNumChildren; ++i)
@@ -198,146 +253,116 @@ ck::Model::Model(const std::string& model_path) : load_path(model_path)
         node_queue.pop();
     }
 
+    if (!cache_writer.write(cache_path, cache_key))
+    {
+        LOG(WARNING) << "failed to write mesh cache for model: " << model_path;
+    }
+    LOG(INFO) << "load model with assimp (cold): " << model_path << " | "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                           start_time)
+                     .count()
+              << " ms";
+
     // NOTE - 内存的释放由Assimp::Importer importer对象的析构自动完成
     GL_CHECK();
 }
 
-void ck::Model::processNode(const aiNode* node, const aiScene* scene)
+void ck::Model::processNode(const aiNode*                               node,
+                            const aiScene*                              scene,
+                            const std::vector<std::vector<TextureRef>>& material_textures,
+                            MeshCacheWriter&                            cache_writer)
 {
     // 处理节点所有的网格
     for (int i = 0; i < node->mNumMeshes; ++i)
     {
+        CookedMesh cooked_mesh = cook_mesh(scene->mMeshes[node->mMeshes[i]], vertex_format);
+
         // 处理材质纹理
         std::vector<Texture> textures;
-        uint32_t             material_index = scene->mMeshes[node->mMeshes[i]]->mMaterialIndex;
-        if (material_index >= 0)
+        if (cooked_mesh.material_index < material_textures.size())
         {
-            aiMaterial* material = scene->mMaterials[material_index];
-
-            // diffuse
-            std::vector<Texture> diffuseMaps =
-                loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-            // specular
-            std::vector<Texture> specularMaps =
-                loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-
-            // normal
-            std::vector<Texture> normalMaps =
-                loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-            textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-            // FIXME - 为什么法线贴图的类型是 aiTextureType_HEIGHT ？
+            textures = loadMaterialTextures(material_textures[cooked_mesh.material_index]);
         }
 
-        meshes.emplace_back(scene->mMeshes[node->mMeshes[i]], textures);
+        add_mesh(cooked_mesh.view(), textures);
+        cache_writer.add_mesh(std::move(cooked_mesh));
     }
     GL_CHECK();
 }
 
-std::vector<ck::Texture> ck::Model::loadMaterialTextures(const aiMaterial*   material,
-                                                         const aiTextureType type,
-                                                         const std::string&  typeName)
+bool ck::Model::loadFromMeshCache(const std::string& cache_path, const MeshCacheKey& key)
 {
-    std::vector<Texture> textures;
-    for (int i = 0; i < material->GetTextureCount(type); i++)
+    const MeshCacheReader cache_reader(cache_path, key);
+    if (!cache_reader.is_valid()) { return false; }
+
+    // 数据块直接来自mmap的文件，不需要逐顶点解析
+    for (uint32_t i = 0; i < cache_reader.get_mesh_num(); i++)
     {
-        aiString texture_path;
-        material->GetTexture(type, i, &texture_path);
+        std::vector<Texture> textures =
+            loadMaterialTextures(cache_reader.get_material_textures(cache_reader.get_mesh_material(i)));
+        add_mesh(cache_reader.get_mesh(i), textures);
+    }
+    return true;
+}
 
-        bool skip = false;
-        for (const auto& texture_loaded : textures_loaded)
-        {
-            if (texture_loaded.path == std::string(texture_path.C_Str()))
-            {
-                skip = true;
-                textures.push_back(texture_loaded);
-                break;
-            }
-        }
+void ck::Model::add_mesh(const MeshData& mesh_data, std::vector<Texture>& textures)
+{
+    meshes.emplace_back(mesh_data, textures);
+    bounds.expand(meshes.back().get_bounds());
+    const size_t mesh_bytes  = meshes.back().get_arena_bytes();
+    arena_bytes             += mesh_bytes;
+    GLResourceRegistry::get_instance().add_shared_bytes(load_path, mesh_bytes);
+}
 
-        // load texture from path
-        if (!skip)
+std::vector<ck::TextureRef> ck::Model::collectMaterialTextures(const aiMaterial* material)
+{
+    // FIXME - 为什么法线贴图的类型是 aiTextureType_HEIGHT ？
+    static const std::array<std::pair<aiTextureType, const char*>, 3> texture_types = {
+        std::make_pair(aiTextureType_DIFFUSE, "texture_diffuse"),
+        std::make_pair(aiTextureType_SPECULAR, "texture_specular"),
+        std::make_pair(aiTextureType_HEIGHT, "texture_normal")};
+
+    std::vector<TextureRef> texture_refs;
+    for (const auto& [type, type_name] : texture_types)
+    {
+        for (int i = 0; i < material->GetTextureCount(type); i++)
         {
-            uint32_t texture_id =
-                loadTextureFromFile(model_directory + '/' + std::string(texture_path.C_Str()),
-                                    (type == aiTextureType_DIFFUSE));
-            textures.emplace_back(texture_id, typeName, std::string(texture_path.C_Str()));
-            textures_loaded.emplace_back(texture_id, typeName, std::string(texture_path.C_Str()));
+            aiString texture_path;
+            material->GetTexture(type, i, &texture_path);
+            texture_refs.push_back(
+                {type_name, std::string(texture_path.C_Str()), (type == aiTextureType_DIFFUSE)});
         }
     }
-    GL_CHECK();
-    return textures;
+    return texture_refs;
 }
 
-uint32_t ck::Model::loadTextureFromFile(const std::string& file_path, const bool gamma_correction)
+std::vector<ck::Texture> ck::Model::loadMaterialTextures(const std::vector<TextureRef>& texture_refs)
 {
-    LOG(INFO) << "load texture from file: " << file_path;
-
-    // 生成并绑定纹理对象
-    GLuint texture_id = 0;
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-
-    // 读取图片
-    int            width        = 0;
-    int            height       = 0;
-    int            nrComponents = 0;
-    unsigned char* data         = stbi_load(file_path.c_str(), &width, &height, &nrComponents, 0);
-    if (data != nullptr)
+    std::vector<Texture> textures;
+    for (const auto& texture_ref : texture_refs)
     {
-        // 设置纹理内部格式
-        int32_t internal_format = 0;
-        GLenum  format          = 0;
-        if (nrComponents == 1)
-        {
-            internal_format = GL_RED;
-            format          = GL_RED;
-        }
-        else if (nrComponents == 3)
-        {
-            format = GL_RGB;
-            if (gamma_correction) { internal_format = GL_SRGB; }
-            else { internal_format = GL_RGB; }
-        }
-        else if (nrComponents == 4)
-        {
-            format = GL_RGBA;
-            if (gamma_correction) { internal_format = GL_SRGB_ALPHA; }
-            else { internal_format = GL_RGBA; }
-        }
-        else { LOG(WARNING) << "no sutibale format for texture: " << file_path; }
-
-        // 创建纹理对象的数据
-        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE,
-                     data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // 纹理设置
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // 纹理由全局注册表去重，多个模型共用同一张图片时只解码、上传一次
+        const uint32_t texture_id = TextureRegistry::get_instance().acquire(
+            model_directory + '/' + texture_ref.path, texture_ref.gamma_correction, load_path);
+        textures.emplace_back(texture_id, texture_ref.type, texture_ref.path);
+        acquired_textures.push_back(texture_id);
     }
-    else
+    GL_CHECK();
+    return textures;
+}
+
+ck::Model::~Model()
+{
+    GLResourceRegistry::get_instance().remove_shared_bytes(load_path, arena_bytes);
+    for (const uint32_t texture_id : acquired_textures)
     {
-        LOG(WARNING) << "load texture failed: " << file_path;
-        glDeleteTextures(1, &texture_id);
-        texture_id = 0;
+        TextureRegistry::get_instance().release(texture_id);
     }
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    stbi_image_free(data);  // 释放图片的内存
-    GL_CHECK();
-    return texture_id;
 }
 
 void ck::Model::draw(const Shader& shader) const
 {
     shader.use();
-    GLenum last_active_texture;
-    glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
     for (const auto& mesh : meshes)
     {
         mesh.draw(shader);
@@ -361,6 +386,16 @@ void ck::Model::draw(const Shader& shader) const
     return load_path;
 }
 
+[[nodiscard]] const std::vector<ck::Mesh>& ck::Model::get_meshes() const
+{
+    return meshes;
+}
+
+[[nodiscard]] const ck::AABB& ck::Model::get_bounds() const
+{
+    return bounds;
+}
+
 bool ck::Model::operator==(const Model& other) const
 {
     return (this->load_path == other.get_load_path());
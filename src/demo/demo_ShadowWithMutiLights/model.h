@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -7,8 +8,12 @@
 
 #include <assimp/scene.h>
 
+#include "bounds.h"
 #include "core/ck_debug.h"
+#include "mesh_arena.h"
+#include "mesh_cache.h"
 #include "shader.h"
+#include "vertex_format.h"
 
 namespace ck {
 
@@ -51,47 +56,83 @@ struct Texture
 
 class Mesh {
 private:
-    std::vector<Texture> textures;
-    int32_t              indices_num;
-    uint32_t             vao, vbo, ebo;
+    std::vector<Texture>     textures;
+    std::vector<UniformName> texture_uniform_names;  // 和textures一一对应，构造时生成
+    uint32_t                 material_key;           // 纹理组合的哈希，用于渲染队列排序
+    MeshAllocation           allocation;             // 在MeshArena共享缓冲中的位置
+
+    DequantBox dequant_box;
+    AABB       bounds;  // 模型空间，加载时由顶点计算
 
 public:
-    Mesh(const aiMesh* mesh, std::vector<Texture>& textures);
+    Mesh(const MeshData& mesh_data, std::vector<Texture>& textures);
     ~Mesh();
 
-    Mesh(const Mesh&)            = default;
-    Mesh& operator=(const Mesh&) = default;
-    Mesh(Mesh&&)                 = default;
-    Mesh& operator=(Mesh&&)      = default;
-
-    void draw(const Shader& shader) const;
-
-    [[nodiscard]] uint32_t get_vao() const;
+    // NOTE - Mesh独占共享缓冲中的区间，复制会导致重复归还；移动后原对象不再持有区间
+    Mesh(const Mesh&)            = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+
+    /// @param instance_num 大于1时实例化绘制，model矩阵由着色器从InstanceBuffer中读取
+    void draw(const Shader& shader, uint32_t instance_num = 1) const;
+    /// @brief 绑定贴图并设置采样器，间接绘制时同一材质的所有网格共用一次
+    void bind_textures(const Shader& shader) const;
+
+    /// @brief 共享VAO，同一顶点格式的网格都相同
+    [[nodiscard]] uint32_t              get_vao() const;
+    /// @brief 网格在MeshArena中的编号，用作渲染队列的网格排序键
+    [[nodiscard]] uint32_t              get_mesh_id() const;
+    [[nodiscard]] const MeshAllocation& get_allocation() const;
+    [[nodiscard]] VertexFormat          get_vertex_format() const;
+    [[nodiscard]] const DequantBox&     get_dequant_box() const;
+    [[nodiscard]] uint32_t              get_material_key() const;
+    [[nodiscard]] const AABB&           get_bounds() const;
+    /// @brief 在MeshArena共享缓冲中占用的字节数
+    [[nodiscard]] size_t                get_arena_bytes() const;
     /// @brif 返回第一个最小的可用纹理slot
     [[nodiscard]] int32_t get_avaliable_texture_slot() const;
 };
 
 class Model {
 private:
-    std::vector<Mesh>    meshes;
-    std::string          model_directory;
-    std::vector<Texture> textures_loaded;
+    std::vector<Mesh>     meshes;
+    std::string           model_directory;
+    std::vector<uint32_t> acquired_textures;  // 每次acquire都记录一次，析构时逐一release
+
+    std::string  load_path;
+    VertexFormat vertex_format;
+    AABB         bounds;       // 所有网格包围盒的并集
+    size_t       arena_bytes;  // 所有网格在共享缓冲中的大小，记在GLResourceRegistry中
+
+    /// @brief 创建网格并更新包围盒和显存统计
+    void add_mesh(const MeshData& mesh_data, std::vector<Texture>& textures);
+
+    void processNode(const aiNode*                               node,
+                     const aiScene*                              scene,
+                     const std::vector<std::vector<TextureRef>>& material_textures,
+                     MeshCacheWriter&                            cache_writer);
+    bool loadFromMeshCache(const std::string& cache_path, const MeshCacheKey& key);
+    std::vector<Texture>           loadMaterialTextures(const std::vector<TextureRef>& texture_refs);
+    static std::vector<TextureRef> collectMaterialTextures(const aiMaterial* material);
 
-    std::string load_path;
+public:
+    explicit Model(const std::string& model_path,
+                   VertexFormat       vertex_format = VertexFormat::SNORM16);
+    ~Model();
 
-    void                 processNode(const aiNode* node, const aiScene* scene);
-    std::vector<Texture> loadMaterialTextures(const aiMaterial*  material,
-                                              aiTextureType      type,
-                                              const std::string& typeName);
-    static uint32_t      loadTextureFromFile(const std::string& file_path, bool gamma_correction);
+    // NOTE - Model持有纹理的引用计数，复制会导致重复release
+    Model(const Model&)            = delete;
+    Model& operator=(const Model&) = delete;
 
-public:
-    explicit Model(const std::string& model_path);
     void draw(const Shader& shader) const;
 
     /// @brief 返回第一个最小的可用纹理slot
-    [[nodiscard]] int32_t            get_avaliable_texture_slot() const;
-    [[nodiscard]] const std::string& get_load_path() const;
+    [[nodiscard]] int32_t                  get_avaliable_texture_slot() const;
+    [[nodiscard]] const std::string&       get_load_path() const;
+    [[nodiscard]] const std::vector<Mesh>& get_meshes() const;
+    /// @brief 模型空间的包围盒，没有网格时为空盒
+    [[nodiscard]] const AABB&              get_bounds() const;
 
     bool operator==(const Model& other) const;
 };
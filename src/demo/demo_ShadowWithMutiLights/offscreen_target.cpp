@@ -0,0 +1,93 @@
+#include "offscreen_target.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+
+#include <glad/glad.h>  //glad first
+
+#include <glog/logging.h>
+
+#include "core/ck_debug.h"
+
+ck::OffscreenTarget::OffscreenTarget()
+    : width(0), height(0), samples(0)
+{
+}
+
+ck::OffscreenTarget::~OffscreenTarget()
+{
+    shutdown();
+}
+
+bool ck::OffscreenTarget::create(const uint32_t new_width,
+                                 const uint32_t new_height,
+                                 const uint32_t new_samples)
+{
+    shutdown();
+    width  = new_width;
+    height = new_height;
+
+    // 驱动支持的采样数可能更少（llvmpipe最多支持4x）
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    samples = std::min(new_samples, static_cast<uint32_t>(std::max(max_samples, 0)));
+
+    const auto w = static_cast<GLsizei>(width);
+    const auto h = static_cast<GLsizei>(height);
+    const auto s = static_cast<GLsizei>(samples);
+    // 两个附件都是每个采样4字节（RGBA8和D24S8）
+    const size_t attachment_bytes =
+        static_cast<size_t>(width) * height * std::max(samples, 1U) * 4;
+    color_renderbuffer.create("offscreen color", "OffscreenTarget");
+    glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer.get());
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, s, GL_SRGB8_ALPHA8, w, h);
+    color_renderbuffer.set_bytes(attachment_bytes);
+    depth_renderbuffer.create("offscreen depth stencil", "OffscreenTarget");
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer.get());
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, s, GL_DEPTH24_STENCIL8, w, h);
+    depth_renderbuffer.set_bytes(attachment_bytes);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    framebuffer.create("offscreen target", "OffscreenTarget");
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+    framebuffer.set_bytes(0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              color_renderbuffer.get());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                              depth_renderbuffer.get());
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete) { LOG(ERROR) << "Offscreen framebuffer is not complete!"; }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GL_CHECK();
+    return complete;
+}
+
+void ck::OffscreenTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+    glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+}
+
+void ck::OffscreenTarget::shutdown()
+{
+    framebuffer.reset();
+    color_renderbuffer.reset();
+    depth_renderbuffer.reset();
+}
+
+[[nodiscard]] uint32_t ck::OffscreenTarget::get_framebuffer() const
+{
+    return framebuffer.get();
+}
+
+[[nodiscard]] uint32_t ck::OffscreenTarget::get_width() const
+{
+    return width;
+}
+
+[[nodiscard]] uint32_t ck::OffscreenTarget::get_height() const
+{
+    return height;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/ck_gl_resource.h"
+
+namespace ck {
+
+static const uint32_t DEFAULT_OFFSCREEN_SAMPLES = 4;  // 和窗口的GLFW_SAMPLES一致
+
+/// @brief 离屏渲染目标：sRGB颜色 + 深度模板，两者都是（多重采样的）渲染缓冲
+/// @note 无头模式下没有默认帧缓冲，场景画在这里；附件格式和窗口的默认帧缓冲一致，
+///       阴影图集和Hi-Z会在用完自己的帧缓冲之后还原到它
+class OffscreenTarget {
+private:
+    GLFramebuffer  framebuffer;
+    GLRenderbuffer color_renderbuffer;
+    GLRenderbuffer depth_renderbuffer;
+    uint32_t       width;
+    uint32_t       height;
+    uint32_t       samples;
+
+public:
+    OffscreenTarget();
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&)            = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    /// @brief 创建（或按新的尺寸重新创建）渲染目标
+    /// @return 帧缓冲是否完整
+    bool create(uint32_t width, uint32_t height, uint32_t samples = DEFAULT_OFFSCREEN_SAMPLES);
+
+    /// @brief 绑定为读写帧缓冲，并把视口设置成整个目标
+    void bind() const;
+
+    /// @brief 释放帧缓冲和渲染缓冲，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    [[nodiscard]] uint32_t get_framebuffer() const;
+    [[nodiscard]] uint32_t get_width() const;
+    [[nodiscard]] uint32_t get_height() const;
+};
+
+};  // namespace ck
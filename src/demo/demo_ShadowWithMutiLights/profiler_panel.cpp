@@ -0,0 +1,86 @@
+#include "profiler_panel.h"
+
+#include <cstdint>
+
+#include <vector>
+
+#include <imgui.h>
+
+#include "core/ck_cpu_profiler.h"
+#include "core/ck_gpu_profiler.h"
+
+namespace {
+
+const char* const CPU_TRACE_PATH = "ck_trace.json";
+
+void draw_node(const ck::GpuProfiler& profiler, const uint32_t index)
+{
+    const ck::GpuProfileNode& node = profiler.get_nodes()[index];
+    if (!profiler.is_node_active(node)) { return; }
+
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanFullWidth;
+    if (node.children.empty())
+    {
+        flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+    }
+    // 同名的作用域可能出现在不同的父节点下，用下标作为ID
+    const bool open = ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<intptr_t>(index)),
+                                        flags, "%s", node.name);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3f", node.cpu_ms);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3f", node.gpu_ms);
+    if (open && !node.children.empty())
+    {
+        for (const uint32_t child : node.children) { draw_node(profiler, child); }
+        ImGui::TreePop();
+    }
+}
+
+}  // namespace
+
+void ck::draw_profiler_panel()
+{
+    GpuProfiler& profiler = GpuProfiler::get_instance();
+
+    // 第一次出现时放在右上角，之后可以拖动
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.0F,
+                                   viewport->WorkPos.y + 10.0F),
+                            ImGuiCond_FirstUseEver, ImVec2(1.0F, 0.0F));
+    ImGui::SetNextWindowBgAlpha(0.8F);
+    ImGui::Begin("Profiler");
+
+    bool enabled = profiler.is_enabled();
+    if (ImGui::Checkbox("GPU timers", &enabled)) { profiler.set_enabled(enabled); }
+    ImGui::SameLine();
+    if (ImGui::Button("reset")) { profiler.reset(); }
+    ImGui::Text("average of %u frames, read back %u frames late, dropped %u", GPU_PROFILER_HISTORY,
+                GPU_PROFILER_LATENCY, profiler.get_dropped_frame_num());
+
+    // CPU trace：开始时清空旧事件，保存时停止记录
+    CpuProfiler& cpu_profiler = CpuProfiler::get_instance();
+    bool         recording    = CpuProfiler::is_recording();
+    if (ImGui::Checkbox("record CPU trace", &recording))
+    {
+        if (recording) { cpu_profiler.clear(); }
+        cpu_profiler.set_recording(recording);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("save trace")) { cpu_profiler.write_chrome_trace(CPU_TRACE_PATH); }
+
+    const ImGuiTableFlags table_flags =
+        ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable("profiler_tree", 3, table_flags))
+    {
+        ImGui::TableSetupColumn("scope", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("CPU ms", ImGuiTableColumnFlags_WidthFixed, 70.0F);
+        ImGui::TableSetupColumn("GPU ms", ImGuiTableColumnFlags_WidthFixed, 70.0F);
+        ImGui::TableHeadersRow();
+        for (const uint32_t root : profiler.get_root_nodes()) { draw_node(profiler, root); }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace ck {
+
+/// @brief 计时器的ImGui浮窗：按层级显示每个作用域CPU/GPU时间的滑动平均，
+///        并可以录制CPU trace保存到ck_trace.json
+/// @note 在ImGui::NewFrame()和ImGui::Render()之间调用
+void draw_profiler_panel();
+
+};  // namespace ck
@@ -6,160 +6,228 @@
 #include <memory>
 #include <utility>
 
-#include <glm/ext/matrix_transform.hpp>
+#include <glog/logging.h>
 
+#include "bvh.h"
+#include "core/ck_gl_state.h"
+#include "instance_buffer.h"
 #include "light.h"
 #include "model.h"
-#include "scene.h"
+#include "render_queue.h"
 #include "shader.h"
 
-void ck::RenderObject::modify_object(const ck::SceneObjectEdittingCtx* ctx)
+ck::Renderable::Renderable(RenderObjectType               _object_type,
+                           const std::shared_ptr<Model>&  _model,
+                           const std::shared_ptr<Shader>& _shader,
+                           RenderDrawType                 _draw_type)
+    : object_type(_object_type), model(_model), shader(_shader), draw_type(_draw_type),
+      instance_slot(InstanceBuffer::get_instance().allocate_slot()), bounds_proxy(NULL_BVH_NODE)
 {
-    // 设置共有属性
-    // general
-    if (!ctx->object_name.empty()) { object_name = ctx->object_name; }
-    if (ctx->parent_object != nullptr && object_type != RenderObjectType::NULL_OBJECT)
+}
+
+ck::Renderable::~Renderable()
+{
+    if (instance_slot != NULL_INSTANCE_SLOT)
     {
-        // 寻找父级child列表中指向自己的指针
-        for (auto it = parent_object->get_children().begin();
-             it != parent_object->get_children().end(); it++)
-        {
-            if (*it == this)
-            {
-                parent_object->get_children().erase(it);
-                break;
-            }
-        }
-        parent_object = ctx->parent_object;
-        parent_object->get_children().push_back(this);
+        InstanceBuffer::get_instance().free_slot(instance_slot);
     }
-
-    // transformation
-    if (ctx->postion != nullptr) { postion = *(ctx->postion); }
-    if (ctx->rotation != nullptr) { rotation = *(ctx->rotation); }
-    if (ctx->scale != nullptr) { scale = *(ctx->scale); }
 }
 
-ck::RenderObject::RenderObject(RenderObjectType               _object_type,
-                               std::string                    _object_name,
-                               const std::shared_ptr<Model>&  _model,
-                               Light                          _light,
-                               const std::shared_ptr<Shader>& _shader,
-                               RenderObject*                  _parent_object,
-                               RenderDrawType                 _draw_type)
-    : object_type(_object_type), model(_model), light(_light), shader(_shader),
-      object_name(std::move(_object_name)), parent_object(_parent_object), postion(0), rotation(0),
-      scale(1), draw_type(_draw_type)
+ck::Renderable::Renderable(Renderable&& other) noexcept
+    : object_type(other.object_type), model(std::move(other.model)),
+      shader(std::move(other.shader)), draw_type(other.draw_type),
+      instance_slot(other.instance_slot), bounds_proxy(other.bounds_proxy),
+      uniform_handles(other.uniform_handles)
 {
-    // NOTE - 允许用RenderObjectType::NULL_OBJECT来创建Scene的Root节点
-    // if (_object_type == RenderObjectType::NULL_OBJECT)
-    // {
-    //     LOG(ERROR) << "null object type to create a new render object!";
-    // }
-    // if (_object_name.empty()) { LOG(ERROR) << "no object name given!"; }
-
-    // NOTE - 如果是灯光，设置它们的model和shader
-    // 现在不设置了，默认创建的时候都有正确设置
+    other.instance_slot = NULL_INSTANCE_SLOT;  // 槽位的所有权转移了
+    other.bounds_proxy  = NULL_BVH_NODE;
 }
 
-void ck::RenderObject::draw(const RenderingSceneSettingCtx* ctx) const
+ck::Renderable& ck::Renderable::operator=(Renderable&& other) noexcept
 {
-    if (shader == nullptr || model == nullptr)
+    if (this == &other) { return *this; }
+    if (instance_slot != NULL_INSTANCE_SLOT)
     {
-        LOG(ERROR) << "no model or shader given to render";
-        return;
+        InstanceBuffer::get_instance().free_slot(instance_slot);
     }
+    object_type         = other.object_type;
+    model               = std::move(other.model);
+    shader              = std::move(other.shader);
+    draw_type           = other.draw_type;
+    instance_slot       = other.instance_slot;
+    bounds_proxy        = other.bounds_proxy;
+    uniform_handles     = other.uniform_handles;
+    other.instance_slot = NULL_INSTANCE_SLOT;
+    other.bounds_proxy  = NULL_BVH_NODE;
+    return *this;
+}
 
-    // transform martix
-    glm::mat4 matrix_model = glm::translate(glm::mat4(1), postion);
-    matrix_model           = glm::rotate(matrix_model, rotation.x, glm::vec3(1, 0, 0));
-    matrix_model           = glm::rotate(matrix_model, rotation.y, glm::vec3(0, 1, 0));
-    matrix_model           = glm::rotate(matrix_model, rotation.z, glm::vec3(0, 0, 1));
-    matrix_model           = glm::scale(matrix_model, scale);
+void ck::Renderable::resolve_uniform_handles() const
+{
+    // NOTE - 以shader id判断是否需要重新解析，set_shader()替换shader后自动生效
+    if (uniform_handles.shader_id == shader->get_id()) { return; }
+    uniform_handles.shader_id       = shader->get_id();
+    uniform_handles.model           = shader->get_uniform<glm::mat4>("model");
+    uniform_handles.view            = shader->get_uniform<glm::mat4>("view");
+    uniform_handles.projection      = shader->get_uniform<glm::mat4>("projection");
+    uniform_handles.camera_position = shader->get_uniform<glm::vec3>("cameraPos");
+    uniform_handles.light_color     = shader->get_uniform<glm::vec3>("lightColor");
+    uniform_handles.skybox          = shader->get_uniform<int>("skybox");
+    uniform_handles.use_instancing  = shader->get_uniform<bool>("useInstancing");
+    uniform_handles.instance_base   = shader->get_uniform<int>("instanceBase");
+    uniform_handles.use_indirect    = shader->get_uniform<bool>("useIndirect");
+    uniform_handles.draw_base       = shader->get_uniform<int>("drawBase");
+}
 
-    switch (object_type)
-    {
-        case RenderObjectType::POLYGEN_MESH: {
-            shader->use();
-            shader->setParameter("model", matrix_model);
-            shader->setParameter("view", ctx->view);
-            shader->setParameter("projection", ctx->projection);
-            shader->setParameter("cameraPos", ctx->camera_position);
+void ck::Renderable::set_model(const std::shared_ptr<Model>& _model)
+{
+    model = _model;
+}
 
-            // sky box texture
-            int32_t skyBox_texture_slot = model->get_avaliable_texture_slot();
-            glActiveTexture(GL_TEXTURE0 + skyBox_texture_slot);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, ctx->skyBox_texture);
-            shader->setParameter("skybox", skyBox_texture_slot);
+void ck::Renderable::set_shader(const std::shared_ptr<Shader>& _shader)
+{
+    shader = _shader;
+}
 
-            model->draw(*shader);
-            GL_CHECK();
-            break;
+void ck::Renderable::set_draw_type(const RenderDrawType _draw_type)
+{
+    draw_type = _draw_type;
+}
 
-            // TODO - 根据RenderDrawType实现不同的渲染效果
-        }
-        case RenderObjectType::LIGHT: {
-            shader->use();
-            shader->setParameter("model", matrix_model);
-            shader->setParameter("view", ctx->view);
-            shader->setParameter("projection", ctx->projection);
-            shader->setParameter("lightColor", light.get_color());
-            model->draw(*shader);
-            GL_CHECK();
-            break;
-        }
-        default: {
-            LOG(ERROR) << "unknown object type to draw!";
-            return;
-        }
-    }
+void ck::Renderable::set_bounds_proxy(const uint32_t proxy)
+{
+    bounds_proxy = proxy;
 }
 
-[[nodiscard]] ck::RenderObjectType ck::RenderObject::get_object_type() const
+[[nodiscard]] ck::RenderObjectType ck::Renderable::get_object_type() const
 {
     return object_type;
 }
 
-[[nodiscard]] std::vector<ck::RenderObject*>& ck::RenderObject::get_children()
+[[nodiscard]] uint32_t ck::Renderable::get_instance_slot() const
 {
-    return children_objects;
+    return instance_slot;
 }
 
-[[nodiscard]] const std::string& ck::RenderObject::get_object_name() const
+[[nodiscard]] uint32_t ck::Renderable::get_bounds_proxy() const
 {
-    return object_name;
+    return bounds_proxy;
 }
 
-[[nodiscard]] const ck::Light& ck::RenderObject::get_light() const
+[[nodiscard]] ck::RenderDrawType ck::Renderable::get_draw_type() const
 {
-    if (object_type != RenderObjectType::LIGHT) { LOG(ERROR) << "object type is not light!"; }
-    return light;
+    return draw_type;
 }
 
-[[nodiscard]] std::array<glm::vec3, 3> ck::RenderObject::get_transform() const
+[[nodiscard]] const ck::Model* ck::Renderable::get_model() const
 {
-    return {postion, rotation, scale};
+    return model.get();
 }
 
-void ck::RenderObject::modify_polygen(const ck::SceneObjectEdittingCtx* ctx)
+[[nodiscard]] bool ck::Renderable::is_instanceable() const
 {
-    if (ctx->model) { model = ctx->model; }
-    if (ctx->shader) { shader = ctx->shader; }
-    modify_object(ctx);
+    // NOTE - 灯光有各自的颜色，不参与合批
+    return object_type == RenderObjectType::POLYGEN_MESH &&
+           uniform_handles.use_instancing.is_valid();
 }
 
-void ck::RenderObject::modify_light(const ck::SceneObjectEdittingCtx* ctx)
+[[nodiscard]] bool ck::Renderable::is_indirect_drawable() const
 {
-    if (ctx->light_attributes != nullptr)
+    return is_instanceable() && uniform_handles.use_indirect.is_valid();
+}
+
+[[nodiscard]] bool ck::Renderable::is_translucent() const
+{
+    const auto translucent_bit = static_cast<uint32_t>(RenderDrawType::TRANSLUCENT);
+    return (static_cast<uint32_t>(draw_type) & translucent_bit) != 0;
+}
+
+void ck::Renderable::enqueue(RenderQueue&                    queue,
+                             const uint32_t                  renderable_index,
+                             const glm::mat4&                world_matrix,
+                             const RenderingSceneSettingCtx* ctx) const
+{
+    if (shader == nullptr || model == nullptr)
+    {
+        LOG(ERROR) << "no model or shader given to render";
+        return;
+    }
+    if (object_type != RenderObjectType::POLYGEN_MESH && object_type != RenderObjectType::LIGHT)
     {
-        light = Light(ctx->light_attributes->light_type, ctx->light_attributes->color,
-                      ctx->light_attributes->intensity, ctx->light_attributes->inner_cutOff,
-                      ctx->light_attributes->outer_cutOff);
+        LOG(ERROR) << "unknown object type to draw!";
+        return;
     }
-    modify_object(ctx);
+    resolve_uniform_handles();
+
+    // 以物体原点在观察空间中的深度作为排序深度
+    const float view_depth  = -(ctx->view * world_matrix[3]).z;
+    const bool  translucent = is_translucent();
+    for (const auto& mesh : model->get_meshes())
+    {
+        const uint64_t sort_key = RenderQueue::make_sort_key(
+            RenderPass::MAIN, translucent, shader->get_id(), mesh.get_material_key(),
+            mesh.get_mesh_id(), view_depth, ctx->camera->get_near_plane(),
+            ctx->camera->get_far_plane());
+        queue.push({renderable_index, shader.get(), &mesh}, sort_key);
+    }
+}
+
+void ck::Renderable::apply_view_uniforms(const RenderingSceneSettingCtx* ctx) const
+{
+    shader->setParameter(uniform_handles.view, ctx->view);
+    shader->setParameter(uniform_handles.projection, ctx->projection);
+    if (object_type == RenderObjectType::POLYGEN_MESH)
+    {
+        shader->setParameter(uniform_handles.camera_position, ctx->camera_position);
+    }
+}
+
+void ck::Renderable::apply_object_uniforms(const glm::mat4&                world_matrix,
+                                           const Light*                    light,
+                                           const RenderingSceneSettingCtx* ctx) const
+{
+    shader->setParameter(uniform_handles.use_instancing, false);
+    shader->setParameter(uniform_handles.use_indirect, false);
+    shader->setParameter(uniform_handles.model, world_matrix);
+    switch (object_type)
+    {
+        case RenderObjectType::POLYGEN_MESH: {
+            // sky box texture
+            int32_t skyBox_texture_slot = model->get_avaliable_texture_slot();
+            GLStateCache::get_instance().bind_texture(skyBox_texture_slot, GL_TEXTURE_CUBE_MAP,
+                                                      ctx->skyBox_texture);
+            shader->setParameter(uniform_handles.skybox, skyBox_texture_slot);
+            break;
+
+            // TODO - 根据RenderDrawType实现不同的渲染效果
+        }
+        case RenderObjectType::LIGHT: {
+            if (light != nullptr)
+            {
+                shader->setParameter(uniform_handles.light_color, light->get_color());
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+void ck::Renderable::apply_instancing_uniforms(const uint32_t                  instance_base,
+                                               const glm::mat4&                world_matrix,
+                                               const RenderingSceneSettingCtx* ctx) const
+{
+    // 合批的物体共享模型和shader，其余uniform都相同
+    apply_object_uniforms(world_matrix, nullptr, ctx);
+    shader->setParameter(uniform_handles.use_instancing, true);
+    shader->setParameter(uniform_handles.instance_base, static_cast<int>(instance_base));
 }
 
-int32_t ck::SceneLightUBOManager::calculate_memory_occupation() const
+void ck::Renderable::apply_indirect_uniforms(const uint32_t                  draw_base,
+                                             const glm::mat4&                world_matrix,
+                                             const RenderingSceneSettingCtx* ctx) const
 {
-    return MAX_LIGHTS_SUPPORTED * Light::calculate_memory_occupancy();
+    // 一次多重绘制中的批次共享shader和材质，其余uniform都相同
+    apply_object_uniforms(world_matrix, nullptr, ctx);
+    shader->setParameter(uniform_handles.use_indirect, true);
+    shader->setParameter(uniform_handles.draw_base, static_cast<int>(draw_base));
 }
@@ -32,77 +32,102 @@ struct RenderingSceneSettingCtx
 
 /// @brief 只有当对象是多边形几何体时，RenderDrawType才有意义
 enum class RenderDrawType : uint32_t {
-    NULL_TYPE  = 0,
-    NORMAL     = 1 << 0,
-    UNVISIABLE = 1 << 1,
-    OUTLINE    = 1 << 2,
-    SHADOW     = 1 << 3,
-    FLASHING   = 1 << 4,
-    BLUR       = 1 << 5
+    NULL_TYPE   = 0,
+    NORMAL      = 1 << 0,
+    UNVISIABLE  = 1 << 1,
+    OUTLINE     = 1 << 2,
+    SHADOW      = 1 << 3,
+    FLASHING    = 1 << 4,
+    BLUR        = 1 << 5,
+    TRANSLUCENT = 1 << 6  // 半透明，在渲染队列中由远到近绘制
 };
 
-struct SceneObjectEdittingCtx;
+class RenderQueue;
 
-/// @brief 渲染对象可以是几何体、灯光。。。
-/// @note 灯光没设计好，以后还是拆开单独设计好了
-/// 平时的时候单独存储，烘培的时候打组统一更新uniform buffer
-class RenderObject {
+/// @brief 可渲染组件：几何体和灯光（灯光用默认的球体模型画出来）
+/// @note 由EntityRegistry紧密存储，变换/层级/名字/灯光属性在其他组件数组中
+/**NOTE - 组件只能移动，不能复制
+每个Renderable独占InstanceBuffer中的一个槽位，复制会导致重复归还；
+EntityRegistry删除组件时把末尾的组件移动到空位上，移动后原对象不再持有槽位。
+*/
+class Renderable {
 private:
-    RenderObjectType           object_type;
-    std::string                object_name;
-    RenderObject*              parent_object;
-    std::vector<RenderObject*> children_objects;
-
+    RenderObjectType        object_type;
     std::shared_ptr<Model>  model;  // 如果是灯光，则使用灯光默认的模型（sphere）
-    Light                   light;
     std::shared_ptr<Shader> shader;
-
-    // transformation
-    glm::vec3 postion;
-    glm::vec3 rotation;
-    glm::vec3 scale;
-
-    RenderDrawType draw_type;
-
-    void modify_object(const ck::SceneObjectEdittingCtx* ctx);
+    RenderDrawType          draw_type;
+    uint32_t                instance_slot;  // 在InstanceBuffer中的槽位
+    uint32_t                bounds_proxy;   // 在Scene的BVH中的proxy
+
+    /// @brief 绘制时用到的uniform句柄，shader被替换后重新解析
+    struct UniformHandleCache
+    {
+        uint32_t                 shader_id{0};
+        UniformHandle<glm::mat4> model;
+        UniformHandle<glm::mat4> view;
+        UniformHandle<glm::mat4> projection;
+        UniformHandle<glm::vec3> camera_position;
+        UniformHandle<glm::vec3> light_color;
+        UniformHandle<int>       skybox;
+        UniformHandle<bool>      use_instancing;
+        UniformHandle<int>       instance_base;
+        UniformHandle<bool>      use_indirect;
+        UniformHandle<int>       draw_base;
+    };
+    mutable UniformHandleCache uniform_handles;
+
+    void resolve_uniform_handles() const;
 
 public:
-    explicit RenderObject(RenderObjectType               _object_type,
-                          std::string                    _object_name,
-                          const std::shared_ptr<Model>&  _model         = nullptr,
-                          Light                          _light         = Light(-1),
-                          const std::shared_ptr<Shader>& _shader        = nullptr,
-                          RenderObject*                  _parent_object = nullptr,
-                          RenderDrawType                 _draw_type = RenderDrawType::NULL_TYPE);
-
-    void draw(const RenderingSceneSettingCtx* ctx) const;
-
-    [[nodiscard]] RenderObjectType            get_object_type() const;
-    [[nodiscard]] std::vector<RenderObject*>& get_children();
-    [[nodiscard]] const std::string&          get_object_name() const;
-    [[nodiscard]] const Light&                get_light() const;
-    [[nodiscard]] std::array<glm::vec3, 3>    get_transform() const;
-
-    void modify_polygen(const ck::SceneObjectEdittingCtx* ctx);
-    void modify_light(const ck::SceneObjectEdittingCtx* ctx);
-};
-
-struct SceneObjectEdittingCtx
-{
-    RenderObjectType object_type{RenderObjectType::NULL_OBJECT};
-    std::string      object_name;
-    RenderObject*    parent_object{nullptr};
-
-    std::shared_ptr<Model>  model{nullptr};
-    LightAttributes*        light_attributes{nullptr};
-    std::shared_ptr<Shader> shader{nullptr};
-
-    // transformation
-    glm::vec3* postion{nullptr};
-    glm::vec3* rotation{nullptr};
-    glm::vec3* scale{nullptr};
-
-    RenderDrawType draw_type{RenderDrawType::NULL_TYPE};
+    Renderable(RenderObjectType               _object_type,
+               const std::shared_ptr<Model>&  _model,
+               const std::shared_ptr<Shader>& _shader,
+               RenderDrawType                 _draw_type);
+    ~Renderable();
+
+    Renderable(const Renderable&)            = delete;
+    Renderable& operator=(const Renderable&) = delete;
+    Renderable(Renderable&& other) noexcept;
+    Renderable& operator=(Renderable&& other) noexcept;
+
+    /// @brief 把每个网格作为一个DrawPacket放进渲染队列
+    /// @param renderable_index 在EntityRegistry的紧密数组中的下标
+    void enqueue(RenderQueue&                    queue,
+                 uint32_t                        renderable_index,
+                 const glm::mat4&                world_matrix,
+                 const RenderingSceneSettingCtx* ctx) const;
+    /// @brief 设置相机相关的uniform，同一个shader每帧只需要设置一次
+    void apply_view_uniforms(const RenderingSceneSettingCtx* ctx) const;
+    /// @brief 设置物体相关的uniform（非实例化绘制）
+    /// @param light 灯光物体的灯光组件，几何体传nullptr
+    void apply_object_uniforms(const glm::mat4&                world_matrix,
+                               const Light*                    light,
+                               const RenderingSceneSettingCtx* ctx) const;
+    /// @brief 设置实例化绘制的uniform，model矩阵从InstanceBuffer中读取
+    void apply_instancing_uniforms(uint32_t                        instance_base,
+                                   const glm::mat4&                world_matrix,
+                                   const RenderingSceneSettingCtx* ctx) const;
+    /// @brief 设置间接绘制的uniform，实例和反量化参数从IndirectDrawBuffer中读取
+    /// @param draw_base 这次glMultiDrawElementsIndirect的第一条命令
+    void apply_indirect_uniforms(uint32_t                        draw_base,
+                                 const glm::mat4&                world_matrix,
+                                 const RenderingSceneSettingCtx* ctx) const;
+
+    void set_model(const std::shared_ptr<Model>& _model);
+    void set_shader(const std::shared_ptr<Shader>& _shader);
+    void set_draw_type(RenderDrawType _draw_type);
+    void set_bounds_proxy(uint32_t proxy);
+
+    [[nodiscard]] RenderObjectType get_object_type() const;
+    [[nodiscard]] uint32_t         get_instance_slot() const;
+    [[nodiscard]] uint32_t         get_bounds_proxy() const;
+    [[nodiscard]] RenderDrawType   get_draw_type() const;
+    [[nodiscard]] const Model*     get_model() const;
+    [[nodiscard]] bool             is_translucent() const;
+    /// @brief 几何体并且shader支持实例化时，可以和其他物体合批
+    [[nodiscard]] bool is_instanceable() const;
+    /// @brief 可以合批并且shader支持间接绘制时，可以和其他批次一起用glMultiDrawElementsIndirect提交
+    [[nodiscard]] bool is_indirect_drawable() const;
 };
 
-};  // namespace ck
\ No newline at end of file
+};  // namespace ck
@@ -0,0 +1,309 @@
+#include "render_queue.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "entity_registry.h"
+#include "gpu_culling.h"
+#include "indirect_draw_buffer.h"
+#include "instance_buffer.h"
+#include "mesh_arena.h"
+#include "model.h"
+#include "render_object.h"
+#include "shader.h"
+
+ck::RenderQueue::RenderQueue()
+    : sorted(true), indirect_enabled(true), draw_call_num(0), indirect_command_num(0)
+{
+}
+
+void ck::RenderQueue::clear()
+{
+    packets.clear();
+    sort_entries.clear();
+    sorted               = true;
+    draw_call_num        = 0;
+    indirect_command_num = 0;
+}
+
+void ck::RenderQueue::push(const DrawPacket& packet, const uint64_t sort_key)
+{
+    sort_entries.push_back({sort_key, static_cast<uint32_t>(packets.size())});
+    packets.push_back(packet);
+    sorted = false;
+}
+
+void ck::RenderQueue::sort()
+{
+    if (sorted) { return; }
+    radix_sort();
+    sorted = true;
+}
+
+void ck::RenderQueue::radix_sort()
+{
+    if (sort_entries.empty()) { return; }
+    sort_scratch.resize(sort_entries.size());
+
+    std::array<size_t, 256> counts = {};
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        counts.fill(0);
+        for (const auto& entry : sort_entries)
+        {
+            counts[(entry.key >> shift) & 0xFF]++;
+        }
+        // 所有键在这8位上都相同（常见于pass/shader所在的高位），这一趟不会改变顺序
+        if (counts[(sort_entries.front().key >> shift) & 0xFF] == sort_entries.size()) { continue; }
+
+        size_t offset = 0;
+        for (auto& count : counts)
+        {
+            const size_t bucket_size  = count;
+            count                     = offset;
+            offset                   += bucket_size;
+        }
+        for (const auto& entry : sort_entries)
+        {
+            sort_scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        std::swap(sort_entries, sort_scratch);
+    }
+}
+
+[[nodiscard]] std::pair<size_t, size_t> ck::RenderQueue::find_range(const RenderPass pass,
+                                                                     const bool translucent) const
+{
+    // 排序键的最高5位就是(pass, translucent)
+    const uint64_t bucket =
+        (static_cast<uint64_t>(pass) << 1) | static_cast<uint64_t>(translucent);
+    const auto is_before = [bucket](const SortEntry& entry) {
+        return (entry.key >> SORT_KEY_TRANSLUCENT_SHIFT) < bucket;
+    };
+    const auto is_in_bucket = [bucket](const SortEntry& entry) {
+        return (entry.key >> SORT_KEY_TRANSLUCENT_SHIFT) == bucket;
+    };
+    const auto first = std::partition_point(sort_entries.begin(), sort_entries.end(), is_before);
+    const auto last  = std::partition_point(first, sort_entries.end(), is_in_bucket);
+    return {first - sort_entries.begin(), last - sort_entries.begin()};
+}
+
+[[nodiscard]] bool ck::RenderQueue::can_merge(const DrawBatch&               batch,
+                                              const DrawPacket&              packet,
+                                              const std::vector<Renderable>& renderables) const
+{
+    const Renderable& renderable = renderables[packet.renderable];
+    if (batch.instance_num == 0 || !renderable.is_instanceable()) { return false; }
+    const DrawPacket& first            = packets[batch.packet_index];
+    const Renderable& first_renderable = renderables[first.renderable];
+    return first.shader == packet.shader && first.mesh == packet.mesh &&
+           first_renderable.get_model() == renderable.get_model() &&
+           first_renderable.get_draw_type() == renderable.get_draw_type();
+}
+
+void ck::RenderQueue::build_batches(const size_t          first,
+                                    const size_t          last,
+                                    const EntityRegistry& registry)
+{
+    const std::vector<Renderable>& renderables = registry.get_renderables();
+
+    InstanceBuffer& instance_buffer = InstanceBuffer::get_instance();
+    instance_buffer.clear_indices();
+    batches.clear();
+    for (size_t i = first; i < last; i++)
+    {
+        const uint32_t    packet_index = sort_entries[i].packet_index;
+        const DrawPacket& packet       = packets[packet_index];
+        const Renderable& renderable   = renderables[packet.renderable];
+        if (!batches.empty() && can_merge(batches.back(), packet, renderables))
+        {
+            instance_buffer.push_index(renderable.get_instance_slot());
+            batches.back().instance_num++;
+        }
+        else if (renderable.is_instanceable())
+        {
+            const uint32_t instance_base =
+                instance_buffer.push_index(renderable.get_instance_slot());
+            batches.push_back({packet_index, instance_base, 1, NULL_DRAW_COMMAND});
+        }
+        else { batches.push_back({packet_index, 0, 0, NULL_DRAW_COMMAND}); }
+    }
+    instance_buffer.upload_and_bind();
+}
+
+void ck::RenderQueue::build_indirect_commands(const EntityRegistry&           registry,
+                                              const RenderingSceneSettingCtx* ctx,
+                                              GpuCulling*                     culling)
+{
+    if (!indirect_enabled) { return; }
+    const std::vector<Renderable>& renderables = registry.get_renderables();
+    const std::vector<uint32_t>&   slots       = InstanceBuffer::get_instance().get_indices();
+    const bool                     gpu_culling = culling != nullptr && culling->is_enabled();
+
+    IndirectDrawBuffer& indirect_buffer = IndirectDrawBuffer::get_instance();
+    indirect_buffer.clear();
+    for (auto& batch : batches)
+    {
+        const DrawPacket& packet = packets[batch.packet_index];
+        if (batch.instance_num == 0 || !renderables[packet.renderable].is_indirect_drawable())
+        {
+            continue;
+        }
+        batch.command_index = indirect_buffer.push(
+            packet.mesh->get_allocation(), packet.mesh->get_dequant_box(),
+            packet.mesh->get_bounds(), batch.instance_base, slots.data() + batch.instance_base,
+            batch.instance_num);
+    }
+    if (indirect_buffer.get_command_num() == 0) { return; }
+    indirect_buffer.upload_and_bind(gpu_culling);
+    if (gpu_culling) { culling->cull(indirect_buffer, ctx->projection * ctx->view); }
+    indirect_command_num += static_cast<uint32_t>(indirect_buffer.get_command_num());
+}
+
+[[nodiscard]] bool
+ck::RenderQueue::can_share_multi_draw(const DrawBatch&               first,
+                                      const DrawBatch&               batch,
+                                      const std::vector<Renderable>& renderables) const
+{
+    if (batch.command_index == NULL_DRAW_COMMAND) { return false; }
+    const DrawPacket& first_packet = packets[first.packet_index];
+    const DrawPacket& packet       = packets[batch.packet_index];
+    // 一次调用只能使用一组贴图和一个VAO，天空盒占用的纹理单元也要相同
+    return first_packet.shader == packet.shader &&
+           first_packet.mesh->get_material_key() == packet.mesh->get_material_key() &&
+           first_packet.mesh->get_vertex_format() == packet.mesh->get_vertex_format() &&
+           renderables[first_packet.renderable].get_model()->get_avaliable_texture_slot() ==
+               renderables[packet.renderable].get_model()->get_avaliable_texture_slot();
+}
+
+void ck::RenderQueue::submit(const RenderPass                pass,
+                             const bool                      translucent,
+                             const EntityRegistry&           registry,
+                             const RenderingSceneSettingCtx* ctx,
+                             GpuCulling*                     culling)
+{
+    if (!sorted)
+    {
+        LOG(ERROR) << "render queue must be sorted before submit";
+        return;
+    }
+
+    const auto [first, last] = find_range(pass, translucent);
+    if (first == last) { return; }
+    build_batches(first, last, registry);
+    build_indirect_commands(registry, ctx, culling);
+
+    const std::vector<Renderable>& renderables        = registry.get_renderables();
+    const Shader*                  current_shader     = nullptr;
+    uint32_t                       current_renderable = NULL_ENTITY_INDEX;
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        const DrawBatch&  batch      = batches[b];
+        const DrawPacket& packet     = packets[batch.packet_index];
+        const Renderable& renderable = renderables[packet.renderable];
+        // 相邻的批次大多共享shader，只在切换时重新设置相机相关的uniform
+        if (packet.shader != current_shader)
+        {
+            current_shader     = packet.shader;
+            current_renderable = NULL_ENTITY_INDEX;
+            current_shader->use();
+            renderable.apply_view_uniforms(ctx);
+        }
+        if (batch.command_index != NULL_DRAW_COMMAND)
+        {
+            // 和后面相邻的批次一起，用一次多重绘制提交
+            size_t end = b + 1;
+            while (end < batches.size() && can_share_multi_draw(batch, batches[end], renderables))
+            {
+                end++;
+            }
+            current_renderable = NULL_ENTITY_INDEX;
+            renderable.apply_indirect_uniforms(
+                batch.command_index, registry.get_renderable_world_matrix(packet.renderable), ctx);
+            packet.mesh->bind_textures(*current_shader);
+            MeshArena::get_instance().bind(packet.mesh->get_vertex_format());
+            IndirectDrawBuffer::get_instance().multi_draw(batch.command_index,
+                                                          static_cast<uint32_t>(end - b));
+            draw_call_num++;
+            b = end - 1;
+            continue;
+        }
+        if (batch.instance_num > 0)
+        {
+            current_renderable = NULL_ENTITY_INDEX;
+            renderable.apply_instancing_uniforms(
+                batch.instance_base, registry.get_renderable_world_matrix(packet.renderable), ctx);
+        }
+        else if (packet.renderable != current_renderable)
+        {
+            current_renderable = packet.renderable;
+            renderable.apply_object_uniforms(
+                registry.get_renderable_world_matrix(packet.renderable),
+                registry.get_renderable_light(packet.renderable), ctx);
+        }
+        packet.mesh->draw(*current_shader, std::max(batch.instance_num, 1U));
+        draw_call_num++;
+    }
+}
+
+void ck::RenderQueue::set_indirect_drawing(const bool enabled)
+{
+    indirect_enabled = enabled;
+}
+
+[[nodiscard]] bool ck::RenderQueue::is_indirect_drawing_enabled() const
+{
+    return indirect_enabled;
+}
+
+[[nodiscard]] size_t ck::RenderQueue::get_packet_num() const
+{
+    return packets.size();
+}
+
+[[nodiscard]] uint32_t ck::RenderQueue::get_draw_call_num() const
+{
+    return draw_call_num;
+}
+
+[[nodiscard]] uint32_t ck::RenderQueue::get_indirect_command_num() const
+{
+    return indirect_command_num;
+}
+
+uint64_t ck::RenderQueue::make_sort_key(const RenderPass pass,
+                                        const bool       translucent,
+                                        const uint32_t   shader_id,
+                                        const uint32_t   material_key,
+                                        const uint32_t   mesh_key,
+                                        const float      view_depth,
+                                        const float      near_plane,
+                                        const float      far_plane)
+{
+    // 深度在[near, far]之间线性量化为15位，超出范围的钳制到两端
+    const float    depth_range = std::max(far_plane - near_plane, 1e-6F);
+    const float    normalized  = std::clamp((view_depth - near_plane) / depth_range, 0.0F, 1.0F);
+    const uint64_t max_depth   = (1ULL << SORT_KEY_DEPTH_BITS) - 1;
+    const auto     depth       = static_cast<uint64_t>(normalized * static_cast<float>(max_depth));
+
+    const uint64_t shader   = shader_id & 0xFFFULL;
+    const uint64_t material = material_key & 0xFFFFULL;
+    const uint64_t mesh     = mesh_key & 0xFFFFULL;
+
+    uint64_t key = (static_cast<uint64_t>(pass) << SORT_KEY_PASS_SHIFT);
+    if (translucent)
+    {
+        key |= 1ULL << SORT_KEY_TRANSLUCENT_SHIFT;
+        key |= (max_depth - depth) << 44;  // 由远到近
+        key |= shader << 32 | material << 16 | mesh;
+    }
+    else { key |= shader << 47 | material << 31 | mesh << 15 | depth; }
+    return key;
+}
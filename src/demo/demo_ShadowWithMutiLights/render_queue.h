@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace ck {
+
+class Mesh;
+class Shader;
+class GpuCulling;
+class Renderable;
+class EntityRegistry;
+struct RenderingSceneSettingCtx;
+
+/// @brief 渲染通道，占据排序键的最高位，决定提交的先后顺序
+enum class RenderPass : uint32_t { MAIN = 0, PASS_NUM };
+
+/**NOTE - 64位排序键
+不透明物体：按shader -> 材质（纹理组合）-> 网格 -> 由近到远排序，尽量减少状态切换，同时利用early-Z
+半透明物体：必须由远到近绘制才能正确混合，深度放在shader之前
+
+    | 63..60 | 59          | 58 ............................................. 0 |
+    | pass   | translucent | opaque:      shader(12) material(16) mesh(16) depth(15)   |
+    |        |             | translucent: ~depth(15) shader(12) material(16) mesh(16) |
+*/
+static const uint32_t SORT_KEY_PASS_SHIFT        = 60;
+static const uint32_t SORT_KEY_TRANSLUCENT_SHIFT = 59;
+static const uint32_t SORT_KEY_DEPTH_BITS        = 15;
+static const uint32_t NULL_DRAW_COMMAND          = 0xFFFFFFFF;
+
+/// @brief 一次绘制需要的全部信息，一个网格对应一个packet
+struct DrawPacket
+{
+    uint32_t      renderable;  // 在EntityRegistry::get_renderables()中的下标
+    const Shader* shader;
+    const Mesh*   mesh;
+};
+
+/// @brief 渲染队列：收集场景中的绘制请求，按排序键基数排序后再统一提交
+/**NOTE - 自动实例化
+排序后，相同(shader, 网格, 绘制类型)的packet自然相邻，提交时把连续的一段合并成一个批次，
+用一次glDrawElementsInstanced画完，model矩阵从InstanceBuffer中按槽位读取。
+只合并相邻的packet，半透明物体由远到近的顺序不会被打乱。
+*/
+/**NOTE - 间接绘制（可选）
+打开后，每个实例化批次变成IndirectDrawBuffer中的一条绘制命令；
+相邻的、shader、材质、顶点格式都相同的批次用一次glMultiDrawElementsIndirect提交。
+排序键中shader和材质在网格之前，同一材质的所有网格自然相邻，
+不透明通道的提交次数从“批次数”降到“shader × 材质数”。
+不支持间接绘制的shader和不能合批的物体（比如灯光）仍然按原来的方式逐个提交。
+提交时传入GpuCulling，间接绘制的实例先在GPU上剔除一遍，见 gpu_culling.h。
+*/
+class RenderQueue {
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t packet_index;
+    };
+
+    struct DrawBatch
+    {
+        uint32_t packet_index;   // 批次中第一个packet
+        uint32_t instance_base;  // 在实例索引数组中的起始位置
+        uint32_t instance_num;   // 为0表示不走实例化，按普通方式绘制
+        uint32_t command_index;  // 间接绘制命令，NULL_DRAW_COMMAND表示不走间接绘制
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<SortEntry>  sort_entries;
+    std::vector<SortEntry>  sort_scratch;  // 基数排序的双缓冲
+    std::vector<DrawBatch>  batches;
+    bool                    sorted;
+    bool                    indirect_enabled;
+    uint32_t                draw_call_num;         // 本帧提交的绘制调用数量
+    uint32_t                indirect_command_num;  // 本帧间接绘制的命令数量
+
+    void build_batches(size_t first, size_t last, const EntityRegistry& registry);
+    [[nodiscard]] bool can_merge(const DrawBatch&               batch,
+                                 const DrawPacket&              packet,
+                                 const std::vector<Renderable>& renderables) const;
+    /// @brief 为可以间接绘制的批次生成绘制命令并上传，culling不为空时在GPU上剔除实例
+    void build_indirect_commands(const EntityRegistry&           registry,
+                                 const RenderingSceneSettingCtx* ctx,
+                                 GpuCulling*                     culling);
+    /// @brief batch能否和first在同一次glMultiDrawElementsIndirect中提交
+    [[nodiscard]] bool can_share_multi_draw(const DrawBatch&               first,
+                                            const DrawBatch&               batch,
+                                            const std::vector<Renderable>& renderables) const;
+
+    /// @brief 按8位一组做LSD基数排序，所有键在某一组上都相同时跳过这一趟
+    void radix_sort();
+
+    /// @brief 已排序的队列中属于(pass, translucent)的区间[first, second)
+    [[nodiscard]] std::pair<size_t, size_t> find_range(RenderPass pass, bool translucent) const;
+
+public:
+    RenderQueue();
+
+    /// @brief 每帧开始时清空队列（保留已分配的内存）
+    void clear();
+
+    void push(const DrawPacket& packet, uint64_t sort_key);
+
+    void sort();
+
+    /// @brief 提交一个通道中所有不透明/半透明的packet，需要先调用sort()
+    /// @note 不透明和半透明分开提交，中间可以插入天空盒等其他绘制
+    /// @param culling 不为空且已打开时，间接绘制的实例先经过GPU剔除
+    void submit(RenderPass                      pass,
+                bool                            translucent,
+                const EntityRegistry&           registry,
+                const RenderingSceneSettingCtx* ctx,
+                GpuCulling*                     culling = nullptr);
+
+    /// @brief 打开/关闭间接绘制
+    void set_indirect_drawing(bool enabled);
+
+    [[nodiscard]] bool     is_indirect_drawing_enabled() const;
+    [[nodiscard]] size_t   get_packet_num() const;
+    [[nodiscard]] uint32_t get_draw_call_num() const;
+    [[nodiscard]] uint32_t get_indirect_command_num() const;
+
+    /// @param view_depth 观察空间中的深度（到相机平面的距离）
+    static uint64_t make_sort_key(RenderPass pass,
+                                  bool       translucent,
+                                  uint32_t   shader_id,
+                                  uint32_t   material_key,
+                                  uint32_t   mesh_key,
+                                  float      view_depth,
+                                  float      near_plane,
+                                  float      far_plane);
+};
+
+};  // namespace ck
@@ -1,6 +1,8 @@
 #include "scene.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include <algorithm>
 #include <array>
@@ -12,14 +14,26 @@
 #include <stb_image.h>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "asset_registry.h"
+#include "bounds.h"
+#include "bvh.h"
 #include "camera.h"
+#include "clustered_lighting.h"
+#include "entity_registry.h"
+#include "core/ck_cpu_profiler.h"
 #include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "core/ck_gpu_profiler.h"
+#include "gpu_culling.h"
 #include "imgui_glfw_window_base.h"
 #include "light.h"
 #include "model.h"
 #include "render_object.h"
 #include "shader.h"
+#include "shadow_atlas.h"
+#include "texture_loader.h"
 
 extern const std::string stdAsset_root;
 /**FIXME - 错题本：多个文件中共享const对象
@@ -34,7 +48,7 @@ extern const std::string stdAsset_root;
 */
 
 ck::SkyBoxObject::SkyBoxObject()
-    : skyBox_texture(0), pureWhite_skyBox_texture(0), skyBox_color(1.0F),
+    : skyBox_color(1.0F),
       skyBox_shader(stdAsset_root + "stdShader/stdSkyboxShader.vs.glsl",
                     stdAsset_root + "stdShader/stdSkyboxShader.fs.glsl"),
       skyBox_model(stdAsset_root + "stdModel/box/box.obj")
@@ -44,18 +58,16 @@ ck::SkyBoxObject::SkyBoxObject()
     用户可以自己添加天空盒，或者使用默认的。
     */
     create_skyBox_texture_from_file(pureWhite_skyBox_texture, stdAsset_root + "stdTexture/skybox/");
-}
 
-ck::SkyBoxObject::~SkyBoxObject()
-{
-    glDeleteTextures(1, &pureWhite_skyBox_texture);
-    if (skyBox_texture != 0) { glDeleteTextures(1, &skyBox_texture); }
+    view_uniform       = skyBox_shader.get_uniform<glm::mat4>("view");
+    projection_uniform = skyBox_shader.get_uniform<glm::mat4>("projection");
+    skybox_uniform     = skyBox_shader.get_uniform<int>("skybox");
 }
 
 [[nodiscard]] uint32_t ck::SkyBoxObject::get_skyBox_texture() const
 {
-    if (skyBox_texture == 0) { return pureWhite_skyBox_texture; }
-    return skyBox_texture;
+    if (!skyBox_texture.is_valid()) { return pureWhite_skyBox_texture.get(); }
+    return skyBox_texture.get();
 }
 
 [[nodiscard]] glm::vec3 ck::SkyBoxObject::get_skyBox_color() const
@@ -63,11 +75,12 @@ ck::SkyBoxObject::~SkyBoxObject()
     return skyBox_color;
 }
 
-void ck::SkyBoxObject::create_skyBox_texture_from_file(uint32_t&          target_texture,
+void ck::SkyBoxObject::create_skyBox_texture_from_file(GLTexture&         target_texture,
                                                        const std::string& image_folder)
 {
-    glGenTextures(1, &target_texture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, target_texture);
+    target_texture.create("skybox cubemap", image_folder);
+    GLStateCache::get_instance().bind_texture(0, GL_TEXTURE_CUBE_MAP, target_texture.get());
+    size_t bytes = 0;
     std::vector<std::string> cubeTexture_names = {"right.jpg",  "left.jpg",  "top.jpg",
                                                   "bottom.jpg", "front.jpg", "back.jpg"};
     for (int i = 0; i < 6; i++)
@@ -82,6 +95,7 @@ void ck::SkyBoxObject::create_skyBox_texture_from_file(uint32_t&          target
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_SRGB, width, height, 0, GL_RGB,
                          GL_UNSIGNED_BYTE, data);
+            bytes += static_cast<size_t>(width) * height * 4;  // RGB通常按RGBA存储
             // 设置纹理属性
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -92,50 +106,39 @@ void ck::SkyBoxObject::create_skyBox_texture_from_file(uint32_t&          target
         else { LOG(WARNING) << "Failed to load texture: " << cubeTexture_path; }
         stbi_image_free(data);
     }
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);  // 解绑
+    GLStateCache::get_instance().bind_texture(0, GL_TEXTURE_CUBE_MAP, 0);  // 解绑
+    target_texture.set_bytes(bytes);
 }
 
 void ck::SkyBoxObject::load_skyBox_texture_from_file(const std::string& image_folder)
 {
-    if (skyBox_texture != 0) { glDeleteTextures(1, &skyBox_texture); }
-    create_skyBox_texture_from_file(skyBox_texture, image_folder);
+    create_skyBox_texture_from_file(skyBox_texture, image_folder);  // 删除原来的纹理
 }
 
 void ck::SkyBoxObject::draw(const RenderingSceneSettingCtx* ctx) const
 {
-    glFrontFace(GL_CW);  // 把顺时针的面设置为“正面”。
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    gl_state.set_front_face(GL_CW);  // 把顺时针的面设置为“正面”。
     skyBox_shader.use();
-    skyBox_shader.setParameter("view",
+    skyBox_shader.setParameter(view_uniform,
                                glm::mat4(glm::mat3(ctx->view)));  // 除去位移，相当于锁头
-    skyBox_shader.setParameter("projection", ctx->projection);
+    skyBox_shader.setParameter(projection_uniform, ctx->projection);
 
     // sky box texture
     int32_t skyBox_texture_slot = skyBox_model.get_avaliable_texture_slot();
-    glActiveTexture(GL_TEXTURE0 + skyBox_texture_slot);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skyBox_texture);
-    skyBox_shader.setParameter("skybox", skyBox_texture_slot);
+    gl_state.bind_texture(skyBox_texture_slot, GL_TEXTURE_CUBE_MAP, skyBox_texture.get());
+    skyBox_shader.setParameter(skybox_uniform, skyBox_texture_slot);
 
     skyBox_model.draw(skyBox_shader);
-    glFrontFace(GL_CCW);
+    gl_state.set_front_face(GL_CCW);
     GL_CHECK();
 }
 
 ck::Scene::Scene()
-    : camera(new Camera(glm::vec3(0.0F, 0.5F, -5.0F))), skyBox(new SkyBoxObject()),
-      scene_root(new RenderObject(RenderObjectType::NULL_OBJECT, "root"))
-{
-    objects.push_back(scene_root);  // 创建Scene默认的Root节点
-}
-
-void ck::Scene::add_model_prototype(const std::string& model_file_path)
+    : camera(new Camera(glm::vec3(0.0F, 0.5F, -5.0F))), skyBox(new SkyBoxObject())
 {
-    model_prototypes.emplace_back(std::make_shared<Model>(model_file_path));
-}
-
-void ck::Scene::add_shader_prototype(const std::array<std::string, 3>& shader_file_path)
-{
-    shader_prototypes.emplace_back(
-        std::make_shared<Shader>(shader_file_path[0], shader_file_path[1], shader_file_path[2]));
+    // 创建Scene默认的Root节点
+    scene_root = registry.create(RenderObjectType::NULL_OBJECT, "root", EntityHandle());
 }
 
 std::unique_ptr<ck::Scene> ck::Scene::singleton = nullptr;
@@ -158,86 +161,40 @@ ck::Scene& ck::Scene::get_instance()
     */
 }
 
-std::shared_ptr<ck::RenderObject>&
-ck::Scene::add_model_from_file(const std::string&                model_file_path,
-                               const std::array<std::string, 3>& shader_file_path,
-                               const std::string&                object_name)
+ck::EntityHandle ck::Scene::add_model_from_file(const std::string&                model_file_path,
+                                                const std::array<std::string, 3>& shader_file_path,
+                                                const std::string&                object_name)
 {
-    // 在model_prototypes中查找是否有对应的model
-    auto model_it = model_prototypes.begin();
-    for (; model_it != model_prototypes.end(); model_it++)
-    {
-        if ((*model_it)->get_load_path() == model_file_path) { break; }
-    }
-    if (model_it == model_prototypes.end())
-    {
-        // 如果没有找到，则创建一个新的model
-        add_model_prototype(model_file_path);
-        model_it = model_prototypes.end() - 1;  // 新添加的一定在末尾
-    }
-
-    // 同理，shader
-    auto shader_it = shader_prototypes.begin();
-    for (; shader_it != shader_prototypes.end(); shader_it++)
-    {
-        if ((*shader_it)->get_load_path() == shader_file_path) { break; }
-    }
-    if (shader_it == shader_prototypes.end())
-    {
-        // 如果没有找到，则创建一个新的model
-        add_shader_prototype(shader_file_path);
-        shader_it = shader_prototypes.end() - 1;  // 新添加的一定在末尾
-    }
-
-    // 创建object
-    objects.emplace_back(std::make_shared<RenderObject>(RenderObjectType::POLYGEN_MESH, object_name,
-                                                        *model_it, Light(-1), *shader_it,
-                                                        scene_root.get(), RenderDrawType::NORMAL));
-    scene_root->get_children().push_back(objects.back().get());  // 向scene_root添加子节点
-    return objects.back();
+    // 从assets中获取原型，没有时才加载
+    const std::shared_ptr<Model>  model  = assets.acquire_model(model_file_path);
+    const std::shared_ptr<Shader> shader = assets.acquire_shader(shader_file_path);
+
+    // 创建object，挂在scene_root下
+    const EntityHandle object =
+        registry.create(RenderObjectType::POLYGEN_MESH, object_name, scene_root);
+    registry.add_renderable(object, model, shader, RenderDrawType::NORMAL);
+    return object;
     /**FIXME - 错题本
     Access violation reading location 0xFFFFFFFFFFFFFFFF.
     std::vector容器是会更改位置的，所以之前拿到的指向容器元素的指针，不能保证未来仍然有效
 
     * NOTE - 修改方案：
-    std::vector<RenderObject>            objects;
-    std::vector<std::shared_ptr<RenderObject>>            objects;
+    不再对外发放指针，而是发放EntityHandle（下标 + 代数），组件数组扩容后句柄仍然有效
     */
 }
 
-std::shared_ptr<ck::RenderObject>& ck::Scene::add_light(std::string      object_name,
-                                                        const ck::Light& light)
+ck::EntityHandle ck::Scene::add_light(std::string object_name, const ck::Light& light)
 {
-    // 在model_prototypes中查找是否有对应的model
-    auto model_it = model_prototypes.begin();
-    for (; model_it != model_prototypes.end(); model_it++)
-    {
-        if ((*model_it)->get_load_path() == defualt_light_model_path) { break; }
-    }
-    if (model_it == model_prototypes.end())  // 如果没有找到，则创建一个新的model
-    {
-        add_model_prototype(defualt_light_model_path);
-        model_it = model_prototypes.end() - 1;  // 新添加的一定在末尾
-    }
+    // 灯光默认的model和shader
+    const std::shared_ptr<Model>  model  = assets.acquire_model(defualt_light_model_path);
+    const std::shared_ptr<Shader> shader = assets.acquire_shader(defualt_light_shader_path);
 
-    // 同理，shader
-    auto shader_it = shader_prototypes.begin();
-    for (; shader_it != shader_prototypes.end(); shader_it++)
-    {
-        if ((*shader_it)->get_load_path() == defualt_light_shader_path) { break; }
-    }
-    if (shader_it == shader_prototypes.end())  // 如果没有找到，则创建一个新的model
-    {
-        add_shader_prototype(defualt_light_shader_path);
-        shader_it = shader_prototypes.end() - 1;  // 新添加的一定在末尾
-    }
-
-    objects.emplace_back(std::make_shared<RenderObject>(
-        RenderObjectType::LIGHT, std::move(object_name), *model_it, light, *shader_it,
-        scene_root.get(), RenderDrawType::NORMAL));
     // 向scene_root添加子节点
-    scene_root->get_children().push_back(objects.back().get());
-    return objects.back();
+    const EntityHandle object =
+        registry.create(RenderObjectType::LIGHT, std::move(object_name), scene_root);
+    registry.add_renderable(object, model, shader, RenderDrawType::NORMAL);
+    registry.add_light(object, light);
+    return object;
 
     /**FIXME - 问题记录：灯光渲染不出来
     因为render object的model矩阵的计算是根据RenderObject::position计算的，
@@ -249,64 +206,136 @@ std::shared_ptr<ck::RenderObject>& ck::Scene::add_light(std::string      object_
      */
 }
 
-void ck::Scene::modify_object(const std::shared_ptr<ck::RenderObject>& object_ptr,
-                              const ck::SceneObjectEdittingCtx*        ctx)
+std::vector<ck::EntityHandle> ck::Scene::add_models(const std::vector<SceneObjectDesc>& descs)
+{
+    std::vector<EntityHandle> objects;
+    objects.reserve(descs.size());
+    registry.reserve(registry.get_entity_num() + descs.size(),
+                     registry.get_renderables().size() + descs.size(),
+                     registry.get_lights().size());
+
+    for (const SceneObjectDesc& desc : descs)
+    {
+        const EntityHandle parent =
+            registry.is_alive(desc.parent_object) ? desc.parent_object : scene_root;
+        const EntityHandle object =
+            registry.create(RenderObjectType::POLYGEN_MESH, desc.object_name, parent);
+        registry.add_renderable(object, assets.acquire_model(desc.model_file_path),
+                                assets.acquire_shader(desc.shader_file_path),
+                                RenderDrawType::NORMAL);
+
+        Transform& transform = registry.edit_transform(object);
+        transform.set_position(desc.postion);
+        transform.set_rotation(desc.rotation);
+        transform.set_scale(desc.scale);
+        objects.push_back(object);
+    }
+    LOG(INFO) << "added " << descs.size() << " objects, " << assets.get_model_num()
+              << " model prototypes, " << assets.get_shader_num() << " shader prototypes";
+    return objects;
+}
+
+void ck::Scene::modify_object(const EntityHandle object, const ck::SceneObjectEdittingCtx* ctx)
 {
-    if (!object_ptr)
+    if (!registry.is_alive(object))
     {
-        LOG(WARNING) << "object_ptr is nullptr!";
+        LOG(WARNING) << "object is not alive!";
         return;
     }
-    if (ctx->object_type == RenderObjectType::NULL_OBJECT)
+    if (ctx->object_type == RenderObjectType::NULL_OBJECT || object == scene_root)
     {
         LOG(ERROR) << "NULL object or Scene root object cannot be modified!";
         return;
     }
-
-    bool find_matched_object = false;
-    bool find_matched_parent = false;
-    for (const auto& object : objects)
+    if (!ctx->parent_object.is_null() && !registry.is_alive(ctx->parent_object))
     {
-        if (object_ptr == object) { find_matched_object = true; }
-        if (ctx->parent_object != nullptr && ctx->parent_object == object.get())
-        {
-            find_matched_parent = true;
-        }
+        LOG(WARNING) << "parent_object is not alive!";
+        return;
     }
-    if (!find_matched_object)
+    if (ctx->object_type != registry.get_type(object))
     {
-        LOG(WARNING) << "object_ptr is not a member of objects!";
+        LOG(ERROR) << "object type mismatch!";
         return;
     }
-    if (ctx->parent_object != nullptr && !find_matched_parent)
+
+    // 设置共有属性
+    // general
+    if (!ctx->object_name.empty()) { registry.set_name(object, ctx->object_name); }
+    if (!ctx->parent_object.is_null() && !registry.set_parent(object, ctx->parent_object))
     {
-        LOG(WARNING) << "parent_object is not a member of objects!";
         return;
     }
 
-    if (ctx->object_type != object_ptr->get_object_type())
+    // transformation
+    if (ctx->postion != nullptr || ctx->rotation != nullptr || ctx->scale != nullptr)
     {
-        LOG(ERROR) << "object type mismatch!";
-        return;
+        Transform& transform = registry.edit_transform(object);
+        if (ctx->postion != nullptr) { transform.set_position(*(ctx->postion)); }
+        if (ctx->rotation != nullptr) { transform.set_rotation(*(ctx->rotation)); }
+        if (ctx->scale != nullptr) { transform.set_scale(*(ctx->scale)); }
     }
 
     switch (ctx->object_type)
     {
         case RenderObjectType::POLYGEN_MESH: {
-            object_ptr->modify_polygen(ctx);
+            Renderable* renderable = registry.find_renderable(object);
+            if (renderable == nullptr) { break; }
+            if (ctx->model)
+            {
+                renderable->set_model(ctx->model);
+                registry.edit_transform(object).mark_world_dirty();  // 模型变了，重新计算包围盒
+            }
+            if (ctx->shader) { renderable->set_shader(ctx->shader); }
+            if (ctx->draw_type != RenderDrawType::NULL_TYPE)
+            {
+                renderable->set_draw_type(ctx->draw_type);
+            }
             break;
         }
         case RenderObjectType::LIGHT: {
-            object_ptr->modify_light(ctx);
+            if (ctx->light_attributes == nullptr) { break; }
+            Light* light = registry.edit_light(object);  // 标记为脏，下一次更新灯光UBO时重写
+            if (light != nullptr)
+            {
+                *light = Light(ctx->light_attributes->light_type, ctx->light_attributes->color,
+                               ctx->light_attributes->intensity,
+                               ctx->light_attributes->inner_cutOff,
+                               ctx->light_attributes->outer_cutOff);
+            }
             break;
         }
         default: break;
     }
 }
 
-[[nodiscard]] std::vector<std::shared_ptr<ck::RenderObject>>& ck::Scene::get_scene_objects()
+void ck::Scene::remove_object(const EntityHandle object)
 {
-    return objects;
+    if (object == scene_root)
+    {
+        LOG(ERROR) << "Scene root object cannot be removed!";
+        return;
+    }
+    registry.destroy(object);
+}
+
+[[nodiscard]] ck::AssetRegistry& ck::Scene::get_assets()
+{
+    return assets;
+}
+
+[[nodiscard]] ck::EntityRegistry& ck::Scene::get_registry()
+{
+    return registry;
+}
+
+[[nodiscard]] const ck::EntityRegistry& ck::Scene::get_registry() const
+{
+    return registry;
+}
+
+[[nodiscard]] ck::EntityHandle ck::Scene::get_scene_root() const
+{
+    return scene_root;
 }
 
 ck::SkyBoxObject& ck::Scene::get_skyBox()
@@ -319,12 +348,126 @@ ck::Camera& ck::Scene::get_camera()
     return *camera;
 }
 
-void ck::Scene::draw(const ImguiGlfwWindowBase& window) const
+[[nodiscard]] const ck::RenderQueue& ck::Scene::get_render_queue() const
+{
+    return render_queue;
+}
+
+[[nodiscard]] const ck::CullingStats& ck::Scene::get_culling_stats() const
+{
+    return culling_stats;
+}
+
+[[nodiscard]] ck::ClusteredLighting& ck::Scene::get_clustered_lighting()
+{
+    return clustered_lighting;
+}
+
+[[nodiscard]] ck::ShadowAtlas& ck::Scene::get_shadow_atlas()
+{
+    return shadow_atlas;
+}
+
+[[nodiscard]] ck::GpuCulling& ck::Scene::get_gpu_culling()
+{
+    return gpu_culling;
+}
+
+[[nodiscard]] bool ck::Scene::is_frustum_culling_enabled() const
+{
+    return frustum_culling_enabled;
+}
+
+void ck::Scene::set_frustum_culling(const bool enabled)
+{
+    frustum_culling_enabled = enabled;
+}
+
+[[nodiscard]] bool ck::Scene::is_indirect_drawing_enabled() const
+{
+    return render_queue.is_indirect_drawing_enabled();
+}
+
+void ck::Scene::set_indirect_drawing(const bool enabled)
+{
+    render_queue.set_indirect_drawing(enabled);
+}
+
+void ck::Scene::invalidate_shadows(const AABB& bounds)
+{
+    // 一直没有draw()时（比如只更新变换的基准测试）不让列表无限增长，合并成一个包围盒
+    static const size_t MAX_SHADOW_INVALIDATION_NUM = 1024;
+    if (shadow_invalidations.size() >= MAX_SHADOW_INVALIDATION_NUM)
+    {
+        AABB merged = bounds;
+        for (const AABB& invalidation : shadow_invalidations)
+        {
+            merged.expand(invalidation);
+        }
+        shadow_invalidations.assign(1, merged);
+        return;
+    }
+    shadow_invalidations.push_back(bounds);
+}
+
+void ck::Scene::update_transforms()
+{
+    registry.update_transforms();
+
+    // 被删除的物体：原来投下的阴影需要擦掉
+    for (const uint32_t proxy : registry.get_released_bounds_proxies())
+    {
+        invalidate_shadows(bvh.get_fat_bounds(proxy));
+        bvh.destroy_proxy(proxy);
+    }
+    registry.clear_released_bounds_proxies();
+
+    // 移动过的物体：包围盒还在胖包围盒内时，move_proxy不会改动树
+    for (const uint32_t entity_index : registry.get_moved_entities())
+    {
+        const uint32_t renderable_index = registry.get_renderable_index(entity_index);
+        if (renderable_index == NULL_ENTITY_INDEX) { continue; }  // 之后又被删除了
+
+        Renderable&  renderable = registry.get_renderable(renderable_index);
+        const Model* model      = renderable.get_model();
+        if (model == nullptr || model->get_bounds().is_empty()) { continue; }  // 没有可画的网格
+
+        const AABB world_bounds = model->get_bounds().transformed(
+            registry.get_renderable_world_matrix(renderable_index));
+        const bool casts_shadow = renderable.get_object_type() == RenderObjectType::POLYGEN_MESH;
+        if (renderable.get_bounds_proxy() == NULL_BVH_NODE)
+        {
+            renderable.set_bounds_proxy(bvh.create_proxy(world_bounds, entity_index));
+        }
+        else
+        {
+            // 移动前的位置：原来的阴影需要擦掉
+            const uint32_t proxy = renderable.get_bounds_proxy();
+            if (casts_shadow) { invalidate_shadows(bvh.get_fat_bounds(proxy)); }
+            bvh.move_proxy(proxy, world_bounds);
+        }
+        if (casts_shadow) { invalidate_shadows(world_bounds); }
+    }
+    registry.clear_moved_entities();
+}
+
+void ck::Scene::draw(const ImguiGlfwWindowBase& window)
 {
-    // view and projection
     int32_t window_width  = 0;
     int32_t window_height = 0;
     glfwGetFramebufferSize(window.get_window(), &window_width, &window_height);
+    draw(static_cast<uint32_t>(window_width), static_cast<uint32_t>(window_height));
+}
+
+void ck::Scene::draw(const uint32_t width, const uint32_t height)
+{
+    CK_PROFILE_SCOPE("Scene::draw");
+    CK_GPU_PROFILE_SCOPE("scene");
+    update_transforms();
+
+    // view and projection
+    const auto  window_width  = static_cast<int32_t>(width);
+    const auto  window_height = static_cast<int32_t>(height);
     const float camera_aspect_ratio =
         static_cast<float>(window_width) / static_cast<float>(window_height);
 
@@ -336,105 +479,243 @@ void ck::Scene::draw(const ImguiGlfwWindowBase& window) const
     ctx.skyBox_texture           = skyBox->get_skyBox_texture();
     ctx.skyBox_color             = skyBox->get_skyBox_color();
 
+    // 结算上一帧的状态切换计数
+    GLStateCache::get_instance().begin_frame();
+
+    // 上传工作线程已经解码完成的纹理
+    TextureLoader::get_instance().process_uploads();
+
+    // 读回几帧之前的GPU剔除统计
+    gpu_culling.begin_frame();
+
+    // 阴影：只重新渲染失效的tile，之后恢复目标帧缓冲的视口
+    {
+        CK_GPU_PROFILE_SCOPE("shadows");
+        shadow_atlas.update(registry, bvh, shadow_invalidations, ctx,
+                            static_cast<uint32_t>(window_height));
+        shadow_invalidations.clear();
+        shadow_atlas.upload_and_bind();
+        glViewport(0, 0, window_width, window_height);
+    }
+
+    // 分簇光照：灯光的世界坐标在update_transforms()之后才是最新的
+    {
+        CK_GPU_PROFILE_SCOPE("clustered lighting");
+        clustered_lighting.update(registry, ctx.view, ctx.projection, camera->get_near_plane(),
+                                  camera->get_far_plane(), static_cast<uint32_t>(window_width),
+                                  static_cast<uint32_t>(window_height),
+                                  &shadow_atlas.get_light_shadow_indices());
+        clustered_lighting.upload_and_bind();
+    }
+
     // clear
     glClearColor(ctx.skyBox_color[0], ctx.skyBox_color[1], ctx.skyBox_color[2], 1.0F);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    for (const auto& object : objects)
+    // 收集 -> 排序 -> 提交
+    render_queue.clear();
+    const std::vector<Renderable>& renderables = registry.get_renderables();
+    if (frustum_culling_enabled)
     {
-        if (object->get_object_type() != RenderObjectType::NULL_OBJECT) { object->draw(&ctx); }
+        bvh.query(Frustum(ctx.projection * ctx.view), visible_entities, culling_stats);
+        for (const uint32_t entity_index : visible_entities)
+        {
+            const uint32_t i = registry.get_renderable_index(entity_index);
+            if (i == NULL_ENTITY_INDEX) { continue; }
+            renderables[i].enqueue(render_queue, i, registry.get_renderable_world_matrix(i), &ctx);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < renderables.size(); i++)
+        {
+            renderables[i].enqueue(render_queue, i, registry.get_renderable_world_matrix(i), &ctx);
+        }
+        culling_stats = {0, 0, static_cast<uint32_t>(renderables.size())};
+    }
+    render_queue.sort();
+    {
+        CK_GPU_PROFILE_SCOPE("opaque");
+        render_queue.submit(RenderPass::MAIN, false, registry, &ctx, &gpu_culling);
+    }
+    // 不透明物体的深度就是下一帧的遮挡体
+    gpu_culling.build_hiz(static_cast<uint32_t>(window_width),
+                          static_cast<uint32_t>(window_height), ctx.projection * ctx.view);
+    {
+        CK_GPU_PROFILE_SCOPE("skybox");
+        skyBox->draw(&ctx);  // 在不透明物体之后渲染天空盒
+    }
+    {
+        // 半透明物体最后由远到近绘制
+        CK_GPU_PROFILE_SCOPE("translucent");
+        render_queue.submit(RenderPass::MAIN, true, registry, &ctx);
     }
-
-    skyBox->draw(&ctx);  // 最后渲染天空盒
     GL_CHECK();
 }
 
-ck::SceneLightUBOManager::SceneLightUBOManager() : scene(&Scene::get_instance()), lights_UBO(0) {}
-
-void ck::SceneLightUBOManager::create_light_UBO()
+int32_t ck::SceneLightUBOManager::calculate_memory_occupation() const
 {
-    // 如果已经存在一个buffer，首先删除它
-    if (lights_UBO != 0)
-    {
-        glDeleteBuffers(1, &lights_UBO);
-        lights_UBO = 0;
-    }
+    return MAX_LIGHTS_SUPPORTED * Light::calculate_memory_occupancy();
+}
 
-    glGenBuffers(1, &lights_UBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, lights_UBO);
+ck::SceneLightUBOManager::SceneLightUBOManager()
+    : scene(&Scene::get_instance()), mapped_ptr(nullptr), region_size(0), region(0),
+      binding_point(0), region_fences{}, pending_writes{}, header_pending_writes(0),
+      light_num(0)
+{
+}
 
-    // 计算灯光组占据的内存空间（以Byte为单位）
-    glBufferData(GL_UNIFORM_BUFFER, calculate_memory_occupation() + 16, nullptr, GL_STATIC_DRAW);
-    // NOTE - 这里出GL_STATIC_DRAW，暂且认为灯光的数据初始化后不再修改。
-    // FIXME - +16意味着缓冲的前4B是int型的灯光数量，但是要对齐到16B
+ck::SceneLightUBOManager::~SceneLightUBOManager()
+{
+    shutdown();
+}
 
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);  // 解绑
+void ck::SceneLightUBOManager::shutdown()
+{
+    for (GLsync& fence : region_fences)
+    {
+        if (fence != nullptr) { glDeleteSync(fence); }
+        fence = nullptr;
+    }
+    lights_UBO.reset();  // 持久映射的缓冲可以直接删除，不需要先解除映射
+    mapped_ptr = nullptr;
+}
 
-    update_light_UBO();  // 更新灯光组数据}
+void ck::SceneLightUBOManager::create_light_UBO()
+{
+    // 如果已经存在一个buffer，首先删除它
+    shutdown();
+
+    // 每个区域 = 16B头部（int型的灯光数量，对齐到16B）+ 灯光数组，起点需要满足UBO的偏移对齐
+    GLint offset_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+    const auto alignment = static_cast<size_t>(std::max(offset_alignment, 1));
+    const auto data_size = sizeof(LightGroupHeader) + calculate_memory_occupation();
+    region_size          = (data_size + alignment - 1) / alignment * alignment;
+
+    lights_UBO.create("light group UBO", "SceneLightUBOManager");
+    GLStateCache::get_instance().bind_buffer(GL_UNIFORM_BUFFER, lights_UBO.get());
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const auto       size  = static_cast<GLsizeiptr>(region_size * LIGHT_UBO_REGION_NUM);
+    glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+    lights_UBO.set_bytes(region_size * LIGHT_UBO_REGION_NUM);
+    mapped_ptr = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+    GLStateCache::get_instance().bind_buffer(GL_UNIFORM_BUFFER, 0);  // 解绑
+
+    // 新缓冲里什么都没有，每个区域都要完整写一遍，空槽位写入“空”灯光
+    pending_writes.fill(LIGHT_UBO_REGION_NUM);
+    header_pending_writes = LIGHT_UBO_REGION_NUM;
+    light_num             = 0;
+    region                = 0;
+
+    update_light_UBO();  // 更新灯光组数据
 
     GL_CHECK();
 }
 
-void ck::SceneLightUBOManager::update_light_UBO() const
+void ck::SceneLightUBOManager::wait_region(const uint32_t region_index)
 {
-    glBindBuffer(GL_UNIFORM_BUFFER, lights_UBO);
-    int stride = Light::calculate_memory_occupancy();
-    // 获取指向buffer的指针
-    auto* ptr = static_cast<unsigned char*>(glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY));
+    GLsync& fence = region_fences[region_index];
+    if (fence == nullptr) { return; }
+    // 三重缓冲下这里几乎不会真正等待
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED &&
+           result != GL_WAIT_FAILED)
+    {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);  // 1ms
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
 
-    int32_t num_lights_found = 0;
-    for (const auto& object : scene->get_scene_objects())
+void ck::SceneLightUBOManager::update_light_UBO()
+{
+    CK_PROFILE_SCOPE("SceneLightUBOManager::update_light_UBO");
+    if (mapped_ptr == nullptr) { return; }
+
+    // 上一次调用之后提交的绘制都在读当前区域，用完之前不能再写它
+    if (region_fences[region] != nullptr) { glDeleteSync(region_fences[region]); }
+    region_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region                = (region + 1) % LIGHT_UBO_REGION_NUM;
+    wait_region(region);
+
+    // 收集脏的槽位
+    EntityRegistry&           registry = scene->get_registry();
+    const std::vector<Light>& lights   = registry.get_lights();
+    if (lights.size() > MAX_LIGHTS_SUPPORTED)
+    {
+        // 每帧都会更新，只提示一次；分簇光照的shader不受这个限制
+        LOG_FIRST_N(WARNING, 1) << "Warning: The number of lights exceeds the maximum "
+                                   "supported. The number of lights in the light group UBO "
+                                   "will be limited to "
+                                << MAX_LIGHTS_SUPPORTED << ".";
+    }
+    const auto num = static_cast<uint32_t>(
+        std::min<size_t>(lights.size(), MAX_LIGHTS_SUPPORTED));
+    for (uint32_t i = 0; i < num; i++)
     {
-        if (object->get_object_type() == RenderObjectType::LIGHT)
+        if (registry.is_light_dirty(i)) { pending_writes[i] = LIGHT_UBO_REGION_NUM; }
+    }
+    if (num != light_num)
+    {
+        // 灯光数量变了：numLights和变化范围内的槽位都要重写（多出来的槽位写成“空”灯光）
+        for (uint32_t i = std::min(num, light_num); i < std::max(num, light_num); i++)
         {
-            // update light UBO
-            unsigned char* lightPtr = ptr + num_lights_found * stride + 16;
-            // FIXME - +16意味着缓冲的前16B是int型的灯光数量
-            const std::array<glm::vec3, 3>& transform = object->get_transform();
-            object->get_light().update_light_uniformBuffer(lightPtr, transform[0], transform[1]);
-
-            if ((++num_lights_found) == MAX_LIGHTS_SUPPORTED)
-            {
-                LOG(WARNING) << "Warning: The number of lights exceeds the maximum supported."
-                                "The number of lights will be limited to "
-                             << MAX_LIGHTS_SUPPORTED << ".";
-                break;
-            }
+            pending_writes[i] = LIGHT_UBO_REGION_NUM;
         }
+        header_pending_writes = LIGHT_UBO_REGION_NUM;
+        light_num             = num;
     }
+    registry.clear_light_dirty();
 
-    if (num_lights_found < MAX_LIGHTS_SUPPORTED)
+    // 只写入脏的记录
+    unsigned char* const region_ptr = mapped_ptr + region * region_size;
+    if (header_pending_writes > 0)
     {
-        // 向UBO中写入“空”灯光
-        int32_t null_light_type = -1;
-        for (int i = num_lights_found; i < MAX_LIGHTS_SUPPORTED; i++)
+        LightGroupHeader header = {};
+        header.num_lights       = static_cast<int32_t>(light_num);
+        memcpy(region_ptr, &header, sizeof(LightGroupHeader));
+        header_pending_writes--;
+    }
+    auto* const records =
+        reinterpret_cast<LightUniformData*>(region_ptr + sizeof(LightGroupHeader));
+    for (uint32_t i = 0; i < MAX_LIGHTS_SUPPORTED; i++)
+    {
+        if (pending_writes[i] == 0) { continue; }
+        LightUniformData data = {};
+        data.light_type       = -1;  // “空”灯光
+        if (i < light_num)
         {
-            // 用“空”灯光更新灯光UBO
-            memcpy(ptr + i * stride + 16, &(null_light_type), sizeof(int32_t));
+            // 位置使用世界坐标，灯光会跟着父节点移动
+            const Transform& transform = registry.get_light_transform(i);
+            data = lights[i].get_uniform_data(transform.get_world_position(),
+                                              transform.get_rotation());
         }
+        memcpy(&records[i], &data, sizeof(LightUniformData));
+        pending_writes[i]--;
     }
 
-    memcpy(ptr, &(num_lights_found), sizeof(int32_t));  // 更新numLights
-    // FIXME - 前16B = 4B整数 + 12B空填充
-    glUnmapBuffer(GL_UNIFORM_BUFFER);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);  // 解绑
-    /**FIXME - 有个bug修一下:
-    GL_INVALID_OPERATION error generated.
-    Target buffer must be bound and not overlapped with mapping range.
-    原因是：不可以在解绑glUnmapBuffer()前，继续使用glBufferSubData()
-    向同一个target buffer写入数据
-    */
+    binding_uniformBuffer(binding_point);
 }
 
-void ck::SceneLightUBOManager::binding_uniformBuffer(const uint32_t binding_point) const
+void ck::SceneLightUBOManager::binding_uniformBuffer(const uint32_t binding_point)
 {
-    glBindBufferBase(GL_UNIFORM_BUFFER, binding_point, lights_UBO);
+    this->binding_point = binding_point;
+    if (!lights_UBO.is_valid()) { return; }
+    GLStateCache::get_instance().bind_buffer_range(
+        GL_UNIFORM_BUFFER, binding_point, lights_UBO.get(),
+        static_cast<GLintptr>(region * region_size),
+        static_cast<GLsizeiptr>(sizeof(LightGroupHeader) + calculate_memory_occupation()));
 }
 
 void ck::SceneLightUBOManager::print_bufferData() const
 {
-    glBindBuffer(GL_UNIFORM_BUFFER, lights_UBO);
-    // 获取指向buffer的指针
-    auto* ptr = static_cast<unsigned char*>(glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY));
+    // 映射是只写的，从GL读回当前区域
+    std::vector<unsigned char> data(sizeof(LightGroupHeader) + calculate_memory_occupation());
+    GLStateCache::get_instance().bind_buffer(GL_UNIFORM_BUFFER, lights_UBO.get());
+    glGetBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(region * region_size),
+                       static_cast<GLsizeiptr>(data.size()), data.data());
+    GLStateCache::get_instance().bind_buffer(GL_UNIFORM_BUFFER, 0);  // 解绑
+    const unsigned char* ptr = data.data();
 
     for (int i = 0; i < 16; i++)
     {
@@ -443,7 +724,7 @@ void ck::SceneLightUBOManager::print_bufferData() const
         if ((i + 1) % 32 == 0) { printf("\n"); }
     }
     printf("\n");
-    ptr += 16;  // FIXME - 前16B放一个int变量
+    ptr += sizeof(LightGroupHeader);  // FIXME - 前16B放一个int变量
 
     uint32_t buffer_size = calculate_memory_occupation();
 
@@ -454,7 +735,4 @@ void ck::SceneLightUBOManager::print_bufferData() const
         if ((i + 1) % 4 == 0) { printf(" "); }
         if ((i + 1) % 32 == 0) { printf("\n"); }
     }
-
-    glUnmapBuffer(GL_UNIFORM_BUFFER);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);  // 解绑}
-}
\ No newline at end of file
+}
@@ -12,12 +12,20 @@
 #include <glm/ext/vector_float3.hpp>
 #include <glm/glm.hpp>
 
+#include "asset_registry.h"
+#include "bvh.h"
 #include "camera.h"
+#include "clustered_lighting.h"
+#include "core/ck_gl_resource.h"
+#include "entity_registry.h"
+#include "gpu_culling.h"
 #include "imgui_glfw_window_base.h"
 #include "light.h"
 #include "model.h"
 #include "render_object.h"
+#include "render_queue.h"
 #include "shader.h"
+#include "shadow_atlas.h"
 
 extern const std::string stdAsset_root;
 static const std::string defualt_light_model_path = stdAsset_root + "stdModel/sphere/sphere.obj";
@@ -29,20 +37,55 @@ static const std::array<std::string, 3> defualt_light_shader_path = {
 
 namespace ck {
 
+struct SceneObjectEdittingCtx
+{
+    RenderObjectType object_type{RenderObjectType::NULL_OBJECT};
+    std::string      object_name;
+    EntityHandle     parent_object;  // 为空表示不修改父节点
+
+    std::shared_ptr<Model>  model{nullptr};
+    LightAttributes*        light_attributes{nullptr};
+    std::shared_ptr<Shader> shader{nullptr};
+
+    // transformation
+    glm::vec3* postion{nullptr};
+    glm::vec3* rotation{nullptr};
+    glm::vec3* scale{nullptr};
+
+    RenderDrawType draw_type{RenderDrawType::NULL_TYPE};
+};
+
+/// @brief 场景描述中的一个几何体，用于批量添加
+struct SceneObjectDesc
+{
+    std::string                model_file_path;
+    std::array<std::string, 3> shader_file_path;
+    std::string                object_name;
+    EntityHandle               parent_object;  // 为空时挂在scene_root下
+
+    glm::vec3 postion{0.0F};
+    glm::vec3 rotation{0.0F};
+    glm::vec3 scale{1.0F};
+};
+
 class SkyBoxObject {
 private:
-    uint32_t  skyBox_texture;
-    uint32_t  pureWhite_skyBox_texture;
+    GLTexture skyBox_texture;
+    GLTexture pureWhite_skyBox_texture;
     glm::vec3 skyBox_color;
     Shader    skyBox_shader;
     Model     skyBox_model;
 
-    static void create_skyBox_texture_from_file(uint32_t&          target_texture,
+    // 天空盒的shader不会被替换，构造时解析一次
+    UniformHandle<glm::mat4> view_uniform;
+    UniformHandle<glm::mat4> projection_uniform;
+    UniformHandle<int>       skybox_uniform;
+
+    static void create_skyBox_texture_from_file(GLTexture&         target_texture,
                                                 const std::string& image_folder);
 
 public:
     SkyBoxObject();
-    ~SkyBoxObject();
 
     [[nodiscard]] uint32_t  get_skyBox_texture() const;
     [[nodiscard]] glm::vec3 get_skyBox_color() const;
@@ -56,20 +99,46 @@ public:
 class Scene {
 private:
     /**NOTE - object in the scene
-    允许多个object的model/shader，指向同一个model_prototypes/shader_prototypes
-    即同一个model_prototypes/shader_prototypes实例出多个model/shader
+    允许多个object的model/shader，指向assets中的同一个原型
+    即同一个model/shader原型实例出多个object
 
     当引用计数为1的时候表示该model/shader不再被引用
+
+    物体本身的数据按组件存放在registry中，对外只发放EntityHandle
     */
-    std::vector<std::shared_ptr<Model>>        model_prototypes;
-    std::vector<std::shared_ptr<Shader>>       shader_prototypes;
-    std::vector<std::shared_ptr<RenderObject>> objects;
-    std::shared_ptr<RenderObject>              scene_root;
+    AssetRegistry  assets;
+    EntityRegistry registry;
+    EntityHandle   scene_root;
 
     std::unique_ptr<Camera>       camera;
     std::unique_ptr<SkyBoxObject> skyBox;
+    RenderQueue                   render_queue;  // 每帧重新收集，复用内存
+
+    /**NOTE - 视锥剔除
+    每个Renderable在bvh中有一个proxy，包围盒 = 模型空间包围盒变换到世界空间。
+    update_transforms()只根据registry记录的moved_entities增量地移动proxy，
+    draw()时只有和视锥体相交的物体才会进入渲染队列。
+    */
+    DynamicBVH            bvh;
+    std::vector<uint32_t> visible_entities;  // 实体下标，复用内存
+    CullingStats          culling_stats{};
+    bool                  frustum_culling_enabled{true};
+
+    // 每帧把点光/聚光分配到视锥体的格子里，供分簇光照的shader使用
+    ClusteredLighting clustered_lighting;
+
+    /**NOTE - 阴影
+    所有投射阴影的灯光共用一张深度图集，见 shadow_atlas.h。
+    update_transforms()把移动前后、出现和消失的几何体的包围盒记进shadow_invalidations，
+    draw()时交给图集，只重新渲染这些包围盒落在其中的tile。
+    */
+    ShadowAtlas       shadow_atlas;
+    std::vector<AABB> shadow_invalidations;
+
+    // 间接绘制的实例在GPU上再做一次视锥剔除和Hi-Z遮挡剔除，见 gpu_culling.h
+    GpuCulling gpu_culling;
 
-    // TODO - shadowMap baking system
+    void invalidate_shadows(const AABB& bounds);
 
     /**NOTE - singleton class
     定义移动构造器（删除也算进行了定义），
@@ -80,31 +149,53 @@ private:
     Scene();
     Scene(Scene&&) = delete;
 
-    void add_model_prototype(const std::string& model_file_path);
-    void add_shader_prototype(const std::array<std::string, 3>& shader_file_path);
-
 public:
     static Scene& get_instance();
 
     /// @brief 添加一个模型到场景中
     /// @note 从已加载的prototypes中快速加载，由内部判断和实现
-    std::shared_ptr<RenderObject>&
-    add_model_from_file(const std::string&                model_file_path,
-                        const std::array<std::string, 3>& shader_file_path,
-                        const std::string&                object_name);
+    EntityHandle add_model_from_file(const std::string&                model_file_path,
+                                     const std::array<std::string, 3>& shader_file_path,
+                                     const std::string&                object_name);
+
+    /// @brief 批量添加几何体（比如从场景描述文件中读出来的）
+    /// @note 预先为所有物体分配好存储，原型只在第一次出现时加载
+    /// @return 和descs一一对应的句柄
+    std::vector<EntityHandle> add_models(const std::vector<SceneObjectDesc>& descs);
 
     /// @brief 添加一个灯光到场景中
     /// @note 灯光有默认的mesh和shader
-    std::shared_ptr<RenderObject>& add_light(std::string object_name, const Light& light);
+    EntityHandle add_light(std::string object_name, const Light& light);
 
-    void modify_object(const std::shared_ptr<ck::RenderObject>& object_ptr,
-                       const SceneObjectEdittingCtx*            ctx);
+    void modify_object(EntityHandle object, const SceneObjectEdittingCtx* ctx);
 
-    [[nodiscard]] std::vector<std::shared_ptr<RenderObject>>& get_scene_objects();
-    [[nodiscard]] SkyBoxObject&                               get_skyBox();
-    [[nodiscard]] Camera&                                     get_camera();
+    /// @brief 删除物体以及它的所有子物体，之后这些物体的句柄都会失效
+    void remove_object(EntityHandle object);
 
-    void draw(const ImguiGlfwWindowBase& window) const;
+    [[nodiscard]] AssetRegistry&        get_assets();
+    [[nodiscard]] EntityRegistry&       get_registry();
+    [[nodiscard]] const EntityRegistry& get_registry() const;
+    [[nodiscard]] EntityHandle          get_scene_root() const;
+    [[nodiscard]] SkyBoxObject&         get_skyBox();
+    [[nodiscard]] Camera&               get_camera();
+    [[nodiscard]] const RenderQueue&    get_render_queue() const;
+    [[nodiscard]] const CullingStats&   get_culling_stats() const;
+    [[nodiscard]] ClusteredLighting&    get_clustered_lighting();
+    [[nodiscard]] ShadowAtlas&          get_shadow_atlas();
+    [[nodiscard]] GpuCulling&           get_gpu_culling();
+    [[nodiscard]] bool                  is_frustum_culling_enabled() const;
+    void                                set_frustum_culling(bool enabled);
+    [[nodiscard]] bool                  is_indirect_drawing_enabled() const;
+    /// @brief 打开时实例化批次用glMultiDrawElementsIndirect提交，见 render_queue.h
+    void                                set_indirect_drawing(bool enabled);
+
+    /// @brief 广度优先更新所有物体的世界矩阵，只进入有变化的子树，并同步BVH中的包围盒
+    /// @note draw()会先调用它；在draw()之前需要世界坐标（比如更新灯光UBO）时可以提前调用
+    void update_transforms();
+
+    void draw(const ImguiGlfwWindowBase& window);
+    /// @brief 绘制到当前绑定的帧缓冲，尺寸由调用者给出（比如无窗口的离屏渲染）
+    void draw(uint32_t width, uint32_t height);
 };
 /**FIXME - Call to implicitly-deleted default constructor
 类成员变量会在构造函数“函数体”前进行初始化
@@ -112,19 +203,58 @@ public:
 其中Shader没有默认的构造函数
 */
 
+static const uint32_t LIGHT_UBO_REGION_NUM = 3;  // 三重缓冲
+
+/// @brief 灯光组UBO的头部（std140），numLights之后填充到16B
+struct LightGroupHeader
+{
+    int32_t num_lights;
+    int32_t padding[3];
+};
+static_assert(sizeof(LightGroupHeader) == 16);
+
+/// @brief 灯光组UBO
+/**NOTE - 持久映射 + 三重缓冲
+缓冲用glBufferStorage创建，整个生命周期只映射一次（persistent + coherent），
+分成LIGHT_UBO_REGION_NUM个区域轮流使用：CPU写第N帧的区域时，GPU可能还在读前两帧的区域。
+每个区域在被绑定使用后插入一个fence，下一次轮到它时先等fence，保证不会改写GPU正在读的数据。
+
+只重写脏的灯光记录：灯光被标记为脏时，它的槽位需要在接下来的每个区域中各写一次，
+pending_writes记录还剩几个区域没写。灯光不动的时候每帧不产生任何写入。
+*/
 class SceneLightUBOManager {
 private:
-    Scene*   scene;
-    uint32_t lights_UBO;
+    Scene*         scene;
+    GLBuffer       lights_UBO;
+    unsigned char* mapped_ptr;
+    size_t         region_size;  // 对齐到GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    uint32_t       region;       // 当前使用的区域
+    uint32_t       binding_point;
+
+    std::array<GLsync, LIGHT_UBO_REGION_NUM>  region_fences;
+    std::array<uint8_t, MAX_LIGHTS_SUPPORTED> pending_writes;  // 每个槽位还要写几个区域
+    uint8_t                                   header_pending_writes;
+    uint32_t                                  light_num;  // 已经写入的灯光数
 
     int32_t calculate_memory_occupation() const;
+    /// @brief 等待GPU用完这个区域
+    void wait_region(uint32_t region_index);
 
 public:
     SceneLightUBOManager();
+    ~SceneLightUBOManager();
+
+    SceneLightUBOManager(const SceneLightUBOManager&)            = delete;
+    SceneLightUBOManager& operator=(const SceneLightUBOManager&) = delete;
 
     void create_light_UBO();
-    void update_light_UBO() const;
-    void binding_uniformBuffer(uint32_t binding_point) const;
+    /// @brief 切换到下一个区域，写入脏的灯光，并把新区域绑定到binding point
+    /// @note 每帧调用一次，在这一帧的绘制之前
+    void update_light_UBO();
+    void binding_uniformBuffer(uint32_t binding_point);
+
+    /// @brief 释放缓冲和fence，需要在销毁GL上下文之前调用
+    void shutdown();
 
     void print_bufferData() const;
 };
@@ -0,0 +1,129 @@
+#include "scene_benchmark.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glog/logging.h>
+
+#include "clustered_lighting.h"
+#include "entity_registry.h"
+#include "light.h"
+#include "render_object.h"
+#include "transform.h"
+
+namespace {
+
+static const uint32_t BENCHMARK_GROUP_SIZE  = 64;  // 每个分组节点下挂的实体数
+static const uint32_t BENCHMARK_LIGHT_EVERY = 8;   // 每8个实体中有一个灯光
+
+/// @brief 执行一次fn并打印耗时
+template <typename Fn> void measure(const char* name, const uint32_t entity_num, Fn&& fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto   end = std::chrono::steady_clock::now();
+    const double ms  = std::chrono::duration<double, std::milli>(end - start).count();
+    LOG(INFO) << "[scene benchmark] " << name << ": " << ms << " ms ("
+              << ms * 1e6 / static_cast<double>(entity_num) << " ns/entity)";
+}
+
+}  // namespace
+
+void ck::run_scene_benchmark(const uint32_t entity_num)
+{
+    LOG(INFO) << "[scene benchmark] " << entity_num << " entities, " << BENCHMARK_GROUP_SIZE
+              << " per group";
+
+    EntityRegistry            registry;
+    const EntityHandle        root = registry.create(RenderObjectType::NULL_OBJECT, "root", {});
+    std::vector<EntityHandle> groups;
+    std::vector<EntityHandle> entities;
+    entities.reserve(entity_num);
+
+    measure("create", entity_num, [&]() {
+        for (uint32_t i = 0; i < entity_num; i++)
+        {
+            if (i % BENCHMARK_GROUP_SIZE == 0)
+            {
+                groups.push_back(registry.create(RenderObjectType::NULL_OBJECT,
+                                                 "group_" + std::to_string(groups.size()), root));
+            }
+            const bool         is_light = (i % BENCHMARK_LIGHT_EVERY == 0);
+            const EntityHandle entity   = registry.create(
+                is_light ? RenderObjectType::LIGHT : RenderObjectType::POLYGEN_MESH,
+                "entity_" + std::to_string(i), groups.back());
+            registry.edit_transform(entity).set_position(
+                glm::vec3(static_cast<float>(i % 100), 0.0F, static_cast<float>(i / 100)));
+            registry.add_renderable(entity, nullptr, nullptr, RenderDrawType::NORMAL);
+            if (is_light) { registry.add_light(entity, Light(0)); }
+            entities.push_back(entity);
+        }
+    });
+
+    measure("update transforms (all dirty)", entity_num, [&]() { registry.update_transforms(); });
+    measure("update transforms (clean)", entity_num, [&]() { registry.update_transforms(); });
+
+    // 移动1%的实体，以及一个分组节点（它的整棵子树都要更新）
+    for (uint32_t i = 0; i < entity_num; i += 100)
+    {
+        registry.edit_transform(entities[i]).set_rotation(glm::vec3(0.0F, 1.0F, 0.0F));
+    }
+    registry.edit_transform(groups.front()).set_scale(glm::vec3(2.0F));
+    measure("update transforms (1% dirty)", entity_num, [&]() { registry.update_transforms(); });
+
+    // 按组件紧密遍历，模拟Scene::draw()收集和灯光UBO的更新
+    float checksum = 0.0F;
+    measure("iterate renderables", entity_num, [&]() {
+        for (uint32_t i = 0; i < registry.get_renderables().size(); i++)
+        {
+            checksum += registry.get_renderable_world_matrix(i)[3].x;
+        }
+    });
+    measure("iterate lights", entity_num, [&]() {
+        for (uint32_t i = 0; i < registry.get_lights().size(); i++)
+        {
+            checksum += registry.get_light_transform(i).get_world_position().z;
+            checksum += registry.get_lights()[i].get_color().x;
+        }
+    });
+
+    // 分簇光照的灯光分配（只在CPU上，不上传）
+    {
+        ClusteredLighting lighting;
+        const glm::mat4   view = glm::lookAt(glm::vec3(50.0F, 20.0F, -10.0F),
+                                             glm::vec3(50.0F, 0.0F, 50.0F), glm::vec3(0, 1, 0));
+        const glm::mat4 projection =
+            glm::perspective(glm::radians(45.0F), 16.0F / 9.0F, 0.1F, 100.0F);
+        const auto light_num = static_cast<uint32_t>(registry.get_lights().size());
+        measure("assign lights to clusters", light_num, [&]() {
+            lighting.update(registry, view, projection, 0.1F, 100.0F, 1280, 720);
+        });
+        const ClusteredLightingStats& stats = lighting.get_stats();
+        LOG(INFO) << "[scene benchmark] clustered lights: " << stats.light_num
+                  << ", indices: " << stats.light_index_num
+                  << ", max/cluster: " << stats.max_cluster_light_num
+                  << ", dropped: " << stats.overflow_num;
+    }
+
+    // 销毁一半的分组，句柄应当全部失效
+    measure("destroy half", entity_num, [&]() {
+        for (size_t i = 0; i < groups.size(); i += 2)
+        {
+            registry.destroy(groups[i]);
+        }
+    });
+    size_t stale_handles = 0;
+    for (const EntityHandle& entity : entities)
+    {
+        if (!registry.is_alive(entity)) { stale_handles++; }
+    }
+
+    LOG(INFO) << "[scene benchmark] alive: " << registry.get_entity_num()
+              << ", stale handles: " << stale_handles << ", checksum: " << checksum;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ck {
+
+static const uint32_t DEFAULT_BENCHMARK_ENTITY_NUM = 100000;
+
+/// @brief 场景存储的CPU基准测试：创建、更新变换、按组件遍历、销毁
+/// @note 只用到EntityRegistry，不需要GL上下文（模型和shader留空，不会真正绘制）
+void run_scene_benchmark(uint32_t entity_num = DEFAULT_BENCHMARK_ENTITY_NUM);
+
+};  // namespace ck
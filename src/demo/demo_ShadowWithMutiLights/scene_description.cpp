@@ -0,0 +1,136 @@
+#include "scene_description.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glog/logging.h>
+
+#include "light.h"
+#include "scene.h"
+
+extern const std::string stdAsset_root;
+
+namespace {
+
+bool read_vec3(std::istringstream& stream, glm::vec3& value)
+{
+    return static_cast<bool>(stream >> value.x >> value.y >> value.z);
+}
+
+bool parse_object(std::istringstream& stream, ck::SceneObjectDesc& desc)
+{
+    std::string model;
+    std::string vertex_shader;
+    std::string fragment_shader;
+    if (!(stream >> model >> vertex_shader >> fragment_shader >> desc.object_name))
+    {
+        return false;
+    }
+    desc.model_file_path  = stdAsset_root + model;
+    desc.shader_file_path = {stdAsset_root + vertex_shader, stdAsset_root + fragment_shader, ""};
+    return read_vec3(stream, desc.postion) && read_vec3(stream, desc.rotation) &&
+           read_vec3(stream, desc.scale);
+}
+
+bool parse_light(std::istringstream& stream, ck::SceneLightDesc& desc)
+{
+    int32_t   type      = -1;
+    glm::vec3 color     = glm::vec3(1.0F);
+    float     intensity = 1.0F;
+    if (!(stream >> desc.object_name >> type) || !read_vec3(stream, color) ||
+        !(stream >> intensity))
+    {
+        return false;
+    }
+    desc.light = ck::Light(type, color, intensity);
+    return read_vec3(stream, desc.postion) && read_vec3(stream, desc.rotation);
+}
+
+bool parse_camera(std::istringstream& stream, ck::CameraKeyframe& keyframe)
+{
+    return (stream >> keyframe.time) && read_vec3(stream, keyframe.position) &&
+           (stream >> keyframe.yaw >> keyframe.pitch);
+}
+
+}  // namespace
+
+[[nodiscard]] float ck::SceneDescription::get_duration() const
+{
+    if (camera_path.empty()) { return 0.0F; }
+    return camera_path.back().time - camera_path.front().time;
+}
+
+[[nodiscard]] ck::CameraKeyframe ck::SceneDescription::sample_camera_path(const float time) const
+{
+    if (camera_path.empty()) { return {}; }
+    if (time <= camera_path.front().time) { return camera_path.front(); }
+    if (time >= camera_path.back().time) { return camera_path.back(); }
+
+    // 第一个时间大于time的关键帧，和它前面的一个插值
+    const auto next = std::upper_bound(
+        camera_path.begin(), camera_path.end(), time,
+        [](const float t, const CameraKeyframe& keyframe) { return t < keyframe.time; });
+    const CameraKeyframe& b = *next;
+    const CameraKeyframe& a = *(next - 1);
+    const float           t = (time - a.time) / std::max(b.time - a.time, 1e-6F);
+
+    CameraKeyframe result;
+    result.time     = time;
+    result.position = glm::mix(a.position, b.position, t);
+    result.yaw      = glm::mix(a.yaw, b.yaw, t);
+    result.pitch    = glm::mix(a.pitch, b.pitch, t);
+    return result;
+}
+
+bool ck::load_scene_description(const std::string& file_path, SceneDescription& description)
+{
+    std::ifstream file(file_path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Failed to open scene description: " << file_path;
+        return false;
+    }
+
+    description = {};
+    std::string line;
+    size_t      line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) { line.erase(comment); }
+        std::istringstream stream(line);
+        std::string        kind;
+        if (!(stream >> kind)) { continue; }  // 空行
+
+        bool ok = false;
+        if (kind == "object")
+        {
+            ok = parse_object(stream, description.objects.emplace_back());
+        }
+        else if (kind == "light") { ok = parse_light(stream, description.lights.emplace_back()); }
+        else if (kind == "camera")
+        {
+            ok = parse_camera(stream, description.camera_path.emplace_back());
+            ok = ok && (description.camera_path.size() < 2 ||
+                        description.camera_path.back().time >=
+                            description.camera_path[description.camera_path.size() - 2].time);
+        }
+        if (!ok)
+        {
+            LOG(ERROR) << file_path << ":" << line_number << ": cannot parse \"" << line << "\"";
+            return false;
+        }
+    }
+    LOG(INFO) << "Loaded scene description " << file_path << ": " << description.objects.size()
+              << " objects, " << description.lights.size() << " lights, "
+              << description.camera_path.size() << " camera keyframes";
+    return true;
+}
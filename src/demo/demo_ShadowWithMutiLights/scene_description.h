@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "light.h"
+#include "scene.h"
+
+namespace ck {
+
+/// @brief 场景描述中的一个灯光
+struct SceneLightDesc
+{
+    std::string object_name;
+    Light       light;
+    glm::vec3   postion{0.0F};
+    glm::vec3   rotation{0.0F};  // 日光和聚光用它表示朝向
+};
+
+/// @brief 相机路径上的一个关键帧，yaw/pitch为角度制
+struct CameraKeyframe
+{
+    float     time{0.0F};  // 秒
+    glm::vec3 position{0.0F};
+    float     yaw{-90.0F};
+    float     pitch{0.0F};
+};
+
+/// @brief 从文本文件读出的场景：几何体、灯光和一条相机路径
+/**NOTE - 场景描述文件
+每行一条记录，空白分隔，#之后是注释；路径都相对于stdAsset_root：
+    object <model> <vertex shader> <fragment shader> <name> px py pz rx ry rz sx sy sz
+    light  <name> <type> r g b intensity px py pz rx ry rz
+    camera <time> px py pz yaw pitch
+旋转为弧度，和SceneObjectEdittingCtx一致；灯光类型和Light一致（0点光，1日光，2聚光）。
+camera按时间顺序给出，关键帧之间线性插值。
+*/
+struct SceneDescription
+{
+    std::vector<SceneObjectDesc> objects;
+    std::vector<SceneLightDesc>  lights;
+    std::vector<CameraKeyframe>  camera_path;
+
+    /// @brief 相机路径的总时长（秒）
+    [[nodiscard]] float get_duration() const;
+
+    /// @brief 在time时刻对相机路径插值，超出范围时取两端的关键帧
+    [[nodiscard]] CameraKeyframe sample_camera_path(float time) const;
+};
+
+/// @brief 解析场景描述文件
+/// @return 文件打不开或者有无法解析的行时返回false，并打印出错的行号
+bool load_scene_description(const std::string& file_path, SceneDescription& description);
+
+};  // namespace ck
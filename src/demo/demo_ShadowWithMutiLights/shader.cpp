@@ -1,18 +1,57 @@
 #include "shader.h"
 
+#include <cstddef>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <utility>
 
+#include "core/ck_cpu_profiler.h"
 #include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "shader_cache.h"
+
+ck::UniformName::UniformName(std::string name) : name(std::move(name)), hash(0)
+{
+    hash = hash_string(this->name);
+}
+
+[[nodiscard]] const std::string& ck::UniformName::get_name() const
+{
+    return name;
+}
+
+[[nodiscard]] uint64_t ck::UniformName::get_hash() const
+{
+    return hash;
+}
+
+uint64_t ck::UniformName::hash_string(const std::string_view str)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : str)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
 
 ck::Shader::Shader(const std::string& vertexShader_path,
                    const std::string& fragmentShader_path,
                    const std::string& geometryShader_path)
-    : load_path{vertexShader_path, fragmentShader_path, geometryShader_path}
+    : load_path{vertexShader_path, fragmentShader_path, geometryShader_path}, uniform_num(0)
 {
+    CK_PROFILE_SCOPE("Shader::Shader");
     bool use_geomShader = !geometryShader_path.empty();
     if (use_geomShader) { LOG(INFO) << "use geometry shader"; }
 
@@ -58,13 +97,93 @@ ck::Shader::Shader(const std::string& vertexShader_path,
         LOG(ERROR) << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << e.what();
     }
 
-    const char* vShaderCode = vertexShader_code.c_str();
-    const char* fShaderCode = fragShader_code.c_str();
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // 优先从程序二进制缓存载入，缓存缺失或被驱动拒绝时再从源码编译
+    const bool           use_cache = is_shader_cache_enabled();
+    const ShaderCacheKey cache_key =
+        ShaderCacheKey::from_sources({vertexShader_code, fragShader_code, geomShader_code});
+    program.create(std::filesystem::path(vertexShader_path).filename().string(), vertexShader_path);
+    const uint32_t id        = program.get();
+    const bool     cache_hit = use_cache && load_program_binary(id, cache_key);
+    if (!cache_hit)
+    {
+        if (use_cache) { glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+        compile_and_link(vertexShader_code, fragShader_code, geomShader_code);
+        if (use_cache) { store_program_binary(id, cache_key); }
+    }
+    track_program_bytes();
+    // 反射所有uniform的location
+    reflect_uniforms();
+
+    const auto elapsed_time = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start_time)
+                                  .count();
+    LOG(INFO) << "shader " << vertexShader_path << " ready in " << elapsed_time << " ms "
+              << (cache_hit ? "(warm, program binary)" : "(cold, compiled from source)");
+
+    use();
+    GL_CHECK();
+}
+
+ck::Shader::Shader(const std::string& computeShader_path)
+    : load_path{computeShader_path, "", ""}, uniform_num(0)
+{
+    CK_PROFILE_SCOPE("Shader::Shader (compute)");
+    std::string   computeShader_code;
+    std::ifstream computeShader_file;
+    computeShader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        computeShader_file.open(computeShader_path);
+        std::stringstream computeShader_stream;
+        computeShader_stream << computeShader_file.rdbuf();
+        computeShader_file.close();
+        computeShader_code = computeShader_stream.str();
+    }
+    catch (std::ifstream::failure& e)
+    {
+        LOG(ERROR) << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << e.what();
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // 和图形程序共用二进制缓存，片元着色器的位置为空，不会和任何图形程序的键冲突
+    const bool           use_cache = is_shader_cache_enabled();
+    const ShaderCacheKey cache_key = ShaderCacheKey::from_sources({computeShader_code, "", ""});
+    program.create(std::filesystem::path(computeShader_path).filename().string(),
+                   computeShader_path);
+    const uint32_t id        = program.get();
+    const bool     cache_hit = use_cache && load_program_binary(id, cache_key);
+    if (!cache_hit)
+    {
+        if (use_cache) { glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+        compile_and_link_compute(computeShader_code);
+        if (use_cache) { store_program_binary(id, cache_key); }
+    }
+    track_program_bytes();
+    reflect_uniforms();
+
+    const auto elapsed_time = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start_time)
+                                  .count();
+    LOG(INFO) << "compute shader " << computeShader_path << " ready in " << elapsed_time << " ms "
+              << (cache_hit ? "(warm, program binary)" : "(cold, compiled from source)");
+    GL_CHECK();
+}
+
+void ck::Shader::compile_and_link(const std::string& vertexShader_code,
+                                  const std::string& fragShader_code,
+                                  const std::string& geomShader_code) const
+{
+    const bool  use_geomShader = !geomShader_code.empty();
+    const char* vShaderCode    = vertexShader_code.c_str();
+    const char* fShaderCode    = fragShader_code.c_str();
 
     // 编译着色器程序
     GLuint vertexShade = glCreateShader(GL_VERTEX_SHADER);
     GLuint fragShader  = glCreateShader(GL_FRAGMENT_SHADER);
-    GLuint geomShader  = glCreateShader(GL_GEOMETRY_SHADER);
+    GLuint geomShader  = 0;
     // 设置着色器的源码
     glShaderSource(vertexShade, 1, &vShaderCode, nullptr);
     glShaderSource(fragShader, 1, &fShaderCode, nullptr);
@@ -76,13 +195,14 @@ ck::Shader::Shader(const std::string& vertexShader_path,
     if (use_geomShader)
     {
         const char* gShaderCode = geomShader_code.c_str();
+        geomShader              = glCreateShader(GL_GEOMETRY_SHADER);
         glShaderSource(geomShader, 1, &gShaderCode, nullptr);
         glCompileShader(geomShader);
         checkShaderCompiling(geomShader);
     }
 
     // 着色器程序
-    id = glCreateProgram();
+    const uint32_t id = program.get();
     glAttachShader(id, vertexShade);
     glAttachShader(id, fragShader);
     if (use_geomShader) { glAttachShader(id, geomShader); }
@@ -93,49 +213,207 @@ ck::Shader::Shader(const std::string& vertexShader_path,
     glDeleteShader(vertexShade);
     glDeleteShader(fragShader);
     if (use_geomShader) { glDeleteShader(geomShader); }
+}
 
-    use();
-    GL_CHECK();
+void ck::Shader::compile_and_link_compute(const std::string& computeShader_code) const
+{
+    const char* cShaderCode   = computeShader_code.c_str();
+    GLuint      computeShader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeShader, 1, &cShaderCode, nullptr);
+    glCompileShader(computeShader);
+    checkShaderCompiling(computeShader);
+
+    const uint32_t id = program.get();
+    glAttachShader(id, computeShader);
+    glLinkProgram(id);
+    checkShaderProgramCompiling(id);
+    glDeleteShader(computeShader);
 }
 
-ck::Shader::~Shader()
+void ck::Shader::track_program_bytes() const
 {
-    glDeleteProgram(id);
+    // 驱动没有报告程序的显存占用，用程序二进制的大小估算
+    GLint binary_length = 0;
+    glGetProgramiv(program.get(), GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    program.set_bytes(static_cast<size_t>(std::max(binary_length, 0)));
 }
 
 void ck::Shader::use() const
 {
-    glUseProgram(id);
+    GLStateCache::get_instance().use_program(program.get());
 }
 
 void ck::Shader::setParameter(const std::string& name, const bool& value) const
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), static_cast<int>(value));
+    glUniform1i(get_uniform_location(name), static_cast<int>(value));
 }
 
 void ck::Shader::setParameter(const std::string& name, const int& value) const
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1i(get_uniform_location(name), value);
 }
 
 void ck::Shader::setParameter(const std::string& name, const float& value) const
 {
-    glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1f(get_uniform_location(name), value);
 }
 
 void ck::Shader::setParameter(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, glm::value_ptr(value));
+    glUniform3fv(get_uniform_location(name), 1, glm::value_ptr(value));
 }
 
 void ck::Shader::setParameter(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(id, name.c_str()), 1, glm::value_ptr(value));
+    glUniform2fv(get_uniform_location(name), 1, glm::value_ptr(value));
 }
 
 void ck::Shader::setParameter(const std::string& name, const glm::mat4& value) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ck::Shader::setParameter(const UniformHandle<bool> handle, const bool& value) const
+{
+    glUniform1i(handle.get_location(), static_cast<int>(value));
+}
+
+void ck::Shader::setParameter(const UniformHandle<int> handle, const int& value) const
+{
+    glUniform1i(handle.get_location(), value);
+}
+
+void ck::Shader::setParameter(const UniformHandle<float> handle, const float& value) const
+{
+    glUniform1f(handle.get_location(), value);
+}
+
+void ck::Shader::setParameter(const UniformHandle<glm::vec3> handle, const glm::vec3& value) const
+{
+    glUniform3fv(handle.get_location(), 1, glm::value_ptr(value));
+}
+
+void ck::Shader::setParameter(const UniformHandle<glm::vec2> handle, const glm::vec2& value) const
+{
+    glUniform2fv(handle.get_location(), 1, glm::value_ptr(value));
+}
+
+void ck::Shader::setParameter(const UniformHandle<glm::mat4> handle, const glm::mat4& value) const
+{
+    glUniformMatrix4fv(handle.get_location(), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+[[nodiscard]] int32_t ck::Shader::get_uniform_location(const std::string& name) const
+{
+    const UniformSlot* slot = find_uniform(name, UniformName::hash_string(name));
+    return (slot == nullptr) ? -1 : slot->location;
+    // NOTE - location为-1时，glUniform*会被静默忽略，和glGetUniformLocation的行为一致
+}
+
+void ck::Shader::reflect_uniforms()
+{
+    GLint resource_num = 0;
+    glGetProgramInterfaceiv(program.get(), GL_UNIFORM, GL_ACTIVE_RESOURCES, &resource_num);
+
+    // 负载因子不超过0.5，数组展开后的名字也要算进去，所以先按uniform数量的4倍分配
+    size_t capacity = 16;
+    while (capacity < static_cast<size_t>(resource_num) * 4) { capacity *= 2; }
+    uniform_table.assign(capacity, UniformSlot{0, -1, GL_NONE, ""});
+    uniform_num = 0;
+
+    static const std::array<GLenum, 4> properties = {GL_NAME_LENGTH, GL_LOCATION, GL_TYPE,
+                                                     GL_ARRAY_SIZE};
+    std::string                        name;
+    for (GLint i = 0; i < resource_num; i++)
+    {
+        std::array<GLint, 4> values = {};
+        glGetProgramResourceiv(program.get(), GL_UNIFORM, i, properties.size(), properties.data(),
+                               values.size(), nullptr, values.data());
+        const GLint location = values[1];
+        if (location < 0) { continue; }  // uniform block中的成员没有location
+
+        name.resize(values[0]);
+        glGetProgramResourceName(program.get(), GL_UNIFORM, i, values[0], nullptr, name.data());
+        name.resize(values[0] - 1);  // 去掉'\0'
+        const auto type = static_cast<GLenum>(values[2]);
+
+        // 数组名形如"xxx[0]"，额外登记"xxx"和"xxx[i]"
+        const size_t bracket_pos = name.rfind("[0]");
+        if (bracket_pos != std::string::npos && bracket_pos + 3 == name.size())
+        {
+            const std::string base_name = name.substr(0, bracket_pos);
+            insert_uniform(base_name, location, type);
+            for (GLint j = 0; j < values[3]; j++)
+            {
+                insert_uniform(base_name + "[" + std::to_string(j) + "]", location + j, type);
+            }
+        }
+        else { insert_uniform(name, location, type); }
+    }
+    GL_CHECK();
+}
+
+void ck::Shader::insert_uniform(const std::string& name, const int32_t location, const GLenum type)
+{
+    // 负载因子超过0.5时扩容
+    if ((uniform_num + 1) * 2 > uniform_table.size()) { grow_uniform_table(); }
+
+    // 线性探测
+    const uint64_t hash = UniformName::hash_string(name);
+    const size_t   mask = uniform_table.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        UniformSlot& slot = uniform_table[i];
+        if (slot.location < 0) { uniform_num++; }
+        else if (slot.hash != hash || slot.name != name) { continue; }
+        slot = UniformSlot{hash, location, type, name};
+        return;
+    }
+}
+
+void ck::Shader::grow_uniform_table()
+{
+    std::vector<UniformSlot> old_table = std::move(uniform_table);
+    uniform_table.assign(std::max<size_t>(16, old_table.size() * 2),
+                         UniformSlot{0, -1, GL_NONE, ""});
+    const size_t mask = uniform_table.size() - 1;
+    for (UniformSlot& old_slot : old_table)
+    {
+        if (old_slot.location < 0) { continue; }
+        size_t i = old_slot.hash & mask;
+        while (uniform_table[i].location >= 0) { i = (i + 1) & mask; }
+        uniform_table[i] = std::move(old_slot);
+    }
+}
+
+[[nodiscard]] const ck::Shader::UniformSlot* ck::Shader::find_uniform(const std::string_view name,
+                                                                      const uint64_t hash) const
+{
+    if (uniform_table.empty()) { return nullptr; }
+    const size_t mask = uniform_table.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const UniformSlot& slot = uniform_table[i];
+        if (slot.location < 0) { return nullptr; }  // 探测到空槽，说明不存在
+        if (slot.hash == hash && slot.name == name) { return &slot; }
+    }
+}
+
+[[nodiscard]] bool ck::Shader::is_uniform_type_compatible(const GLenum actual_type,
+                                                          const GLenum expected_type)
+{
+    if (actual_type == expected_type) { return true; }
+    switch (expected_type)
+    {
+        // bool和int可以互相设置，采样器用int设置纹理单元
+        case GL_INT:
+            return actual_type == GL_BOOL || actual_type == GL_SAMPLER_2D ||
+                   actual_type == GL_SAMPLER_CUBE || actual_type == GL_SAMPLER_2D_SHADOW ||
+                   actual_type == GL_SAMPLER_CUBE_SHADOW || actual_type == GL_SAMPLER_2D_ARRAY ||
+                   actual_type == GL_SAMPLER_2D_ARRAY_SHADOW;
+        case GL_BOOL: return actual_type == GL_INT;
+        default: return false;
+    }
 }
 
 void ck::Shader::checkShaderCompiling(const GLuint shader)
@@ -164,6 +442,11 @@ void ck::Shader::checkShaderProgramCompiling(const GLuint shaderProgram)
     else { LOG(INFO) << "Shader Program Compile success!"; }
 }
 
+[[nodiscard]] uint32_t ck::Shader::get_id() const
+{
+    return program.get();
+}
+
 [[nodiscard]] const std::array<std::string, 3>& ck::Shader::get_load_path() const
 {
     return load_path;
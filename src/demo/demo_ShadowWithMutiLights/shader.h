@@ -4,6 +4,7 @@
 
 #include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <glad/glad.h>
@@ -12,24 +13,96 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glog/logging.h>
 
+#include "core/ck_gl_resource.h"
+
 namespace ck {
 
+/// @brief 预先计算好哈希值的uniform名字，避免每次绘制都重新构造、哈希字符串
+class UniformName {
+private:
+    std::string name;
+    uint64_t    hash;
+
+public:
+    explicit UniformName(std::string name);
+
+    [[nodiscard]] const std::string& get_name() const;
+    [[nodiscard]] uint64_t           get_hash() const;
+
+    static uint64_t hash_string(std::string_view str);
+};
+
+/// @brief 已经解析好location的uniform句柄，T是uniform在C++侧的类型
+/// @note 句柄只对创建它的Shader有效
+template <typename T>
+class UniformHandle {
+private:
+    int32_t location;
+
+public:
+    UniformHandle() : location(-1) {}
+    explicit UniformHandle(const int32_t location) : location(location) {}
+
+    [[nodiscard]] int32_t get_location() const { return location; }
+    [[nodiscard]] bool    is_valid() const { return location >= 0; }
+};
+
+/// @brief C++类型对应的GL uniform类型
+template <typename T> struct UniformGLType;
+template <> struct UniformGLType<bool> { static constexpr GLenum value = GL_BOOL; };
+template <> struct UniformGLType<int> { static constexpr GLenum value = GL_INT; };
+template <> struct UniformGLType<float> { static constexpr GLenum value = GL_FLOAT; };
+template <> struct UniformGLType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template <> struct UniformGLType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformGLType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
 class Shader {
 private:
-    uint32_t                   id;
+    /**NOTE - uniform表
+    链接成功后一次性反射出所有active uniform（不包括uniform block中的成员），
+    存进一张开放寻址的扁平哈希表，之后的查询不再调用glGetUniformLocation。
+    */
+    struct UniformSlot
+    {
+        uint64_t    hash;
+        int32_t     location;  // -1表示空槽
+        GLenum      type;
+        std::string name;
+    };
+
+    GLProgram                  program;
     std::array<std::string, 3> load_path;
+    std::vector<UniformSlot>   uniform_table;  // 容量是2的幂
+    size_t                     uniform_num;    // uniform_table中已用的槽数
 
     static void checkShaderCompiling(GLuint shader);
     static void checkShaderProgramCompiling(GLuint shaderProgram);
 
+    void compile_and_link(const std::string& vertexShader_code,
+                          const std::string& fragShader_code,
+                          const std::string& geomShader_code) const;
+    void compile_and_link_compute(const std::string& computeShader_code) const;
+    /// @brief 把程序的大小报告给GLResourceRegistry
+    void track_program_bytes() const;
+    void reflect_uniforms();
+    void insert_uniform(const std::string& name, int32_t location, GLenum type);
+    /// @brief 容量翻倍，把已有的槽重新放进新表（名字各不相同，不需要比较）
+    void grow_uniform_table();
+
+    [[nodiscard]] const UniformSlot* find_uniform(std::string_view name, uint64_t hash) const;
+    [[nodiscard]] static bool        is_uniform_type_compatible(GLenum actual_type,
+                                                                GLenum expected_type);
+
 public:
     Shader(const std::string& vertexShader_path,
            const std::string& fragmentShader_path,
            const std::string& geometryShader_path = "");
-    ~Shader();
+    /// @brief 计算着色器程序，用glDispatchCompute执行
+    explicit Shader(const std::string& computeShader_path);
 
-    Shader(const Shader&)            = default;
-    Shader& operator=(const Shader&) = default;
+    // NOTE - Shader独占程序对象，复制会导致重复删除；移动后原对象不再持有程序
+    Shader(const Shader&)            = delete;
+    Shader& operator=(const Shader&) = delete;
     Shader(Shader&&)                 = default;
     Shader& operator=(Shader&&)      = default;
 
@@ -41,6 +114,37 @@ public:
     void setParameter(const std::string& name, const glm::vec2& value) const;
     void setParameter(const std::string& name, const glm::mat4& value) const;
 
+    void setParameter(UniformHandle<bool> handle, const bool& value) const;
+    void setParameter(UniformHandle<int> handle, const int& value) const;
+    void setParameter(UniformHandle<float> handle, const float& value) const;
+    void setParameter(UniformHandle<glm::vec3> handle, const glm::vec3& value) const;
+    void setParameter(UniformHandle<glm::vec2> handle, const glm::vec2& value) const;
+    void setParameter(UniformHandle<glm::mat4> handle, const glm::mat4& value) const;
+
+    template <typename T> void setParameter(const UniformName& name, const T& value) const
+    {
+        setParameter(get_uniform<T>(name), value);
+    }
+
+    /// @brief 查询uniform句柄，类型不匹配或者uniform不存在时返回无效句柄
+    template <typename T> [[nodiscard]] UniformHandle<T> get_uniform(const UniformName& name) const
+    {
+        const UniformSlot* slot = find_uniform(name.get_name(), name.get_hash());
+        if (slot == nullptr) { return UniformHandle<T>(); }
+        if (!is_uniform_type_compatible(slot->type, UniformGLType<T>::value))
+        {
+            LOG(WARNING) << "uniform type mismatch: " << name.get_name();
+            return UniformHandle<T>();
+        }
+        return UniformHandle<T>(slot->location);
+    }
+    template <typename T> [[nodiscard]] UniformHandle<T> get_uniform(const std::string& name) const
+    {
+        return get_uniform<T>(UniformName(name));
+    }
+
+    [[nodiscard]] int32_t get_uniform_location(const std::string& name) const;
+
     [[nodiscard]] uint32_t                          get_id() const;
     [[nodiscard]] const std::array<std::string, 3>& get_load_path() const;
 
@@ -0,0 +1,200 @@
+#include "shader_cache.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <glog/logging.h>
+
+#include "core/ck_debug.h"
+
+namespace {
+
+const uint32_t SHADER_CACHE_MAGIC = 0x42504B43;  // "CKPB"
+
+struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key_hash;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+std::string shader_cache_directory = ck::DEFAULT_SHADER_CACHE_DIRECTORY;
+
+/// @brief FNV-1a，每段之后额外混入一个分隔符，避免 "ab"+"c" 和 "a"+"bc" 撞车
+void hash_append(uint64_t& hash, const std::string_view str)
+{
+    for (const char c : str)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= 0xFF;
+    hash *= 1099511628211ULL;
+}
+
+std::string_view get_gl_string(const GLenum name)
+{
+    const auto* str = reinterpret_cast<const char*>(glGetString(name));
+    return (str == nullptr) ? std::string_view() : std::string_view(str);
+}
+
+}  // namespace
+
+ck::ShaderCacheKey ck::ShaderCacheKey::from_sources(const std::array<std::string, 3>& sources)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash_append(hash, std::to_string(SHADER_CACHE_VERSION));
+    hash_append(hash, get_gl_string(GL_VENDOR));
+    hash_append(hash, get_gl_string(GL_RENDERER));
+    hash_append(hash, get_gl_string(GL_VERSION));
+    hash_append(hash, get_gl_string(GL_SHADING_LANGUAGE_VERSION));
+    for (const auto& source : sources)
+    {
+        hash_append(hash, source);
+    }
+    return {hash};
+}
+
+[[nodiscard]] std::string ck::ShaderCacheKey::to_hex() const
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string       hex(16, '0');
+    for (int i = 0; i < 16; i++)
+    {
+        hex[15 - i] = digits[(hash >> (i * 4)) & 0xF];
+    }
+    return hex;
+}
+
+[[nodiscard]] bool ck::is_shader_cache_enabled()
+{
+    static const bool enabled = [] {
+        const char* env = std::getenv("CK_SHADER_CACHE");
+        if (env != nullptr && std::strcmp(env, "0") == 0)
+        {
+            LOG(INFO) << "shader cache disabled by CK_SHADER_CACHE=0";
+            return false;
+        }
+        GLint format_num = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_num);
+        if (format_num <= 0)
+        {
+            LOG(INFO) << "shader cache disabled: driver supports no program binary format";
+            return false;
+        }
+        return true;
+    }();
+    return enabled;
+}
+
+void ck::set_shader_cache_directory(const std::string& directory)
+{
+    shader_cache_directory = directory;
+}
+
+[[nodiscard]] std::string ck::get_shader_cache_path(const ShaderCacheKey& key)
+{
+    return shader_cache_directory + "/" + key.to_hex() + ".ckprog";
+}
+
+bool ck::load_program_binary(const uint32_t program, const ShaderCacheKey& key)
+{
+    const std::string cache_path = get_shader_cache_path(key);
+    std::ifstream     file(cache_path, std::ios::binary);
+    if (!file.is_open()) { return false; }
+
+    ShaderCacheHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || header.magic != SHADER_CACHE_MAGIC ||
+        header.version != SHADER_CACHE_VERSION || header.key_hash != key.hash)
+    {
+        return false;
+    }
+    // 头中的大小来自磁盘，先和文件大小核对，损坏的缓存不会申请巨大的内存
+    std::error_code error;
+    const uintmax_t file_size = std::filesystem::file_size(cache_path, error);
+    if (error || file_size != sizeof(header) + static_cast<uintmax_t>(header.binary_size))
+    {
+        LOG(INFO) << "corrupt shader cache, recompile: " << cache_path;
+        file.close();
+        std::filesystem::remove(cache_path, error);
+        return false;
+    }
+    std::vector<char> binary(header.binary_size);
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!file.good()) { return false; }
+
+    // NOTE - 驱动拒绝二进制时可能产生GL_INVALID_ENUM，这是预期内的，要清掉它。
+    //        GL_CHECK()是采样的，之前的错误可能还没被读走：先报告出来，只丢弃这里产生的错误
+    ck::glCheckError_(__FILE__, __LINE__);
+    glProgramBinary(program, header.binary_format, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+    GLint link_status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+    glGetError();
+    if (link_status != GL_TRUE)
+    {
+        LOG(INFO) << "driver rejected cached program binary, recompile: " << cache_path;
+        std::filesystem::remove(cache_path, error);
+        return false;
+    }
+    return true;
+}
+
+bool ck::store_program_binary(const uint32_t program, const ShaderCacheKey& key)
+{
+    GLint binary_size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (binary_size <= 0) { return false; }
+
+    std::vector<char> binary(binary_size);
+    GLenum            binary_format = 0;
+    glGetProgramBinary(program, binary_size, nullptr, &binary_format, binary.data());
+    GL_CHECK();
+
+    std::error_code error;
+    std::filesystem::create_directories(shader_cache_directory, error);
+
+    // 先写到临时文件，成功后再替换，避免留下写了一半的缓存
+    const std::string cache_path = get_shader_cache_path(key);
+    const std::string temp_path  = cache_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            LOG(WARNING) << "failed to create shader cache: " << temp_path;
+            return false;
+        }
+        const ShaderCacheHeader header = {SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key.hash,
+                                          binary_format, static_cast<uint32_t>(binary_size)};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file.good())
+        {
+            LOG(WARNING) << "failed to write shader cache: " << temp_path;
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error)
+    {
+        LOG(WARNING) << "failed to replace shader cache " << cache_path << ": " << error.message();
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
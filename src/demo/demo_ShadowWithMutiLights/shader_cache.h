@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include <array>
+#include <string>
+
+namespace ck {
+
+/**NOTE - 着色器程序二进制缓存
+每次启动都从GLSL源码编译、链接所有着色器，在软件光栅（llvmpipe）上尤其慢。
+第一次链接成功后用glGetProgramBinary取出驱动的二进制，写进 <cache directory>/<key>.ckprog，
+之后的启动直接glProgramBinary载入；驱动拒绝（驱动升级、换了显卡……）时退回源码编译并覆盖缓存。
+
+缓存键是以下内容的哈希：
+    GL_VENDOR / GL_RENDERER / GL_VERSION / GL_SHADING_LANGUAGE_VERSION
+    各个阶段的着色器源码（#define也写在源码里，所以已经包含在内）
+
+设置环境变量 CK_SHADER_CACHE=0 可以关闭缓存，用来对比有无缓存时的启动耗时。
+*/
+static const uint32_t SHADER_CACHE_VERSION             = 1;
+static const char     DEFAULT_SHADER_CACHE_DIRECTORY[] = "shader_cache";
+
+/// @brief 判断缓存是否有效的全部依据
+struct ShaderCacheKey
+{
+    uint64_t hash;
+
+    /// @brief 需要在GL线程调用（要查询驱动信息）
+    /// @param sources 顶点/片元/几何着色器源码，没有的阶段为空字符串
+    static ShaderCacheKey from_sources(const std::array<std::string, 3>& sources);
+
+    [[nodiscard]] std::string to_hex() const;
+};
+
+/// @brief 驱动支持程序二进制并且没有被环境变量关闭
+[[nodiscard]] bool is_shader_cache_enabled();
+
+void set_shader_cache_directory(const std::string& directory);
+
+[[nodiscard]] std::string get_shader_cache_path(const ShaderCacheKey& key);
+
+/// @brief 尝试从缓存载入程序二进制
+/// @return 载入并且链接成功时返回true；失败时program保持未链接状态，可以继续从源码链接
+bool load_program_binary(uint32_t program, const ShaderCacheKey& key);
+
+/// @brief 把已经链接成功的程序写进缓存
+/// @note 链接前需要设置GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+bool store_program_binary(uint32_t program, const ShaderCacheKey& key);
+
+};  // namespace ck
@@ -0,0 +1,718 @@
+#include "shadow_atlas.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glog/logging.h>
+
+#include "bounds.h"
+#include "bvh.h"
+#include "camera.h"
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+#include "entity_registry.h"
+#include "light.h"
+#include "model.h"
+#include "render_object.h"
+#include "shader.h"
+#include "transform.h"
+
+extern const std::string stdAsset_root;
+
+namespace {
+
+const uint32_t SHADOW_TILE_LEVEL_NUM = 6;  // 4096 -> 128
+
+/// @brief 点光立方体6个面的朝向，顺序和着色器中按主轴选面的顺序一致：+X,-X,+Y,-Y,+Z,-Z
+const std::array<glm::vec3, 6> CUBE_FACE_DIRECTIONS = {
+    glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+    glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)};
+const std::array<glm::vec3, 6> CUBE_FACE_UPS = {
+    glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+    glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)};
+
+glm::vec3 choose_up(const glm::vec3& direction)
+{
+    return (std::abs(direction.y) > 0.99F) ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+}
+
+glm::vec3 get_light_direction(const glm::vec3& rotation)
+{
+    return (glm::dot(rotation, rotation) > 0.0F) ? glm::normalize(rotation) : glm::vec3(0, -1, 0);
+}
+
+}  // namespace
+
+// ANCHOR - tile分配
+
+ck::ShadowTileAllocator::ShadowTileAllocator() : free_tiles(SHADOW_TILE_LEVEL_NUM)
+{
+    free_tiles[0].emplace_back(0, 0);
+}
+
+[[nodiscard]] uint32_t ck::ShadowTileAllocator::get_level(const uint32_t tile_size)
+{
+    uint32_t level = 0;
+    while ((SHADOW_ATLAS_SIZE >> level) > tile_size && level + 1 < SHADOW_TILE_LEVEL_NUM)
+    {
+        level++;
+    }
+    return level;
+}
+
+bool ck::ShadowTileAllocator::allocate_level(const uint32_t level, glm::uvec2& origin)
+{
+    std::vector<glm::uvec2>& tiles = free_tiles[level];
+    if (!tiles.empty())
+    {
+        origin = tiles.back();
+        tiles.pop_back();
+        return true;
+    }
+    if (level == 0) { return false; }
+
+    // 没有这一层的空闲tile时，拆开一个上一层的tile，留下其余三个
+    glm::uvec2 parent{0};
+    if (!allocate_level(level - 1, parent)) { return false; }
+    const uint32_t size = SHADOW_ATLAS_SIZE >> level;
+    tiles.emplace_back(parent.x + size, parent.y + size);
+    tiles.emplace_back(parent.x, parent.y + size);
+    tiles.emplace_back(parent.x + size, parent.y);
+    origin = parent;
+    return true;
+}
+
+void ck::ShadowTileAllocator::free_level(const uint32_t level, const glm::uvec2 origin)
+{
+    std::vector<glm::uvec2>& tiles = free_tiles[level];
+    if (level == 0)
+    {
+        tiles.push_back(origin);
+        return;
+    }
+
+    // 三个兄弟都空闲时合并回父节点
+    const uint32_t                  size   = SHADOW_ATLAS_SIZE >> level;
+    const glm::uvec2                parent = origin / (size * 2) * (size * 2);
+    const std::array<glm::uvec2, 4> siblings = {parent, parent + glm::uvec2(size, 0),
+                                                parent + glm::uvec2(0, size),
+                                                parent + glm::uvec2(size, size)};
+    std::array<size_t, 3> found{};
+    uint32_t              found_num = 0;
+    for (const glm::uvec2& sibling : siblings)
+    {
+        if (sibling == origin) { continue; }
+        const auto it = std::find(tiles.begin(), tiles.end(), sibling);
+        if (it == tiles.end()) { break; }
+        found[found_num++] = static_cast<size_t>(it - tiles.begin());
+    }
+    if (found_num < 3)
+    {
+        tiles.push_back(origin);
+        return;
+    }
+
+    // 从后往前删，下标不会失效
+    std::sort(found.begin(), found.end());
+    for (auto it = found.rbegin(); it != found.rend(); ++it)
+    {
+        tiles[*it] = tiles.back();
+        tiles.pop_back();
+    }
+    free_level(level - 1, parent);
+}
+
+bool ck::ShadowTileAllocator::allocate(const uint32_t tile_size, glm::uvec2& origin)
+{
+    return allocate_level(get_level(tile_size), origin);
+}
+
+void ck::ShadowTileAllocator::free(const uint32_t tile_size, const glm::uvec2 origin)
+{
+    free_level(get_level(tile_size), origin);
+}
+
+// ANCHOR - 阴影图集
+
+ck::ShadowAtlas::ShadowAtlas()
+    : frame(0), cascade_num(CSM_MAX_CASCADE_NUM), cascade_lambda(CSM_DEFAULT_LAMBDA),
+      cascade_max_distance(CSM_DEFAULT_MAX_DISTANCE), cascade_slices{}, stats{},
+      records_capacity(0),
+      depth_shader(stdAsset_root + "stdShader/stdShadowDepth.vs.glsl",
+                   stdAsset_root + "stdShader/stdShadowDepth.fs.glsl")
+{
+    model_uniform                 = depth_shader.get_uniform<glm::mat4>("model");
+    light_view_projection_uniform = depth_shader.get_uniform<glm::mat4>("lightViewProjection");
+}
+
+ck::ShadowAtlas::~ShadowAtlas()
+{
+    shutdown();
+}
+
+void ck::ShadowAtlas::shutdown()
+{
+    records_buffer.reset();
+    atlas_texture.reset();
+    framebuffer.reset();
+    records_capacity = 0;
+
+    // 图集没有了，缓存的深度也随之失效
+    casters.clear();
+    allocator = ShadowTileAllocator();
+}
+
+void ck::ShadowAtlas::create_atlas()
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+
+    atlas_texture.create("shadow atlas", "ShadowAtlas");
+    gl_state.bind_texture(SHADOW_ATLAS_TEXTURE_UNIT, GL_TEXTURE_2D, atlas_texture.get());
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
+    atlas_texture.set_bytes(static_cast<size_t>(SHADOW_ATLAS_SIZE) * SHADOW_ATLAS_SIZE * 4);
+    // 硬件比较 + 线性过滤 = 2x2 PCF
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    // 场景可能画在离屏的帧缓冲上，创建完之后恢复原来的绑定
+    GLint previous_framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+    framebuffer.create("shadow atlas", "ShadowAtlas");
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+    framebuffer.set_bytes(0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas_texture.get(),
+                           0);
+    glDrawBuffer(GL_NONE);  // 只有深度
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG(ERROR) << "Shadow atlas framebuffer is not complete!";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+    GL_CHECK();
+}
+
+void ck::ShadowAtlas::release_caster(ShadowCaster& caster)
+{
+    for (uint32_t i = 0; i < caster.view_num; i++)
+    {
+        allocator.free(caster.tile_size, caster.views[i].tile_origin);
+    }
+    caster.tile_size = 0;
+    caster.view_num  = 0;
+}
+
+[[nodiscard]] uint32_t ck::ShadowAtlas::get_view_num(const int32_t light_type) const
+{
+    // 面光暂时按点光处理
+    if (light_type == 1) { return cascade_num; }
+    return (light_type == 2) ? 1 : 6;
+}
+
+[[nodiscard]] float ck::ShadowAtlas::get_screen_size(const LightUniformData& light,
+                                                     const glm::vec3&        camera_position,
+                                                     const float             projection_scale,
+                                                     const uint32_t          viewport_height)
+{
+    if (light.light_type == 1) { return static_cast<float>(SHADOW_TILE_MAX_SIZE); }
+
+    // 影响范围是一个球，投影到屏幕上的半径 = scale * r / sqrt(d^2 - r^2)（NDC）
+    const glm::vec3 offset      = light.position - camera_position;
+    const float     distance_sq = glm::dot(offset, offset);
+    const float     range_sq    = light.range * light.range;
+    if (distance_sq <= range_sq) { return static_cast<float>(SHADOW_TILE_MAX_SIZE); }  // 在球内
+    const float ndc_radius = projection_scale * light.range / std::sqrt(distance_sq - range_sq);
+    return ndc_radius * static_cast<float>(viewport_height);  // 直径
+}
+
+bool ck::ShadowAtlas::fit_tiles(ShadowCaster& caster, const int32_t light_type, float screen_size)
+{
+    const uint32_t view_num = get_view_num(light_type);
+    if (light_type != 1 && view_num == 6) { screen_size *= 0.5F; }  // 每个面只覆盖90°
+    screen_size = std::clamp(screen_size, static_cast<float>(SHADOW_TILE_MIN_SIZE),
+                             static_cast<float>(SHADOW_TILE_MAX_SIZE));
+
+    // 现有的tile够用、也没有大太多时保持不变
+    if (caster.view_num == view_num)
+    {
+        const auto current = static_cast<float>(caster.tile_size);
+        if (screen_size <= current &&
+            (caster.tile_size == SHADOW_TILE_MIN_SIZE ||
+             screen_size > current * SHADOW_TILE_SHRINK_RATIO))
+        {
+            return true;
+        }
+    }
+
+    release_caster(caster);
+    uint32_t tile_size = SHADOW_TILE_MIN_SIZE;
+    while (static_cast<float>(tile_size) < screen_size)
+    {
+        tile_size *= 2;
+    }
+
+    // 图集不够时逐级降低分辨率
+    for (; tile_size >= SHADOW_TILE_MIN_SIZE; tile_size /= 2)
+    {
+        uint32_t allocated_num = 0;
+        for (; allocated_num < view_num; allocated_num++)
+        {
+            if (!allocator.allocate(tile_size, caster.views[allocated_num].tile_origin)) { break; }
+        }
+        if (allocated_num == view_num)
+        {
+            caster.tile_size = tile_size;
+            caster.view_num  = view_num;
+            for (uint32_t i = 0; i < view_num; i++)
+            {
+                caster.views[i].dirty          = true;
+                caster.views[i].rendered       = false;
+                caster.views[i].cascade_radius = 0.0F;
+            }
+            return true;
+        }
+        for (uint32_t i = 0; i < allocated_num; i++)
+        {
+            allocator.free(tile_size, caster.views[i].tile_origin);
+        }
+    }
+    return false;
+}
+
+void ck::ShadowAtlas::update_view_projections(ShadowCaster& caster)
+{
+    const LightUniformData& light = caster.snapshot;
+    const float             far_plane = std::max(light.range, SHADOW_NEAR_PLANE * 2.0F);
+
+    if (light.light_type == 1)
+    {
+        // 日光：级联的投影由update_cascades()按相机计算
+        for (uint32_t i = 0; i < caster.view_num; i++)
+        {
+            caster.views[i].cascade_radius = 0.0F;
+        }
+        update_cascades(caster);
+        return;
+    }
+    if (light.light_type == 2)
+    {
+        // 聚光：视角覆盖外圈的张角
+        const glm::vec3 direction = get_light_direction(light.rotation);
+        const float     fov =
+            std::clamp(2.0F * std::acos(std::clamp(light.outer_cutOff, -1.0F, 1.0F)) * 1.05F,
+                       glm::radians(1.0F), glm::radians(170.0F));
+        const glm::mat4 view =
+            glm::lookAt(light.position, light.position + direction, choose_up(direction));
+        caster.views[0].view_projection =
+            glm::perspective(fov, 1.0F, SHADOW_NEAR_PLANE, far_plane) * view;
+    }
+    else
+    {
+        const glm::mat4 projection =
+            glm::perspective(glm::radians(90.0F), 1.0F, SHADOW_NEAR_PLANE, far_plane);
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            caster.views[i].view_projection =
+                projection * glm::lookAt(light.position, light.position + CUBE_FACE_DIRECTIONS[i],
+                                         CUBE_FACE_UPS[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < caster.view_num; i++)
+    {
+        caster.views[i].dirty = true;
+    }
+}
+
+void ck::ShadowAtlas::update_cascade_slices(const RenderingSceneSettingCtx& ctx)
+{
+    const float near_plane = ctx.camera->get_near_plane();
+    const float far_plane  = ctx.camera->get_far_plane();
+    const float max_depth  = std::clamp(cascade_max_distance, near_plane * 2.0F, far_plane);
+
+    // 相机视锥体的8个角，前4个在近平面，后4个在远平面
+    const glm::mat4          inverse_view_projection = glm::inverse(ctx.projection * ctx.view);
+    std::array<glm::vec3, 8> corners{};
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const glm::vec4 ndc((i & 1) ? 1.0F : -1.0F, (i & 2) ? 1.0F : -1.0F,
+                            (i & 4) ? 1.0F : -1.0F, 1.0F);
+        const glm::vec4 world = inverse_view_projection * ndc;
+        corners[i]            = glm::vec3(world) / world.w;
+    }
+
+    float split_near = near_plane;
+    for (uint32_t c = 0; c < cascade_num; c++)
+    {
+        // practical split scheme
+        const float ratio = static_cast<float>(c + 1) / static_cast<float>(cascade_num);
+        const float log_split     = near_plane * std::pow(max_depth / near_plane, ratio);
+        const float uniform_split = near_plane + (max_depth - near_plane) * ratio;
+        const float split_far =
+            cascade_lambda * log_split + (1.0F - cascade_lambda) * uniform_split;
+
+        // 视锥体的棱是从相机出发的射线，观察空间深度沿棱线性变化
+        std::array<glm::vec3, 8> slice{};
+        const float              t_near = (split_near - near_plane) / (far_plane - near_plane);
+        const float              t_far  = (split_far - near_plane) / (far_plane - near_plane);
+        glm::vec3                center(0.0F);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            const glm::vec3 edge = corners[i + 4] - corners[i];
+            slice[i]             = corners[i] + edge * t_near;
+            slice[i + 4]         = corners[i] + edge * t_far;
+            center += slice[i] + slice[i + 4];
+        }
+        center /= 8.0F;
+        float radius = 0.0F;
+        for (const glm::vec3& corner : slice)
+        {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+
+        // 半径取到1/16，避免浮点误差让缓存的级联失效
+        cascade_slices[c] = {split_near, split_far, center, std::ceil(radius * 16.0F) / 16.0F};
+        split_near        = split_far;
+    }
+}
+
+void ck::ShadowAtlas::update_cascades(ShadowCaster& caster)
+{
+    const glm::vec3 direction  = get_light_direction(caster.snapshot.rotation);
+    const glm::mat4 light_view = glm::lookAt(glm::vec3(0.0F), direction, choose_up(direction));
+
+    // 深度范围覆盖整个场景，场景外没有投射阴影的物体
+    float z_min = FLT_MAX;
+    float z_max = -FLT_MAX;
+    if (!caster.scene_bounds.is_empty())
+    {
+        const AABB light_bounds = caster.scene_bounds.transformed(light_view);
+        z_min                   = light_bounds.min.z;
+        z_max                   = light_bounds.max.z;
+    }
+
+    for (uint32_t c = 0; c < caster.view_num; c++)
+    {
+        ShadowView&         view  = caster.views[c];
+        const CascadeSlice& slice = cascade_slices[c];
+        const glm::vec3     center(light_view * glm::vec4(slice.center, 1.0F));
+        const float         half_size = slice.radius * CSM_GUARD_BAND;
+
+        // 外接球还在渲染过的范围内，继续使用
+        const glm::vec2 offset = glm::abs(glm::vec2(center) - view.cascade_center);
+        if (view.cascade_radius == slice.radius &&
+            std::max(offset.x, offset.y) <= half_size - slice.radius)
+        {
+            continue;
+        }
+
+        // 中心对齐到texel，平移时每个texel覆盖的世界空间区域不变
+        const float     texel   = half_size * 2.0F / static_cast<float>(caster.tile_size);
+        const glm::vec2 snapped = glm::floor(glm::vec2(center) / texel) * texel;
+        const float     near_z  = (z_max >= z_min) ? z_max : center.z + half_size;
+        const float     far_z   = (z_max >= z_min) ? z_min : center.z - half_size;
+        // 观察方向是-z，近平面在z_max
+        view.view_projection =
+            glm::ortho(snapped.x - half_size, snapped.x + half_size, snapped.y - half_size,
+                       snapped.y + half_size, -near_z - 0.1F, -far_z + 0.1F) *
+            light_view;
+        view.cascade_center = snapped;
+        view.cascade_radius = slice.radius;
+        view.dirty          = true;
+    }
+}
+
+void ck::ShadowAtlas::render_view(const ShadowCaster&   caster,
+                                  const ShadowView&     view,
+                                  const EntityRegistry& registry,
+                                  DynamicBVH&           bvh)
+{
+    const auto x    = static_cast<GLint>(view.tile_origin.x);
+    const auto y    = static_cast<GLint>(view.tile_origin.y);
+    const auto size = static_cast<GLsizei>(caster.tile_size);
+    glViewport(x, y, size, size);
+    glScissor(x, y, size, size);  // 只清除自己的tile
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    depth_shader.setParameter(light_view_projection_uniform, view.view_projection);
+
+    CullingStats query_stats{};
+    bvh.query(Frustum(view.view_projection), caster_entities, query_stats);
+    const std::vector<Renderable>& renderables = registry.get_renderables();
+    for (const uint32_t entity_index : caster_entities)
+    {
+        const uint32_t i = registry.get_renderable_index(entity_index);
+        if (i == NULL_ENTITY_INDEX) { continue; }
+        // 只有几何体投射阴影，灯光自己的球体不投射
+        if (renderables[i].get_object_type() != RenderObjectType::POLYGEN_MESH) { continue; }
+        const Model* model = renderables[i].get_model();
+        if (model == nullptr) { continue; }
+
+        depth_shader.setParameter(model_uniform, registry.get_renderable_world_matrix(i));
+        for (const Mesh& mesh : model->get_meshes())
+        {
+            mesh.draw(depth_shader);
+        }
+    }
+}
+
+void ck::ShadowAtlas::update(const EntityRegistry&           registry,
+                             DynamicBVH&                     bvh,
+                             const std::vector<AABB>&        invalidated_bounds,
+                             const RenderingSceneSettingCtx& ctx,
+                             const uint32_t                  viewport_height)
+{
+    frame++;
+    stats = {};
+    update_cascade_slices(ctx);
+
+    const std::vector<Light>& lights = registry.get_lights();
+    light_casters.assign(lights.size(), nullptr);
+    const AABB scene_bounds = bvh.get_root_bounds();
+
+    // 同步灯光：分配tile，检查哪些tile失效了
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        const int32_t light_type = lights[i].get_light_type();
+        if (light_type == -1) { continue; }
+        const Transform&       transform = registry.get_light_transform(i);
+        const LightUniformData light =
+            lights[i].get_uniform_data(transform.get_world_position(), transform.get_rotation());
+        const EntityHandle entity = registry.get_light_entity(i);
+
+        auto [it, inserted] = casters.try_emplace(entity.index);
+        ShadowCaster& caster = it->second;
+        if (inserted || caster.entity != entity)
+        {
+            // 新的灯光，或者实体下标被别的灯光复用了
+            if (!inserted) { release_caster(caster); }
+            caster                     = {};
+            caster.entity              = entity;
+            caster.snapshot.light_type = -1;  // 保证第一次比较时不相等
+        }
+        caster.last_seen_frame = frame;
+
+        const float screen_size =
+            get_screen_size(light, ctx.camera_position, ctx.projection[1][1], viewport_height);
+        if (!fit_tiles(caster, light_type, screen_size))
+        {
+            stats.failed_num++;
+            continue;
+        }
+        light_casters[i] = &caster;
+
+        // 灯光本身变了：整组tile重新计算、重新渲染
+        bool light_changed = std::memcmp(&caster.snapshot, &light, sizeof(LightUniformData)) != 0;
+        if (light_type == 1 && !scene_bounds.is_empty() &&
+            !caster.scene_bounds.contains(scene_bounds))
+        {
+            // 级联的深度范围留出余量，场景包围盒小幅变化时不用重新渲染所有级联
+            caster.scene_bounds =
+                scene_bounds.fattened(scene_bounds.get_extent() * 0.1F + glm::vec3(1.0F));
+            light_changed = true;
+        }
+        if (light_changed)
+        {
+            caster.snapshot = light;
+            update_view_projections(caster);
+            continue;
+        }
+        if (light_type == 1) { update_cascades(caster); }  // 相机移动后外接球可能超出渲染过的范围
+
+        // 灯光没变：只有视锥体内有几何体变化的tile需要重新渲染
+        if (invalidated_bounds.empty()) { continue; }
+        for (uint32_t v = 0; v < caster.view_num; v++)
+        {
+            ShadowView& view = caster.views[v];
+            if (view.dirty) { continue; }
+            const Frustum frustum(view.view_projection);
+            for (const AABB& bounds : invalidated_bounds)
+            {
+                if (frustum.test(bounds) != FrustumTestResult::OUTSIDE)
+                {
+                    view.dirty = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 删除的灯光归还tile
+    for (auto it = casters.begin(); it != casters.end();)
+    {
+        if (it->second.last_seen_frame == frame)
+        {
+            ++it;
+            continue;
+        }
+        release_caster(it->second);
+        it = casters.erase(it);
+    }
+
+    // 按预算重新渲染失效的tile，等得最久的优先
+    dirty_views.clear();
+    for (ShadowCaster* caster : light_casters)
+    {
+        if (caster == nullptr) { continue; }
+        for (uint32_t v = 0; v < caster->view_num; v++)
+        {
+            if (caster->views[v].dirty) { dirty_views.emplace_back(caster, v); }
+        }
+    }
+    if (!dirty_views.empty())
+    {
+        const size_t render_num = std::min<size_t>(dirty_views.size(), SHADOW_VIEW_UPDATE_BUDGET);
+        std::partial_sort(dirty_views.begin(), dirty_views.begin() + render_num, dirty_views.end(),
+                          [](const auto& a, const auto& b) {
+                              return a.first->views[a.second].rendered_frame <
+                                     b.first->views[b.second].rendered_frame;
+                          });
+
+        if (!atlas_texture.is_valid()) { create_atlas(); }
+        GLStateCache& gl_state             = GLStateCache::get_instance();
+        GLint         previous_framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+        depth_shader.use();
+        gl_state.set_capability(GL_DEPTH_TEST, true);
+        gl_state.set_depth_mask(true);
+        gl_state.set_depth_func(GL_LESS);
+        gl_state.set_capability(GL_SCISSOR_TEST, true);
+        gl_state.set_capability(GL_POLYGON_OFFSET_FILL, true);
+        glPolygonOffset(2.0F, 4.0F);  // 斜率偏移，减少阴影痤疮
+
+        for (size_t i = 0; i < render_num; i++)
+        {
+            ShadowCaster& caster = *dirty_views[i].first;
+            ShadowView&   view   = caster.views[dirty_views[i].second];
+            render_view(caster, view, registry, bvh);
+            view.rendered_view_projection = view.view_projection;
+            view.dirty                    = false;
+            view.rendered                 = true;
+            view.rendered_frame           = frame;
+        }
+        stats.rendered_view_num = static_cast<uint32_t>(render_num);
+
+        gl_state.set_capability(GL_POLYGON_OFFSET_FILL, false);
+        gl_state.set_capability(GL_SCISSOR_TEST, false);
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+        GL_CHECK();
+    }
+
+    // 所有tile都渲染过的灯光才有阴影
+    records.clear();
+    light_shadow_indices.assign(lights.size(), -1);
+    const float atlas_size = static_cast<float>(SHADOW_ATLAS_SIZE);
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        const ShadowCaster* caster = light_casters[i];
+        if (caster == nullptr) { continue; }
+        stats.caster_num++;
+        stats.view_num += caster->view_num;
+
+        const bool ready = std::all_of(caster->views.begin(),
+                                       caster->views.begin() + caster->view_num,
+                                       [](const ShadowView& view) { return view.rendered; });
+        if (!ready) { continue; }
+        light_shadow_indices[i] = static_cast<int32_t>(records.size());
+        const bool is_cascade = caster->snapshot.light_type == 1;
+        for (uint32_t v = 0; v < caster->view_num; v++)
+        {
+            const ShadowView& view = caster->views[v];
+            const glm::vec4   cascade =
+                is_cascade ? glm::vec4(cascade_slices[v].near_depth, cascade_slices[v].far_depth,
+                                       static_cast<float>(caster->view_num), 0.0F)
+                             : glm::vec4(0.0F);
+            records.push_back({view.rendered_view_projection,
+                               glm::vec4(glm::vec2(view.tile_origin) / atlas_size,
+                                         glm::vec2(static_cast<float>(caster->tile_size)) /
+                                             atlas_size),
+                               cascade});
+        }
+    }
+}
+
+void ck::ShadowAtlas::upload_and_bind()
+{
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    if (!atlas_texture.is_valid()) { create_atlas(); }  // 没有阴影时也要有一张合法的纹理
+
+    if (!records_buffer.is_valid()) { records_buffer.create("shadow records", "ShadowAtlas"); }
+    gl_state.bind_buffer(GL_SHADER_STORAGE_BUFFER, records_buffer.get());
+    if (records_capacity < std::max<size_t>(records.size(), 1))
+    {
+        records_capacity = std::max<size_t>(64, records_capacity);
+        while (records_capacity < records.size()) { records_capacity *= 2; }
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     static_cast<GLsizeiptr>(records_capacity * sizeof(ShadowRecord)), nullptr,
+                     GL_DYNAMIC_DRAW);
+        records_buffer.set_bytes(records_capacity * sizeof(ShadowRecord));
+    }
+    if (!records.empty())
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                        static_cast<GLsizeiptr>(records.size() * sizeof(ShadowRecord)),
+                        records.data());
+    }
+
+    gl_state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, SHADOW_RECORDS_BINDING,
+                              records_buffer.get());
+    gl_state.bind_texture(SHADOW_ATLAS_TEXTURE_UNIT, GL_TEXTURE_2D, atlas_texture.get());
+    GL_CHECK();
+}
+
+void ck::ShadowAtlas::set_cascade_num(const uint32_t num)
+{
+    // 级联数变了，日光在下一次update()时重新分配tile
+    cascade_num = std::clamp(num, 1U, CSM_MAX_CASCADE_NUM);
+}
+
+void ck::ShadowAtlas::set_cascade_lambda(const float lambda)
+{
+    cascade_lambda = std::clamp(lambda, 0.0F, 1.0F);
+}
+
+void ck::ShadowAtlas::set_cascade_max_distance(const float distance)
+{
+    cascade_max_distance = std::max(distance, 0.0F);
+}
+
+[[nodiscard]] uint32_t ck::ShadowAtlas::get_cascade_num() const
+{
+    return cascade_num;
+}
+
+[[nodiscard]] float ck::ShadowAtlas::get_cascade_lambda() const
+{
+    return cascade_lambda;
+}
+
+[[nodiscard]] float ck::ShadowAtlas::get_cascade_max_distance() const
+{
+    return cascade_max_distance;
+}
+
+[[nodiscard]] const std::vector<int32_t>& ck::ShadowAtlas::get_light_shadow_indices() const
+{
+    return light_shadow_indices;
+}
+
+[[nodiscard]] const ck::ShadowAtlasStats& ck::ShadowAtlas::get_stats() const
+{
+    return stats;
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "bvh.h"
+#include "core/ck_gl_resource.h"
+#include "entity_registry.h"
+#include "light.h"
+#include "render_object.h"
+#include "shader.h"
+
+namespace ck {
+
+static const uint32_t SHADOW_ATLAS_SIZE         = 4096;
+static const uint32_t SHADOW_TILE_MAX_SIZE      = 1024;
+static const uint32_t SHADOW_TILE_MIN_SIZE      = 128;
+static const uint32_t SHADOW_VIEW_UPDATE_BUDGET = 12;     // 每帧最多重新渲染的tile数（两盏点光）
+static const float    SHADOW_TILE_SHRINK_RATIO  = 0.375F;  // 屏幕尺寸低于tile的3/8时才缩小
+static const float    SHADOW_NEAR_PLANE         = 0.05F;
+
+// 日光的级联阴影
+static const uint32_t CSM_MAX_CASCADE_NUM      = 4;
+static const float    CSM_DEFAULT_LAMBDA       = 0.75F;   // 对数划分和均匀划分的混合比例
+static const float    CSM_DEFAULT_MAX_DISTANCE = 100.0F;  // 超出这个距离没有日光阴影
+static const float    CSM_GUARD_BAND           = 1.25F;   // 级联渲染的范围比需要的大，见下面的说明
+
+static const uint32_t SHADOW_RECORDS_BINDING    = 5;   // SSBO binding，2~4是分簇光照
+static const uint32_t SHADOW_ATLAS_TEXTURE_UNIT = 15;  // 和着色器中的layout(binding)一致
+
+/// @brief 着色器中的一条阴影记录（std430）
+struct ShadowRecord
+{
+    glm::mat4 view_projection;
+    glm::vec4 atlas_rect;  // xy：tile在图集中的起点，zw：tile的大小，都以UV为单位
+    glm::vec4 cascade;     // 日光：xy：级联覆盖的观察空间深度[near, far)，z：级联数
+};
+static_assert(sizeof(ShadowRecord) == 96);
+
+/// @brief 一帧阴影的统计
+struct ShadowAtlasStats
+{
+    uint32_t caster_num;         // 投射阴影的灯光数
+    uint32_t view_num;           // 占用的tile数
+    uint32_t rendered_view_num;  // 本帧重新渲染的tile数
+    uint32_t failed_num;         // 图集放不下、没有阴影的灯光数
+};
+
+/// @brief 图集中正方形tile的分配器（四叉树伙伴分配）
+/// @note tile的边长是2的幂，起点对齐到边长；释放时四个兄弟都空闲就合并回父节点
+class ShadowTileAllocator {
+private:
+    std::vector<std::vector<glm::uvec2>> free_tiles;  // 每一层空闲tile的起点，第0层是整个图集
+
+    [[nodiscard]] static uint32_t get_level(uint32_t tile_size);
+    bool                          allocate_level(uint32_t level, glm::uvec2& origin);
+    void                          free_level(uint32_t level, glm::uvec2 origin);
+
+public:
+    ShadowTileAllocator();
+
+    /// @return 图集放不下时返回false
+    bool allocate(uint32_t tile_size, glm::uvec2& origin);
+    void free(uint32_t tile_size, glm::uvec2 origin);
+};
+
+/// @brief 所有投射阴影的灯光共用一张深度图集
+/**NOTE - 阴影图集
+1. 聚光占一个tile（透视投影），点光占6个tile（立方体的6个面，各90°透视投影），
+   日光占CSM_MAX_CASCADE_NUM以内可配置数量的tile（级联阴影，每级一个正交投影）。
+2. tile的大小按灯光在屏幕上的重要性选择：灯光影响范围投影到屏幕上的像素数，取2的幂。
+   变大时立刻重新分配；变小到tile的3/8（SHADOW_TILE_SHRINK_RATIO）以下才重新分配，
+   避免在阈值附近来回抖动。
+3. 每个tile缓存自己的深度，只在下面的情况下重新渲染：
+   - 灯光的参数或位置变了（和上一次渲染时的记录比较）；
+   - 有几何体在这个tile的视锥体内移动、出现或者消失（Scene收集移动前后的包围盒）。
+   静止的场景中阴影不产生任何绘制，开销只和场景的变化有关，和灯光数 × 帧数无关。
+4. 每帧重新渲染的tile数有上限，超出的留到下一帧；tile第一次渲染完成之前灯光没有阴影。
+着色器通过灯光记录中的shadow_index找到阴影记录，点光按方向的主轴选择对应的面。
+*/
+/**NOTE - 级联阴影
+1. 划分：相机的[near, min(far, max_distance)]按practical split scheme分段，
+   d_i = lambda * n * (f / n)^(i / N) + (1 - lambda) * (n + (f - n) * i / N)。
+2. 稳定：每一段视锥体取外接球，半径只和fov、宽高比、分段有关，相机转动时不变；
+   灯光空间固定在原点，球心对齐到texel的整数倍，相机平移时阴影边缘不会闪烁。
+3. 缓存：每级按外接球半径的CSM_GUARD_BAND倍渲染，只要新的外接球还在渲染过的范围内，
+   就继续使用原来的深度，不需要每帧为每一级重画整个场景；越远的级联覆盖越大，更新越少。
+4. 剔除：深度范围取场景包围盒在灯光空间的范围，每级只绘制和自己的正交视锥体相交的物体，
+   和场景不相交的级联只清除深度。
+着色器按片元的观察空间深度选择级联，在每一段的末尾CASCADE_BLEND_RATIO内和下一级混合。
+*/
+class ShadowAtlas {
+private:
+    struct ShadowView
+    {
+        glm::uvec2 tile_origin;
+        glm::mat4  view_projection;
+        glm::mat4  rendered_view_projection;  // tile中的深度对应的矩阵，等待重新渲染时仍然有效
+        uint64_t   rendered_frame;  // 上一次渲染的帧，预算不够时先渲染等得最久的
+        bool       dirty;
+        bool       rendered;  // 至少渲染过一次
+
+        // 级联：渲染范围的中心（灯光空间，已对齐到texel）和外接球半径，半径为0表示需要重新计算
+        glm::vec2 cascade_center;
+        float     cascade_radius;
+    };
+
+    /// @brief 相机视锥体的一段，每帧计算一次，所有日光共用
+    struct CascadeSlice
+    {
+        float     near_depth;
+        float     far_depth;
+        glm::vec3 center;  // 外接球，世界空间
+        float     radius;
+    };
+
+    struct ShadowCaster
+    {
+        EntityHandle              entity;
+        LightUniformData          snapshot;  // 上一次计算view_projection时的灯光
+        AABB                      scene_bounds;  // 日光：上一次计算深度范围时的场景包围盒
+        uint32_t                  tile_size;
+        uint32_t                  view_num;
+        std::array<ShadowView, 6> views;
+        uint64_t                  last_seen_frame;
+    };
+
+    ShadowTileAllocator                        allocator;
+    std::unordered_map<uint32_t, ShadowCaster> casters;  // 灯光所属的实体下标 -> 阴影
+    uint64_t                                   frame;
+
+    uint32_t                                      cascade_num;
+    float                                         cascade_lambda;
+    float                                         cascade_max_distance;
+    std::array<CascadeSlice, CSM_MAX_CASCADE_NUM> cascade_slices;
+
+    // 以下每帧重建，复用内存
+    std::vector<ShadowCaster*>                     light_casters;  // 按灯光组件下标，可能为空
+    std::vector<std::pair<ShadowCaster*, uint32_t>> dirty_views;
+    std::vector<uint32_t>                          caster_entities;  // BVH查询结果
+    std::vector<ShadowRecord>                      records;
+    std::vector<int32_t>                           light_shadow_indices;  // 按灯光组件下标
+    ShadowAtlasStats                               stats;
+
+    GLTexture     atlas_texture;
+    GLFramebuffer framebuffer;
+    GLBuffer      records_buffer;
+    size_t        records_capacity;  // 以记录为单位
+
+    Shader                   depth_shader;
+    UniformHandle<glm::mat4> model_uniform;
+    UniformHandle<glm::mat4> light_view_projection_uniform;
+
+    void create_atlas();
+    void release_caster(ShadowCaster& caster);
+    /// @brief 按重要性选择tile大小，需要时重新分配
+    /// @return 图集放不下时返回false
+    bool fit_tiles(ShadowCaster& caster, int32_t light_type, float screen_size);
+    void update_view_projections(ShadowCaster& caster);
+    /// @brief 按相机计算每一段视锥体的外接球
+    void update_cascade_slices(const RenderingSceneSettingCtx& ctx);
+    /// @brief 外接球超出渲染过的范围时重新计算级联的投影，并标记为需要重新渲染
+    void update_cascades(ShadowCaster& caster);
+    void render_view(const ShadowCaster&   caster,
+                     const ShadowView&     view,
+                     const EntityRegistry& registry,
+                     DynamicBVH&           bvh);
+
+    [[nodiscard]] uint32_t get_view_num(int32_t light_type) const;
+    /// @brief 灯光影响范围投影到屏幕上的直径（像素），日光总是取最大值
+    [[nodiscard]] static float get_screen_size(const LightUniformData& light,
+                                               const glm::vec3&        camera_position,
+                                               float                   projection_scale,
+                                               uint32_t                viewport_height);
+
+public:
+    ShadowAtlas();
+    ~ShadowAtlas();
+
+    ShadowAtlas(const ShadowAtlas&)            = delete;
+    ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+    /// @brief 为场景中的灯光分配tile，并重新渲染失效的tile
+    /// @param invalidated_bounds 自上一帧以来移动、出现或者消失的几何体的世界包围盒
+    /// @note 会修改viewport，调用之后需要恢复；帧缓冲的绑定会还原成调用前的
+    void update(const EntityRegistry&           registry,
+                DynamicBVH&                     bvh,
+                const std::vector<AABB>&        invalidated_bounds,
+                const RenderingSceneSettingCtx& ctx,
+                uint32_t                        viewport_height);
+
+    /// @brief 上传阴影记录，绑定图集和SSBO
+    void upload_and_bind();
+
+    /// @brief 释放GL资源，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    /// @brief 日光的级联数，范围[1, CSM_MAX_CASCADE_NUM]
+    void set_cascade_num(uint32_t num);
+    /// @brief 划分的混合比例，0为均匀划分，1为对数划分
+    void set_cascade_lambda(float lambda);
+    void set_cascade_max_distance(float distance);
+
+    [[nodiscard]] uint32_t get_cascade_num() const;
+    [[nodiscard]] float    get_cascade_lambda() const;
+    [[nodiscard]] float    get_cascade_max_distance() const;
+
+    /// @brief 每个灯光（按EntityRegistry中的灯光组件下标）的第一条阴影记录，-1表示没有阴影
+    [[nodiscard]] const std::vector<int32_t>& get_light_shadow_indices() const;
+    [[nodiscard]] const ShadowAtlasStats&     get_stats() const;
+};
+
+};  // namespace ck
@@ -0,0 +1,283 @@
+#include "texture_loader.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <glad/glad.h>  //glad first
+
+#include <glog/logging.h>
+#include <stb_image.h>
+
+#include "core/ck_cpu_profiler.h"
+#include "core/ck_debug.h"
+#include "core/ck_gl_state.h"
+
+ck::TextureLoader* ck::TextureLoader::singleton = nullptr;
+
+ck::TextureLoader& ck::TextureLoader::get_instance()
+{
+    if (singleton == nullptr)
+    {
+        // hardware_concurrency()可能返回0，先取至少1再减
+        const uint32_t hardware_threads = std::max(1U, std::thread::hardware_concurrency());
+        singleton = new TextureLoader(std::max(1U, hardware_threads - 1));
+        // NOTE - 留一个核给GL线程
+    }
+    return *singleton;
+}
+
+ck::TextureLoader::TextureLoader(const uint32_t worker_num)
+    : stopping(false), decoded_capacity(DEFAULT_DECODED_QUEUE_CAPACITY), pending_num(0),
+      next_ticket(1)
+{
+    for (uint32_t i = 0; i < worker_num; i++)
+    {
+        workers.emplace_back(&TextureLoader::worker_loop, this);
+    }
+    LOG(INFO) << "texture loader started with " << worker_num << " worker threads";
+}
+
+ck::TextureLoader::~TextureLoader()
+{
+    shutdown();
+}
+
+void ck::TextureLoader::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> request_lock(request_mutex);
+        std::lock_guard<std::mutex> decoded_lock(decoded_mutex);
+        stopping = true;
+    }
+    request_cv.notify_all();
+    decoded_cv.notify_all();
+    for (auto& worker : workers)
+    {
+        if (worker.joinable()) { worker.join(); }
+    }
+    workers.clear();
+
+    // 丢弃还没上传的图片
+    for (auto& image : decoded_images)
+    {
+        stbi_image_free(image.pixels);
+    }
+    decoded_images.clear();
+    requests.clear();
+    active_tickets.clear();
+    pending_num = 0;
+
+    pixel_unpack_buffer.reset();
+}
+
+void ck::TextureLoader::worker_loop()
+{
+    stbi_set_flip_vertically_on_load_thread(0);  // 模型纹理不翻转，且不受其他线程的全局设置影响
+    CpuProfiler::get_instance().set_thread_name("texture decoder");
+
+    while (true)
+    {
+        DecodeRequest request;
+        {
+            std::unique_lock<std::mutex> lock(request_mutex);
+            request_cv.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping) { return; }
+            request = std::move(requests.front());
+            requests.pop_front();
+        }
+
+        DecodedImage image = {request.ticket, request.texture_id, std::move(request.file_path),
+                              request.gamma_correction, 0, 0, 0, nullptr};
+        {
+            CK_PROFILE_SCOPE("stbi_load");
+            image.pixels =
+                stbi_load(image.file_path.c_str(), &image.width, &image.height, &image.channels, 0);
+        }
+
+        {
+            // 有界队列：GL线程来不及上传时阻塞解码线程，避免几十张4K图片同时躺在内存里
+            std::unique_lock<std::mutex> lock(decoded_mutex);
+            decoded_cv.wait(lock,
+                            [this] { return stopping || decoded_images.size() < decoded_capacity; });
+            if (stopping)
+            {
+                stbi_image_free(image.pixels);
+                return;
+            }
+            decoded_images.push_back(std::move(image));
+        }
+        decoded_cv.notify_all();
+    }
+}
+
+void ck::TextureLoader::fill_placeholder(const uint32_t texture_id)
+{
+    static const unsigned char placeholder_pixel[4] = {255, 255, 255, 255};
+
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    gl_state.bind_texture(0, GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder_pixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl_state.bind_texture(0, GL_TEXTURE_2D, 0);
+}
+
+uint32_t ck::TextureLoader::load_texture_async(const std::string& file_path,
+                                               const bool         gamma_correction)
+{
+    GLuint texture_id = 0;
+    glGenTextures(1, &texture_id);
+    fill_placeholder(texture_id);
+
+    const uint64_t ticket      = next_ticket++;
+    active_tickets[texture_id] = ticket;
+    ++pending_num;
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        requests.push_back({ticket, texture_id, file_path, gamma_correction});
+    }
+    request_cv.notify_one();
+
+    GL_CHECK();
+    return texture_id;
+}
+
+void ck::TextureLoader::cancel(const uint32_t texture_id)
+{
+    active_tickets.erase(texture_id);
+}
+
+void ck::TextureLoader::set_upload_callback(std::function<void(uint32_t, size_t)> callback)
+{
+    upload_callback = std::move(callback);
+}
+
+size_t ck::TextureLoader::upload(const DecodedImage& image)
+{
+    // 纹理已经被取消（或者纹理名已经被重新分配）
+    const auto ticket_it = active_tickets.find(image.texture_id);
+    if (ticket_it == active_tickets.end() || ticket_it->second != image.ticket) { return 0; }
+    active_tickets.erase(ticket_it);
+
+    if (image.pixels == nullptr)
+    {
+        LOG(WARNING) << "load texture failed: " << image.file_path << " | "
+                     << stbi_failure_reason();
+        return 0;  // 保留占位图
+    }
+
+    // 设置纹理内部格式
+    int32_t internal_format = 0;
+    GLenum  format          = 0;
+    if (image.channels == 1)
+    {
+        internal_format = GL_RED;
+        format          = GL_RED;
+    }
+    else if (image.channels == 3)
+    {
+        format = GL_RGB;
+        if (image.gamma_correction) { internal_format = GL_SRGB; }
+        else { internal_format = GL_RGB; }
+    }
+    else if (image.channels == 4)
+    {
+        format = GL_RGBA;
+        if (image.gamma_correction) { internal_format = GL_SRGB_ALPHA; }
+        else { internal_format = GL_RGBA; }
+    }
+    else
+    {
+        LOG(WARNING) << "no sutibale format for texture: " << image.file_path;
+        return 0;
+    }
+
+    // 经过PBO上传：像素先拷贝进驱动管理的缓冲，glTexImage2D从缓冲中异步读取
+    const auto image_size = static_cast<GLsizeiptr>(image.width) * image.height * image.channels;
+    GLStateCache& gl_state = GLStateCache::get_instance();
+    if (!pixel_unpack_buffer.is_valid())
+    {
+        pixel_unpack_buffer.create("texture upload PBO", "TextureLoader");
+    }
+    gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, pixel_unpack_buffer.get());
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, image_size, nullptr, GL_STREAM_DRAW);  // orphan
+    pixel_unpack_buffer.set_bytes(static_cast<size_t>(image_size));
+    void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image_size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (ptr != nullptr)
+    {
+        memcpy(ptr, image.pixels, image_size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else { gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0); }  // 映射失败时直接从内存上传
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // RGB图片的行不一定是4B对齐的
+    gl_state.bind_texture(0, GL_TEXTURE_2D, image.texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0, format,
+                 GL_UNSIGNED_BYTE, (ptr != nullptr) ? nullptr : image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    gl_state.bind_texture(0, GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // 显存占用估算：RGB通常按RGBA存储，完整的mipmap链约为第0层的4/3
+    const size_t texel_size = (image.channels == 1) ? 1 : 4;
+    const size_t resident_size =
+        static_cast<size_t>(image.width) * image.height * texel_size * 4 / 3;
+    if (upload_callback) { upload_callback(image.texture_id, resident_size); }
+
+    GL_CHECK();
+    return resident_size;
+}
+
+uint32_t ck::TextureLoader::process_uploads(const size_t byte_budget)
+{
+    uint32_t uploaded_num  = 0;
+    size_t   uploaded_size = 0;
+    while (uploaded_size < byte_budget)
+    {
+        DecodedImage image;
+        {
+            std::lock_guard<std::mutex> lock(decoded_mutex);
+            if (decoded_images.empty()) { break; }
+            image = std::move(decoded_images.front());
+            decoded_images.pop_front();
+        }
+        decoded_cv.notify_all();  // 队列有空位了
+
+        if (upload(image) > 0) { ++uploaded_num; }
+        uploaded_size += static_cast<size_t>(image.width) * image.height * image.channels;
+        stbi_image_free(image.pixels);
+        --pending_num;
+    }
+    return uploaded_num;
+}
+
+void ck::TextureLoader::wait_all()
+{
+    while (pending_num > 0)
+    {
+        process_uploads(SIZE_MAX);
+        if (pending_num == 0) { break; }
+
+        std::unique_lock<std::mutex> lock(decoded_mutex);
+        decoded_cv.wait_for(lock, std::chrono::milliseconds(10),
+                            [this] { return stopping || !decoded_images.empty(); });
+        if (stopping) { break; }
+    }
+}
+
+[[nodiscard]] uint32_t ck::TextureLoader::get_pending_num() const
+{
+    return pending_num;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/ck_gl_resource.h"
+
+namespace ck {
+
+static const size_t DEFAULT_DECODED_QUEUE_CAPACITY = 8;                 // 最多缓存8张已解码图片
+static const size_t DEFAULT_UPLOAD_BUDGET_BYTES    = 32 * 1024 * 1024;  // 每帧最多上传32MB
+
+/// @brief 异步纹理加载器
+/// @note 设计成单例类，工作线程用stb解码图片，GL线程通过PBO上传
+/**NOTE - 加载流程
+1. GL线程调用load_texture_async()：立刻创建纹理对象，填入1x1的占位图，并提交解码请求
+2. 工作线程从请求队列取出请求，用stb解码，放进有界的已解码队列（队列满时阻塞，限制内存占用）
+3. GL线程每帧调用process_uploads()：在字节预算内取出已解码图片，经过PBO上传到同一个纹理对象
+
+纹理id从一开始就是有效的，上传完成前采样到的是占位图，调用者不需要关心纹理是否已经驻留。
+*/
+class TextureLoader {
+private:
+    struct DecodeRequest
+    {
+        uint64_t    ticket;
+        uint32_t    texture_id;
+        std::string file_path;
+        bool        gamma_correction;
+    };
+
+    struct DecodedImage
+    {
+        uint64_t       ticket;
+        uint32_t       texture_id;
+        std::string    file_path;
+        bool           gamma_correction;
+        int32_t        width;
+        int32_t        height;
+        int32_t        channels;
+        unsigned char* pixels;  // stbi_load分配，上传后由GL线程释放
+    };
+
+    std::vector<std::thread> workers;
+    bool                     stopping;
+
+    std::mutex                request_mutex;
+    std::condition_variable   request_cv;
+    std::deque<DecodeRequest> requests;
+
+    std::mutex               decoded_mutex;
+    std::condition_variable  decoded_cv;
+    std::deque<DecodedImage> decoded_images;
+    size_t                   decoded_capacity;
+
+    std::atomic<uint32_t> pending_num;
+    GLBuffer              pixel_unpack_buffer;
+
+    // 以下成员只在GL线程访问
+    uint64_t                               next_ticket;
+    std::unordered_map<uint32_t, uint64_t> active_tickets;  // texture id -> ticket
+    std::function<void(uint32_t, size_t)>  upload_callback;
+    /**NOTE - ticket
+    纹理被释放后，GL可能把同一个名字分配给新的纹理。
+    用ticket区分同一个纹理id上的不同请求，过期的解码结果直接丢弃，不会覆盖新的纹理。
+    */
+
+    static TextureLoader* singleton;
+    // NOTE - 故意不释放：Model可能在静态析构阶段才释放纹理，单例必须比所有Model活得久
+    explicit TextureLoader(uint32_t worker_num);
+
+    void   worker_loop();
+    size_t upload(const DecodedImage& image);
+
+    static void fill_placeholder(uint32_t texture_id);
+
+public:
+    static TextureLoader& get_instance();
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&)            = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    /// @brief 创建纹理对象并提交异步解码（只能在GL线程调用）
+    /// @return 立刻可用的纹理id，上传完成前内容是占位图
+    uint32_t load_texture_async(const std::string& file_path, bool gamma_correction);
+
+    /// @brief 上传已经解码完成的图片（只能在GL线程调用）
+    /// @return 本次上传的纹理数量
+    uint32_t process_uploads(size_t byte_budget = DEFAULT_UPLOAD_BUDGET_BYTES);
+
+    /// @brief 取消一个尚未上传的纹理，之后可以安全地删除这个纹理对象（只能在GL线程调用）
+    void cancel(uint32_t texture_id);
+
+    /// @brief 每个纹理上传完成后回调(texture_id, 显存占用字节数)
+    void set_upload_callback(std::function<void(uint32_t, size_t)> callback);
+
+    /// @brief 阻塞直到所有已提交的纹理都上传完成（只能在GL线程调用）
+    void wait_all();
+
+    /// @brief 停止工作线程并释放PBO，需要在销毁GL上下文之前调用
+    void shutdown();
+
+    [[nodiscard]] uint32_t get_pending_num() const;
+};
+
+};  // namespace ck
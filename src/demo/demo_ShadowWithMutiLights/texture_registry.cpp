@@ -0,0 +1,113 @@
+#include "texture_registry.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "texture_loader.h"
+
+ck::TextureRegistry* ck::TextureRegistry::singleton = nullptr;
+
+bool ck::TextureRegistry::TextureKey::operator==(const TextureKey& other) const
+{
+    return srgb == other.srgb && canonical_path == other.canonical_path;
+}
+
+size_t ck::TextureRegistry::TextureKeyHash::operator()(const TextureKey& key) const
+{
+    return std::hash<std::string>()(key.canonical_path) ^ static_cast<size_t>(key.srgb);
+}
+
+ck::TextureRegistry& ck::TextureRegistry::get_instance()
+{
+    if (singleton == nullptr) { singleton = new TextureRegistry(); }
+    return *singleton;
+}
+
+ck::TextureRegistry::TextureRegistry() : resident_bytes(0)
+{
+    TextureLoader::get_instance().set_upload_callback(
+        [this](const uint32_t texture_id, const size_t bytes) {
+            on_texture_resident(texture_id, bytes);
+        });
+}
+
+std::string ck::TextureRegistry::canonicalize_path(const std::string& file_path)
+{
+    // NOTE - "a/../b/wood.jpg" 和 "b/wood.jpg" 应该命中同一个纹理
+    std::error_code error;
+    const auto      canonical_path = std::filesystem::weakly_canonical(file_path, error);
+    if (error) { return std::filesystem::path(file_path).lexically_normal().generic_string(); }
+    return canonical_path.generic_string();
+}
+
+uint32_t ck::TextureRegistry::acquire(const std::string& file_path,
+                                      const bool         srgb,
+                                      const std::string& owner)
+{
+    TextureKey key = {canonicalize_path(file_path), srgb};
+
+    auto it = textures.find(key);
+    if (it != textures.end())
+    {
+        it->second.ref_count++;
+        return it->second.texture.get();
+    }
+
+    LOG(INFO) << "load texture from file: " << key.canonical_path;
+    const uint32_t texture_id = TextureLoader::get_instance().load_texture_async(file_path, srgb);
+    TextureEntry   entry;
+    entry.texture.adopt(texture_id, std::filesystem::path(file_path).filename().string(), owner);
+    entry.ref_count      = 1;
+    entry.resident_bytes = 0;
+    texture_keys.emplace(texture_id, key);
+    textures.emplace(std::move(key), std::move(entry));
+    return texture_id;
+}
+
+void ck::TextureRegistry::release(const uint32_t texture_id)
+{
+    const auto key_it = texture_keys.find(texture_id);
+    if (key_it == texture_keys.end())
+    {
+        LOG(WARNING) << "release a texture that is not in the registry: " << texture_id;
+        return;
+    }
+
+    auto it = textures.find(key_it->second);
+    if (--(it->second.ref_count) > 0) { return; }
+
+    // 最后一个使用者：取消尚未完成的上传，再删除纹理对象（随entry一起析构）
+    TextureLoader::get_instance().cancel(texture_id);
+    resident_bytes -= it->second.resident_bytes;
+    textures.erase(it);
+    texture_keys.erase(key_it);
+}
+
+void ck::TextureRegistry::on_texture_resident(const uint32_t texture_id, const size_t bytes)
+{
+    const auto key_it = texture_keys.find(texture_id);
+    if (key_it == texture_keys.end()) { return; }
+    auto& entry           = textures.at(key_it->second);
+    resident_bytes       += bytes - entry.resident_bytes;
+    entry.resident_bytes  = bytes;
+    entry.texture.set_bytes(bytes);
+}
+
+[[nodiscard]] size_t ck::TextureRegistry::get_texture_num() const
+{
+    return textures.size();
+}
+
+[[nodiscard]] size_t ck::TextureRegistry::get_resident_bytes() const
+{
+    return resident_bytes;
+}
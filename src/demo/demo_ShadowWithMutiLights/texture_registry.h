@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "core/ck_gl_resource.h"
+
+namespace ck {
+
+/// @brief 进程内共享的纹理注册表
+/// @note 设计成单例类，所有Model通过它获取纹理
+/**NOTE - 纹理的引用计数
+以 (规范化路径, 颜色空间) 作为键，同一张图片在sRGB和线性空间下是两个不同的纹理。
+acquire()命中时只增加引用计数，不会重复解码和上传；
+release()让引用计数减一，归零时删除GL纹理对象。
+纹理对象登记在GLResourceRegistry中，显存算在第一个获取它的资源名下。
+*/
+class TextureRegistry {
+private:
+    struct TextureKey
+    {
+        std::string canonical_path;
+        bool        srgb;
+
+        bool operator==(const TextureKey& other) const;
+    };
+
+    struct TextureKeyHash
+    {
+        size_t operator()(const TextureKey& key) const;
+    };
+
+    struct TextureEntry
+    {
+        GLTexture texture;  // 由TextureLoader生成，注册表接管
+        uint32_t  ref_count;
+        size_t    resident_bytes;  // 上传完成前为0
+    };
+
+    std::unordered_map<TextureKey, TextureEntry, TextureKeyHash> textures;
+    std::unordered_map<uint32_t, TextureKey>                     texture_keys;  // id -> key
+    size_t                                                       resident_bytes;
+
+    static TextureRegistry* singleton;
+    // NOTE - 故意不释放：Model可能在静态析构阶段才释放纹理，单例必须比所有Model活得久
+    TextureRegistry();
+
+    void on_texture_resident(uint32_t texture_id, size_t bytes);
+
+    [[nodiscard]] static std::string canonicalize_path(const std::string& file_path);
+
+public:
+    static TextureRegistry& get_instance();
+
+    TextureRegistry(const TextureRegistry&)            = delete;
+    TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+    /// @brief 获取纹理并增加引用计数，首次获取时异步加载（只能在GL线程调用）
+    /// @param owner 显存统计中纹理所属的资源，只在首次获取时记录
+    uint32_t acquire(const std::string& file_path, bool srgb, const std::string& owner);
+
+    /// @brief 减少引用计数，归零时释放GL纹理（只能在GL线程调用）
+    void release(uint32_t texture_id);
+
+    [[nodiscard]] size_t get_texture_num() const;
+    [[nodiscard]] size_t get_resident_bytes() const;
+};
+
+};  // namespace ck
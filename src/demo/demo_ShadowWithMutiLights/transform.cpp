@@ -0,0 +1,86 @@
+#include "transform.h"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/glm.hpp>
+
+ck::Transform::Transform()
+    : position(0), rotation(0), scale(1), local_matrix(1), world_matrix(1), local_dirty(false),
+      world_dirty(true)
+{
+}
+
+void ck::Transform::set_position(const glm::vec3& position)
+{
+    this->position = position;
+    local_dirty    = true;
+    world_dirty    = true;
+}
+
+void ck::Transform::set_rotation(const glm::vec3& rotation)
+{
+    this->rotation = rotation;
+    local_dirty    = true;
+    world_dirty    = true;
+}
+
+void ck::Transform::set_scale(const glm::vec3& scale)
+{
+    this->scale = scale;
+    local_dirty = true;
+    world_dirty = true;
+}
+
+void ck::Transform::mark_world_dirty()
+{
+    world_dirty = true;
+}
+
+void ck::Transform::update_world_matrix(const glm::mat4* parent_world)
+{
+    if (local_dirty)
+    {
+        local_matrix = glm::translate(glm::mat4(1), position);
+        local_matrix = glm::rotate(local_matrix, rotation.x, glm::vec3(1, 0, 0));
+        local_matrix = glm::rotate(local_matrix, rotation.y, glm::vec3(0, 1, 0));
+        local_matrix = glm::rotate(local_matrix, rotation.z, glm::vec3(0, 0, 1));
+        local_matrix = glm::scale(local_matrix, scale);
+        local_dirty  = false;
+    }
+    world_matrix = (parent_world == nullptr) ? local_matrix : (*parent_world) * local_matrix;
+    world_dirty  = false;
+}
+
+[[nodiscard]] const glm::vec3& ck::Transform::get_position() const
+{
+    return position;
+}
+
+[[nodiscard]] const glm::vec3& ck::Transform::get_rotation() const
+{
+    return rotation;
+}
+
+[[nodiscard]] const glm::vec3& ck::Transform::get_scale() const
+{
+    return scale;
+}
+
+[[nodiscard]] const glm::mat4& ck::Transform::get_local_matrix() const
+{
+    return local_matrix;
+}
+
+[[nodiscard]] const glm::mat4& ck::Transform::get_world_matrix() const
+{
+    return world_matrix;
+}
+
+[[nodiscard]] glm::vec3 ck::Transform::get_world_position() const
+{
+    return glm::vec3(world_matrix[3]);
+}
+
+[[nodiscard]] bool ck::Transform::is_world_dirty() const
+{
+    return world_dirty;
+}
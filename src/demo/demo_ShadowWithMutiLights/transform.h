@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace ck {
+
+/// @brief 变换组件：保存局部TRS，并缓存局部/世界矩阵
+/**NOTE - 脏标记
+set_xxx()只修改TRS并打上标记，不做任何矩阵运算。
+local_dirty：TRS改变，下一次更新时需要重新计算局部矩阵
+world_dirty：自身或者祖先改变，下一次更新时需要重新计算世界矩阵
+矩阵由Scene::update_transforms()每帧统一更新一次，没有改变的物体不产生任何矩阵运算。
+*/
+class Transform {
+private:
+    glm::vec3 position;
+    glm::vec3 rotation;  // 欧拉角（弧度），按X -> Y -> Z的顺序旋转
+    glm::vec3 scale;
+
+    glm::mat4 local_matrix;
+    glm::mat4 world_matrix;
+    bool      local_dirty;
+    bool      world_dirty;
+
+public:
+    Transform();
+
+    void set_position(const glm::vec3& position);
+    void set_rotation(const glm::vec3& rotation);
+    void set_scale(const glm::vec3& scale);
+    /// @brief 祖先的世界矩阵改变，或者换了父节点
+    void mark_world_dirty();
+
+    /// @brief 重新计算世界矩阵（局部矩阵只在TRS改变时重新计算）
+    /// @param parent_world 父节点的世界矩阵，根节点传nullptr
+    void update_world_matrix(const glm::mat4* parent_world);
+
+    [[nodiscard]] const glm::vec3& get_position() const;
+    [[nodiscard]] const glm::vec3& get_rotation() const;
+    [[nodiscard]] const glm::vec3& get_scale() const;
+    [[nodiscard]] const glm::mat4& get_local_matrix() const;
+    [[nodiscard]] const glm::mat4& get_world_matrix() const;
+    [[nodiscard]] glm::vec3        get_world_position() const;
+    [[nodiscard]] bool             is_world_dirty() const;
+};
+
+};  // namespace ck
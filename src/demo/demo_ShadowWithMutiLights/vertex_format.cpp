@@ -0,0 +1,199 @@
+#include "vertex_format.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include <glad/glad.h>  //glad first
+
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glog/logging.h>
+
+#include "core/ck_debug.h"
+
+namespace {
+
+const glm::vec3 DEFAULT_NORMAL   = glm::vec3(0.0F, 0.0F, 1.0F);
+const glm::vec3 DEFAULT_TANGENT  = glm::vec3(1.0F, 0.0F, 0.0F);
+const float     MIN_DIRECTION_L1 = 1e-6F;
+
+/// @brief 零向量或含NaN的方向（退化uv生成的切线）换成默认方向，否则八面体编码会除以0
+inline glm::vec3 sanitize_direction(const glm::vec3& v, const glm::vec3& fallback)
+{
+    const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    return (std::isfinite(l1) && l1 > MIN_DIRECTION_L1) ? v : fallback;
+}
+
+inline glm::vec3 to_glm(const aiVector3D& v)
+{
+    return {v.x, v.y, v.z};
+}
+
+/// @brief 副切线相对于 cross(normal, tangent) 的朝向
+inline float bitangent_sign(const glm::vec3& normal,
+                            const glm::vec3& tangent,
+                            const glm::vec3& bitangent)
+{
+    return (glm::dot(glm::cross(normal, tangent), bitangent) < 0.0F) ? -1.0F : 1.0F;
+}
+
+}  // namespace
+
+glm::vec2 ck::oct_encode(glm::vec3 n)
+{
+    n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0F)
+    {
+        // 下半球沿对角线折叠到外侧
+        const float sign_x = (p.x >= 0.0F) ? 1.0F : -1.0F;
+        const float sign_y = (p.y >= 0.0F) ? 1.0F : -1.0F;
+        p = glm::vec2((1.0F - std::abs(n.y)) * sign_x, (1.0F - std::abs(n.x)) * sign_y);
+    }
+    return p;
+}
+
+uint32_t ck::get_vertex_stride(const VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::FLOAT32: return sizeof(Float32Vertex);
+        case VertexFormat::HALF16:
+        case VertexFormat::SNORM16: return sizeof(QuantizedVertex);
+    }
+    return 0;
+}
+
+ck::DequantBox
+ck::pack_vertices(const aiMesh* mesh, const VertexFormat format, std::vector<uint8_t>& out_data)
+{
+    const uint32_t vertex_num = mesh->mNumVertices;
+    const bool     has_uv     = mesh->HasTextureCoords(0);
+    const bool     has_normal = mesh->mNormals != nullptr;
+    const bool     has_tangent =
+        mesh->mTangents != nullptr && mesh->mBitangents != nullptr;  // 没有uv时不会生成切线
+
+    // 计算包围盒，量化格式把位置归一化到[-1, 1]
+    DequantBox dequant_box;
+    if (format != VertexFormat::FLOAT32 && vertex_num > 0)
+    {
+        glm::vec3 box_min = to_glm(mesh->mVertices[0]);
+        glm::vec3 box_max = box_min;
+        for (uint32_t i = 1; i < vertex_num; i++)
+        {
+            box_min = glm::min(box_min, to_glm(mesh->mVertices[i]));
+            box_max = glm::max(box_max, to_glm(mesh->mVertices[i]));
+        }
+        dequant_box.offset = (box_min + box_max) * 0.5F;
+        dequant_box.scale  = glm::max((box_max - box_min) * 0.5F, glm::vec3(1e-6F));
+        // NOTE - 退化的轴（比如平面的厚度）也要保证scale非零
+    }
+
+    const uint32_t stride = get_vertex_stride(format);
+    out_data.resize(static_cast<size_t>(vertex_num) * stride);
+
+    for (uint32_t i = 0; i < vertex_num; i++)
+    {
+        const glm::vec3 position = to_glm(mesh->mVertices[i]);
+        const glm::vec3 normal =
+            has_normal ? sanitize_direction(to_glm(mesh->mNormals[i]), DEFAULT_NORMAL)
+                       : DEFAULT_NORMAL;
+        const glm::vec3 tangent =
+            has_tangent ? sanitize_direction(to_glm(mesh->mTangents[i]), DEFAULT_TANGENT)
+                        : DEFAULT_TANGENT;
+        const float     sign =
+            has_tangent ? bitangent_sign(normal, tangent, to_glm(mesh->mBitangents[i])) : 1.0F;
+        const glm::vec2 tex_coord =
+            has_uv ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y)
+                   : glm::vec2(0.0F);
+
+        const uint32_t packed_normal  = glm::packSnorm2x16(oct_encode(normal));
+        const uint32_t packed_tangent = glm::packSnorm2x16(oct_encode(tangent));
+        uint8_t* const dst            = out_data.data() + static_cast<size_t>(i) * stride;
+
+        if (format == VertexFormat::FLOAT32)
+        {
+            Float32Vertex vertex{};
+            vertex.position[0] = position.x;
+            vertex.position[1] = position.y;
+            vertex.position[2] = position.z;
+            vertex.position[3] = sign;
+            vertex.normal      = packed_normal;
+            vertex.texCoord[0] = tex_coord.x;
+            vertex.texCoord[1] = tex_coord.y;
+            vertex.tangent     = packed_tangent;
+            memcpy(dst, &vertex, sizeof(vertex));
+        }
+        else
+        {
+            const glm::vec4 quantized_position(
+                glm::clamp((position - dequant_box.offset) / dequant_box.scale, -1.0F, 1.0F), sign);
+            const uint64_t packed_position = (format == VertexFormat::HALF16)
+                                                 ? glm::packHalf4x16(quantized_position)
+                                                 : glm::packSnorm4x16(quantized_position);
+
+            QuantizedVertex vertex{};
+            memcpy(vertex.position, &packed_position, sizeof(vertex.position));
+            vertex.normal   = packed_normal;
+            vertex.texCoord = glm::packHalf2x16(tex_coord);
+            vertex.tangent  = packed_tangent;
+            memcpy(dst, &vertex, sizeof(vertex));
+        }
+    }
+
+    if (!has_normal || !has_tangent)
+    {
+        LOG(WARNING) << "mesh has no normals/tangents, default values are packed instead";
+    }
+    return dequant_box;
+}
+
+void ck::setup_vertex_attributes(const VertexFormat format)
+{
+    const auto stride = static_cast<GLsizei>(get_vertex_stride(format));
+
+    if (format == VertexFormat::FLOAT32)
+    {
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void*)offsetof(Float32Vertex, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+                              (void*)offsetof(Float32Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride,
+                              (void*)offsetof(Float32Vertex, texCoord));
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride,
+                              (void*)offsetof(Float32Vertex, tangent));
+    }
+    else
+    {
+        // NOTE - snorm16在GL中归一化到[-1, 1]，half直接按浮点读取
+        if (format == VertexFormat::HALF16)
+        {
+            glVertexAttribPointer(0, 4, GL_HALF_FLOAT, GL_FALSE, stride,
+                                  (void*)offsetof(QuantizedVertex, position));
+        }
+        else
+        {
+            glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, stride,
+                                  (void*)offsetof(QuantizedVertex, position));
+        }
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+                              (void*)offsetof(QuantizedVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                              (void*)offsetof(QuantizedVertex, texCoord));
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride,
+                              (void*)offsetof(QuantizedVertex, tangent));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    glDisableVertexAttribArray(4);  // 副切线在着色器中重建
+
+    GL_CHECK();
+}
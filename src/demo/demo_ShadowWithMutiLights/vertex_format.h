@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vector>
+
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+
+namespace ck {
+
+/**NOTE - 顶点格式
+所有格式都是交错存储（interleaved）的单一顶点流，对应stdVerShader.vs.glsl中的同一套attribute：
+    location 0: vec4 aPos        xyz为量化空间中的位置，w为副切线的符号（±1）
+    location 1: vec2 aNormal     八面体编码（octahedral）的法线
+    location 2: vec2 aTexCoord   纹理坐标
+    location 3: vec2 aTangent    八面体编码的切线
+副切线不再上传，在着色器中由 cross(normal, tangent) * sign 重建。
+位置在着色器中通过 aPos.xyz * dequantScale + dequantOffset 反量化。
+*/
+enum class VertexFormat : uint32_t {
+    FLOAT32 = 0,  // float位置 + float纹理坐标，32B，精度最高
+    HALF16  = 1,  // half位置（相对于包围盒归一化）+ half纹理坐标，20B
+    SNORM16 = 2   // snorm16位置（相对于包围盒归一化）+ half纹理坐标，20B
+};
+
+struct Float32Vertex
+{
+    float    position[4];  // xyz + bitangent sign
+    uint32_t normal;       // snorm16x2 octahedral
+    float    texCoord[2];
+    uint32_t tangent;  // snorm16x2 octahedral
+};
+static_assert(sizeof(Float32Vertex) == 32, "Float32Vertex must be tightly packed");
+
+struct QuantizedVertex
+{
+    uint16_t position[4];  // half4 or snorm16x4, xyz + bitangent sign
+    uint32_t normal;       // snorm16x2 octahedral
+    uint32_t texCoord;     // half2
+    uint32_t tangent;      // snorm16x2 octahedral
+};
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must be tightly packed");
+
+/// @brief 顶点位置的反量化参数：position = quantized * scale + offset
+struct DequantBox
+{
+    glm::vec3 offset{0.0F};
+    glm::vec3 scale{1.0F};
+};
+
+[[nodiscard]] uint32_t get_vertex_stride(VertexFormat format);
+
+/// @brief 把aiMesh的顶点数据打包成指定格式的交错顶点流
+/// @return 用于在着色器中还原位置的反量化参数
+DequantBox pack_vertices(const aiMesh* mesh, VertexFormat format, std::vector<uint8_t>& out_data);
+
+/// @brief 按照顶点格式设置当前绑定VAO的attribute pointer（需要先绑定VAO和VBO）
+void setup_vertex_attributes(VertexFormat format);
+
+/// @brief 八面体编码，返回[-1, 1]范围内的二维坐标
+/// @note n的L1范数必须是大于0的有限值
+[[nodiscard]] glm::vec2 oct_encode(glm::vec3 n);
+
+};  // namespace ck